@@ -53,9 +53,33 @@ namespace sbn {
         );
     }
 
+    /// Children are executed immediately, hence they are generated in one loop.
+    class generator_kernel: public kernel {
+
+    public:
+
+        void act() override {
+            // The generator owns itself until the loop ends: the children
+            // return to it inline and it completes only after the last one.
+            kernel_ptr self(std::move(this_ptr()));
+            while (auto k = next_child()) { upstream<Local>(this, std::move(k)); }
+            this_ptr(&self);
+            complete_generator();
+        }
+
+        void react(kernel_ptr&& child) override { collect_child(std::move(child)); }
+
+    protected:
+        virtual kernel_ptr next_child() = 0;
+        virtual void collect_child(kernel_ptr&& child) = 0;
+        virtual void complete_generator() { commit<Local>(std::move(this_ptr())); }
+
+    };
+
 }
 #else
 #include <subordination/api.hh>
+#include <subordination/core/generator_kernel.hh>
 #endif
 
 #endif // vim:filetype=cpp
@@ -82,6 +82,8 @@ autoreg::Wave_surface_generator<T>::generate_parts() {
     const auto n1 = num_parts[1];
     const auto n2 = num_parts[2];
     const Index<3> index(num_parts);
+    auto& graph = this->_graph;
+    graph.clear();
     this->_parts.reserve(num_parts.product());
     for (uint32_t i=0; i<n0; ++i) {
         for (uint32_t j=0; j<n1; ++j) {
@@ -91,93 +93,83 @@ autoreg::Wave_surface_generator<T>::generate_parts() {
                 auto offset = min(begin, _phi_size);
                 auto end = where(ijk == num_parts-1, this->_zeta_size_full, begin+part_size);
                 this->_parts.emplace_back(begin-offset, offset, end, index(i,j,k));
+                // task identifier is the same as part index
+                graph.add((end-begin).product());
             }
         }
     }
-}
-
-template <class T> bool
-autoreg::Wave_surface_generator<T>::push_kernels() {
-    size3 part_size = min(this->_part_size, this->_zeta_size_full);
-    size3 num_parts = this->_zeta_size_full / part_size;
-    const auto n0 = num_parts[0];
-    const auto n1 = num_parts[1];
-    const auto n2 = num_parts[2];
-    const Index<3> index(num_parts);
-    uint32_t nfinished = 0, nsubmitted = 0;
+    // each part depends on the neighbouring parts with smaller indices
     for (uint32_t i=0; i<n0; ++i) {
         for (uint32_t j=0; j<n1; ++j) {
             for (uint32_t k=0; k<n2; ++k) {
-                auto& part = this->_parts[index(i,j,k)];
-                if (part.completed()) { ++nfinished; continue; }
-                if (part.submitted()) { ++nsubmitted; continue; }
-                int ncompleted = 0, ndependencies = 0;
                 auto nl = std::min(i+1, 2u);
                 auto nm = std::min(j+1, 2u);
                 auto nn = std::min(k+1, 2u);
                 for (uint32_t l=0; l<nl; ++l) {
                     for (uint32_t m=0; m<nm; ++m) {
                         for (uint32_t n=0; n<nn; ++n) {
-                            if (this->_parts[index(i-l,j-m,k-n)].completed()) {
-                                ++ncompleted;
-                            }
-                            ++ndependencies;
+                            if (l == 0 && m == 0 && n == 0) { continue; }
+                            graph.depends(index(i,j,k), index(i-l,j-m,k-n));
                         }
                     }
                 }
-                if (ncompleted == ndependencies-1) {
-                    //#if defined(AUTOREG_DEBUG)
-                    sys::log_message("autoreg", "submit _", part.begin_index());
-                    //#endif
-                    part.state(Part::State::Submitted);
-                    ++nsubmitted;
-                    auto k = sbn::make_pointer<Part_generator<T>>(
-                        part, _phi_size, this->_phi,
-                        this->_zeta[part.slice_in(this->_zeta_size_full)],
-                        this->_white_noise_variance, this->_seed);
-                    #if defined(AUTOREG_MPI)
-                    if (mpi::nranks != 1) {
-                        if (this->_subordinate == 0) { ++this->_subordinate; }
-                        /*if (this->_subordinate == 0) {
-                            k->act();
-                            react(std::move(k));
-                            ++nfinished;
-                        } else*/ {
-                            //this->_buffer.clear();
-                            auto old_position = this->_output_buffer.position();
-                            auto old_size = this->_output_buffer.size();
-                            k->write(this->_output_buffer);
-                            if (this->_output_buffer.size() != old_size) {
-                                sys::log_message("autoreg", "old-size _ new-size _", old_size, this->_output_buffer.size());
-                                throw std::runtime_error("buffer overflow");
-                            }
-                            auto req = mpi::async_send(
-                                this->_output_buffer.data()+old_position,
-                                int(this->_output_buffer.position() - old_position),
-                                this->_subordinate, tag_kernel);
-                            this->_requests.emplace_back(std::move(req),
-                                                         sbn::kernel_buffer());
-                        }
-                        if (++this->_subordinate == mpi::nranks) {
-                            this->_subordinate = 0;
-                        }
-                    } else {
-                        k->act();
-                        react(std::move(k));
-                        ++nfinished;
-                    }
-                    #else
-                    sbn::upstream<sbn::Remote>(this, std::move(k));
-                    #endif
-                }
             }
         }
     }
+    graph.prepare();
+}
+
+template <class T> bool
+autoreg::Wave_surface_generator<T>::push_kernels() {
+    auto& graph = this->_graph;
+    #if !defined(AUTOREG_MPI)
+    sbn::kernel_ptr_array kernels;
+    #endif
+    while (graph.has_ready()) {
+        auto& part = this->_parts[graph.pop_ready()];
+        //#if defined(AUTOREG_DEBUG)
+        sys::log_message("autoreg", "submit _", part.begin_index());
+        //#endif
+        part.state(Part::State::Submitted);
+        auto k = sbn::make_pointer<Part_generator<T>>(
+            part, _phi_size,
+            #if defined(AUTOREG_MPI)
+            this->_phi,
+            #else
+            this->_phi_id,
+            #endif
+            this->_zeta[part.slice_in(this->_zeta_size_full)],
+            this->_white_noise_variance, this->_seed);
+        #if defined(AUTOREG_MPI)
+        if (mpi::nranks != 1) {
+            if (this->_subordinate == 0) { ++this->_subordinate; }
+            auto old_position = this->_output_buffer.position();
+            auto old_size = this->_output_buffer.size();
+            k->write(this->_output_buffer);
+            if (this->_output_buffer.size() != old_size) {
+                sys::log_message("autoreg", "old-size _ new-size _", old_size, this->_output_buffer.size());
+                throw std::runtime_error("buffer overflow");
+            }
+            auto req = mpi::async_send(
+                this->_output_buffer.data()+old_position,
+                int(this->_output_buffer.position() - old_position),
+                this->_subordinate, tag_kernel);
+            this->_requests.emplace_back(std::move(req), sbn::kernel_buffer());
+            if (++this->_subordinate == mpi::nranks) {
+                this->_subordinate = 0;
+            }
+        } else {
+            k->act();
+            react(std::move(k));
+        }
+        #else
+        kernels.emplace_back(std::move(k));
+        #endif
+    }
     //#if defined(AUTOREG_DEBUG)
-    sys::log_message("autoreg", "completed _ of _, submitted _", nfinished,
-                     this->_parts.size(), nsubmitted);
+    sys::log_message("autoreg", "completed _ of _", graph.num_completed(), graph.size());
     //#endif
-    if (nfinished == this->_parts.size()) {
+    if (graph.done()) {
         #if defined(AUTOREG_MPI)
         for (int i=1; i<mpi::nranks; ++i) {
             mpi::send<int>(nullptr, 0, i, tag_terminate);
@@ -203,6 +195,8 @@ autoreg::Wave_surface_generator<T>::push_kernels() {
         k->read(this->_buffer);
         react(std::move(k));
         remove_completed_requests();
+        #else
+        sbn::upstream_many<sbn::Remote>(this, std::move(kernels));
         #endif
         return false;
     }
@@ -288,7 +282,15 @@ autoreg::Part_generator<T>::act() {
     const auto& offset = this->_part.offset();
     const Vector<int,3> size = this->_part.end_index() - this->_part.begin_index();
     auto& zeta = this->_zeta;
+    #if defined(AUTOREG_MPI)
     auto& phi = this->_phi;
+    #else
+    auto phi_object = sbn::factory.shared_objects().get(this->_phi);
+    if (phi_object->count<T>() != size_t(this->_phi_size.product())) {
+        throw std::runtime_error("bad number of AR coefficients");
+    }
+    const T* phi = phi_object->begin<T>();
+    #endif
     Index<3> zeta_index(size);
     Index<3> phi_index(this->_phi_size);
     const auto variance = this->_white_noise_variance;
@@ -435,6 +437,10 @@ autoreg::Wave_surface_generator<T>::act() {
     AUTOREG_MPI_SUBORDINATE(this->_phi.resize(this->_phi_size.product()););
     mpi::broadcast(&this->_phi[0], this->_phi.size());
     #endif
+    #if !defined(AUTOREG_MPI)
+    // the coefficients are sent to each node only once
+    this->_phi_id = sbn::factory.shared_objects().publish(this->_phi);
+    #endif
     AUTOREG_MPI_SUPERIOR(
         this->_zeta.resize(this->_zeta_size_full.product());
         //generate_white_noise(this->_zeta);
@@ -485,6 +491,7 @@ autoreg::Wave_surface_generator<T>::react(sbn::kernel_ptr&& child) {
         auto tmp = sbn::pointer_dynamic_cast<Part_generator<T>>(std::move(child));
         auto& part = this->_parts[tmp->part().index()];
         part.state(Part::State::Completed);
+        this->_graph.complete(tmp->part().index());
         this->_zeta[tmp->part().slice_out(this->_zeta_size_full)] =
             tmp->zeta()[tmp->part().slice_out()];
         using namespace std::chrono;
@@ -11,6 +11,9 @@
 
 #include <unistdx/ipc/process>
 
+#include <subordination/core/shared_object.hh>
+#include <subordination/core/task_graph.hh>
+
 #include <autoreg/domain.hh>
 #include <autoreg/mapreduce.hh>
 #include <autoreg/valarray_ext.hh>
@@ -145,7 +148,12 @@ namespace autoreg {
     private:
         Part _part;
         size3 _phi_size;
+        #if defined(AUTOREG_MPI)
         std::valarray<T> _phi;
+        #else
+        /// AR coefficients are published once by the generator.
+        sbn::shared_object_id _phi;
+        #endif
         std::valarray<T> _zeta;
         T _white_noise_variance;
         uint64_t _seed = 0;
@@ -153,11 +161,21 @@ namespace autoreg {
     public:
         Part_generator() = default;
 
+        #if defined(AUTOREG_MPI)
         inline explicit
         Part_generator(const Part& part, const size3& phi_size, const std::valarray<T>& phi,
                        std::valarray<T>&& zeta, T white_noise_variance, uint64_t seed):
         _part(part), _phi_size(phi_size), _phi(phi), _zeta(std::move(zeta)),
         _white_noise_variance(white_noise_variance), _seed(seed) {}
+        #else
+        inline explicit
+        Part_generator(const Part& part, const size3& phi_size, sbn::shared_object_id phi,
+                       std::valarray<T>&& zeta, T white_noise_variance, uint64_t seed):
+        _part(part), _phi_size(phi_size), _phi(phi), _zeta(std::move(zeta)),
+        _white_noise_variance(white_noise_variance), _seed(seed) {
+            add_shared_object(phi);
+        }
+        #endif
 
         void act() override;
         void write(sbn::kernel_buffer& out) const override;
@@ -203,11 +221,15 @@ namespace autoreg {
     private:
         std::valarray<T> _phi;
         size3 _phi_size;
+        #if !defined(AUTOREG_MPI)
+        sbn::shared_object_id _phi_id = 0;
+        #endif
         T _white_noise_variance;
         size3 _zeta_size_full;
         size3 _zeta_size;
         size3 _part_size;
         std::vector<Part> _parts;
+        sbn::task_graph _graph;
         std::valarray<T> _zeta;
         uint64_t _seed = 0;
         std::array<time_point,4> _time_points;
@@ -7,11 +7,12 @@ namespace sbn {
 
     class Notification: public kernel {};
 
+    /// Workers are created on demand when the previous ones return.
     template<class F, class G, class I>
-    struct Map: public kernel {
+    struct Map: public generator_kernel {
 
         Map(F f_, G g_, I a_, I b_, I bs_=1):
-        f(f_), g(g_), a(a_), b(b_), bs(bs_), n(0), m(calc_m()) {}
+        f(f_), g(g_), a(a_), b(b_), bs(bs_), next(a_) {}
 
         struct Worker: public kernel {
             Worker(F& f_, I a_, I b_):
@@ -26,31 +27,28 @@ namespace sbn {
             I a, b;
         };
 
-        void
-        act() override {
-            for (I i=a; i<b; i+=bs) {
-                upstream<Local>(this, sbn::make_pointer<Worker>(f, i, std::min(i+bs, b)));
-            }
+    protected:
+
+        kernel_ptr
+        next_child() override {
+            if (!(next < b)) { return nullptr; }
+            const I first = next;
+            next = std::min(next+bs, b);
+            return sbn::make_pointer<Worker>(f, first, next);
         }
 
         void
-        react(kernel_ptr&& k) override {
+        collect_child(kernel_ptr&& k) override {
             auto w = sbn::pointer_dynamic_cast<Worker>(std::move(k));
             I x1 = w->a, x2 = w->b;
             for (I i=x1; i<x2; ++i) g(i);
-            if (++n == m) { commit<Local>(std::move(this_ptr())); }
         }
 
     private:
 
-        I
-        calc_m() const {
-            return (b-a)/bs + ((b-a)%bs == 0 ? 0 : 1);
-        }
-
         F f;
         G g;
-        I a, b, bs, n, m;
+        I a, b, bs, next;
 
     };
 
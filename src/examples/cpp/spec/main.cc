@@ -14,6 +14,7 @@ main(int argc, char** argv) {
         factory.types().add<Spectrum_directory_kernel<T>>(2);
         factory.types().add<Five_files_kernel<T>>(3);
         factory.types().add<File_kernel<T>>(4);
+        factory.types().add<Variance_kernel<T>>(5);
     }
     factory_guard g;
     if (sbn::this_application::standalone()) {
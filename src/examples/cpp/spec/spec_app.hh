@@ -207,16 +207,19 @@ public:
     using Map = std::array<std::vector<T>,spec::max_variables>;
 
 private:
-    Map& _data;
+    Map _data;
     spec::Timestamp _date{};
-    const std::vector<T>& _frequencies;
+    /// Frequencies are published once for all kernels of the station.
+    sbn::shared_object_id _frequencies = 0;
     T _variance{};
 
 public:
 
-    Variance_kernel(Map& m, spec::Timestamp d, const std::vector<T>& freq):
-        _data(m), _date(d), _frequencies(freq), _variance(0)
-    {}
+    Variance_kernel() = default;
+
+    Variance_kernel(Map&& m, spec::Timestamp d, sbn::shared_object_id freq):
+        _data(std::move(m)), _date(d), _frequencies(freq), _variance(0)
+    { add_shared_object(freq); }
 
     void act() override {
         if (!std::getenv("SBN_TEST_NO_VARIANCE")) {
@@ -225,6 +228,18 @@ public:
         sbn::commit(std::move(this_ptr()));
     }
 
+    void write(sbn::kernel_buffer& out) const override {
+        sbn::kernel::write(out);
+        for (const auto& array : this->_data) { out << array; }
+        out << this->_date << this->_frequencies << this->_variance;
+    }
+
+    void read(sbn::kernel_buffer& in) override {
+        sbn::kernel::read(in);
+        for (auto& array : this->_data) { in >> array; }
+        in >> this->_date >> this->_frequencies >> this->_variance;
+    }
+
     T spectrum(int32_t i, T angle) {
         auto density = this->_data[DENSITY][i];
         auto r1 = this->_data[R_1][i];
@@ -239,7 +254,8 @@ public:
     T compute_variance() {
         const T theta0 = 0;
         const T theta1 = 2.0f*M_PI;
-        int32_t n = std::min(this->_frequencies.size(), this->_data[0].size());
+        auto frequencies = sbn::factory.shared_objects().get(this->_frequencies);
+        int32_t n = std::min(frequencies->count<T>(), this->_data[0].size());
         for (const auto& array : this->_data) {
             int32_t new_n = array.size();
             if (new_n < n) { n = new_n; }
@@ -484,11 +500,14 @@ public:
         if (this->_spectra.empty()) {
             sbn::commit<sbn::Remote>(std::move(this_ptr()));
         } else {
+            // the frequencies are the same for all dates
+            const auto frequencies = sbn::factory.shared_objects().publish(this->_frequencies);
+            sbn::kernel_ptr_array kernels;
             for (auto& pair : this->_spectra) {
-                auto k = sbn::make_pointer<Variance_kernel<T>>(
-                    pair.second, pair.first, _frequencies);
-                sbn::upstream(this, std::move(k));
+                kernels.emplace_back(sbn::make_pointer<Variance_kernel<T>>(
+                    std::move(pair.second), pair.first, frequencies));
             }
+            sbn::upstream_many(this, std::move(kernels));
         }
     }
 
@@ -1,7 +1,14 @@
 #ifndef SUBORDINATION_API_HH
 #define SUBORDINATION_API_HH
 
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <subordination/core/collective_kernel.hh>
 #include <subordination/core/factory.hh>
+#include <subordination/core/future.hh>
 #include <subordination/core/kernel_buffer.hh>
 #include <subordination/core/kernel_type_registry.hh>
 
@@ -30,10 +37,44 @@ namespace sbn {
         factory.remote().send(std::move(k));
     }
 
+    template <Target t=Target::Local>
+    inline void
+    send(kernel_ptr_array&& kernels) {
+        factory.local().send(std::move(kernels));
+    }
+
+    template <>
+    inline void
+    send<Local>(kernel_ptr_array&& kernels) {
+        factory.local().send(std::move(kernels));
+    }
+
+    template <>
+    inline void
+    send<Remote>(kernel_ptr_array&& kernels) {
+        factory.remote().send(std::move(kernels));
+    }
+
+    /**
+    Send the subordinate kernel \p rhs of the principal \p lhs.
+    \see make_subordinate
+    */
     template<Target target=Target::Local>
     void
     upstream(kernel* lhs, kernel_ptr&& rhs) {
-        rhs->parent(lhs);
+        make_subordinate(lhs, *rhs);
+        send<target>(std::move(rhs));
+    }
+
+    /**
+    \brief Send multiple subordinate kernels at once.
+    \details The pipeline is locked once for all kernels. The remote pipeline
+    writes the header and the parent id once for all kernels.
+    */
+    template<Target target=Target::Local>
+    void
+    upstream_many(kernel* lhs, kernel_ptr_array&& rhs) {
+        for (auto& k : rhs) { make_subordinate(lhs, *k); }
         send<target>(std::move(rhs));
     }
 
@@ -67,6 +108,22 @@ namespace sbn {
         send<target>(std::move(lhs));
     }
 
+    /**
+    \brief Cancel the kernel and all its subordinate kernels.
+    \details The subordinates that wait in the queues of the local and the remote
+    pipeline return to their parents with \link exit_code::cancelled\endlink exit
+    code. The subordinates that were sent to other cluster nodes are cancelled
+    there on a best-effort basis. Running kernels are not interrupted, they
+    should check \link kernel::cancelled\endlink periodically. The cancelled
+    kernel itself is not returned to its parent.
+    */
+    inline void
+    cancel(kernel* k) {
+        k->cancel();
+        factory.local().cancel();
+        factory.remote().cancel();
+    }
+
     struct factory_guard {
 
         inline
@@ -86,10 +143,416 @@ namespace sbn {
     template<class Pipeline>
     void
     upstream(Pipeline& ppl, kernel* lhs, kernel_ptr&& rhs) {
-        rhs->parent(lhs);
+        make_subordinate(lhs, *rhs);
         ppl.send(std::move(rhs));
     }
 
+    /**
+    Send the kernel to the target pipeline.
+    \return the future that is ready when the kernel returns
+    */
+    template <Target target=Target::Local, class K>
+    inline future<pointer<K>>
+    async(pointer<K>&& k) {
+        auto* parent = new promise_kernel<K>;
+        auto result = parent->get_future();
+        k->parent(parent);
+        send<target>(std::move(k));
+        return result;
+    }
+
+    /**
+    \brief The number of elements that are processed by one kernel.
+    \details Each upstream thread of the local pipeline gets four kernels
+    on average, so that the threads that finish early pick up the remaining ones.
+    */
+    template <class Index> inline Index
+    grain_size(Index n) {
+        const auto nthreads = std::max(factory.local().num_upstream_threads(), size_t(1));
+        return std::max(static_cast<Index>(n / static_cast<Index>(nthreads*4)), Index(1));
+    }
+
+    /// A part of the range that is processed by one kernel.
+    template <class Index>
+    class range_chunk: public kernel {
+
+    protected:
+        Index _first{}, _last{};
+
+    public:
+        range_chunk() = default;
+        inline range_chunk(Index first, Index last): _first(first), _last(last) {}
+        inline Index first() const noexcept { return this->_first; }
+        inline Index last() const noexcept { return this->_last; }
+
+        void write(kernel_buffer& out) const override {
+            kernel::write(out);
+            out << this->_first << this->_last;
+        }
+
+        void read(kernel_buffer& in) override {
+            kernel::read(in);
+            in >> this->_first >> this->_last;
+        }
+
+    };
+
+    /**
+    \brief Splits the range into chunks, sends chunk kernels to the target pipeline
+    and collects their results.
+    \details The number of chunks is computed before any of them is sent,
+    because the chunks may return before \link act\endlink finishes.
+    */
+    template <Target target, class Index, class Chunk, class Base>
+    class range_kernel: public Base {
+
+    protected:
+        Index _first{}, _last{}, _grain{};
+        size_t _num_chunks = 0, _num_completed = 0;
+
+    public:
+
+        template <class ... Args> inline
+        range_kernel(Index first, Index last, Index grain, Args&& ... args):
+        Base(std::forward<Args>(args)...), _first(first), _last(last), _grain(grain) {}
+
+        void act() override {
+            const Index n = this->_last > this->_first ? this->_last-this->_first : Index(0);
+            if (this->_grain <= Index(0)) { this->_grain = grain_size(n); }
+            this->_num_chunks = n/this->_grain + (n%this->_grain == 0 ? 0 : 1);
+            if (this->_num_chunks == 0) { commit<Local>(std::move(this->this_ptr())); return; }
+            kernel_ptr_array chunks;
+            chunks.reserve(this->_num_chunks);
+            for (Index i=0; i<n; i+=std::min(this->_grain, n-i)) {
+                const Index first = this->_first+i;
+                chunks.emplace_back(make_chunk(first, first+std::min(this->_grain, n-i)));
+            }
+            upstream_many<target>(this, std::move(chunks));
+        }
+
+        void react(kernel_ptr&& k) override {
+            auto c = pointer_dynamic_cast<Chunk>(std::move(k));
+            if (c->return_code() == exit_code::success) { collect(*c); }
+            else { this->return_code(c->return_code()); }
+            if (++this->_num_completed == this->_num_chunks) {
+                commit<Local>(std::move(this->this_ptr()));
+            }
+        }
+
+        inline Index first() const noexcept { return this->_first; }
+        inline Index last() const noexcept { return this->_last; }
+        inline Index grain() const noexcept { return this->_grain; }
+        inline size_t num_chunks() const noexcept { return this->_num_chunks; }
+
+    protected:
+        virtual pointer<Chunk> make_chunk(Index first, Index last) = 0;
+        virtual void collect(Chunk& chunk) = 0;
+
+    };
+
+    /// Completion of \link parallel_for\endlink.
+    class parallel_for_result: public kernel {};
+
+    /// The result of \link map\endlink.
+    template <class T>
+    class map_result: public kernel {
+    protected:
+        std::vector<T> _result;
+    public:
+        inline const std::vector<T>& result() const noexcept { return this->_result; }
+        inline std::vector<T>& result() noexcept { return this->_result; }
+    };
+
+    /// The result of \link map_reduce\endlink.
+    template <class T>
+    class map_reduce_result: public kernel {
+    protected:
+        T _result;
+    public:
+        inline explicit map_reduce_result(T init): _result(std::move(init)) {}
+        inline const T& result() const noexcept { return this->_result; }
+        inline T& result() noexcept { return this->_result; }
+    };
+
+    template <Target target, class Index, class Function>
+    class parallel_for_chunk: public range_chunk<Index> {
+
+    private:
+        Function _function;
+
+    public:
+        parallel_for_chunk() = default;
+
+        inline parallel_for_chunk(Index first, Index last, const Function& f):
+        range_chunk<Index>(first, last), _function(f) {}
+
+        void act() override {
+            for (Index i=this->_first; i<this->_last; ++i) { this->_function(i); }
+            commit<target>(std::move(this->this_ptr()));
+        }
+
+    };
+
+    template <Target target, class Index, class Function>
+    class parallel_for_kernel:
+    public range_kernel<target,Index,parallel_for_chunk<target,Index,Function>,
+                        parallel_for_result> {
+
+    public:
+        using chunk_type = parallel_for_chunk<target,Index,Function>;
+
+    private:
+        using base_type = range_kernel<target,Index,chunk_type,parallel_for_result>;
+
+    private:
+        Function _function;
+
+    public:
+        inline parallel_for_kernel(Index first, Index last, Function f, Index grain=Index(0)):
+        base_type(first, last, grain), _function(std::move(f)) {}
+
+    protected:
+        pointer<chunk_type> make_chunk(Index first, Index last) override {
+            return make_pointer<chunk_type>(first, last, this->_function);
+        }
+
+        void collect(chunk_type&) override {}
+
+    };
+
+    template <class Index, class Function>
+    using map_value_type = typename std::decay<
+        decltype(std::declval<Function&>()(std::declval<Index>()))>::type;
+
+    template <Target target, class Index, class Function>
+    class map_chunk: public range_chunk<Index> {
+
+    public:
+        using value_type = map_value_type<Index,Function>;
+
+    private:
+        Function _function;
+        std::vector<value_type> _result;
+
+    public:
+        map_chunk() = default;
+
+        inline map_chunk(Index first, Index last, const Function& f):
+        range_chunk<Index>(first, last), _function(f) {}
+
+        void act() override {
+            this->_result.reserve(this->_last-this->_first);
+            for (Index i=this->_first; i<this->_last; ++i) {
+                this->_result.emplace_back(this->_function(i));
+            }
+            commit<target>(std::move(this->this_ptr()));
+        }
+
+        inline std::vector<value_type>& result() noexcept { return this->_result; }
+
+        void write(kernel_buffer& out) const override {
+            range_chunk<Index>::write(out);
+            out << this->_result;
+        }
+
+        void read(kernel_buffer& in) override {
+            range_chunk<Index>::read(in);
+            in >> this->_result;
+        }
+
+    };
+
+    template <Target target, class Index, class Function>
+    class map_kernel:
+    public range_kernel<target,Index,map_chunk<target,Index,Function>,
+                        map_result<map_value_type<Index,Function>>> {
+
+    public:
+        using chunk_type = map_chunk<target,Index,Function>;
+        using value_type = typename chunk_type::value_type;
+
+    private:
+        using base_type = range_kernel<target,Index,chunk_type,map_result<value_type>>;
+
+    private:
+        Function _function;
+
+    public:
+        inline map_kernel(Index first, Index last, Function f, Index grain=Index(0)):
+        base_type(first, last, grain), _function(std::move(f)) {
+            if (last > first) { this->_result.resize(last-first); }
+        }
+
+    protected:
+        pointer<chunk_type> make_chunk(Index first, Index last) override {
+            return make_pointer<chunk_type>(first, last, this->_function);
+        }
+
+        void collect(chunk_type& c) override {
+            std::move(c.result().begin(), c.result().end(),
+                      this->_result.begin() + (c.first()-this->_first));
+        }
+
+    };
+
+    template <Target target, class Index, class T, class Map, class Reduce>
+    class map_reduce_chunk: public range_chunk<Index> {
+
+    private:
+        Map _map;
+        Reduce _reduce;
+        T _result{};
+
+    public:
+        map_reduce_chunk() = default;
+
+        inline map_reduce_chunk(Index first, Index last, const T& init,
+                                const Map& map, const Reduce& reduce):
+        range_chunk<Index>(first, last), _map(map), _reduce(reduce), _result(init) {}
+
+        void act() override {
+            for (Index i=this->_first; i<this->_last; ++i) {
+                this->_result = this->_reduce(std::move(this->_result), this->_map(i));
+            }
+            commit<target>(std::move(this->this_ptr()));
+        }
+
+        inline T& result() noexcept { return this->_result; }
+
+        void write(kernel_buffer& out) const override {
+            range_chunk<Index>::write(out);
+            out << this->_result;
+        }
+
+        void read(kernel_buffer& in) override {
+            range_chunk<Index>::read(in);
+            in >> this->_result;
+        }
+
+    };
+
+    /**
+    \brief Folds the mapped values of each chunk with \c reduce
+    and the results of the chunks with \c combine.
+    \details The chunks start from the initial value,
+    so it has to be the identity element of both functions.
+    */
+    template <Target target, class Index, class T, class Map, class Reduce, class Combine>
+    class map_reduce_kernel:
+    public range_kernel<target,Index,map_reduce_chunk<target,Index,T,Map,Reduce>,
+                        map_reduce_result<T>> {
+
+    public:
+        using chunk_type = map_reduce_chunk<target,Index,T,Map,Reduce>;
+
+    private:
+        using base_type = range_kernel<target,Index,chunk_type,map_reduce_result<T>>;
+
+    private:
+        T _init;
+        Map _map;
+        Reduce _reduce;
+        Combine _combine;
+
+    public:
+        inline map_reduce_kernel(Index first, Index last, T init, Map map, Reduce reduce,
+                                 Combine combine, Index grain=Index(0)):
+        base_type(first, last, grain, init), _init(std::move(init)), _map(std::move(map)),
+        _reduce(std::move(reduce)), _combine(std::move(combine)) {}
+
+    protected:
+        pointer<chunk_type> make_chunk(Index first, Index last) override {
+            return make_pointer<chunk_type>(first, last, this->_init, this->_map, this->_reduce);
+        }
+
+        void collect(chunk_type& c) override {
+            this->_result = this->_combine(std::move(this->_result), std::move(c.result()));
+        }
+
+    };
+
+    /**
+    Call \c f for each index in <code>[first,last)</code> in parallel.
+    The parent receives \link parallel_for_result\endlink when all calls finish.
+    Chunks are sent to the \c target pipeline; remote chunks are
+    default-constructed on the other node, so the function has to be
+    a stateless function object, and \link parallel_for_chunk\endlink
+    has to be registered in the kernel type registry.
+    Use the kernel classes directly to set grain size explicitly.
+    */
+    template <Target target=Target::Local, class Index, class Function>
+    inline void
+    parallel_for(kernel* parent, Index first, Index last, Function f) {
+        using kernel_type = parallel_for_kernel<target,Index,Function>;
+        upstream<Local>(parent, make_pointer<kernel_type>(first, last, std::move(f)));
+    }
+
+    /**
+    Compute <code>f(i)</code> for each index in <code>[first,last)</code> in parallel.
+    The parent receives \link map_result\endlink with the values in index order.
+    */
+    template <Target target=Target::Local, class Index, class Function>
+    inline void
+    map(kernel* parent, Index first, Index last, Function f) {
+        using kernel_type = map_kernel<target,Index,Function>;
+        upstream<Local>(parent, make_pointer<kernel_type>(first, last, std::move(f)));
+    }
+
+    /**
+    Fold <code>map(i)</code> for each index in <code>[first,last)</code> with
+    \c reduce in each chunk and combine the results of the chunks with \c combine.
+    The parent receives \link map_reduce_result\endlink.
+    */
+    template <Target target=Target::Local, class Index, class T,
+              class Map, class Reduce, class Combine>
+    inline void
+    map_reduce(kernel* parent, Index first, Index last, T init,
+               Map map, Reduce reduce, Combine combine) {
+        using kernel_type = map_reduce_kernel<target,Index,T,Map,Reduce,Combine>;
+        upstream<Local>(parent, make_pointer<kernel_type>(first, last, std::move(init),
+                                                          std::move(map), std::move(reduce),
+                                                          std::move(combine)));
+    }
+
+    /// Same as above, but \c reduce is used to combine the results of the chunks.
+    template <Target target=Target::Local, class Index, class T, class Map, class Reduce>
+    inline void
+    map_reduce(kernel* parent, Index first, Index last, T init, Map map, Reduce reduce) {
+        Reduce combine(reduce);
+        map_reduce<target>(parent, first, last, std::move(init), std::move(map),
+                           std::move(reduce), std::move(combine));
+    }
+
+
+    /**
+    Execute collective kernel \c k on every cluster node.
+    The kernel is copied along the edges of the node hierarchy, and
+    the parent receives the kernel when all nodes have finished.
+    The results of the copies are discarded.
+    */
+    template <class K>
+    inline void
+    broadcast(kernel* parent, pointer<K>&& k) {
+        static_assert(std::is_base_of<collective_kernel,K>::value,
+                      "broadcast requires collective kernel");
+        k->combine_results(false);
+        upstream<Remote>(parent, std::move(k));
+    }
+
+    /**
+    Execute collective kernel \c k on every cluster node and combine
+    partial results with \link collective_kernel::combine\endlink
+    on each node on the way back to the parent.
+    */
+    template <class K>
+    inline void
+    reduce(kernel* parent, pointer<K>&& k) {
+        static_assert(std::is_base_of<collective_kernel,K>::value,
+                      "reduce requires collective kernel");
+        k->combine_results(true);
+        upstream<Remote>(parent, std::move(k));
+    }
+
 }
 
 #endif // vim:filetype=cpp
@@ -125,6 +125,8 @@ sbn::operator<<(std::ostream& out, const application& rhs) {
         list("id", rhs._id),
         list("user-id", rhs._uid),
         list("group-id", rhs._gid),
+        list("priority", unsigned(rhs._priority)),
+        list("share", rhs._share),
         list("arguments", make_list_view(rhs._args)),
         //list("env", rhs._env),
         list("working-directory", make_string(rhs._working_directory)));
@@ -154,7 +156,8 @@ _env(env) {
     }
 }
 
-int sbn::application::execute(const sys::two_way_pipe& pipe) const {
+int sbn::application::execute(const sys::two_way_pipe& pipe,
+                               const string_array& daemon_env) const {
     sys::argstream args, env;
     for (const std::string& a : this->_args) {
         args.append(a);
@@ -162,6 +165,9 @@ int sbn::application::execute(const sys::two_way_pipe& pipe) const {
     for (const std::string& a : this->_env) {
         env.append(a);
     }
+    for (const std::string& a : daemon_env) {
+        env.append(a);
+    }
     // pass application ID
     env.append(generate_env(SUBORDINATION_ENV_APPLICATION_ID, this->_id));
     // pass in/out file descriptors
@@ -210,6 +216,7 @@ void sbn::application::write(kernel_buffer& out) const {
     write_vector(out, this->_args);
     write_vector(out, this->_env);
     out << this->_working_directory;
+    out << this->_priority << this->_share;
 }
 
 void sbn::application::read(kernel_buffer& in) {
@@ -217,6 +224,7 @@ void sbn::application::read(kernel_buffer& in) {
     read_vector(in, this->_args);
     read_vector(in, this->_env);
     in >> this->_working_directory;
+    in >> this->_priority >> this->_share;
 }
 
 sbn::kernel_buffer& sbn::operator<<(kernel_buffer& out, const application& rhs) {
@@ -19,6 +19,8 @@ namespace sbn {
     public:
         using id_type = sys::u64;
         using string_array = std::vector<std::string>;
+        using priority_type = sys::u8;
+        using share_type = sys::u32;
 
     private:
         id_type _id = 0;
@@ -27,6 +29,10 @@ namespace sbn {
         string_array _args, _env;
         sys::path _working_directory;
         bool _wait_for_completion = false;
+        /// Applications with higher priority are admitted to the node first.
+        priority_type _priority = 0;
+        /// Relative share of the node's threads among applications with the same priority.
+        share_type _share = 1;
 
         static_assert(sizeof(_uid) <= sizeof(uint32_t), "bad uid_type");
         static_assert(sizeof(_gid) <= sizeof(uint32_t), "bad gid_type");
@@ -72,7 +78,15 @@ namespace sbn {
             this->_wait_for_completion = rhs;
         }
 
-        int execute(const sys::two_way_pipe& pipe) const;
+        inline priority_type priority() const noexcept { return this->_priority; }
+        inline void priority(priority_type rhs) noexcept { this->_priority = rhs; }
+        inline share_type share() const noexcept { return this->_share; }
+        inline void share(share_type rhs) noexcept { this->_share = rhs; }
+
+        /**
+        \param[in] env additional environment variables that are set by the daemon
+        */
+        int execute(const sys::two_way_pipe& pipe, const string_array& env=string_array()) const;
 
         void write(kernel_buffer& out) const;
         void read(kernel_buffer& in);
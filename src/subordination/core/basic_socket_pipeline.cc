@@ -15,6 +15,7 @@ sbn::basic_socket_pipeline::basic_socket_pipeline(const properties& p):
 basic_socket_pipeline{} {
     this->_min_input_buffer_size = p.min_input_buffer_size;
     this->_min_output_buffer_size = p.min_output_buffer_size;
+    this->_max_kernels = p.max_kernels;
     this->_threads.cpus(p.cpus);
 }
 
@@ -22,11 +23,15 @@ void sbn::basic_socket_pipeline::loop() {
     lock_type lock(this->_mutex);
     while (!stopping()) {
         auto result = oldest_connection();
-        duration dt = std::chrono::seconds(999);
+        duration dt = this->_wakeup_interval;
         if (result != this->_connections.end()) {
-            dt = std::max((*result)->start_time_point() +
-                          connection_timeout() - clock_type::now(),
-                          duration::zero());
+            dt = std::min(dt, std::max((*result)->start_time_point() +
+                                       connection_timeout() - clock_type::now(),
+                                       duration::zero()));
+        }
+        const auto t = next_wakeup_time_point();
+        if (t != time_point::max()) {
+            dt = std::min(dt, std::max(t - clock_type::now(), duration::zero()));
         }
         try {
             poller().wait_for(lock, dt);
@@ -35,10 +40,15 @@ void sbn::basic_socket_pipeline::loop() {
             log("error _", err.what());
         }
         process_kernels();
+        if (this->_max_kernels != 0) { this->_producer_semaphore.notify_all(); }
         process_connections();
     }
 }
 
+auto sbn::basic_socket_pipeline::next_wakeup_time_point() const noexcept -> time_point {
+    return time_point::max();
+}
+
 void sbn::basic_socket_pipeline::process_connections() {
     handle_events();
     flush_buffers();
@@ -149,6 +159,7 @@ void sbn::basic_socket_pipeline::start() {
         #if defined(UNISTDX_HAVE_PRCTL)
         ::prctl(PR_SET_NAME, this->_name);
         #endif
+        is_pipeline_thread(true);
         if (this->_thread_init) { this->_thread_init(); }
         loop();
     });
@@ -160,6 +171,7 @@ void sbn::basic_socket_pipeline::stop() {
     this->setstate(states::stopping);
     for (auto& conn : this->_connections) { if (conn) { conn->stop(); } }
     this->_semaphore.notify_all();
+    this->_producer_semaphore.notify_all();
 }
 
 void sbn::basic_socket_pipeline::wait() {
@@ -181,6 +193,62 @@ void sbn::basic_socket_pipeline::clear(kernel_sack& sack) {
     this->_trash.clear();
 }
 
+bool sbn::basic_socket_pipeline::full() const {
+    lock_type lock(this->_mutex);
+    return kernels_full();
+}
+
+void sbn::basic_socket_pipeline::cancel() {
+    kernel_ptr_array cancelled;
+    {
+        lock_type lock(this->_mutex);
+        kernel_queue kernels;
+        for (auto& k : this->_kernels) {
+            if (k->phase() == kernel::phases::upstream && k->parent() && k->cancelled()) {
+                cancelled.emplace_back(std::move(k));
+            } else {
+                kernels.emplace_back(std::move(k));
+            }
+        }
+        this->_kernels.swap(kernels);
+        if (!cancelled.empty() && this->_max_kernels != 0) {
+            this->_producer_semaphore.notify_all();
+        }
+        for (auto& conn : this->_connections) {
+            if (conn) { conn->cancel(); }
+        }
+        poller().notify_one();
+    }
+    auto* ppl = native_pipeline();
+    for (auto& k : cancelled) {
+        k->return_to_parent(exit_code::cancelled);
+        if (ppl) { ppl->send(std::move(k)); }
+    }
+}
+
+void sbn::basic_socket_pipeline::cancel(const kernel& notice) {
+    lock_type lock(this->_mutex);
+    for (auto& conn : this->_connections) {
+        if (conn) { conn->cancel(notice); }
+    }
+    poller().notify_one();
+}
+
+void sbn::basic_socket_pipeline::cancel_received(const kernel& notice) {
+    #if defined(SBN_DEBUG)
+    log("cancel received _", notice);
+    #endif
+    if (notice.target_application_id() == this_application::id()) {
+        cancel_received_kernel(notice);
+        cancel();
+        if (auto* ppl = native_pipeline()) { auto g = unguard(); ppl->cancel(); }
+    } else {
+        cancel(notice);
+        auto* ppl = foreign_pipeline();
+        if (ppl && ppl != this) { auto g = unguard(); ppl->cancel(notice); }
+    }
+}
+
 void sbn::basic_socket_pipeline::remove_listener(kernel* b) {
     Expects(b);
     this->_listeners.erase(
@@ -195,6 +263,8 @@ bool sbn::basic_socket_pipeline::properties::set(const char* key, const std::str
         min_input_buffer_size = std::stoul(value);
     } else if (std::strcmp(key, "min-output-buffer-size") == 0) {
         min_output_buffer_size = std::stoul(value);
+    } else if (std::strcmp(key, "max-kernels") == 0) {
+        max_kernels = std::stoul(value);
     } else {
         found = false;
     }
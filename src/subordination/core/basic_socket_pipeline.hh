@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -31,6 +32,8 @@ namespace sbn {
             sys::cpu_set cpus;
             size_t min_output_buffer_size;
             size_t min_input_buffer_size;
+            /// The maximal number of kernels in the queue (0 means unbounded).
+            size_t max_kernels = 0;
 
             inline properties():
             properties{sys::this_process::cpus(), sys::page_size()} {}
@@ -69,6 +72,8 @@ namespace sbn {
         semaphore_type _semaphore;
         connection_table _connections;
         duration _connection_timeout = std::chrono::seconds(7);
+        /// The maximal time between two iterations of the event loop.
+        duration _wakeup_interval = std::chrono::seconds(999);
         sys::u32 _max_connection_attempts = 1;
         pipeline* _foreign_pipeline = nullptr;
         pipeline* _native_pipeline = nullptr;
@@ -80,6 +85,10 @@ namespace sbn {
         kernel_ptr_array _trash;
         size_t _min_input_buffer_size = 4096*16;
         size_t _min_output_buffer_size = 4096*16;
+        /// The maximal number of kernels in the queue (0 means unbounded).
+        size_t _max_kernels = 0;
+        /// Producers that wait for the free space in the queue.
+        std::condition_variable_any _producer_semaphore;
         /// Function that is called in each new thread.
         thread_init_type _thread_init;
 
@@ -126,7 +135,8 @@ namespace sbn {
             this->log("send _", *k);
             #endif
             lock_type lock(this->_mutex);
-            this->_kernels.emplace_back(std::move(k));
+            if (!is_pipeline_thread()) { wait_for_free_space(lock); }
+            enqueue_by_priority(this->_kernels, std::move(k));
             this->_semaphore.notify_one();
         }
 
@@ -134,11 +144,20 @@ namespace sbn {
             lock_type lock(this->_mutex);
             for (size_t i=0; i<n; ++i) {
                 Assert(kernels[i]);
-                this->_kernels.emplace_back(std::move(kernels[i]));
+                if (kernels_full() && !is_pipeline_thread()) {
+                    this->_semaphore.notify_all();
+                    wait_for_free_space(lock);
+                }
+                enqueue_by_priority(this->_kernels, std::move(kernels[i]));
             }
             this->_semaphore.notify_all();
         }
 
+        inline void send(kernel_ptr_array&& kernels) {
+            const auto n = kernels.size();
+            this->send(std::move(kernels), n);
+        }
+
         void start();
         void stop();
         void wait();
@@ -181,6 +200,31 @@ namespace sbn {
         inline void thread_init(thread_init_type rhs) { this->_thread_init = rhs; }
         inline void transactions(transaction_log* rhs) noexcept { this->_transactions = rhs; }
 
+        /**
+        \brief Limit the number of kernels in the queue.
+        \details When the queue is full, \link send\endlink blocks unless it is
+        called from the thread of some pipeline.
+        */
+        inline void max_kernels(size_t rhs) noexcept { this->_max_kernels = rhs; }
+        inline size_t max_kernels() const noexcept { return this->_max_kernels; }
+
+        bool full() const override;
+
+        /**
+        Return the cancelled kernels from the queue to their parents and
+        send the cancellation notices for the kernels that were sent to other
+        processes.
+        */
+        void cancel() override;
+        void cancel(const kernel& notice) override;
+
+        /**
+        \brief Handle the cancellation notice that was received by the connection.
+        \details The kernels of this application are cancelled locally,
+        the notices for other applications are sent further.
+        */
+        void cancel_received(const kernel& notice);
+
         inline void trash(kernel_ptr&& k) {
             Expects(k);
             this->_trash.emplace_back(std::move(k));
@@ -217,6 +261,14 @@ namespace sbn {
             this->_connection_timeout = rhs;
         }
 
+        inline const duration& wakeup_interval() const noexcept {
+            return this->_wakeup_interval;
+        }
+
+        inline void wakeup_interval(const duration& rhs) noexcept {
+            this->_wakeup_interval = rhs;
+        }
+
         inline sys::u32 max_connection_attempts() const noexcept {
             return this->_max_connection_attempts;
         }
@@ -302,6 +354,19 @@ namespace sbn {
         virtual void process_connections();
         virtual void loop();
 
+        /// \return the time point at which the event loop wakes up even if there are no events
+        virtual time_point next_wakeup_time_point() const noexcept;
+
+        inline bool kernels_full() const noexcept {
+            return this->_max_kernels != 0 && this->_kernels.size() >= this->_max_kernels;
+        }
+
+        inline void wait_for_free_space(lock_type& lock) {
+            this->_producer_semaphore.wait(lock, [this] () {
+                return !kernels_full() || this->stopping();
+            });
+        }
+
     private:
 
         void flush_buffers();
@@ -1,3 +1,5 @@
+#include <deque>
+
 #include <unistdx/io/pipe>
 
 #include <subordination/bits/contracts.hh>
@@ -14,11 +16,29 @@ void sbn::child_process_pipeline::send(kernel_ptr&& k) {
     if (!this->_parent) {
         send_native(std::move(k));
     } else {
-        this->_kernels.emplace_back(std::move(k));
+        if (!is_pipeline_thread()) { wait_for_free_space(lock); }
+        enqueue_by_priority(this->_kernels, std::move(k));
         this->poller().notify_one();
     }
 }
 
+void sbn::child_process_pipeline::send(kernel_ptr_array&& kernels) {
+    lock_type lock(this->_mutex);
+    for (auto& k : kernels) {
+        Expects(k.get());
+        if (!this->_parent) {
+            send_native(std::move(k));
+        } else {
+            if (kernels_full() && !is_pipeline_thread()) {
+                this->poller().notify_one();
+                wait_for_free_space(lock);
+            }
+            enqueue_by_priority(this->_kernels, std::move(k));
+        }
+    }
+    if (this->_parent) { this->poller().notify_one(); }
+}
+
 void sbn::child_process_pipeline::add_connection() {
     using f = connection_flags;
     sys::fd_type in = this_application::get_input_fd();
@@ -33,31 +53,68 @@ void sbn::child_process_pipeline::add_connection() {
         this->_parent->setf(f::save_upstream_kernels);
         this->_parent->state(connection::states::starting);
         this->_parent->name(name());
+        this->_parent->max_upstream_kernels(this->_max_upstream_kernels);
         this->_parent->add(this->_parent);
     }
 }
 
 void sbn::child_process_pipeline::process_kernels() {
-    while (!this->_kernels.empty()) {
-        auto k = std::move(this->_kernels.front());
-        this->_kernels.pop_front();
-        if (this->_parent && (this->_parent->state() == connection::states::started ||
-                              this->_parent->state() == connection::states::starting)) {
-            this->_parent->send(k);
-        } else {
+    if (this->_parent && (this->_parent->state() == connection::states::started ||
+                          this->_parent->state() == connection::states::starting)) {
+        // the connection writes the kernels that share the header in one frame
+        // upstream kernels that exceed the limit are held in the queue,
+        // the other kernels are sent immediately
+        auto capacity = this->_parent->upstream_capacity();
+        kernel_ptr_array kernels;
+        std::deque<kernel_ptr> held;
+        while (!this->_kernels.empty()) {
+            auto k = std::move(this->_kernels.front());
+            this->_kernels.pop_front();
+            if (k->phase() == kernel::phases::upstream) {
+                if (capacity == 0) { held.emplace_back(std::move(k)); continue; }
+                --capacity;
+            }
+            kernels.emplace_back(std::move(k));
+        }
+        this->_kernels.swap(held);
+        if (!kernels.empty()) { this->_parent->send(kernels); }
+    } else {
+        while (!this->_kernels.empty()) {
+            auto k = std::move(this->_kernels.front());
+            this->_kernels.pop_front();
             send_native(std::move(k));
         }
     }
 }
 
+void sbn::child_process_pipeline::process_connections() {
+    basic_socket_pipeline::process_connections();
+    // send the kernels that were held until the parent returned some of the previous ones
+    if (this->_max_upstream_kernels != 0 && !this->_kernels.empty()) { process_kernels(); }
+}
+
+void sbn::child_process_pipeline::max_upstream_kernels(size_t rhs) {
+    lock_type lock(this->_mutex);
+    this->_max_upstream_kernels = rhs;
+    if (this->_parent) { this->_parent->max_upstream_kernels(rhs); }
+}
+
+bool sbn::child_process_pipeline::full() const {
+    lock_type lock(this->_mutex);
+    return kernels_full() || (this->_parent && this->_parent->upstream_capacity() == 0);
+}
+
 sbn::child_process_pipeline::child_process_pipeline(const properties& p):
-sbn::basic_socket_pipeline{p}, _pipe_buffer_size{p.pipe_buffer_size} {}
+sbn::basic_socket_pipeline{p}, _pipe_buffer_size{p.pipe_buffer_size},
+_max_upstream_kernels{p.max_upstream_kernels} {}
 
 bool sbn::child_process_pipeline::properties::set(const char* key, const std::string& value) {
     bool found = true;
     if (basic_socket_pipeline::properties::set(key, value)) {
     } else if (std::strcmp(key, "pipe-buffer-size") == 0) {
         pipe_buffer_size = std::stoul(value);
+    } else if (std::strcmp(key, "max-upstream-kernels") == 0) {
+        max_upstream_kernels = std::stoul(value);
     } else {
         found = false;
     }
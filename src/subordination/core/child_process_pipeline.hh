@@ -13,6 +13,8 @@ namespace sbn {
     public:
         struct properties: public sbn::basic_socket_pipeline::properties {
             size_t pipe_buffer_size;
+            /// The maximal number of kernels that wait for the reply from the parent process.
+            size_t max_upstream_kernels = 0;
 
             inline properties():
             properties{sys::this_process::cpus(), sys::page_size()} {}
@@ -32,6 +34,7 @@ namespace sbn {
     private:
         connection_ptr _parent;
         size_t _pipe_buffer_size = 4096UL*16UL;
+        size_t _max_upstream_kernels = 0;
 
     public:
 
@@ -44,14 +47,28 @@ namespace sbn {
         child_process_pipeline& operator=(child_process_pipeline&&) = delete;
 
         void send(kernel_ptr&& k) override;
+        void send(kernel_ptr_array&& kernels);
         void add_connection();
 
         inline void pipe_buffer_size(size_t rhs) noexcept { this->_pipe_buffer_size = rhs; }
         void write(std::ostream& out) const override;
 
+        /**
+        \brief Limit the number of kernels that were sent to the parent process
+        and wait for the reply.
+        \details The rest of the kernels wait in the queue.
+        */
+        void max_upstream_kernels(size_t rhs);
+        inline size_t max_upstream_kernels() const noexcept {
+            return this->_max_upstream_kernels;
+        }
+
+        bool full() const override;
+
     protected:
 
         void process_kernels() override;
+        void process_connections() override;
 
     private:
 
@@ -0,0 +1,65 @@
+#include <stdexcept>
+#include <typeindex>
+
+#include <subordination/core/collective_kernel.hh>
+#include <subordination/core/factory.hh>
+#include <subordination/core/kernel_buffer.hh>
+
+void sbn::collective_kernel::act() {
+    // copy the kernel before the partial result is computed
+    kernel_ptr_array copies;
+    for (const auto& address : neighbours()) {
+        auto k = copy();
+        k->destination(address);
+        copies.emplace_back(std::move(k));
+    }
+    neighbours({});
+    this->_num_pending = copies.size();
+    act_on_node();
+    if (copies.empty()) { sbn::commit(std::move(this_ptr()), factory.remote()); return; }
+    send_subordinates(this, std::move(copies), factory.remote());
+}
+
+void sbn::collective_kernel::react(kernel_ptr&& child) {
+    if (child->return_code() != exit_code::success) {
+        // the subtree is not reachable, its result is lost
+        sys::log_message("collective", "subtree returned _", child->return_code());
+    } else if (combine_results()) {
+        if (auto* k = dynamic_cast<collective_kernel*>(child.get())) { combine(*k); }
+    }
+    if (--this->_num_pending == 0) { sbn::commit(std::move(this_ptr()), factory.remote()); }
+}
+
+void sbn::collective_kernel::combine(collective_kernel&) {}
+
+void sbn::collective_kernel::write(kernel_buffer& out) const {
+    kernel::write(out);
+    out << sys::u8(this->_combine_results);
+}
+
+void sbn::collective_kernel::read(kernel_buffer& in) {
+    kernel::read(in);
+    sys::u8 combine_results = 1;
+    in >> combine_results;
+    this->_combine_results = combine_results != 0;
+}
+
+sbn::kernel_ptr sbn::collective_kernel::copy() const {
+    auto& types = factory.types();
+    auto result = types.find(std::type_index(typeid(*this)));
+    if (result == types.end()) {
+        throw std::invalid_argument("collective kernel type is not registered");
+    }
+    kernel_buffer buffer;
+    buffer.types(&types);
+    write(buffer);
+    buffer.flip();
+    auto k = result->construct();
+    k->read(buffer);
+    // the copy is the new kernel
+    k->id(0);
+    k->return_code(exit_code::undefined);
+    k->phase(phases::upstream);
+    k->setf(kernel_flag::send_to_subordinate_node);
+    return k;
+}
@@ -0,0 +1,64 @@
+#ifndef SUBORDINATION_CORE_COLLECTIVE_KERNEL_HH
+#define SUBORDINATION_CORE_COLLECTIVE_KERNEL_HH
+
+#include <subordination/core/kernel.hh>
+
+namespace sbn {
+
+    /**
+    \brief The kernel that is executed on every cluster node and that
+    follows the tree of cluster node hierarchy.
+    \details
+    The daemon delivers the kernel to the application process on the local node
+    and puts the neighbours of the node (except the one from which the kernel came)
+    into \link kernel::neighbours\endlink. The kernel sends a copy of itself to each
+    of the neighbours, executes \link act_on_node\endlink and then combines
+    the results returned by the copies with \link combine\endlink before returning
+    to its parent. As a result, each kernel receives results only from
+    its neighbours (the fan-in is bounded by the fan-out of the hierarchy) and each
+    link between nodes carries exactly one copy of the kernel in each direction.
+    When \link combine_results\endlink is false (\link sbn::broadcast\endlink),
+    the kernel only waits for the copies and does not call \link combine\endlink.
+    The kernel type has to be registered in \link kernel_type_registry\endlink,
+    and the derived kernels have to call \link write\endlink and \link read\endlink
+    of this class.
+    */
+    class collective_kernel: public kernel {
+
+    private:
+        size_t _num_pending = 0;
+        bool _combine_results = true;
+
+    public:
+
+        inline collective_kernel() { setf(kernel_flag::send_to_subordinate_node); }
+
+        void act() final;
+        void react(kernel_ptr&& child) final;
+        void write(kernel_buffer& out) const override;
+        void read(kernel_buffer& in) override;
+
+        /// Combine the results of the copies (reduce) or only wait for them (broadcast).
+        inline bool combine_results() const noexcept { return this->_combine_results; }
+        inline void combine_results(bool rhs) noexcept { this->_combine_results = rhs; }
+
+    protected:
+
+        /// Do the job on the current node (e.g. compute partial result).
+        virtual void act_on_node() = 0;
+
+        /**
+        Combine the partial result of this kernel with the result of
+        the subtree that is rooted at the neighbour.
+        Does nothing by default (broadcast).
+        */
+        virtual void combine(collective_kernel& child);
+
+    private:
+        kernel_ptr copy() const;
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
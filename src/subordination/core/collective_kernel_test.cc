@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <unistdx/net/ipv4_socket_address>
+
+#include <subordination/api.hh>
+#include <subordination/core/error_handler.hh>
+
+namespace {
+
+    constexpr const int num_neighbours = 3;
+    int sum = 0;
+    int num_nodes = 0;
+    int broadcast_sum = 0;
+    int broadcast_num_nodes = 0;
+
+    class Count: public sbn::collective_kernel {
+
+    private:
+        int _sum = 0;
+        int _num_nodes = 0;
+
+    public:
+
+        void write(sbn::kernel_buffer& out) const override {
+            sbn::collective_kernel::write(out);
+            out << this->_sum << this->_num_nodes;
+        }
+
+        void read(sbn::kernel_buffer& in) override {
+            sbn::collective_kernel::read(in);
+            in >> this->_sum >> this->_num_nodes;
+        }
+
+        inline int sum() const noexcept { return this->_sum; }
+        inline int num_nodes() const noexcept { return this->_num_nodes; }
+
+    protected:
+
+        void act_on_node() override {
+            this->_sum += 10;
+            ++this->_num_nodes;
+        }
+
+        void combine(sbn::collective_kernel& child) override {
+            auto& k = dynamic_cast<Count&>(child);
+            this->_sum += k._sum;
+            this->_num_nodes += k._num_nodes;
+        }
+
+    };
+
+    class Main: public sbn::kernel {
+
+    private:
+        int _num_returned = 0;
+
+    public:
+
+        void act() override {
+            sbn::reduce(this, make_count());
+            sbn::broadcast(this, make_count());
+        }
+
+        void react(sbn::kernel_ptr&& child) override {
+            auto k = sbn::pointer_dynamic_cast<Count>(std::move(child));
+            if (k->combine_results()) {
+                sum = k->sum();
+                num_nodes = k->num_nodes();
+            } else {
+                broadcast_sum = k->sum();
+                broadcast_num_nodes = k->num_nodes();
+            }
+            if (++this->_num_returned == 2) { sbn::commit<sbn::Local>(std::move(this_ptr())); }
+        }
+
+    private:
+
+        sbn::pointer<Count> make_count() {
+            // pretend that the daemon has found the neighbours
+            auto k = sbn::make_pointer<Count>();
+            sbn::kernel::socket_address_array neighbours;
+            for (int i=0; i<num_neighbours; ++i) {
+                neighbours.emplace_back(sys::ipv4_socket_address{{127,0,0,1},
+                                        sys::port_type(33333+i)});
+            }
+            k->neighbours(std::move(neighbours));
+            return k;
+        }
+
+    };
+
+}
+
+TEST(collective_kernel, reduce_and_broadcast) {
+    int ret = 0;
+    {
+        sbn::factory_guard g;
+        sbn::factory.types().add<Count>(1);
+        sbn::send(sbn::make_pointer<Main>());
+        ret = sbn::wait_and_return();
+    }
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(num_neighbours+1, num_nodes);
+    EXPECT_EQ(10*(num_neighbours+1), sum);
+    // the results of the copies are not combined
+    EXPECT_EQ(1, broadcast_num_nodes);
+    EXPECT_EQ(10, broadcast_sum);
+}
+
+int main(int argc, char* argv[]) {
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 
 #include <subordination/core/application.hh>
@@ -83,6 +84,31 @@ void sbn::connection::send(kernel_ptr& k) {
     }
 }
 
+void sbn::connection::send(kernel_ptr_array& kernels) {
+    const auto n = kernels.size();
+    size_t first = 0;
+    while (first != n) {
+        auto& k = kernels[first];
+        Expects(k);
+        size_t last = first+1;
+        while (last != n && k->shares_header(*kernels[last])) { ++last; }
+        if (last-first == 1) {
+            send(k);
+        } else {
+            ensure_has_id(k->parent());
+            for (size_t i=first; i<last; ++i) { generate_new_id(kernels[i].get()); }
+            #if defined(SBN_DEBUG)
+            log("send _ kernels to _", last-first, this->_socket_address);
+            #endif
+            write_kernels(kernels.data()+first, last-first);
+            for (size_t i=first; i<last; ++i) {
+                kernels[i] = save_kernel(std::move(kernels[i]));
+            }
+        }
+        first = last;
+    }
+}
+
 sbn::kernel_ptr sbn::connection::do_forward(kernel_ptr k) {
     Expects(k);
     write_kernel(k.get());
@@ -91,9 +117,13 @@ sbn::kernel_ptr sbn::connection::do_forward(kernel_ptr k) {
 
 void sbn::connection::write_kernel(const kernel* k) noexcept {
     try {
-        kernel_frame frame;
-        kernel_write_guard g(frame, this->_output_buffer);
-        this->_output_buffer.write(k);
+        const auto position = this->_output_buffer.position();
+        {
+            kernel_frame frame;
+            kernel_write_guard g(frame, this->_output_buffer);
+            this->_output_buffer.write(k);
+        }
+        reorder_output(position, k->priority());
         if (k->phase() == sbn::kernel::phases::upstream) {
             this->_load += k->weights();
         }
@@ -104,31 +134,155 @@ void sbn::connection::write_kernel(const kernel* k) noexcept {
     }
 }
 
+void sbn::connection::write_kernels(const kernel_ptr* kernels, size_t n) noexcept {
+    try {
+        const auto position = this->_output_buffer.position();
+        {
+            kernel_frame frame;
+            frame.batch(true);
+            kernel_write_guard g(frame, this->_output_buffer);
+            this->_output_buffer.write(kernels, n);
+        }
+        // all kernels in the batch have the same priority
+        reorder_output(position, kernels[0]->priority());
+        for (size_t i=0; i<n; ++i) { this->_load += kernels[i]->weights(); }
+    } catch (const std::exception& err) {
+        log_write_error(err.what());
+    } catch (...) {
+        log_write_error("<unknown>");
+    }
+}
+
+void sbn::connection::write_cancellation(const kernel* k) noexcept {
+    try {
+        const auto position = this->_output_buffer.position();
+        {
+            kernel_frame frame;
+            frame.cancel(true);
+            kernel_write_guard g(frame, this->_output_buffer);
+            k->write_header(this->_output_buffer);
+            this->_output_buffer << k->id() << k->old_id();
+        }
+        // the notice must not overtake the kernel
+        reorder_output(position, k->priority());
+    } catch (const std::exception& err) {
+        log_write_error(err.what());
+    } catch (...) {
+        log_write_error("<unknown>");
+    }
+}
+
+void sbn::connection::cancel() {
+    for (auto& k : this->_upstream) {
+        if (k->phase() != kernel::phases::upstream) { continue; }
+        if (k->cancellation_sent() || !k->cancelled()) { continue; }
+        #if defined(SBN_DEBUG)
+        log("cancel _ sent to _", *k, this->_socket_address);
+        #endif
+        write_cancellation(k.get());
+        k->cancellation_sent(true);
+    }
+}
+
+bool sbn::connection::cancel(const kernel& notice) {
+    auto result = std::find_if(
+        this->_upstream.begin(), this->_upstream.end(),
+        [&notice] (const kernel_ptr& k) {
+            if (k->phase() != kernel::phases::upstream) { return false; }
+            if (k->same_identity(notice)) { return true; }
+            // the routed kernel gets new id, and the old one is kept in old_id
+            return k->old_id() != 0 && k->old_id() == notice.id() &&
+                k->source_application_id() == notice.source_application_id() &&
+                k->target_application_id() == notice.target_application_id() &&
+                k->source() == notice.source();
+        });
+    if (result == this->_upstream.end()) { return false; }
+    auto& k = *result;
+    if (!k->cancellation_sent()) {
+        #if defined(SBN_DEBUG)
+        log("forward cancellation of _ to _", *k, this->_socket_address);
+        #endif
+        write_cancellation(k.get());
+        k->cancellation_sent(true);
+    }
+    return true;
+}
+
+void sbn::connection::receive_cancellation(kernel_ptr&& notice) {
+    if (auto* ppl = parent()) { ppl->cancel_received(*notice); }
+}
+
+/**
+Frames with the same priority are sent in FIFO order. The frame that
+is partially sent stays in place.
+*/
+void sbn::connection::reorder_output(size_t start, priority_type priority) {
+    auto& frames = this->_output_frames;
+    const size_t end = this->_output_buffer.position();
+    if (end == start) { return; }
+    if (this->_output_frames_size - this->_output_frame_offset != start) {
+        // some data was written or sent without accounting, do not move it
+        frames.clear();
+        this->_output_frame_offset = 0;
+        this->_output_frames_size = start;
+        if (start != 0) {
+            frames.emplace_back(output_frame{start, std::numeric_limits<priority_type>::max()});
+        }
+    }
+    const size_t first_frame = this->_output_frame_offset == 0 ? 0 : 1;
+    auto n = frames.size();
+    auto position = start;
+    while (n != first_frame && frames[n-1].priority < priority) {
+        --n;
+        position -= frames[n].size;
+    }
+    if (position != start) {
+        auto* data = this->_output_buffer.data();
+        std::rotate(data+position, data+start, data+end);
+    }
+    frames.emplace(frames.begin()+n, output_frame{end-start, priority});
+    this->_output_frames_size += end-start;
+}
+
+void sbn::connection::output_flushed(size_t n) {
+    auto& frames = this->_output_frames;
+    n += this->_output_frame_offset;
+    while (!frames.empty() && frames.front().size <= n) {
+        n -= frames.front().size;
+        this->_output_frames_size -= frames.front().size;
+        frames.pop_front();
+    }
+    this->_output_frame_offset = frames.empty() ? 0 : n;
+}
+
 void sbn::connection::receive_kernels() {
     kernel_frame frame;
     while (this->_input_buffer.remaining() >= sizeof(kernel_frame)) {
         try {
             kernel_read_guard g(frame, this->_input_buffer);
             if (!g) { break; }
-            auto k = read_kernel();
-            Assert(k);
-            if (k->phase() == sbn::kernel::phases::downstream) {
-                log("LOAD before _ k _", this->_load, k->weights());
-                this->_load -= k->weights();
-                log("LOAD after _ k _", this->_load, k->weights());
-            }
-            if (k->is_foreign()) {
-                #if defined(SBN_DEBUG)
-                log("read foreign src _ dst _ app _ id _", k->source(),
-                    k->destination(), k->source_application_id(), k->id());
-                #endif
-                receive_foreign_kernel(std::move(k));
+            if (frame.cancel()) {
+                auto& in = this->_input_buffer;
+                kernel_ptr notice(new kernel);
+                notice->read_header(in);
+                kernel::id_type id = 0, old_id = 0;
+                in >> id >> old_id;
+                notice->id(id);
+                notice->old_id(old_id);
+                if (this->_socket_address) { notice->source(this->_socket_address); }
+                receive_cancellation(std::move(notice));
+            } else if (frame.batch()) {
+                auto& in = this->_input_buffer;
+                in.begin_batch();
+                try {
+                    while (in.position() != in.limit()) { receive_frame_kernel(read_kernel()); }
+                } catch (...) {
+                    in.end_batch();
+                    throw;
+                }
+                in.end_batch();
             } else {
-                #if defined(SBN_DEBUG)
-                log("read native src _ dst _ app _ id _", k->source(),
-                    k->destination(), k->source_application_id(), k->id());
-                #endif
-                receive_kernel(std::move(k));
+                receive_frame_kernel(read_kernel());
             }
         } catch (const std::exception& err) {
             log_read_error(err.what());
@@ -139,6 +293,28 @@ void sbn::connection::receive_kernels() {
     this->_input_buffer.compact();
 }
 
+void sbn::connection::receive_frame_kernel(kernel_ptr&& k) {
+    Assert(k);
+    if (k->phase() == sbn::kernel::phases::downstream) {
+        log("LOAD before _ k _", this->_load, k->weights());
+        this->_load -= k->weights();
+        log("LOAD after _ k _", this->_load, k->weights());
+    }
+    if (k->is_foreign()) {
+        #if defined(SBN_DEBUG)
+        log("read foreign src _ dst _ app _ id _", k->source(),
+            k->destination(), k->source_application_id(), k->id());
+        #endif
+        receive_foreign_kernel(std::move(k));
+    } else {
+        #if defined(SBN_DEBUG)
+        log("read native src _ dst _ app _ id _", k->source(),
+            k->destination(), k->source_application_id(), k->id());
+        #endif
+        receive_kernel(std::move(k));
+    }
+}
+
 void sbn::connection::receive_foreign_kernel(kernel_ptr&& k) {
     Expects(k);
     // TODO The following two lines destroy daemon/transactions test.
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <deque>
 #include <functional>
+#include <limits>
 #include <memory>
 
 #include <unistdx/base/flag>
@@ -39,6 +40,15 @@ namespace sbn {
     private:
         using kernel_queue = std::deque<kernel_ptr>;
         using id_type = typename kernel::id_type;
+        using priority_type = typename kernel::priority_type;
+
+        /// The frame in the output buffer that was not sent completely.
+        struct output_frame {
+            size_t size;
+            priority_type priority;
+        };
+
+        using output_frame_queue = std::deque<output_frame>;
 
     public:
         using clock_type = std::chrono::system_clock;
@@ -52,8 +62,15 @@ namespace sbn {
         flag _flags{};
         id_type _counter = 1;
         sys::u32 _attempts = 1;
+        /// The maximal number of upstream kernels that wait for the reply (0 means unbounded).
+        size_t _max_upstream_kernels = 0;
         const char* _name = "ppl";
         states _state = states::initial;
+        output_frame_queue _output_frames;
+        /// The total size of the frames in the output frame queue.
+        size_t _output_frames_size = 0;
+        /// The no. of bytes of the first frame that were already sent.
+        size_t _output_frame_offset = 0;
 
     protected:
         kernel_queue _upstream, _downstream;
@@ -72,6 +89,12 @@ namespace sbn {
 
         void send(kernel_ptr& k);
 
+        /**
+        Send the kernels. Consecutive upstream kernels that share the header
+        are written in one frame.
+        */
+        void send(kernel_ptr_array& kernels);
+
         inline void forward(kernel_ptr k) {
             do_forward(std::move(k));
         }
@@ -80,6 +103,20 @@ namespace sbn {
 
         void receive_kernels();
 
+        /**
+        Send cancellation notices for the saved upstream kernels
+        that were cancelled on this node (see \link kernel::cancelled\endlink).
+        The notice is sent only once for each kernel.
+        */
+        void cancel();
+
+        /**
+        Send the cancellation notice further for the saved upstream kernel
+        that was received from the sender of the \p notice.
+        \return true if the kernel was found
+        */
+        bool cancel(const kernel& notice);
+
         virtual void handle(const sys::epoll_event& event);
         virtual void add(const connection_ptr& self);
         virtual void remove(const connection_ptr& self);
@@ -130,6 +167,21 @@ namespace sbn {
         inline const kernel_queue& upstream() const noexcept { return this->_upstream; }
         inline const kernel_queue& downstream() const noexcept { return this->_downstream; }
 
+        inline size_t max_upstream_kernels() const noexcept {
+            return this->_max_upstream_kernels;
+        }
+
+        inline void max_upstream_kernels(size_t rhs) noexcept {
+            this->_max_upstream_kernels = rhs;
+        }
+
+        /// The number of upstream kernels that can be sent without exceeding the limit.
+        inline size_t upstream_capacity() const noexcept {
+            if (this->_max_upstream_kernels == 0) { return std::numeric_limits<size_t>::max(); }
+            const auto n = this->_upstream.size();
+            return n < this->_max_upstream_kernels ? this->_max_upstream_kernels-n : 0;
+        }
+
         inline void min_input_buffer_size(size_t rhs) {
             if (this->_input_buffer.size() < rhs) { this->_input_buffer.resize(rhs); }
         }
@@ -156,7 +208,10 @@ namespace sbn {
         virtual void receive_kernel(kernel_ptr&& k);
         virtual void receive_foreign_kernel(kernel_ptr&& fk);
         virtual void write_kernel(const kernel* k) noexcept;
+        virtual void write_kernels(const kernel_ptr* kernels, size_t n) noexcept;
         virtual kernel_ptr read_kernel();
+        virtual void write_cancellation(const kernel* k) noexcept;
+        virtual void receive_cancellation(kernel_ptr&& notice);
 
         struct flush_guard {
             kernel_buffer& _buffer;
@@ -168,8 +223,12 @@ namespace sbn {
 
         template <class Sink>
         inline void flush(Sink& sink) {
-            flush_guard g(this->_output_buffer);
-            this->_output_buffer.flush(sink);
+            const auto old_position = this->_output_buffer.position();
+            {
+                flush_guard g(this->_output_buffer);
+                this->_output_buffer.flush(sink);
+            }
+            output_flushed(old_position - this->_output_buffer.position());
         }
 
         template <class Source>
@@ -187,9 +246,18 @@ namespace sbn {
     private:
 
         void plug_parent(kernel_ptr& k);
+        void receive_frame_kernel(kernel_ptr&& k);
         kernel_ptr save_kernel(kernel_ptr k);
         void recover_kernel(kernel_ptr& k);
 
+        /**
+        Move the frame that was just written to the output buffer starting
+        from the \p position before the frames with lower priority that were
+        not sent yet.
+        */
+        void reorder_output(size_t position, priority_type priority);
+        void output_flushed(size_t n);
+
         template <class E> inline void
         log_write_error(const E& err) { this->log("write error _", err); }
 
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <subordination/core/connection.hh>
+#include <subordination/core/foreign_kernel.hh>
+#include <subordination/core/kernel_buffer.hh>
+
+namespace {
+
+    class Connection: public sbn::connection {
+
+    public:
+        using sbn::connection::write_kernel;
+        using sbn::connection::write_cancellation;
+
+    };
+
+    /// Accepts no more than \p max_size bytes.
+    struct Sink {
+        std::vector<char> data;
+        size_t max_size;
+        ssize_t write(const void* src, size_t n) {
+            n = std::min(n, this->max_size - this->data.size());
+            const auto* first = static_cast<const char*>(src);
+            this->data.insert(this->data.end(), first, first+n);
+            return n;
+        }
+    };
+
+    struct Frame {
+        sbn::application::id_type tag;
+        bool cancel;
+        inline bool operator==(const Frame& rhs) const noexcept {
+            return this->tag == rhs.tag && this->cancel == rhs.cancel;
+        }
+    };
+
+    inline std::ostream& operator<<(std::ostream& out, const Frame& rhs) {
+        return out << rhs.tag << (rhs.cancel ? "c" : "");
+    }
+
+    /// The kernels are tagged with the source application id.
+    inline sbn::foreign_kernel_ptr make_kernel(sbn::application::id_type tag,
+                                               sbn::kernel::priority_type priority) {
+        sbn::foreign_kernel_ptr k(new sbn::foreign_kernel);
+        k->id(tag);
+        k->source_application_id(tag);
+        k->priority(priority);
+        return k;
+    }
+
+    std::vector<Frame> read_frames(const std::vector<char>& data) {
+        sbn::kernel_buffer buf;
+        buf.write(data.data(), data.size());
+        buf.flip();
+        std::vector<Frame> frames;
+        sbn::kernel_frame frame;
+        while (buf.remaining() >= sizeof(sbn::kernel_frame)) {
+            sbn::kernel_read_guard g(frame, buf);
+            if (!g) { break; }
+            sbn::kernel k;
+            k.read_header(buf);
+            frames.emplace_back(Frame{k.source_application_id(), frame.cancel()});
+        }
+        EXPECT_EQ(0u, buf.remaining());
+        return frames;
+    }
+
+}
+
+TEST(connection, reorder_output) {
+    Connection conn;
+    auto a = make_kernel(1, 0), b = make_kernel(2, 2), c = make_kernel(3, 2);
+    // the kernel with higher priority goes first
+    conn.write_kernel(a.get());
+    conn.write_kernel(b.get());
+    // send a part of the first frame
+    Sink sink{{}, 4};
+    conn.flush(sink);
+    ASSERT_EQ(4u, sink.data.size());
+    // the partially sent frame stays in place,
+    // the frames with the same priority are sent in FIFO order
+    conn.write_kernel(c.get());
+    // the notices do not overtake their kernels
+    conn.write_cancellation(a.get());
+    conn.write_cancellation(c.get());
+    sink.max_size = std::numeric_limits<size_t>::max();
+    conn.flush(sink);
+    EXPECT_EQ(
+        (std::vector<Frame>{{2,false}, {3,false}, {3,true}, {1,false}, {1,true}}),
+        read_frames(sink.data));
+    // nothing is left in the buffer
+    const auto size = sink.data.size();
+    conn.flush(sink);
+    EXPECT_EQ(size, sink.data.size());
+}
@@ -0,0 +1,255 @@
+#ifndef SUBORDINATION_CORE_COROUTINE_KERNEL_HH
+#define SUBORDINATION_CORE_COROUTINE_KERNEL_HH
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <unistdx/base/log_message>
+
+#include <subordination/core/factory.hh>
+#include <subordination/core/kernel.hh>
+
+namespace sbn {
+
+    /**
+    \brief The kernel that awaits subordinate kernels in a coroutine.
+    \details
+    The coroutine replaces both \c act and \c react: subordinate kernels
+    are sent with <code>co_await upstream(...)</code> and the coroutine is resumed
+    when all of them return. The coroutine is started by the upstream thread of the
+    pipeline and is resumed in \c react, i.e. by the downstream thread
+    that is selected by the hash of this kernel, so all resumptions of the same
+    coroutine are executed by the same worker. When the coroutine finishes,
+    the kernel returns to its parent. Only C++20 code can use this kernel.
+    */
+    class coroutine_kernel: public kernel {
+
+    public:
+        /// The return type of \link run\endlink.
+        class task {
+
+        public:
+            struct promise_type {
+                std::exception_ptr exception;
+                inline task get_return_object() noexcept {
+                    return task(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+                inline std::suspend_always initial_suspend() noexcept { return {}; }
+                inline std::suspend_always final_suspend() noexcept { return {}; }
+                inline void return_void() noexcept {}
+                inline void unhandled_exception() noexcept {
+                    this->exception = std::current_exception();
+                }
+            };
+
+            using handle_type = std::coroutine_handle<promise_type>;
+
+        private:
+            handle_type _handle;
+
+        public:
+            inline explicit task(handle_type h) noexcept: _handle(h) {}
+            inline ~task() { if (this->_handle) { this->_handle.destroy(); } }
+            inline handle_type release() noexcept { return std::exchange(this->_handle, {}); }
+            task(const task&) = delete;
+            task& operator=(const task&) = delete;
+            inline task(task&& rhs) noexcept: _handle(rhs.release()) {}
+            task& operator=(task&&) = delete;
+
+        };
+
+        /// Sends one subordinate kernel and resumes with this kernel when it returns.
+        template <class K>
+        class child_awaitable {
+
+        private:
+            coroutine_kernel* _parent;
+            pipeline* _pipeline;
+            pointer<K> _child;
+
+        public:
+            inline child_awaitable(coroutine_kernel* parent, pipeline* ppl, pointer<K>&& child):
+            _parent(parent), _pipeline(ppl), _child(std::move(child)) {}
+
+            inline bool await_ready() const noexcept { return false; }
+
+            inline void await_suspend(std::coroutine_handle<>) {
+                this->_parent->push(this->_pipeline, std::move(this->_child));
+                this->_parent->_num_awaited = 1;
+            }
+
+            inline pointer<K> await_resume() {
+                return pointer_dynamic_cast<K>(this->_parent->pop());
+            }
+
+        };
+
+        /**
+        Sends all subordinate kernels and resumes with these kernels
+        (in the order of their completion) when all of them return.
+        */
+        template <class K>
+        class children_awaitable {
+
+        private:
+            coroutine_kernel* _parent;
+            pipeline* _pipeline;
+            std::vector<pointer<K>> _children;
+
+        public:
+            inline children_awaitable(coroutine_kernel* parent, pipeline* ppl,
+                                      std::vector<pointer<K>>&& children):
+            _parent(parent), _pipeline(ppl), _children(std::move(children)) {}
+
+            inline bool await_ready() const noexcept { return this->_children.empty(); }
+
+            inline void await_suspend(std::coroutine_handle<>) {
+                for (auto& k : this->_children) { this->_parent->push(this->_pipeline, std::move(k)); }
+                this->_parent->_num_awaited = this->_children.size();
+            }
+
+            inline std::vector<pointer<K>> await_resume() {
+                auto children = this->_parent->pop_all();
+                const auto n = this->_children.size();
+                for (size_t i=0; i<n; ++i) {
+                    this->_children[i] = pointer_dynamic_cast<K>(std::move(children[i]));
+                }
+                return std::move(this->_children);
+            }
+
+        };
+
+    private:
+        using handle_type = task::handle_type;
+
+    private:
+        handle_type _coroutine{};
+        /// Subordinate kernels that are sent when the coroutine is suspended.
+        kernel_ptr_array _upstream;
+        pipeline* _upstream_pipeline = nullptr;
+        /// Subordinate kernels that returned to this kernel.
+        kernel_ptr_array _downstream;
+        size_t _num_awaited = 0;
+        /// The pipeline that receives this kernel when the coroutine finishes.
+        pipeline* _commit_pipeline = nullptr;
+
+    public:
+
+        coroutine_kernel() = default;
+        inline ~coroutine_kernel() { if (this->_coroutine) { this->_coroutine.destroy(); } }
+
+        /// The coroutine that does the job of \c act and \c react.
+        virtual task run() = 0;
+
+        inline void act() final {
+            this->_coroutine = run().release();
+            resume();
+        }
+
+        inline void react(kernel_ptr&& child) final {
+            this->_downstream.emplace_back(std::move(child));
+            if (this->_downstream.size() == this->_num_awaited) { resume(); }
+        }
+
+        /// The pipeline that receives this kernel when the coroutine finishes.
+        inline void commit_pipeline(pipeline* rhs) noexcept { this->_commit_pipeline = rhs; }
+        inline pipeline* commit_pipeline() const noexcept { return this->_commit_pipeline; }
+
+    protected:
+
+        /// Send subordinate kernel to the local pipeline and await its completion.
+        template <class K> inline child_awaitable<K>
+        upstream(pointer<K>&& child) {
+            return child_awaitable<K>(this, &factory.local(), std::move(child));
+        }
+
+        /// Send subordinate kernel to the pipeline \p ppl and await its completion.
+        template <class K> inline child_awaitable<K>
+        upstream(pipeline& ppl, pointer<K>&& child) {
+            return child_awaitable<K>(this, &ppl, std::move(child));
+        }
+
+        /// Send subordinate kernels to the local pipeline and await their completion.
+        template <class K> inline children_awaitable<K>
+        upstream(std::vector<pointer<K>>&& children) {
+            return children_awaitable<K>(this, &factory.local(), std::move(children));
+        }
+
+        /// Send subordinate kernels to the pipeline \p ppl and await their completion.
+        template <class K> inline children_awaitable<K>
+        upstream(pipeline& ppl, std::vector<pointer<K>>&& children) {
+            return children_awaitable<K>(this, &ppl, std::move(children));
+        }
+
+    private:
+
+        inline void push(pipeline* ppl, kernel_ptr&& child) {
+            make_subordinate(this, *child);
+            this->_upstream_pipeline = ppl;
+            this->_upstream.emplace_back(std::move(child));
+        }
+
+        inline kernel_ptr pop() {
+            auto k = std::move(this->_downstream.front());
+            this->_downstream.clear();
+            return k;
+        }
+
+        /// \return the returned kernels in the order of their completion
+        inline kernel_ptr_array pop_all() {
+            kernel_ptr_array result;
+            result.swap(this->_downstream);
+            return result;
+        }
+
+        inline void resume() {
+            this->_num_awaited = 0;
+            this->_coroutine.resume();
+            if (!this->_coroutine.done()) {
+                // Subordinate kernels are sent after the coroutine is suspended,
+                // because react() may resume it in another thread.
+                // The kernel is not accessed after the first kernel is sent.
+                auto* ppl = this->_upstream_pipeline;
+                kernel_ptr_array children;
+                children.swap(this->_upstream);
+                for (auto& k : children) { ppl->send(std::move(k)); }
+                return;
+            }
+            auto exception = std::move(this->_coroutine.promise().exception);
+            this->_coroutine.destroy();
+            this->_coroutine = {};
+            auto ret = return_code() == exit_code::undefined ? exit_code::success : return_code();
+            if (exception) {
+                try {
+                    std::rethrow_exception(exception);
+                } catch (const std::exception& err) {
+                    sys::log_message("coroutine", "error _", err.what());
+                } catch (...) {
+                    sys::log_message("coroutine", "unknown error");
+                }
+                ret = exit_code::error;
+            }
+            kernel_ptr self(std::move(this_ptr()));
+            if (!has_parent()) {
+                self.reset();
+                ::sbn::exit(static_cast<int>(ret));
+                return;
+            }
+            return_to_parent(ret);
+            auto* ppl = this->_commit_pipeline;
+            if (!ppl) { ppl = &factory.local(); }
+            ppl->send(std::move(self));
+        }
+
+    };
+
+}
+
+#endif
+
+#endif // vim:filetype=cpp
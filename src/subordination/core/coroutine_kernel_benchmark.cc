@@ -0,0 +1,162 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <subordination/api.hh>
+#include <subordination/core/coroutine_kernel.hh>
+#include <subordination/core/error_handler.hh>
+
+/*
+Measures the round trip of a subordinate kernel: the parent sends one
+subordinate kernel and waits for it to return before sending the next one.
+The parent either receives the kernel in react() (through the downstream queue
+of the pipeline) or resumes the coroutine that awaits the kernel.
+Also measures the same for the case when all subordinate kernels are sent at once.
+
+Usage: coroutine-kernel-benchmark [num-kernels] [repetitions]
+*/
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    int num_kernels = 100000;
+    int num_repetitions = 5;
+
+    class Child: public sbn::kernel {
+    public:
+        void act() override { sbn::commit<sbn::Local>(std::move(this_ptr())); }
+    };
+
+    class React_sequential: public sbn::kernel {
+
+    private:
+        int _n = 0;
+
+    public:
+        void act() override { sbn::upstream<sbn::Local>(this, sbn::make_pointer<Child>()); }
+
+        void react(sbn::kernel_ptr&&) override {
+            if (++this->_n == num_kernels) {
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+                return;
+            }
+            sbn::upstream<sbn::Local>(this, sbn::make_pointer<Child>());
+        }
+
+    };
+
+    class React_parallel: public sbn::kernel {
+
+    private:
+        int _n = 0;
+
+    public:
+        void act() override {
+            for (int i=0; i<num_kernels; ++i) {
+                sbn::upstream<sbn::Local>(this, sbn::make_pointer<Child>());
+            }
+        }
+
+        void react(sbn::kernel_ptr&&) override {
+            if (++this->_n == num_kernels) { sbn::commit<sbn::Local>(std::move(this_ptr())); }
+        }
+
+    };
+
+    class Coroutine_sequential: public sbn::coroutine_kernel {
+    public:
+        task run() override {
+            for (int i=0; i<num_kernels; ++i) {
+                co_await upstream(sbn::make_pointer<Child>());
+            }
+        }
+    };
+
+    class Coroutine_parallel: public sbn::coroutine_kernel {
+    public:
+        task run() override {
+            std::vector<sbn::pointer<Child>> children;
+            children.reserve(num_kernels);
+            for (int i=0; i<num_kernels; ++i) { children.emplace_back(sbn::make_pointer<Child>()); }
+            co_await upstream(std::move(children));
+        }
+    };
+
+    enum class methods {
+        react_sequential,
+        coroutine_sequential,
+        react_parallel,
+        coroutine_parallel,
+        size
+    };
+
+    const char* to_string(methods rhs) noexcept {
+        switch (rhs) {
+            case methods::react_sequential: return "react-sequential";
+            case methods::coroutine_sequential: return "coroutine-sequential";
+            case methods::react_parallel: return "react-parallel";
+            case methods::coroutine_parallel: return "coroutine-parallel";
+            default: return "<unknown>";
+        }
+    }
+
+    class Main: public sbn::kernel {
+
+    private:
+        int _method = 0;
+        int _repetition = 0;
+        clock_type::time_point _start;
+
+    public:
+
+        void act() override {
+            std::cout << std::setw(24) << std::left << "method"
+                << std::setw(20) << "time" << "time-per-kernel\n";
+            next();
+        }
+
+        void react(sbn::kernel_ptr&&) override {
+            using namespace std::chrono;
+            const auto t = duration_cast<duration<double>>(clock_type::now()-this->_start);
+            std::cout << std::setw(24) << to_string(methods(this->_method))
+                << std::setw(20) << t.count() << (t.count()/num_kernels) << std::endl;
+            if (++this->_repetition == num_repetitions) {
+                this->_repetition = 0;
+                ++this->_method;
+            }
+            if (this->_method == int(methods::size)) {
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+                return;
+            }
+            next();
+        }
+
+    private:
+
+        void next() {
+            this->_start = clock_type::now();
+            sbn::kernel_ptr k;
+            switch (methods(this->_method)) {
+                case methods::react_sequential: k = sbn::make_pointer<React_sequential>(); break;
+                case methods::coroutine_sequential: k = sbn::make_pointer<Coroutine_sequential>(); break;
+                case methods::react_parallel: k = sbn::make_pointer<React_parallel>(); break;
+                case methods::coroutine_parallel: k = sbn::make_pointer<Coroutine_parallel>(); break;
+                default: return;
+            }
+            sbn::upstream<sbn::Local>(this, std::move(k));
+        }
+
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2) { num_kernels = std::stoi(argv[1]); }
+    if (argc >= 3) { num_repetitions = std::stoi(argv[2]); }
+    sbn::install_error_handler();
+    sbn::factory_guard g;
+    sbn::send(sbn::make_pointer<Main>());
+    return sbn::wait_and_return();
+}
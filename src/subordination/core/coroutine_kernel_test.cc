@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <subordination/api.hh>
+#include <subordination/core/coroutine_kernel.hh>
+#include <subordination/core/error_handler.hh>
+
+namespace {
+
+    constexpr const int num_kernels = 100;
+    int sum = 0;
+    int sequential_sum = 0;
+
+    class Square: public sbn::kernel {
+
+    private:
+        int _value = 0;
+
+    public:
+        inline explicit Square(int value): _value(value) {}
+
+        void act() override {
+            this->_value *= this->_value;
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        inline int value() const noexcept { return this->_value; }
+
+    };
+
+    class Main: public sbn::coroutine_kernel {
+
+    public:
+
+        task run() override {
+            // one subordinate kernel at a time
+            for (int i=1; i<=num_kernels; ++i) {
+                auto k = co_await upstream(sbn::make_pointer<Square>(i));
+                sequential_sum += k->value();
+            }
+            // all subordinate kernels at once
+            std::vector<sbn::pointer<Square>> children;
+            for (int i=1; i<=num_kernels; ++i) {
+                children.emplace_back(sbn::make_pointer<Square>(i));
+            }
+            for (const auto& k : co_await upstream(std::move(children))) {
+                sum += k->value();
+            }
+        }
+
+    };
+
+}
+
+TEST(coroutine_kernel, upstream) {
+    int ret = 0;
+    {
+        sbn::factory_guard g;
+        sbn::send(sbn::make_pointer<Main>());
+        ret = sbn::wait_and_return();
+    }
+    constexpr const int expected = num_kernels*(num_kernels+1)*(2*num_kernels+1)/6;
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(expected, sequential_sum);
+    EXPECT_EQ(expected, sum);
+}
+
+int main(int argc, char* argv[]) {
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
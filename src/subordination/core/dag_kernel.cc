@@ -0,0 +1,50 @@
+#include <subordination/core/dag_kernel.hh>
+#include <subordination/core/factory.hh>
+#include <subordination/core/kernel_buffer.hh>
+
+void sbn::task_kernel::write(kernel_buffer& out) const {
+    kernel::write(out);
+    out << this->_task_id;
+}
+
+void sbn::task_kernel::read(kernel_buffer& in) {
+    kernel::read(in);
+    in >> this->_task_id;
+}
+
+void sbn::dag_kernel::start_graph() {
+    this->_graph.prepare();
+    this->_num_tasks_in_flight = 0;
+    if (this->_graph.done()) { complete_graph(); return; }
+    submit_ready();
+}
+
+void sbn::dag_kernel::react(kernel_ptr&& child) {
+    auto k = pointer_dynamic_cast<task_kernel>(std::move(child));
+    Expects(k);
+    const auto id = k->task();
+    --this->_num_tasks_in_flight;
+    complete_task(std::move(k));
+    this->_graph.complete(id);
+    if (this->_graph.done()) { complete_graph(); return; }
+    submit_ready();
+}
+
+void sbn::dag_kernel::submit_ready() {
+    auto* ppl = this->_task_pipeline;
+    if (!ppl) { ppl = &factory.local(); }
+    const auto max = this->_max_tasks_in_flight;
+    kernel_ptr_array tasks;
+    while (this->_graph.has_ready() && (max == 0 || this->_num_tasks_in_flight < max)) {
+        const auto id = this->_graph.pop_ready();
+        auto k = make_task(id);
+        k->task(id);
+        tasks.emplace_back(std::move(k));
+        ++this->_num_tasks_in_flight;
+    }
+    send_subordinates(this, std::move(tasks), *ppl);
+}
+
+void sbn::dag_kernel::complete_graph() {
+    sbn::commit(std::move(this_ptr()), factory.local());
+}
@@ -0,0 +1,86 @@
+#ifndef SUBORDINATION_CORE_DAG_KERNEL_HH
+#define SUBORDINATION_CORE_DAG_KERNEL_HH
+
+#include <subordination/core/kernel.hh>
+#include <subordination/core/pipeline_base.hh>
+#include <subordination/core/task_graph.hh>
+
+namespace sbn {
+
+    /// The kernel that executes one task of \link dag_kernel\endlink.
+    class task_kernel: public kernel {
+
+    public:
+        using task_id = task_graph::task_id;
+
+    private:
+        task_id _task_id = 0;
+
+    public:
+        inline task_id task() const noexcept { return this->_task_id; }
+        inline void task(task_id rhs) noexcept { this->_task_id = rhs; }
+        void write(kernel_buffer& out) const override;
+        void read(kernel_buffer& in) override;
+
+    };
+
+    /**
+    \brief The kernel that executes \link task_graph\endlink.
+    \details
+    The graph is filled by the derived kernel (usually in \c act) and then
+    \link start_graph\endlink submits tasks without dependencies. Each returned
+    task decrements in-degree counters of its successors and the tasks that
+    became ready are submitted in critical-path-first order.
+    */
+    class dag_kernel: public kernel {
+
+    public:
+        using task_id = task_graph::task_id;
+
+    private:
+        task_graph _graph;
+        pipeline* _task_pipeline = nullptr;
+        size_t _max_tasks_in_flight = 0;
+        size_t _num_tasks_in_flight = 0;
+
+    public:
+
+        void react(kernel_ptr&& child) override;
+
+        inline task_graph& graph() noexcept { return this->_graph; }
+        inline const task_graph& graph() const noexcept { return this->_graph; }
+
+        /// The pipeline to which tasks are sent (local pipeline by default).
+        inline void task_pipeline(pipeline* rhs) noexcept { this->_task_pipeline = rhs; }
+        inline pipeline* task_pipeline() const noexcept { return this->_task_pipeline; }
+
+        /**
+        The maximum number of submitted tasks that are not completed yet
+        (zero means no limit). When the limit is set, critical-path priority
+        decides which of the ready tasks goes next each time a task completes.
+        */
+        inline void max_tasks_in_flight(size_t rhs) noexcept { this->_max_tasks_in_flight = rhs; }
+        inline size_t max_tasks_in_flight() const noexcept { return this->_max_tasks_in_flight; }
+
+    protected:
+
+        /// Compute task priorities and submit the tasks without dependencies.
+        void start_graph();
+
+        /// \return the kernel that executes task \p id
+        virtual pointer<task_kernel> make_task(task_id id) = 0;
+
+        /// Collect the output of the completed task.
+        virtual void complete_task(pointer<task_kernel>&& k) = 0;
+
+        /// Called when all tasks are completed. Returns the kernel to its parent by default.
+        virtual void complete_graph();
+
+    private:
+        void submit_ready();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
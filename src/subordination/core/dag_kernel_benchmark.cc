@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <subordination/api.hh>
+#include <subordination/core/dag_kernel.hh>
+#include <subordination/core/error_handler.hh>
+
+/*
+Generates the three-dimensional grid of parts with the same dependencies as in
+autoreg example (each part depends on up to seven neighbours with smaller indices)
+and executes it by rescanning all parts on each completion (the same as
+autoreg::Wave_surface_generator::push_kernels did) and by sbn::dag_kernel.
+Each part does a small amount of work, so that the time is dominated by scheduling.
+
+Usage: dag-kernel-benchmark [num-parts-per-dimension] [repetitions]
+*/
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using index_type = sbn::task_graph::task_id;
+
+    index_type num_parts = 24;
+    int num_repetitions = 5;
+
+    inline index_type index(index_type i, index_type j, index_type k) noexcept {
+        return (i*num_parts + j)*num_parts + k;
+    }
+
+    class Part: public sbn::task_kernel {
+
+    private:
+        double _sum = 0;
+
+    public:
+        void act() override {
+            for (int i=0; i<1000; ++i) { this->_sum += i; }
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+    };
+
+    enum class part_states: unsigned char {initial, submitted, completed};
+
+    class Scan_generator: public sbn::kernel {
+
+    private:
+        std::vector<part_states> _states;
+        index_type _num_completed = 0;
+
+    public:
+
+        void act() override {
+            this->_states.resize(num_parts*num_parts*num_parts, part_states::initial);
+            push_kernels();
+        }
+
+        void react(sbn::kernel_ptr&& child) override {
+            auto k = sbn::pointer_dynamic_cast<Part>(std::move(child));
+            this->_states[k->task()] = part_states::completed;
+            if (++this->_num_completed == this->_states.size()) {
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+                return;
+            }
+            push_kernels();
+        }
+
+    private:
+
+        void push_kernels() {
+            const auto n = num_parts;
+            sbn::kernel_ptr_array kernels;
+            for (index_type i=0; i<n; ++i) {
+                for (index_type j=0; j<n; ++j) {
+                    for (index_type k=0; k<n; ++k) {
+                        auto& state = this->_states[index(i,j,k)];
+                        if (state != part_states::initial) { continue; }
+                        int ncompleted = 0, ndependencies = 0;
+                        auto nl = std::min(i+1, 2u);
+                        auto nm = std::min(j+1, 2u);
+                        auto nn = std::min(k+1, 2u);
+                        for (index_type l=0; l<nl; ++l) {
+                            for (index_type m=0; m<nm; ++m) {
+                                for (index_type o=0; o<nn; ++o) {
+                                    if (this->_states[index(i-l,j-m,k-o)] ==
+                                        part_states::completed) {
+                                        ++ncompleted;
+                                    }
+                                    ++ndependencies;
+                                }
+                            }
+                        }
+                        if (ncompleted == ndependencies-1) {
+                            state = part_states::submitted;
+                            auto p = sbn::make_pointer<Part>();
+                            p->task(index(i,j,k));
+                            p->parent(this);
+                            kernels.emplace_back(std::move(p));
+                        }
+                    }
+                }
+            }
+            for (auto& k : kernels) { sbn::send<sbn::Local>(std::move(k)); }
+        }
+
+    };
+
+    class Dag_generator: public sbn::dag_kernel {
+
+    public:
+
+        void act() override {
+            const auto n = num_parts;
+            auto& g = graph();
+            for (index_type i=0; i<n*n*n; ++i) { g.add(); }
+            for (index_type i=0; i<n; ++i) {
+                for (index_type j=0; j<n; ++j) {
+                    for (index_type k=0; k<n; ++k) {
+                        auto nl = std::min(i+1, 2u);
+                        auto nm = std::min(j+1, 2u);
+                        auto nn = std::min(k+1, 2u);
+                        for (index_type l=0; l<nl; ++l) {
+                            for (index_type m=0; m<nm; ++m) {
+                                for (index_type o=0; o<nn; ++o) {
+                                    if (l == 0 && m == 0 && o == 0) { continue; }
+                                    g.depends(index(i,j,k), index(i-l,j-m,k-o));
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            start_graph();
+        }
+
+    protected:
+        sbn::pointer<sbn::task_kernel> make_task(task_id) override {
+            return sbn::make_pointer<Part>();
+        }
+        void complete_task(sbn::pointer<sbn::task_kernel>&&) override {}
+
+    };
+
+    enum class methods { scan, dag, size };
+
+    const char* to_string(methods rhs) noexcept {
+        switch (rhs) {
+            case methods::scan: return "scan";
+            case methods::dag: return "dag";
+            default: return "<unknown>";
+        }
+    }
+
+    class Main: public sbn::kernel {
+
+    private:
+        int _method = 0;
+        int _repetition = 0;
+        clock_type::time_point _start;
+
+    public:
+
+        void act() override {
+            std::cout << std::setw(20) << std::left << "method" << "time\n";
+            next();
+        }
+
+        void react(sbn::kernel_ptr&&) override {
+            using namespace std::chrono;
+            const auto t = duration_cast<duration<double>>(clock_type::now()-this->_start);
+            std::cout << std::setw(20) << to_string(methods(this->_method))
+                << t.count() << std::endl;
+            if (++this->_repetition == num_repetitions) {
+                this->_repetition = 0;
+                ++this->_method;
+            }
+            if (this->_method == int(methods::size)) {
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+                return;
+            }
+            next();
+        }
+
+    private:
+
+        void next() {
+            this->_start = clock_type::now();
+            switch (methods(this->_method)) {
+                case methods::scan:
+                    sbn::upstream<sbn::Local>(this, sbn::make_pointer<Scan_generator>());
+                    break;
+                case methods::dag:
+                    sbn::upstream<sbn::Local>(this, sbn::make_pointer<Dag_generator>());
+                    break;
+                default: break;
+            }
+        }
+
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2) { num_parts = std::stoul(argv[1]); }
+    if (argc >= 3) { num_repetitions = std::stoi(argv[2]); }
+    sbn::install_error_handler();
+    sbn::factory_guard g;
+    sbn::send(sbn::make_pointer<Main>());
+    return sbn::wait_and_return();
+}
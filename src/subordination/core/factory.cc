@@ -4,7 +4,8 @@
 #include <subordination/core/factory.hh>
 #include <subordination/core/list.hh>
 
-sbn::Factory::Factory(const Properties& config): _local(config.local), _remote(config.remote) {
+sbn::Factory::Factory(const Properties& config):
+_local(config.local), _remote(config.remote), _shared_objects(config.shared_objects) {
     this->_local.name("app local");
     this->_local.error_pipeline(&this->_remote);
     this->_remote.name("app remote");
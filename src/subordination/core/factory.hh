@@ -11,6 +11,7 @@
 #include <subordination/core/kernel_type_registry.hh>
 #include <subordination/core/parallel_pipeline.hh>
 #include <subordination/core/properties.hh>
+#include <subordination/core/shared_object.hh>
 
 namespace sbn {
 
@@ -22,6 +23,7 @@ namespace sbn {
         child_process_pipeline _remote;
         kernel_type_registry _types;
         kernel_instance_registry _instances;
+        shared_object_store _shared_objects;
 
     public:
 
@@ -34,6 +36,7 @@ namespace sbn {
         inline const child_process_pipeline& remote() const noexcept { return this->_remote; }
         inline sbn::kernel_type_registry& types() noexcept { return this->_types; }
         inline sbn::kernel_instance_registry& instances() noexcept { return this->_instances; }
+        inline shared_object_store& shared_objects() noexcept { return this->_shared_objects; }
 
         void start();
         void stop();
@@ -39,6 +39,8 @@ namespace  {
 
 sbn::Properties::Properties() {
     if (const char* filename = std::getenv("SBN_CONFIG")) { open(filename); }
+    // the daemon fetches the objects into its own directory
+    shared_objects.read_environment();
     const auto& available_cpus = sys::this_process::cpus();
     local.upstream_cpus &= available_cpus;
     if (local.upstream_cpus.count() == 0) {
@@ -59,6 +61,7 @@ sbn::Properties::Properties() {
 void sbn::Properties::property(const std::string& key, const std::string& value) {
     if (set_if_prefix("local.", local, key, value)) {
     } else if (set_if_prefix("remote.", remote, key, value)) {
+    } else if (set_if_prefix("shared-objects.", shared_objects, key, value)) {
     } else {
         throw std::invalid_argument("unknown property");
     }
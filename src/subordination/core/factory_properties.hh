@@ -6,6 +6,7 @@
 #include <subordination/core/child_process_pipeline.hh>
 #include <subordination/core/parallel_pipeline.hh>
 #include <subordination/core/properties.hh>
+#include <subordination/core/shared_object.hh>
 
 namespace sbn {
 
@@ -14,6 +15,7 @@ namespace sbn {
     public:
         parallel_pipeline::properties local;
         child_process_pipeline::properties remote;
+        shared_object_store::properties shared_objects;
 
     public:
         Properties();
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <sys/resource.h>
+
+#include <subordination/api.hh>
+#include <subordination/core/error_handler.hh>
+
+/*
+Spawns N tiny subordinate kernels from a single principal and reports the time
+and the peak resident set size of the process. The principal either sends all
+kernels at once ("eager") or suspends the generation while the local pipeline
+queue is full and resumes it when the children return ("throttled"). The peak
+memory usage is measured for the whole process, hence each method is run in a
+separate process.
+
+Usage: fan-out-benchmark [eager|throttled] [N] [max-upstream-kernels]
+*/
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using index_type = sys::u64;
+
+    enum class methods { eager, throttled };
+
+    methods method = methods::eager;
+    index_type num_kernels = index_type(1) << 22;
+    size_t max_upstream_kernels = 1024;
+
+    class Worker: public sbn::kernel {
+
+    private:
+        index_type _index;
+        double _result = 0;
+
+    public:
+        inline explicit Worker(index_type i): _index(i) {}
+
+        void act() override {
+            this->_result = std::sqrt(double(this->_index));
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        inline double result() const noexcept { return this->_result; }
+
+    };
+
+    class Main: public sbn::kernel {
+
+    private:
+        index_type _num_sent = 0, _num_completed = 0;
+        double _sum = 0;
+        clock_type::time_point _start;
+
+    public:
+
+        void act() override {
+            this->_start = clock_type::now();
+            generate();
+        }
+
+        void react(sbn::kernel_ptr&& k) override {
+            this->_sum += sbn::pointer_dynamic_cast<Worker>(std::move(k))->result();
+            if (++this->_num_completed == num_kernels) {
+                report();
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+                return;
+            }
+            if (method == methods::throttled) { generate(); }
+        }
+
+    private:
+
+        void generate() {
+            auto& ppl = sbn::factory.local();
+            while (this->_num_sent != num_kernels) {
+                if (method == methods::throttled && ppl.full()) { break; }
+                sbn::upstream<sbn::Local>(this, sbn::make_pointer<Worker>(this->_num_sent));
+                ++this->_num_sent;
+            }
+        }
+
+        void report() {
+            using namespace std::chrono;
+            const auto t = duration_cast<duration<double>>(clock_type::now()-this->_start);
+            struct ::rusage usage{};
+            ::getrusage(RUSAGE_SELF, &usage);
+            std::cout << std::setw(20) << std::left << "method"
+                << std::setw(20) << "time"
+                << std::setw(20) << "max-rss-kib" << "sum\n";
+            std::cout << std::setw(20) << (method == methods::eager ? "eager" : "throttled")
+                << std::setw(20) << t.count()
+                << std::setw(20) << usage.ru_maxrss << this->_sum << std::endl;
+        }
+
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2) {
+        if (std::strcmp(argv[1], "eager") == 0) { method = methods::eager; }
+        else if (std::strcmp(argv[1], "throttled") == 0) { method = methods::throttled; }
+        else { std::cerr << "bad method: " << argv[1] << std::endl; return 1; }
+    }
+    if (argc >= 3) { num_kernels = std::stoull(argv[2]); }
+    if (argc >= 4) { max_upstream_kernels = std::stoul(argv[3]); }
+    sbn::install_error_handler();
+    sbn::factory.local().max_upstream_kernels(max_upstream_kernels);
+    sbn::factory_guard g;
+    sbn::send(sbn::make_pointer<Main>());
+    return sbn::wait_and_return();
+}
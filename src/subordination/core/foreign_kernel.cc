@@ -7,6 +7,18 @@ void sbn::foreign_kernel::write(kernel_buffer& out) const {
     out.write(this->_payload.get(), this->_size);
 }
 
+auto sbn::foreign_kernel::copy() const -> foreign_kernel_ptr {
+    kernel_buffer buf;
+    write_header(buf);
+    write(buf);
+    buf.flip();
+    foreign_kernel_ptr k(new foreign_kernel);
+    k->read_header(buf);
+    k->read(buf);
+    k->source_pipeline(source_pipeline());
+    return k;
+}
+
 void sbn::foreign_kernel::read(kernel_buffer& in) {
     in >> this->_type_id;
     sbn::kernel::read(in);
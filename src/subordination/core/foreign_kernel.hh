@@ -28,6 +28,9 @@ namespace sbn {
         void read(kernel_buffer& in) override;
         void write(kernel_buffer& out) const override;
 
+        /// \return the copy of the header and the body of the kernel
+        foreign_kernel_ptr copy() const;
+
     };
 
 }
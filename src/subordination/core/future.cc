@@ -0,0 +1,12 @@
+#include <subordination/core/factory.hh>
+#include <subordination/core/future.hh>
+
+void sbn::continuation_kernel::act() {
+    // the kernel is deleted after the continuation finishes
+    kernel_ptr self(std::move(this_ptr()));
+    this->_function();
+}
+
+void sbn::run_continuation(continuation_kernel::function_type f) {
+    factory.local().send(make_pointer<continuation_kernel>(std::move(f)));
+}
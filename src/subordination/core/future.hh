@@ -0,0 +1,270 @@
+#ifndef SUBORDINATION_CORE_FUTURE_HH
+#define SUBORDINATION_CORE_FUTURE_HH
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <subordination/bits/contracts.hh>
+#include <subordination/core/kernel.hh>
+
+namespace sbn {
+
+    template <class T> class future;
+    template <class T> class promise;
+
+    /// Runs the function in upstream thread of the local pipeline.
+    class continuation_kernel: public kernel {
+
+    public:
+        using function_type = std::function<void()>;
+
+    private:
+        function_type _function;
+
+    public:
+        inline explicit continuation_kernel(function_type f): _function(std::move(f)) {}
+        void act() override;
+
+    };
+
+    /// Sends \link continuation_kernel\endlink to the local pipeline.
+    void run_continuation(continuation_kernel::function_type f);
+
+    /**
+    \brief The value and the continuation that are shared between
+    \link future\endlink and \link promise\endlink.
+    \details The continuation runs in the thread that sets the value,
+    i.e. in the thread of the pipeline that executes \c react of the
+    promise kernel. If the value is already set when the continuation is added,
+    the continuation is sent to the local pipeline, so that the continuation
+    never runs in the thread that is not managed by the pipeline.
+    */
+    template <class T>
+    class shared_state {
+
+    public:
+        using value_type = T;
+        using function_type = std::function<void(T&&)>;
+
+    private:
+        using mutex_type = std::mutex;
+        using lock_type = std::unique_lock<mutex_type>;
+
+    private:
+        mutable mutex_type _mutex;
+        T _value{};
+        function_type _continuation;
+        bool _ready = false;
+
+    public:
+
+        inline void set_value(T&& value) {
+            lock_type lock(this->_mutex);
+            Expects(!this->_ready);
+            this->_ready = true;
+            if (!this->_continuation) { this->_value = std::move(value); return; }
+            auto f = std::move(this->_continuation);
+            lock.unlock();
+            f(std::move(value));
+        }
+
+        inline void continuation(const std::shared_ptr<shared_state>& self, function_type f) {
+            lock_type lock(this->_mutex);
+            Expects(!this->_continuation);
+            if (!this->_ready) { this->_continuation = std::move(f); return; }
+            lock.unlock();
+            run_continuation([self,f] () { f(std::move(self->_value)); });
+        }
+
+        inline bool ready() const {
+            lock_type lock(this->_mutex);
+            return this->_ready;
+        }
+
+    };
+
+    template <class T> struct unwrap_future { using type = T; };
+    template <class T> struct unwrap_future<future<T>> { using type = T; };
+
+    /**
+    \brief The value that is computed asynchronously.
+    \details The value is consumed by exactly one continuation.
+    The future does not have blocking \c get method: the value is accessed
+    only in continuations, and the pipeline threads are never blocked.
+    */
+    template <class T>
+    class future {
+
+    public:
+        using value_type = T;
+
+    private:
+        using state_type = shared_state<T>;
+        using state_ptr = std::shared_ptr<state_type>;
+
+    private:
+        state_ptr _state;
+
+    public:
+
+        inline explicit future(state_ptr s): _state(std::move(s)) {}
+
+        inline bool valid() const noexcept { return static_cast<bool>(this->_state); }
+        inline bool ready() const noexcept { return this->_state->ready(); }
+
+        /**
+        Call \c f with the value when it is ready.
+        If \c f returns a future, the resulting future is ready when
+        the returned future is ready.
+        \return the future of the value returned by \c f
+        */
+        template <class F,
+                  class R=typename std::result_of<F(T&&)>::type,
+                  class U=typename unwrap_future<R>::type>
+        typename std::enable_if<!std::is_void<R>::value,future<U>>::type
+        then(F f) {
+            promise<U> p;
+            auto result = p.get_future();
+            then_void([p,f] (T&& value) mutable { fulfil(p, f(std::move(value))); });
+            return result;
+        }
+
+        /// Call \c f with the value when it is ready. The continuation ends the chain.
+        template <class F, class R=typename std::result_of<F(T&&)>::type>
+        typename std::enable_if<std::is_void<R>::value>::type
+        then(F f) {
+            then_void(std::function<void(T&&)>(std::move(f)));
+        }
+
+        future() = default;
+        ~future() = default;
+        future(const future&) = delete;
+        future& operator=(const future&) = delete;
+        future(future&&) = default;
+        future& operator=(future&&) = default;
+
+    private:
+
+        inline void then_void(std::function<void(T&&)> f) {
+            Expects(valid());
+            auto s = std::move(this->_state);
+            s->continuation(s, std::move(f));
+        }
+
+        template <class V> static inline void
+        fulfil(promise<V>& p, V&& value) { p.set_value(std::move(value)); }
+
+        template <class V> static inline void
+        fulfil(promise<V>& p, future<V>&& f) {
+            f.then([p] (V&& value) mutable { p.set_value(std::move(value)); });
+        }
+
+        template <class X> friend class future;
+
+    };
+
+    /// The object that sets the value of the \link future\endlink.
+    template <class T>
+    class promise {
+
+    private:
+        using state_type = shared_state<T>;
+        using state_ptr = std::shared_ptr<state_type>;
+
+    private:
+        state_ptr _state = std::make_shared<state_type>();
+
+    public:
+        inline future<T> get_future() const { return future<T>(this->_state); }
+        inline void set_value(T&& value) { this->_state->set_value(std::move(value)); }
+        inline void set_value(const T& value) { T tmp(value); set_value(std::move(tmp)); }
+
+        promise() = default;
+        ~promise() = default;
+        promise(const promise&) = default;
+        promise& operator=(const promise&) = default;
+        promise(promise&&) = default;
+        promise& operator=(promise&&) = default;
+
+    };
+
+    /**
+    \brief The parent of the kernel that sets the value of the future
+    when the kernel returns.
+    \details The kernel is deleted after \c react.
+    */
+    template <class K>
+    class promise_kernel: public kernel {
+
+    private:
+        promise<pointer<K>> _promise;
+
+    public:
+        inline future<pointer<K>> get_future() const { return this->_promise.get_future(); }
+
+        void react(kernel_ptr&& child) override {
+            kernel_ptr self(std::move(this_ptr()));
+            this->_promise.set_value(pointer_dynamic_cast<K>(std::move(child)));
+        }
+
+    };
+
+    /// \return the future that is ready when all futures are ready
+    template <class T> future<std::vector<T>>
+    when_all(std::vector<future<T>> futures) {
+        struct state_type {
+            std::mutex mutex;
+            std::vector<T> values;
+            size_t remaining;
+            promise<std::vector<T>> result;
+        };
+        auto s = std::make_shared<state_type>();
+        auto result = s->result.get_future();
+        const auto n = futures.size();
+        s->values.resize(n);
+        s->remaining = n;
+        if (n == 0) { s->result.set_value(std::vector<T>()); return result; }
+        for (size_t i=0; i<n; ++i) {
+            futures[i].then([s,i] (T&& value) {
+                std::unique_lock<std::mutex> lock(s->mutex);
+                s->values[i] = std::move(value);
+                if (--s->remaining != 0) { return; }
+                lock.unlock();
+                s->result.set_value(std::move(s->values));
+            });
+        }
+        return result;
+    }
+
+    /**
+    \return the future that is ready when any of the futures is ready
+    together with the index of this future
+    */
+    template <class T> future<std::pair<size_t,T>>
+    when_any(std::vector<future<T>> futures) {
+        using value_type = std::pair<size_t,T>;
+        struct state_type {
+            std::atomic<bool> done{false};
+            promise<value_type> result;
+        };
+        auto s = std::make_shared<state_type>();
+        auto result = s->result.get_future();
+        const auto n = futures.size();
+        Expects(n != 0);
+        for (size_t i=0; i<n; ++i) {
+            futures[i].then([s,i] (T&& value) {
+                if (s->done.exchange(true)) { return; }
+                s->result.set_value(value_type(i, std::move(value)));
+            });
+        }
+        return result;
+    }
+
+}
+
+#endif // vim:filetype=cpp
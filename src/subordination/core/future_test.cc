@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <subordination/api.hh>
+#include <subordination/core/error_handler.hh>
+
+namespace {
+
+    class Square: public sbn::kernel {
+
+    private:
+        int _value = 0;
+
+    public:
+        inline explicit Square(int value): _value(value) {}
+
+        void act() override {
+            this->_value *= this->_value;
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        inline int value() const noexcept { return this->_value; }
+
+    };
+
+    using square_ptr = sbn::pointer<Square>;
+
+    constexpr const int num_kernels = 10;
+    int nested = 0;
+    int sum = 0;
+    size_t any_index = 0;
+    int any_value = 0;
+
+    std::vector<sbn::future<int>> make_futures() {
+        std::vector<sbn::future<int>> futures;
+        for (int i=1; i<=num_kernels; ++i) {
+            futures.emplace_back(
+                sbn::async(sbn::make_pointer<Square>(i))
+                .then([] (square_ptr&& k) { return k->value(); }));
+        }
+        return futures;
+    }
+
+}
+
+TEST(future, chain) {
+    int ret = 0;
+    {
+        sbn::factory_guard g;
+        // continuations that return futures are flattened
+        sbn::async(sbn::make_pointer<Square>(3))
+            .then([] (square_ptr&& k) {
+                return sbn::async(sbn::make_pointer<Square>(k->value()));
+            })
+            .then([] (square_ptr&& k) {
+                nested = k->value();
+                return sbn::when_all(make_futures());
+            })
+            .then([] (std::vector<int>&& values) {
+                for (auto x : values) { sum += x; }
+                std::vector<sbn::future<square_ptr>> futures;
+                futures.emplace_back(sbn::async(sbn::make_pointer<Square>(2)));
+                return sbn::when_any(std::move(futures));
+            })
+            .then([] (std::pair<size_t,square_ptr>&& result) {
+                any_index = result.first;
+                any_value = result.second->value();
+                sbn::exit(0);
+            });
+        ret = sbn::wait_and_return();
+    }
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(81, nested);
+    EXPECT_EQ(num_kernels*(num_kernels+1)*(2*num_kernels+1)/6, sum);
+    EXPECT_EQ(0u, any_index);
+    EXPECT_EQ(4, any_value);
+}
+
+TEST(future, ready) {
+    sbn::promise<int> p;
+    auto f = p.get_future();
+    EXPECT_TRUE(f.valid());
+    EXPECT_FALSE(f.ready());
+    p.set_value(1);
+    EXPECT_TRUE(f.ready());
+}
+
+int main(int argc, char* argv[]) {
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,51 @@
+#include <subordination/core/factory.hh>
+#include <subordination/core/generator_kernel.hh>
+
+size_t sbn::default_max_children_in_flight(const pipeline* ppl) {
+    const size_t n = factory.local().num_upstream_threads();
+    return ppl == &factory.local() ? 2*n : 16*n;
+}
+
+void sbn::generator_kernel::act() {
+    this->_exhausted = false;
+    this->_num_children_in_flight = 0;
+    if (!this->_child_pipeline) { this->_child_pipeline = &factory.local(); }
+    if (this->_max_children_in_flight == 0) {
+        this->_max_children_in_flight = default_max_children_in_flight(this->_child_pipeline);
+    }
+    generate();
+}
+
+void sbn::generator_kernel::react(kernel_ptr&& child) {
+    --this->_num_children_in_flight;
+    collect_child(std::move(child));
+    generate();
+}
+
+void sbn::generator_kernel::generate() {
+    auto* ppl = this->_child_pipeline;
+    const auto max = this->_max_children_in_flight;
+    kernel_ptr_array children;
+    if (!this->_exhausted && cancelled()) {
+        // stop generation and wait for the children that are in flight
+        this->_exhausted = true;
+        return_code(exit_code::cancelled);
+    }
+    while (!this->_exhausted &&
+           this->_num_children_in_flight < max &&
+           (this->_num_children_in_flight == 0 || !ppl->full())) {
+        auto k = next_child();
+        if (!k) { this->_exhausted = true; break; }
+        children.emplace_back(std::move(k));
+        ++this->_num_children_in_flight;
+    }
+    if (this->_exhausted && this->_num_children_in_flight == 0) {
+        complete_generator();
+        return;
+    }
+    send_subordinates(this, std::move(children), *ppl);
+}
+
+void sbn::generator_kernel::complete_generator() {
+    sbn::commit(std::move(this_ptr()), factory.local());
+}
@@ -0,0 +1,82 @@
+#ifndef SUBORDINATION_CORE_GENERATOR_KERNEL_HH
+#define SUBORDINATION_CORE_GENERATOR_KERNEL_HH
+
+#include <subordination/core/kernel.hh>
+#include <subordination/core/pipeline_base.hh>
+
+namespace sbn {
+
+    /**
+    \return twice the number of upstream threads for the local pipeline and
+    16 times the number of upstream threads for other pipelines
+    \details
+    The remote pipeline is \link pipeline::full\endlink only when
+    its queue is bounded, and the load of the other cluster nodes is not
+    known to the application, hence the limit is finite for all pipelines.
+    */
+    size_t default_max_children_in_flight(const pipeline* ppl);
+
+    /**
+    \brief The kernel that creates subordinate kernels on demand.
+    \details
+    Instead of creating all subordinate kernels in \c act the derived kernel
+    returns them one by one from \link next_child\endlink. The generator keeps
+    only a limited number of children in flight and asks for the next ones
+    when the previous children return, so that the memory usage is bounded by
+    the number of children in flight rather than by the size of the problem.
+    The generation is also suspended while the child pipeline is
+    \link pipeline::full\endlink and stops when the generator is
+    \link kernel::cancelled\endlink.
+    */
+    class generator_kernel: public kernel {
+
+    private:
+        pipeline* _child_pipeline = nullptr;
+        size_t _max_children_in_flight = 0;
+        size_t _num_children_in_flight = 0;
+        bool _exhausted = false;
+
+    public:
+
+        void act() override;
+        void react(kernel_ptr&& child) override;
+
+        /// The pipeline to which children are sent (local pipeline by default).
+        inline void child_pipeline(pipeline* rhs) noexcept { this->_child_pipeline = rhs; }
+        inline pipeline* child_pipeline() const noexcept { return this->_child_pipeline; }
+
+        /**
+        The maximum number of children that were sent and have not returned yet.
+        Zero means \link default_max_children_in_flight\endlink.
+        */
+        inline void max_children_in_flight(size_t rhs) noexcept {
+            this->_max_children_in_flight = rhs;
+        }
+
+        inline size_t max_children_in_flight() const noexcept {
+            return this->_max_children_in_flight;
+        }
+
+        inline size_t num_children_in_flight() const noexcept {
+            return this->_num_children_in_flight;
+        }
+
+    protected:
+
+        /// \return the next child or null pointer if there are no more children
+        virtual kernel_ptr next_child() = 0;
+
+        /// Collect the output of the returned child.
+        virtual void collect_child(kernel_ptr&& child) = 0;
+
+        /// Called when all children returned. Returns the kernel to its parent by default.
+        virtual void complete_generator();
+
+    private:
+        void generate();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -1,3 +1,11 @@
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_set>
+
+#include <subordination/core/basic_pipeline.hh>
 #include <subordination/core/error.hh>
 #include <subordination/core/kernel.hh>
 #include <subordination/core/kernel_buffer.hh>
@@ -10,6 +18,81 @@ namespace {
         return !rhs ? 0 : rhs->id();
     }
 
+    struct cancelled_kernel {
+        sbn::kernel::id_type id = 0;
+        sbn::kernel::id_type old_id = 0;
+        sbn::application::id_type source_application_id = 0;
+        sbn::application::id_type target_application_id = 0;
+        sys::socket_address source;
+
+        explicit cancelled_kernel(const sbn::kernel& k):
+        id(k.id()), old_id(k.old_id()),
+        source_application_id(k.source_application_id()),
+        target_application_id(k.target_application_id()),
+        source(k.source()) {}
+
+        inline bool operator==(const cancelled_kernel& rhs) const noexcept {
+            return this->id == rhs.id && this->old_id == rhs.old_id &&
+                this->source_application_id == rhs.source_application_id &&
+                this->target_application_id == rhs.target_application_id &&
+                this->source == rhs.source;
+        }
+    };
+
+    struct cancelled_kernel_hash {
+        inline size_t operator()(const cancelled_kernel& k) const noexcept {
+            using id_type = sbn::kernel::id_type;
+            using application_id_type = sbn::application::id_type;
+            size_t h = std::hash<id_type>()(k.id);
+            h = h*31 + std::hash<id_type>()(k.old_id);
+            h = h*31 + std::hash<application_id_type>()(k.source_application_id);
+            h = h*31 + std::hash<application_id_type>()(k.target_application_id);
+            return h;
+        }
+    };
+
+    /// Kernels received from other processes that were cancelled by the sender.
+    class cancelled_kernel_registry {
+
+    private:
+        using set_type = std::unordered_set<cancelled_kernel,cancelled_kernel_hash>;
+
+    private:
+        std::mutex _mutex;
+        set_type _kernels;
+        std::deque<cancelled_kernel> _order;
+        size_t _max_size = 4096;
+        std::atomic<size_t> _size{0};
+
+    public:
+
+        inline void add(const sbn::kernel& k) {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            cancelled_kernel key(k);
+            if (!this->_kernels.emplace(key).second) { return; }
+            this->_order.emplace_back(std::move(key));
+            // forget the oldest kernels (most probably they have already returned)
+            while (this->_order.size() > this->_max_size) {
+                this->_kernels.erase(this->_order.front());
+                this->_order.pop_front();
+            }
+            this->_size = this->_kernels.size();
+        }
+
+        inline bool contains(const sbn::kernel& k) noexcept {
+            if (this->_size == 0) { return false; }
+            try {
+                std::lock_guard<std::mutex> lock(this->_mutex);
+                return this->_kernels.find(cancelled_kernel(k)) != this->_kernels.end();
+            } catch (...) {
+                return false;
+            }
+        }
+
+    };
+
+    cancelled_kernel_registry cancelled_kernels;
+
 }
 
 sbn::kernel::~kernel() {
@@ -25,11 +108,14 @@ void sbn::kernel::read(kernel_buffer& in) {
     in >> this->_result >> this->_id >> this->_old_id;
     in >> this->_at;
     in >> this->_flags;
-    in >> this->_parent_id;
+    // the parent is shared by all kernels in the batch
+    if (in.batch()) { this->_parent_id = in.batch_parent_id(); }
+    else { in >> this->_parent_id; }
     in >> this->_principal_id;
     in >> this->_phase;
     in >> this->_path;
     in >> this->_weight;
+    if (bool(this->_flags & kernel_flag::deadline)) { in >> this->_deadline; }
     if (bool(this->_fields & fields::node_filter)) {
         this->_node_filter = sbn::resources::read(in);
     }
@@ -41,11 +127,12 @@ void sbn::kernel::write(kernel_buffer& out) const {
     out << this->_result << this->_id << this->_old_id;
     out << this->_at;
     out << this->_flags;
-    out << parent_id();
+    if (!out.batch()) { out << parent_id(); }
     out << principal_id();
     out << this->_phase;
     out << this->_path;
     out << this->_weight;
+    if (bool(this->_flags & kernel_flag::deadline)) { out << this->_deadline; }
     if (bool(this->_fields & fields::node_filter)) {
         this->_node_filter->write(out);
     }
@@ -62,6 +149,32 @@ void sbn::kernel::write_header(kernel_buffer& out) const {
     else { out << target_application_id(); }
     if (bool(f & fields::source)) { out << source(); }
     if (bool(f & fields::destination)) { out << destination(); }
+    if (bool(f & fields::neighbours)) { out << this->_neighbours; }
+    if (bool(f & fields::shared_objects)) { out << this->_shared_objects; }
+    if (bool(f & fields::priority)) { out << this->_priority; }
+}
+
+bool sbn::kernel::shares_header(const kernel& other) const noexcept {
+    using f = fields;
+    constexpr const auto applications = f::source_application | f::target_application;
+    if (bool((this->_fields | other._fields) & applications)) { return false; }
+    if (phase() != phases::upstream || other.phase() != phases::upstream) { return false; }
+    if (carries_parent() || other.carries_parent()) { return false; }
+    if (isset(kernel_flag::parent_is_id) != other.isset(kernel_flag::parent_is_id)) {
+        return false;
+    }
+    if (isset(kernel_flag::parent_is_id) ? this->_parent_id != other._parent_id
+                                         : this->_parent != other._parent) {
+        return false;
+    }
+    return this->_fields == other._fields &&
+        this->_source_application_id == other._source_application_id &&
+        this->_target_application_id == other._target_application_id &&
+        this->_source == other._source &&
+        this->_destination == other._destination &&
+        this->_neighbours == other._neighbours &&
+        this->_shared_objects == other._shared_objects &&
+        this->_priority == other._priority;
 }
 
 void sbn::kernel::read_header(kernel_buffer& in) {
@@ -80,6 +193,9 @@ void sbn::kernel::read_header(kernel_buffer& in) {
     }
     if (bool(this->_fields & fields::source)) { in >> this->_source; }
     if (bool(this->_fields & fields::destination)) { in >> this->_destination; }
+    if (bool(this->_fields & fields::neighbours)) { in >> this->_neighbours; }
+    if (bool(this->_fields & fields::shared_objects)) { in >> this->_shared_objects; }
+    if (bool(this->_fields & fields::priority)) { in >> this->_priority; }
 }
 
 void sbn::kernel::swap_header(kernel* k) {
@@ -88,11 +204,64 @@ void sbn::kernel::swap_header(kernel* k) {
     std::swap(this->_target_application, k->_target_application);
     std::swap(this->_source, k->_source);
     std::swap(this->_destination, k->_destination);
+    std::swap(this->_neighbours, k->_neighbours);
+    std::swap(this->_shared_objects, k->_shared_objects);
+    std::swap(this->_priority, k->_priority);
 }
 
 void sbn::kernel::act() {}
 void sbn::kernel::react(kernel_ptr&&) { throw ::sbn::error("empty react"); }
 void sbn::kernel::rollback() {}
+void sbn::kernel::merge(kernel&) { throw ::sbn::error("empty merge"); }
+
+bool sbn::kernel::can_merge(const kernel& other) const noexcept {
+    using p = phases;
+    return isset(kernel_flag::combinable) && other.isset(kernel_flag::combinable) &&
+        phase() == p::downstream && other.phase() == p::downstream &&
+        return_code() == exit_code::success && other.return_code() == exit_code::success &&
+        principal() && principal() == other.principal() &&
+        typeid(*this) == typeid(other);
+}
+
+bool sbn::kernel::cancelled() const noexcept {
+    const kernel* k = this;
+    while (true) {
+        if (k->_cancelled) { return true; }
+        const auto* p = k->parent();
+        if (!p) { break; }
+        k = p;
+    }
+    // the root of the local subtree was received from another process
+    return k->phase() == phases::upstream && k->isset(kernel_flag::parent_is_id) &&
+        cancelled_kernels.contains(*k);
+}
+
+bool sbn::kernel::same_identity(const kernel& notice) const noexcept {
+    return id() == notice.id() && old_id() == notice.old_id() &&
+        source_application_id() == notice.source_application_id() &&
+        target_application_id() == notice.target_application_id() &&
+        source() == notice.source();
+}
+
+void sbn::cancel_received_kernel(const kernel& notice) {
+    cancelled_kernels.add(notice);
+}
+
+void sbn::send_subordinates(kernel* principal, kernel_ptr_array&& children, pipeline& ppl) {
+    for (auto& k : children) { make_subordinate(principal, *k); }
+    for (auto& k : children) { ppl.send(std::move(k)); }
+}
+
+void sbn::commit(kernel_ptr&& k, pipeline& ppl) {
+    if (!k->has_parent()) {
+        const auto ret = k->return_code();
+        k.reset();
+        sbn::exit(static_cast<int>(ret == exit_code::undefined ? exit_code::success : ret));
+        return;
+    }
+    k->return_to_parent();
+    ppl.send(std::move(k));
+}
 
 void sbn::kernel::mark_as_deleted(kernel_sack& result) {
     if (isset(kernel_flag::deleted)) { return; }
@@ -121,6 +290,7 @@ std::ostream& sbn::operator<<(std::ostream& out, const kernel& rhs) {
         list("src", make_string(rhs.source())),
         list("dst", make_string(rhs.destination())),
         list("ret", rhs.return_code()),
+        list("priority", unsigned(rhs.priority())),
         list("src-app-id", rhs.source_application_id()),
         list("dst-app-id", rhs.target_application_id()),
         list("src-app", rhs.source_application()),
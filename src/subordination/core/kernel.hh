@@ -1,6 +1,8 @@
 #ifndef SUBORDINATION_CORE_KERNEL_HH
 #define SUBORDINATION_CORE_KERNEL_HH
 
+#include <atomic>
+
 #include <unistdx/base/log_message>
 #include <unistdx/net/socket_address>
 
@@ -31,6 +33,9 @@ namespace sbn {
         source_application = 1<<2,
         target_application = 1<<3,
         node_filter = 1<<4,
+        neighbours = 1<<5,
+        shared_objects = 1<<6,
+        priority = 1<<7,
     };
 
     UNISTDX_FLAGS(kernel_field);
@@ -41,8 +46,11 @@ namespace sbn {
         using id_type = uint64_t;
         template <class T> using pointer = ::sbn::pointer<T>;
         using weight_type = uint32_t;
+        using priority_type = sys::u8;
         using resource_expression = resources::Expression;
         using resource_expression_ptr = resources::expression_ptr;
+        using socket_address_array = std::vector<sys::socket_address>;
+        using shared_object_array = std::vector<uint64_t>;
 
     public:
         enum class phases: sys::u8 {
@@ -63,6 +71,10 @@ namespace sbn {
         phases _phase = phases::upstream;
         sys::socket_address _source{};
         sys::socket_address _destination{};
+        /// Cluster nodes to which collective kernel is propagated from this node.
+        socket_address_array _neighbours;
+        /// Hashes of the shared objects that the kernel reads.
+        shared_object_array _shared_objects;
         union {
             application::id_type _source_application_id = this_application::id();
             // TODO application registry
@@ -83,6 +95,7 @@ namespace sbn {
         std::string _path;
         weight_type _weight = 1;
         resource_expression_ptr _node_filter;
+        priority_type _priority = 0;
 
     protected:
         // node-local type id
@@ -93,6 +106,12 @@ namespace sbn {
 
     private:
         bool _routed = false;
+        // The number of subordinate kernels merged into this one. Node-local variable.
+        sys::u32 _num_merged = 1;
+        // Node-local variable that is set from any thread.
+        std::atomic<bool> _cancelled{false};
+        // The cancellation was sent to the node that executes the kernel. Node-local variable.
+        bool _cancellation_sent = false;
 
     public:
 
@@ -134,6 +153,25 @@ namespace sbn {
             return weight() == max_weight ? weight_array{1u,0u} : weight_array{0u,weight()};
         }
 
+        /**
+        \brief Kernels with higher priority are executed, sent to other nodes and
+        admitted to child processes before the kernels with lower priority.
+        \details Kernels with the same priority are processed in FIFO order.
+        The priority is written to the kernel header only if it is nonzero.
+        The priority is strict and there is no aging: kernels with lower
+        priority wait as long as there are kernels with higher priority,
+        and may starve if the latter arrive continuously.
+        */
+        inline priority_type priority() const noexcept { return this->_priority; }
+        inline void priority(priority_type rhs) noexcept {
+            this->_priority = rhs;
+            if (rhs == 0) {
+                this->_fields &= ~fields::priority;
+            } else {
+                this->_fields |= fields::priority;
+            }
+        }
+
         inline resource_expression* node_filter() noexcept { return this->_node_filter.get(); }
         inline const resource_expression* node_filter() const noexcept { return this->_node_filter.get(); }
         inline void node_filter(resource_expression_ptr&& rhs) {
@@ -176,6 +214,49 @@ namespace sbn {
             this->_destination = rhs;
         }
 
+        /**
+        \brief Neighbours of the current node in cluster node hierarchy
+        to which the collective kernel is propagated.
+        \details The field is set by the daemon for the kernels that have
+        \link kernel_flag::send_to_subordinate_node\endlink flag.
+        */
+        inline const socket_address_array& neighbours() const noexcept {
+            return this->_neighbours;
+        }
+
+        inline void neighbours(socket_address_array&& rhs) {
+            this->_neighbours = std::move(rhs);
+            if (this->_neighbours.empty()) {
+                this->_fields &= ~fields::neighbours;
+            } else {
+                this->_fields |= fields::neighbours;
+            }
+        }
+
+        /**
+        \brief Hashes of the objects from \link shared_object_store\endlink
+        that are used by the kernel.
+        \details The daemon fetches missing objects from the node that
+        sent the kernel before the kernel is delivered to the application.
+        */
+        inline const shared_object_array& shared_objects() const noexcept {
+            return this->_shared_objects;
+        }
+
+        inline void shared_objects(shared_object_array&& rhs) {
+            this->_shared_objects = std::move(rhs);
+            if (this->_shared_objects.empty()) {
+                this->_fields &= ~fields::shared_objects;
+            } else {
+                this->_fields |= fields::shared_objects;
+            }
+        }
+
+        inline void add_shared_object(uint64_t id) {
+            this->_shared_objects.emplace_back(id);
+            this->_fields |= fields::shared_objects;
+        }
+
         inline application::id_type
         source_application_id() const noexcept {
             return bool(this->_fields & fields::source_application)
@@ -277,6 +358,13 @@ namespace sbn {
         void read_header(kernel_buffer& in);
         void swap_header(kernel* k);
 
+        /**
+        \return true if both kernels are upstream kernels with the same parent
+        and the same header, i.e. they can be written in one batch
+        (see \link kernel_buffer::write\endlink).
+        */
+        bool shares_header(const kernel& other) const noexcept;
+
         inline const kernel*
         principal() const noexcept {
             if (bool(flags() & kernel_flag::principal_is_id)) { return nullptr; }
@@ -379,6 +467,48 @@ namespace sbn {
         /// \brief Garbage-collect.
         virtual void mark_as_deleted(kernel_sack& result);
 
+        /**
+        \brief Combiner: merges the result of \p other subordinate kernel
+        of the same principal into this kernel.
+        \details Parallel pipeline calls this method for the returning kernels
+        that have \link kernel_flag::combinable\endlink flag set and wait for
+        the principal in the same queue, so that the principal's
+        \link react\endlink is called once for the whole group.
+        The merge has to be associative and cheap, because it is executed
+        under the pipeline lock.
+        */
+        virtual void merge(kernel& other);
+
+        /// \return true if \p other can be merged into this kernel
+        bool can_merge(const kernel& other) const noexcept;
+
+        /// The number of subordinate kernels that this kernel represents.
+        inline sys::u32 num_merged() const noexcept { return this->_num_merged; }
+        inline void num_merged(sys::u32 rhs) noexcept { this->_num_merged = rhs; }
+
+        /**
+        \brief Mark the kernel as cancelled.
+        \details Use \link sbn::cancel\endlink to also remove the subordinate
+        kernels from the queues and to cancel them on other cluster nodes.
+        */
+        inline void cancel() noexcept { this->_cancelled = true; }
+
+        /**
+        \return true if the kernel or any of its principals was cancelled
+        \details Long-running kernels should check the flag periodically
+        and return to the parent early.
+        */
+        bool cancelled() const noexcept;
+
+        inline bool cancellation_sent() const noexcept { return this->_cancellation_sent; }
+        inline void cancellation_sent(bool rhs) noexcept { this->_cancellation_sent = rhs; }
+
+        /**
+        \return true if the kernel has the same identity as the kernel
+        with the header \p notice, i.e. the notice cancels this kernel
+        */
+        bool same_identity(const kernel& notice) const noexcept;
+
         friend std::ostream&
         operator<<(std::ostream& out, const kernel& rhs);
 
@@ -434,6 +564,82 @@ namespace sbn {
     std::ostream& operator<<(std::ostream& out, const kernel& rhs);
     std::ostream& operator<<(std::ostream& out, const kernel_ptr& rhs);
 
+    /**
+    Remember that the kernel with the identity of \p notice that this process
+    received from another process was cancelled, so that
+    \link kernel::cancelled\endlink returns true for the kernel
+    and its subordinates.
+    */
+    void cancel_received_kernel(const kernel& notice);
+
+    /**
+    Make \p child the subordinate of the \p principal.
+    The subordinate inherits the priority of the principal unless
+    its own priority is set.
+    */
+    inline void make_subordinate(kernel* principal, kernel& child) {
+        child.parent(principal);
+        if (child.priority() == 0) { child.priority(principal->priority()); }
+    }
+
+    /**
+    \brief Send the subordinate kernels of the \p principal to the pipeline.
+    \details The principal's \link kernel::react\endlink may run in another
+    thread as soon as the first subordinate is sent, hence all subordinates
+    have to be created before the call, and the principal must not be
+    accessed after the call.
+    */
+    void send_subordinates(kernel* principal, kernel_ptr_array&& children, pipeline& ppl);
+
+    /**
+    \brief Return the kernel to its parent through the pipeline.
+    \details The kernel without parent is the main kernel of the application,
+    the application exits with the return code of the kernel.
+    */
+    void commit(kernel_ptr&& k, pipeline& ppl);
+
+    /**
+    Insert the kernel into the \p queue after the last kernel with the same
+    or higher priority. If all kernels have the same priority, the queue
+    works as an ordinary FIFO queue.
+    */
+    template <class Queue> inline typename Queue::iterator
+    enqueue_by_priority(Queue& queue, kernel_ptr&& k) {
+        const auto p = k->priority();
+        auto first = queue.end();
+        while (first != queue.begin()) {
+            auto prev = first;
+            --prev;
+            if ((*prev)->priority() >= p) { break; }
+            first = prev;
+        }
+        return queue.insert(first, std::move(k));
+    }
+
+    /**
+    Insert the kernel into the \p queue after the last kernel with higher
+    priority or with the same priority and earlier deadline. Kernels without
+    deadline are executed after the kernels with deadline of the same priority.
+    */
+    template <class Queue> inline typename Queue::iterator
+    enqueue_by_deadline(Queue& queue, kernel_ptr&& k) {
+        if (!k->has_deadline()) { return enqueue_by_priority(queue, std::move(k)); }
+        const auto p = k->priority();
+        const auto t = k->deadline();
+        auto first = queue.end();
+        while (first != queue.begin()) {
+            auto prev = first;
+            --prev;
+            const auto& other = **prev;
+            if (other.priority() > p) { break; }
+            if (other.priority() == p && other.has_deadline() && other.deadline() <= t) {
+                break;
+            }
+            first = prev;
+        }
+        return queue.insert(first, std::move(k));
+    }
+
     inline sbn::kernel_buffer&
     operator<<(sbn::kernel_buffer& out, const kernel& rhs) {
         rhs.write(out);
@@ -5,7 +5,7 @@
 #include <subordination/core/kernel_base.hh>
 
 namespace {
-    std::array<const char*,7> all_exit_codes{
+    std::array<const char*,8> all_exit_codes{
         "success",
         "undefined",
         "error",
@@ -13,6 +13,7 @@ namespace {
         "no_principal_found",
         "no_upstream_servers_available",
         "no_resources",
+        "cancelled",
     };
 }
 
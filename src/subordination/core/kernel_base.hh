@@ -18,6 +18,8 @@ namespace sbn {
         no_principal_found = 4,
         no_upstream_servers_available = 5,
         no_resources = 6,
+        /** The kernel was cancelled before it was executed (see \link sbn::cancel\endlink). */
+        cancelled = 7,
     };
 
     const char* to_string(exit_code rhs) noexcept;
@@ -42,10 +44,19 @@ namespace sbn {
         transactional = 1<<4,
         /** Send the kernel to the superior of cluster node hierarchy. */
         send_to_superior_node = 1<<5,
-        /** Send the kernel to all of the subordinates of cluster node hierarchy. */
+        /** Send the kernel to all of the subordinates of cluster node hierarchy
+        (see \link sbn::collective_kernel\endlink). */
         send_to_subordinate_node = 1<<6,
         /** Allocate a separate thread to execute the kernel in parallel pipeline. */
         new_thread = 1<<7,
+        /** The kernel has a combiner (see \link sbn::kernel::merge\endlink). */
+        combinable = 1<<8,
+        /** The kernel can be executed more than once. The daemon may launch
+        a speculative copy of the kernel on another node when the kernel
+        runs much longer than the other kernels of the same type. */
+        idempotent = 1<<9,
+        /** The kernel has a deadline (see \link sbn::kernel_base::deadline\endlink). */
+        deadline = 1<<10,
     };
 
     UNISTDX_FLAGS(kernel_flag)
@@ -61,6 +72,7 @@ namespace sbn {
     protected:
         exit_code _result = exit_code::undefined;
         time_point _at{};
+        time_point _deadline{};
         kernel_flag _flags{};
 
     public:
@@ -84,6 +96,31 @@ namespace sbn {
             return this->_at != time_point(duration::zero());
         }
 
+        // kernels with deadlines
+        inline time_point deadline() const noexcept { return this->_deadline; }
+
+        /**
+        Set the time point by which the kernel should be completed.
+        Parallel pipeline in earliest-deadline-first mode executes such kernels
+        in the order of their deadlines, and the daemon prefers the nodes
+        that are expected to finish the kernel in time.
+        */
+        inline void deadline(time_point t) noexcept {
+            this->_deadline = t;
+            this->_flags |= kernel_flag::deadline;
+        }
+
+        inline void deadline_after(duration delay) noexcept {
+            deadline(clock_type::now() + delay);
+        }
+
+        inline bool has_deadline() const noexcept { return isset(kernel_flag::deadline); }
+
+        inline bool
+        deadline_missed(time_point now=clock_type::now()) const noexcept {
+            return has_deadline() && this->_deadline < now;
+        }
+
         inline bool new_thread() const noexcept {
             return isset(kernel_flag::new_thread);
         }
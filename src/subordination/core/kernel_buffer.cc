@@ -76,9 +76,56 @@ void sbn::kernel_buffer::write(const kernel* k) {
     }
 }
 
+void sbn::kernel_buffer::write(const kernel_ptr* kernels, size_t n) {
+    Expects(n != 0);
+    const auto* first = kernels[0].get();
+    first->write_header(*this);
+    this->_batch_parent_id = first->parent_id();
+    this->write(this->_batch_parent_id);
+    this->_batch = true;
+    try {
+        for (size_t i=0; i<n; ++i) {
+            const auto* k = kernels[i].get();
+            kernel_frame frame;
+            kernel_write_guard g(frame, *this);
+            if (k->is_foreign()) { k->write(*this); }
+            else { write_native(this, k); }
+        }
+    } catch (...) {
+        this->_batch = false;
+        throw;
+    }
+    this->_batch = false;
+}
+
+void sbn::kernel_buffer::begin_batch() {
+    this->_batch_header_position = position();
+    // skip the header
+    foreign_kernel tmp;
+    tmp.read_header(*this);
+    this->read(this->_batch_parent_id);
+    this->_batch = true;
+}
+
 void sbn::kernel_buffer::read(kernel_ptr& k) {
     foreign_kernel_ptr fk(new foreign_kernel);
-    fk->read_header(*this);
+    if (this->_batch) {
+        // all kernels of the batch share the header
+        const auto old_position = position();
+        position(this->_batch_header_position);
+        fk->read_header(*this);
+        position(old_position);
+        kernel_frame frame;
+        kernel_read_guard g(frame, *this);
+        if (!g) { throw_error("bad kernel batch"); }
+        read_body(fk, k);
+    } else {
+        fk->read_header(*this);
+        read_body(fk, k);
+    }
+}
+
+void sbn::kernel_buffer::read_body(foreign_kernel_ptr& fk, kernel_ptr& k) {
     if (fk->target_application_id() != this_application::id()) {
         fk->read(*this);
         k = std::move(fk);
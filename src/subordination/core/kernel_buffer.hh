@@ -21,6 +21,10 @@ namespace sbn {
     private:
         kernel_type_registry* _types = nullptr;
         bool _carry_all_parents = false;
+        // the state of the batch that is being read or written
+        bool _batch = false;
+        sys::u64 _batch_parent_id = 0;
+        size_type _batch_header_position = 0;
 
     public:
         using sys::byte_buffer::byte_buffer;
@@ -60,6 +64,24 @@ namespace sbn {
         inline void write(const kernel_ptr& k) { this->write(k.get()); }
         void read(kernel_ptr& k);
 
+        /**
+        \brief Write the kernels that share the header (see \link kernel::shares_header\endlink).
+        \details The header and the parent id are written once for all kernels,
+        each kernel is then written in its own frame. The whole batch has to be
+        written in the frame that has \link kernel_frame::batch\endlink flag set.
+        */
+        void write(const kernel_ptr* kernels, size_t n);
+
+        /**
+        \brief Read the shared header of the batch.
+        \details After that each call to \link read\endlink reads the next kernel of
+        the batch until the end of the frame is reached.
+        */
+        void begin_batch();
+        inline void end_batch() noexcept { this->_batch = false; }
+        inline bool batch() const noexcept { return this->_batch; }
+        inline sys::u64 batch_parent_id() const noexcept { return this->_batch_parent_id; }
+
         template <class T> inline kernel_buffer&
         operator<<(const T& rhs) { this->write(rhs); return *this; }
 
@@ -72,6 +94,9 @@ namespace sbn {
         inline void carry_all_parents(bool rhs) noexcept { this->_carry_all_parents = rhs; }
         inline bool carry_all_parents() const noexcept { return this->_carry_all_parents; }
 
+    private:
+        void read_body(foreign_kernel_ptr& fk, kernel_ptr& k);
+
     };
 
     class kernel_frame {
@@ -79,12 +104,39 @@ namespace sbn {
     public:
         using size_type = sys::u32;
 
+    private:
+        /// The highest bit of the size marks the frame with multiple kernels.
+        static constexpr const size_type batch_bit = size_type(1) << 31;
+        /// The next bit marks the frame with the cancellation notice.
+        static constexpr const size_type cancel_bit = size_type(1) << 30;
+        static constexpr const size_type flag_bits = batch_bit | cancel_bit;
+
     private:
         size_type _size = 0;
 
     public:
-        inline void size(size_type rhs) noexcept { this->_size = rhs; }
-        inline size_type size() const noexcept { return this->_size; }
+
+        inline void size(size_type rhs) noexcept {
+            this->_size = (rhs & ~flag_bits) | (this->_size & flag_bits);
+        }
+
+        inline size_type size() const noexcept { return this->_size & ~flag_bits; }
+
+        inline void batch(bool rhs) noexcept {
+            if (rhs) { this->_size |= batch_bit; } else { this->_size &= ~batch_bit; }
+        }
+
+        inline bool batch() const noexcept { return (this->_size & batch_bit) != 0; }
+
+        inline void cancel(bool rhs) noexcept {
+            if (rhs) { this->_size |= cancel_bit; } else { this->_size &= ~cancel_bit; }
+        }
+
+        /**
+        \return true if the frame contains the header, the identifier and
+        the old identifier of the kernel that was cancelled on the sender node
+        */
+        inline bool cancel() const noexcept { return (this->_size & cancel_bit) != 0; }
 
     };
 
@@ -1,5 +1,10 @@
+#include <chrono>
+#include <deque>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include <subordination/core/application.hh>
 #include <subordination/core/foreign_kernel.hh>
 #include <subordination/core/kernel.hh>
 #include <subordination/core/kernel_buffer.hh>
@@ -66,6 +71,19 @@ TEST(interface_address, ipv6) {
     }
 }
 
+TEST(application, priority_and_share) {
+    sbn::application a({"app"}, {}), b;
+    a.priority(3);
+    a.share(5);
+    sbn::kernel_buffer buf;
+    buf << a;
+    buf.flip();
+    buf >> b;
+    EXPECT_EQ(3u, b.priority());
+    EXPECT_EQ(5u, b.share());
+    EXPECT_EQ(buf.limit(), buf.position());
+}
+
 TEST(frame, _) {
     sys::u32 x = 123, y;
     sbn::kernel_buffer buf;
@@ -110,6 +128,97 @@ TEST(frame, empty) {
     EXPECT_EQ(0u, buf.position());
 }
 
+TEST(frame, cancel) {
+    sbn::kernel k;
+    k.id(123);
+    k.old_id(45);
+    k.source_application_id(6);
+    k.target_application_id(7);
+    sbn::kernel_buffer buf;
+    {
+        sbn::kernel_frame frame;
+        frame.cancel(true);
+        sbn::kernel_write_guard g(frame, buf);
+        k.write_header(buf);
+        buf << k.id() << k.old_id();
+    }
+    buf.flip();
+    {
+        sbn::kernel_frame frame;
+        sbn::kernel_read_guard g(frame, buf);
+        EXPECT_TRUE(g);
+        EXPECT_TRUE(frame.cancel());
+        EXPECT_FALSE(frame.batch());
+        EXPECT_EQ(buf.limit(), frame.size());
+        sbn::kernel notice;
+        notice.read_header(buf);
+        sbn::kernel::id_type id = 0, old_id = 0;
+        buf >> id >> old_id;
+        notice.id(id);
+        notice.old_id(old_id);
+        EXPECT_TRUE(k.same_identity(notice));
+        notice.id(124);
+        EXPECT_FALSE(k.same_identity(notice));
+    }
+}
+
+TEST(kernel, priority) {
+    sbn::kernel a, b;
+    sbn::kernel_buffer buf;
+    a.write_header(buf);
+    const auto size = buf.position();
+    a.priority(3);
+    a.write_header(buf);
+    // zero priority is not written
+    EXPECT_EQ(size+1, buf.position()-size);
+    buf.flip();
+    b.read_header(buf);
+    EXPECT_EQ(0u, b.priority());
+    b.read_header(buf);
+    EXPECT_EQ(3u, b.priority());
+    std::deque<sbn::kernel_ptr> queue;
+    for (sys::u8 p : {0, 1, 0, 2, 1}) {
+        sbn::kernel_ptr k(new sbn::kernel);
+        k->id(queue.size()+1);
+        k->priority(p);
+        sbn::enqueue_by_priority(queue, std::move(k));
+    }
+    std::vector<sbn::kernel::id_type> ids;
+    for (const auto& k : queue) { ids.emplace_back(k->id()); }
+    EXPECT_EQ((std::vector<sbn::kernel::id_type>{4, 2, 5, 1, 3}), ids);
+}
+
+TEST(kernel, deadline) {
+    using clock_type = sbn::kernel::clock_type;
+    using std::chrono::seconds;
+    sbn::kernel a, b;
+    const auto t0 = clock_type::now();
+    a.deadline(t0);
+    sbn::kernel_buffer buf;
+    a.write(buf);
+    buf.flip();
+    b.read(buf);
+    EXPECT_TRUE(b.has_deadline());
+    EXPECT_EQ(t0, b.deadline());
+    EXPECT_FALSE(b.deadline_missed(t0));
+    EXPECT_TRUE(b.deadline_missed(t0 + seconds(1)));
+    // kernels of the same priority are ordered by their deadlines,
+    // kernels without deadline are executed last
+    struct { sys::u8 priority; int deadline; } params[] =
+        {{0,-1}, {0,3}, {0,1}, {1,-1}, {0,2}, {0,1}};
+    std::deque<sbn::kernel_ptr> queue;
+    for (const auto& p : params) {
+        sbn::kernel_ptr k(new sbn::kernel);
+        k->id(queue.size()+1);
+        k->priority(p.priority);
+        if (p.deadline >= 0) { k->deadline(t0 + seconds(p.deadline)); }
+        sbn::enqueue_by_deadline(queue, std::move(k));
+    }
+    std::vector<sbn::kernel::id_type> ids;
+    for (const auto& k : queue) { ids.emplace_back(k->id()); }
+    EXPECT_EQ((std::vector<sbn::kernel::id_type>{4, 3, 6, 5, 2, 1}), ids);
+}
+
 class Test_kernel: public sbn::kernel {
 private:
     sys::u32 _number = 0;
@@ -180,3 +289,48 @@ TEST(kernel, with_type) {
     buf.compact();
     EXPECT_EQ(0u, buf.position());
 }
+
+TEST(kernel, batch) {
+    sbn::kernel_type_registry types;
+    types.add<Test_kernel>(333);
+    Test_kernel parent;
+    parent.id(777);
+    sbn::kernel_ptr_array kernels;
+    for (sys::u32 i=0; i<3; ++i) {
+        auto* k = new Test_kernel;
+        k->number(100+i);
+        k->parent(&parent);
+        kernels.emplace_back(k);
+    }
+    EXPECT_TRUE(kernels[0]->shares_header(*kernels[1]));
+    sbn::kernel_buffer buf;
+    buf.types(&types);
+    {
+        sbn::kernel_frame frame;
+        frame.batch(true);
+        sbn::kernel_write_guard g(frame, buf);
+        buf.write(kernels.data(), kernels.size());
+    }
+    buf.flip();
+    {
+        sbn::kernel_frame frame;
+        sbn::kernel_read_guard g(frame, buf);
+        EXPECT_TRUE(g);
+        EXPECT_TRUE(frame.batch());
+        buf.begin_batch();
+        sys::u32 i = 0;
+        while (buf.position() != buf.limit()) {
+            sbn::kernel_ptr k;
+            buf.read(k);
+            auto* tk = dynamic_cast<Test_kernel*>(k.get());
+            ASSERT_NE(nullptr, tk);
+            EXPECT_EQ(100+i, tk->number());
+            EXPECT_EQ(777u, tk->parent_id());
+            ++i;
+        }
+        buf.end_batch();
+        EXPECT_EQ(3u, i);
+    }
+    buf.compact();
+    EXPECT_EQ(0u, buf.position());
+}
@@ -0,0 +1,21 @@
+#include <gtest/gtest.h>
+
+#include <subordination/core/kernel.hh>
+#include <subordination/test/kernel_collector.hh>
+
+TEST(kernel, send_subordinates) {
+    test::Kernel_collector ppl;
+    sbn::kernel principal;
+    principal.priority(3);
+    sbn::kernel_ptr_array children;
+    children.emplace_back(sbn::make_pointer<sbn::kernel>());
+    children.emplace_back(sbn::make_pointer<sbn::kernel>());
+    children.back()->priority(1);
+    sbn::send_subordinates(&principal, std::move(children), ppl);
+    auto kernels = ppl.wait_for(2);
+    ASSERT_EQ(2u, kernels.size());
+    for (const auto& k : kernels) { EXPECT_EQ(&principal, k->parent()); }
+    // the subordinate inherits the priority unless its own priority is set
+    EXPECT_EQ(3u, kernels.front()->priority());
+    EXPECT_EQ(1u, kernels.back()->priority());
+}
@@ -0,0 +1,162 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <subordination/api.hh>
+#include <subordination/core/error_handler.hh>
+
+/*
+Computes the sum of square roots of the first N integers using
+hand-written kernels (one kernel per chunk, the same as in autoreg example),
+sbn::map_reduce with automatic grain size and sbn::map followed by
+sequential summation, and reports the time of each method.
+
+Usage: map-reduce-benchmark [N] [repetitions]
+*/
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using index_type = sys::u64;
+
+    index_type num_elements = index_type(1) << 24;
+    int num_repetitions = 5;
+
+    struct square_root {
+        inline double operator()(index_type i) const { return std::sqrt(double(i)); }
+    };
+
+    struct plus {
+        inline double operator()(double a, double b) const { return a+b; }
+    };
+
+    class Worker: public sbn::kernel {
+
+    private:
+        index_type _first, _last;
+        double _sum = 0;
+
+    public:
+        inline Worker(index_type first, index_type last): _first(first), _last(last) {}
+
+        void act() override {
+            square_root f;
+            for (auto i=this->_first; i<this->_last; ++i) { this->_sum += f(i); }
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        inline double sum() const noexcept { return this->_sum; }
+
+    };
+
+    class Hand_written: public sbn::kernel {
+
+    private:
+        index_type _num_kernels = 0, _num_completed = 0;
+        double _sum = 0;
+
+    public:
+
+        void act() override {
+            const auto grain = sbn::grain_size(num_elements);
+            this->_num_kernels = (num_elements + grain - 1) / grain;
+            for (index_type i=0; i<num_elements; i+=grain) {
+                sbn::upstream<sbn::Local>(
+                    this, sbn::make_pointer<Worker>(i, std::min(i+grain, num_elements)));
+            }
+        }
+
+        void react(sbn::kernel_ptr&& k) override {
+            this->_sum += sbn::pointer_dynamic_cast<Worker>(std::move(k))->sum();
+            if (++this->_num_completed == this->_num_kernels) {
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+            }
+        }
+
+        inline double sum() const noexcept { return this->_sum; }
+
+    };
+
+    enum class methods { hand_written, map_reduce, map, size };
+
+    const char* to_string(methods rhs) noexcept {
+        switch (rhs) {
+            case methods::hand_written: return "hand-written";
+            case methods::map_reduce: return "map-reduce";
+            case methods::map: return "map";
+            default: return "<unknown>";
+        }
+    }
+
+    class Main: public sbn::kernel {
+
+    private:
+        int _method = 0;
+        int _repetition = 0;
+        clock_type::time_point _start;
+
+    public:
+
+        void act() override {
+            std::cout << std::setw(20) << std::left << "method"
+                << std::setw(20) << "time" << "sum\n";
+            next();
+        }
+
+        void react(sbn::kernel_ptr&& k) override {
+            using namespace std::chrono;
+            const auto t = duration_cast<duration<double>>(clock_type::now()-this->_start);
+            double sum = 0;
+            if (auto* a = dynamic_cast<Hand_written*>(k.get())) {
+                sum = a->sum();
+            } else if (auto* b = dynamic_cast<sbn::map_reduce_result<double>*>(k.get())) {
+                sum = b->result();
+            } else if (auto* c = dynamic_cast<sbn::map_result<double>*>(k.get())) {
+                for (auto x : c->result()) { sum += x; }
+            }
+            std::cout << std::setw(20) << to_string(methods(this->_method))
+                << std::setw(20) << t.count() << sum << std::endl;
+            if (++this->_repetition == num_repetitions) {
+                this->_repetition = 0;
+                ++this->_method;
+            }
+            if (this->_method == int(methods::size)) {
+                sbn::commit<sbn::Local>(std::move(this_ptr()));
+                return;
+            }
+            next();
+        }
+
+    private:
+
+        void next() {
+            this->_start = clock_type::now();
+            switch (methods(this->_method)) {
+                case methods::hand_written:
+                    sbn::upstream<sbn::Local>(this, sbn::make_pointer<Hand_written>());
+                    break;
+                case methods::map_reduce:
+                    sbn::map_reduce(this, index_type(0), num_elements, 0.0,
+                                    square_root(), plus());
+                    break;
+                case methods::map:
+                    sbn::map(this, index_type(0), num_elements, square_root());
+                    break;
+                default: break;
+            }
+        }
+
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2) { num_elements = std::stoull(argv[1]); }
+    if (argc >= 3) { num_repetitions = std::stoi(argv[2]); }
+    sbn::install_error_handler();
+    sbn::factory_guard g;
+    sbn::send(sbn::make_pointer<Main>());
+    return sbn::wait_and_return();
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include <subordination/api.hh>
+#include <subordination/core/error_handler.hh>
+#include <subordination/core/generator_kernel.hh>
+
+namespace {
+
+    constexpr const int num_elements = 1000;
+    std::atomic<int> num_calls{0};
+    std::vector<int> squares;
+    int sum = 0;
+    int generated_sum = 0;
+    size_t max_observed_children_in_flight = 0;
+
+    class Square: public sbn::kernel {
+
+    private:
+        int _value;
+
+    public:
+        inline explicit Square(int value): _value(value) {}
+
+        void act() override {
+            this->_value *= this->_value;
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        inline int value() const noexcept { return this->_value; }
+
+    };
+
+    class Square_generator: public sbn::generator_kernel {
+
+    private:
+        int _index = 0;
+        int _sum = 0;
+
+    public:
+        Square_generator() { max_children_in_flight(4); }
+
+        inline int sum() const noexcept { return this->_sum; }
+
+    protected:
+
+        sbn::kernel_ptr next_child() override {
+            max_observed_children_in_flight =
+                std::max(max_observed_children_in_flight, num_children_in_flight());
+            if (this->_index == num_elements) { return nullptr; }
+            return sbn::make_pointer<Square>(this->_index++);
+        }
+
+        void collect_child(sbn::kernel_ptr&& child) override {
+            this->_sum += sbn::pointer_dynamic_cast<Square>(std::move(child))->value();
+        }
+
+    };
+
+    class Main: public sbn::kernel {
+
+    private:
+        int _step = 0;
+
+    public:
+
+        void act() override {
+            sbn::parallel_for(this, 0, num_elements, [] (int) { ++num_calls; });
+        }
+
+        void react(sbn::kernel_ptr&& k) override {
+            if (auto* a = dynamic_cast<sbn::map_result<int>*>(k.get())) {
+                squares = a->result();
+            } else if (auto* b = dynamic_cast<sbn::map_reduce_result<int>*>(k.get())) {
+                sum = b->result();
+            } else if (auto* c = dynamic_cast<Square_generator*>(k.get())) {
+                generated_sum = c->sum();
+            }
+            switch (++this->_step) {
+                case 1:
+                    sbn::map(this, 0, num_elements, [] (int i) { return i*i; });
+                    break;
+                case 2:
+                    sbn::map_reduce(this, 1, num_elements+1, 0,
+                                    [] (int i) { return i; },
+                                    [] (int a, int b) { return a+b; });
+                    break;
+                case 3:
+                    sbn::upstream<sbn::Local>(this, sbn::make_pointer<Square_generator>());
+                    break;
+                default:
+                    sbn::commit<sbn::Local>(std::move(this_ptr()));
+                    break;
+            }
+        }
+
+    };
+
+}
+
+TEST(map_reduce, local) {
+    int ret = 0;
+    {
+        sbn::factory_guard g;
+        sbn::send(sbn::make_pointer<Main>());
+        ret = sbn::wait_and_return();
+    }
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(num_elements, num_calls);
+    ASSERT_EQ(size_t(num_elements), squares.size());
+    for (int i=0; i<num_elements; ++i) { EXPECT_EQ(i*i, squares[i]); }
+    EXPECT_EQ(num_elements*(num_elements+1)/2, sum);
+    EXPECT_EQ((num_elements-1)*num_elements*(2*num_elements-1)/6, generated_sum);
+    EXPECT_LE(max_observed_children_in_flight, 4u);
+}
+
+TEST(map_reduce, grain_size) {
+    EXPECT_EQ(1, sbn::grain_size(0));
+    EXPECT_EQ(1, sbn::grain_size(1));
+    EXPECT_LE(sbn::grain_size(1000), 1000);
+}
+
+int main(int argc, char* argv[]) {
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
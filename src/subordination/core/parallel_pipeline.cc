@@ -6,6 +6,7 @@
 #include <subordination/core/basic_pipeline.hh>
 #include <subordination/core/list.hh>
 #include <subordination/core/parallel_pipeline.hh>
+#include <subordination/core/properties.hh>
 
 namespace {
 
@@ -85,6 +86,13 @@ namespace {
         }
     }
 
+    /// Cancelled kernels that can be returned to their parents.
+    inline bool cancellable(const sbn::kernel& k) noexcept {
+        if (k.phase() != sbn::kernel::phases::upstream) { return false; }
+        if (!k.parent() && !(k.has_parent() && k.source_pipeline())) { return false; }
+        return k.cancelled();
+    }
+
     inline void process_kernel(sbn::kernel_ptr&& k, sbn::parallel_pipeline* this_pipeline) {
         try {
             act(k);
@@ -104,17 +112,23 @@ namespace {
 
 }
 
-void sbn::parallel_pipeline::upstream_loop(kernel_queue& downstream) {
+void sbn::parallel_pipeline::upstream_loop(kernel_queue& downstream,
+                                           combiner_table& combiners) {
     lock_type lock(this->_mutex);
-    this->_upstream_semaphore.wait(lock, [this,&lock,&downstream] () {
+    this->_upstream_semaphore.wait(lock, [this,&lock,&downstream,&combiners] () {
         auto& upstream = this->_upstream_kernels;
         bool downstream_not_empty, upstream_not_empty;
         while ((downstream_not_empty = this->_downstream_threads.empty() &&
                                        !downstream.empty()) ||
                (upstream_not_empty = !upstream.empty())) {
-            auto& queue = (downstream_not_empty ? downstream : upstream);
-            auto k = std::move(queue.front());
-            queue.pop_front();
+            kernel_ptr k;
+            if (downstream_not_empty) {
+                k = pop_downstream(downstream, combiners);
+            } else {
+                k = upstream.pop();
+                if (this->_max_upstream_kernels != 0) { this->_producer_semaphore.notify_one(); }
+                if (k->deadline_missed()) { ++this->_num_missed_deadlines; }
+            }
             sys::unlock_guard<lock_type> g(lock);
             process_kernel(std::move(k), this);
         }
@@ -143,12 +157,12 @@ void sbn::parallel_pipeline::timer_loop() {
     }
 }
 
-void sbn::parallel_pipeline::downstream_loop(kernel_queue& queue, semaphore_type& semaphore) {
+void sbn::parallel_pipeline::downstream_loop(kernel_queue& queue, combiner_table& combiners,
+                                             semaphore_type& semaphore) {
     lock_type lock(this->_mutex);
-    semaphore.wait(lock, [this,&lock,&queue] () {
+    semaphore.wait(lock, [this,&lock,&queue,&combiners] () {
         while (!queue.empty()) {
-            auto k = std::move(queue.front());
-            queue.pop_front();
+            auto k = pop_downstream(queue, combiners);
             sys::unlock_guard<lock_type> g(lock);
             process_kernel(std::move(k), this);
         }
@@ -166,8 +180,9 @@ void sbn::parallel_pipeline::upstream_start(size_t num_threads) {
                 #if defined(UNISTDX_HAVE_PRCTL)
                 ::prctl(PR_SET_NAME, this->_name);
                 #endif
+                is_pipeline_thread(true);
                 if (this->_thread_init) { this->_thread_init(i); }
-                this->upstream_loop(this->_downstream_kernels[i]);
+                this->upstream_loop(this->_downstream_kernels[i], this->_combiners[i]);
             });
     }
 }
@@ -198,8 +213,9 @@ void sbn::parallel_pipeline::downstream_start(size_t num_threads) {
                 #if defined(UNISTDX_HAVE_PRCTL)
                 ::prctl(PR_SET_NAME, this->_name);
                 #endif
+                is_pipeline_thread(true);
                 if (this->_thread_init) { this->_thread_init(i); }
-                this->downstream_loop(this->_downstream_kernels[i],
+                this->downstream_loop(this->_downstream_kernels[i], this->_combiners[i],
                                       this->_downstream_semaphores[i]);
             });
     }
@@ -212,6 +228,7 @@ void sbn::parallel_pipeline::timer_start() {
         #if defined(UNISTDX_HAVE_PRCTL)
         ::prctl(PR_SET_NAME, this->_name);
         #endif
+        is_pipeline_thread(true);
         if (this->_thread_init) { this->_thread_init(0); }
         this->timer_loop();
     });
@@ -224,6 +241,7 @@ void sbn::parallel_pipeline::start() {
     const auto num_downstream_threads = this->_downstream_threads.size();
     if (num_downstream_threads == 0) {
         this->_downstream_kernels = kernel_queue_array(num_upstream_threads);
+        this->_combiners = combiner_table_array(num_upstream_threads);
     }
     upstream_start(num_upstream_threads);
     timer_start();
@@ -236,6 +254,7 @@ void sbn::parallel_pipeline::stop() {
     this->setstate(states::stopping);
     this->_upstream_semaphore.notify_all();
     this->_timer_semaphore.notify_all();
+    this->_producer_semaphore.notify_all();
     for (auto& s : this->_downstream_semaphores) { s.notify_all(); }
 }
 
@@ -249,9 +268,35 @@ void sbn::parallel_pipeline::wait() {
 }
 
 void sbn::parallel_pipeline::clear(kernel_sack& sack) {
-    clear_deque(this->_upstream_kernels, sack);
+    this->_upstream_kernels.clear(sack);
     clear_queue(this->_timer_kernels, sack);
     for (auto& queue : this->_downstream_kernels) { clear_deque(queue, sack); }
+    for (auto& combiners : this->_combiners) { combiners.clear(); }
+}
+
+bool sbn::parallel_pipeline::full() const {
+    lock_type lock(this->_mutex);
+    return upstream_full();
+}
+
+void sbn::parallel_pipeline::cancel() {
+    kernel_ptr_array cancelled;
+    {
+        lock_type lock(this->_mutex);
+        this->_upstream_kernels.remove_if(cancellable, cancelled);
+        this->_timer_kernels.remove_if(cancellable, cancelled);
+        if (cancelled.empty()) { return; }
+        this->_timer_semaphore.notify_one();
+        if (this->_max_upstream_kernels != 0) { this->_producer_semaphore.notify_all(); }
+    }
+    for (auto& k : cancelled) {
+        #if defined(SBN_DEBUG)
+        this->log("cancel _", *k);
+        #endif
+        auto* ppl = k->parent() ? static_cast<pipeline*>(this) : k->source_pipeline();
+        k->return_to_parent(exit_code::cancelled);
+        ppl->send(std::move(k));
+    }
 }
 
 void sbn::parallel_pipeline::num_downstream_threads(size_t n) {
@@ -263,6 +308,7 @@ void sbn::parallel_pipeline::num_downstream_threads(size_t n) {
                  }
     }
     this->_downstream_kernels = kernel_queue_array(n);
+    this->_combiners = combiner_table_array(n);
     this->_downstream_semaphores = semaphore_array(n);
 }
 
@@ -303,6 +349,10 @@ bool sbn::parallel_pipeline::properties::set(const char* key, const std::string&
         std::stringstream tmp(value);
         tmp >> kernel_cpus;
         if (!tmp) { throw std::invalid_argument("bad cpu mask"); }
+    } else if (std::strcmp(key, "max-upstream-kernels") == 0) {
+        max_upstream_kernels = std::stoul(value);
+    } else if (std::strcmp(key, "earliest-deadline-first") == 0) {
+        earliest_deadline_first = string_to_bool(value);
     } else {
         found = false;
     }
@@ -316,6 +366,8 @@ void sbn::parallel_pipeline::write(std::ostream& out) const {
     out << list(
         list("upstream-kernels", make_list_view(this->_upstream_kernels)),
         list("downstream-kernels", make_list_view(tmp)),
-        list("timer-kernels-count", this->_timer_kernels.size())
+        list("timer-kernels-count", this->_timer_kernels.size()),
+        list("merged-kernels", this->_num_merged_kernels),
+        list("missed-deadlines", this->_num_missed_deadlines)
     );
 }
@@ -1,9 +1,11 @@
 #ifndef SUBORDINATION_CORE_PARALLEL_PIPELINE_HH
 #define SUBORDINATION_CORE_PARALLEL_PIPELINE_HH
 
+#include <algorithm>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
 
 #include <subordination/bits/contracts.hh>
 #include <subordination/core/pipeline_base.hh>
@@ -21,6 +23,10 @@ namespace sbn {
             sys::cpu_set kernel_cpus;
             unsigned num_downstream_threads = 0;
             unsigned num_upstream_threads;
+            /// The maximal number of kernels in the upstream queue (0 means unbounded).
+            size_t max_upstream_kernels = 0;
+            /// Execute upstream kernels in the order of their deadlines.
+            bool earliest_deadline_first = false;
 
             inline properties(): properties{sys::this_process::cpus()} {}
 
@@ -51,15 +57,141 @@ namespace sbn {
     private:
         struct compare_time {
             inline bool operator()(const kernel_ptr& a, const kernel_ptr& b) const noexcept {
-                return a->at() > b->at();
+                return a->at() > b->at() ||
+                    (a->at() == b->at() && a->priority() < b->priority());
+            }
+        };
+
+        /// The upstream kernel and its position in the order of arrival.
+        struct upstream_kernel {
+            kernel_ptr ptr;
+            uint64_t sequence;
+            inline friend std::ostream&
+            operator<<(std::ostream& out, const upstream_kernel& rhs) {
+                return out << rhs.ptr;
+            }
+        };
+
+        /**
+        Kernels with higher priority go first, then (in EDF mode) kernels with
+        earlier deadline, then kernels without deadline, then the kernels
+        in the order of arrival.
+        */
+        struct compare_upstream {
+            bool earliest_deadline_first = false;
+            inline bool
+            operator()(const upstream_kernel& a, const upstream_kernel& b) const noexcept {
+                const auto& x = *a.ptr;
+                const auto& y = *b.ptr;
+                if (x.priority() != y.priority()) { return x.priority() < y.priority(); }
+                if (this->earliest_deadline_first) {
+                    if (x.has_deadline() != y.has_deadline()) { return !x.has_deadline(); }
+                    if (x.has_deadline() && x.deadline() != y.deadline()) {
+                        return x.deadline() > y.deadline();
+                    }
+                }
+                return a.sequence > b.sequence;
             }
         };
 
     private:
         using kernel_queue = std::deque<kernel_ptr>;
         using kernel_queue_array = std::vector<kernel_queue>;
-        using kernel_priority_queue =
-            std::priority_queue<kernel_ptr,std::vector<kernel_ptr>,compare_time>;
+        /// The last queued combinable kernel of each principal.
+        using combiner_table = std::unordered_map<const kernel*,kernel*>;
+        using combiner_table_array = std::vector<combiner_table>;
+
+        class kernel_priority_queue:
+        public std::priority_queue<kernel_ptr,std::vector<kernel_ptr>,compare_time> {
+
+        public:
+
+            /// The kernel with the earliest time.
+            inline reference front() noexcept { return this->c.front(); }
+            inline const_reference front() const noexcept { return this->c.front(); }
+
+            /// Move the kernels that match the predicate to \p removed.
+            template <class Pred> inline void
+            remove_if(Pred pred, kernel_ptr_array& removed) {
+                auto& c = this->c;
+                auto first = c.begin(), last = c.end(), result = first;
+                for (; first != last; ++first) {
+                    if (pred(**first)) {
+                        removed.emplace_back(std::move(*first));
+                    } else {
+                        if (result != first) { *result = std::move(*first); }
+                        ++result;
+                    }
+                }
+                if (result == last) { return; }
+                c.erase(result, last);
+                std::make_heap(c.begin(), c.end(), this->comp);
+            }
+
+        };
+
+        /**
+        \brief Binary heap of upstream kernels.
+        \details Insertion and removal take logarithmic time even when
+        kernels with different priorities and deadlines arrive in bursts.
+        */
+        class upstream_kernel_queue:
+        public std::priority_queue<upstream_kernel,std::vector<upstream_kernel>,compare_upstream> {
+
+        private:
+            uint64_t _sequence = 0;
+
+        public:
+
+            inline void push(kernel_ptr&& k) {
+                this->emplace(upstream_kernel{std::move(k), this->_sequence++});
+            }
+
+            /// Remove the kernel that goes first.
+            inline kernel_ptr pop() {
+                auto& c = this->c;
+                std::pop_heap(c.begin(), c.end(), this->comp);
+                auto k = std::move(c.back().ptr);
+                c.pop_back();
+                return k;
+            }
+
+            /// Reorder the queued kernels.
+            inline void earliest_deadline_first(bool rhs) {
+                this->comp.earliest_deadline_first = rhs;
+                std::make_heap(this->c.begin(), this->c.end(), this->comp);
+            }
+
+            /// Move the kernels that match the predicate to \p removed.
+            template <class Pred> inline void
+            remove_if(Pred pred, kernel_ptr_array& removed) {
+                auto& c = this->c;
+                auto first = c.begin(), last = c.end(), result = first;
+                for (; first != last; ++first) {
+                    if (pred(*first->ptr)) {
+                        removed.emplace_back(std::move(first->ptr));
+                    } else {
+                        if (result != first) { *result = std::move(*first); }
+                        ++result;
+                    }
+                }
+                if (result == last) { return; }
+                c.erase(result, last);
+                std::make_heap(c.begin(), c.end(), this->comp);
+            }
+
+            template <class Sack> inline void
+            clear(Sack& sack) {
+                for (auto& x : this->c) { x.ptr.release()->mark_as_deleted(sack); }
+                this->c.clear();
+            }
+
+            /// The kernels in heap order.
+            inline container_type::const_iterator begin() const noexcept { return this->c.begin(); }
+            inline container_type::const_iterator end() const noexcept { return this->c.end(); }
+
+        };
+
         using mutex_type = std::mutex;
         using lock_type = std::unique_lock<mutex_type>;
         using semaphore_type = std::condition_variable;
@@ -70,15 +202,21 @@ namespace sbn {
         /// Same mutex for all kernel queues.
         mutable mutex_type _mutex;
         /// Upstream kernels.
-        kernel_queue _upstream_kernels;
+        upstream_kernel_queue _upstream_kernels;
         thread_pool _upstream_threads;
         semaphore_type _upstream_semaphore;
+        /// The maximal number of kernels in the upstream queue (0 means unbounded).
+        size_t _max_upstream_kernels = 0;
+        /// Producers that wait for the free space in the upstream queue.
+        semaphore_type _producer_semaphore;
         /// Kernels that are scheduled to be executed at specific point of time.
         kernel_priority_queue _timer_kernels;
         thread_pool _timer_threads;
         semaphore_type _timer_semaphore;
         /// Per-thread queue for downstream kernels.
         kernel_queue_array _downstream_kernels;
+        /// Per-thread index of the combinable kernels in the downstream queue.
+        combiner_table_array _combiners;
         thread_pool _downstream_threads;
         semaphore_array _downstream_semaphores;
         /// Per-kernel threads for 'new-thread' kernels.
@@ -87,6 +225,12 @@ namespace sbn {
         pipeline* _error_pipeline = nullptr;
         /// Function that is called in each new thread.
         thread_init_type _thread_init;
+        /// The number of downstream kernels merged by the combiners.
+        size_t _num_merged_kernels = 0;
+        /// The number of upstream kernels that started after their deadline.
+        size_t _num_missed_deadlines = 0;
+        /// Execute upstream kernels in the order of their deadlines.
+        bool _earliest_deadline_first = false;
 
     public:
 
@@ -98,12 +242,16 @@ namespace sbn {
         explicit parallel_pipeline(const properties& p):
         _upstream_threads(p.num_upstream_threads),
         _downstream_kernels(p.num_downstream_threads),
+        _combiners(p.num_downstream_threads),
         _downstream_threads(p.num_downstream_threads),
-        _downstream_semaphores(p.num_downstream_threads) {
+        _downstream_semaphores(p.num_downstream_threads),
+        _max_upstream_kernels(p.max_upstream_kernels),
+        _earliest_deadline_first(p.earliest_deadline_first) {
             this->_upstream_threads.cpus(p.upstream_cpus);
             this->_downstream_threads.cpus(p.downstream_cpus);
             this->_timer_threads.cpus(p.timer_cpus);
             this->_kernel_threads.cpus(p.kernel_cpus);
+            this->_upstream_kernels.earliest_deadline_first(p.earliest_deadline_first);
         }
 
         ~parallel_pipeline() = default;
@@ -127,6 +275,7 @@ namespace sbn {
 
         inline void send(kernel_ptr_array&& kernels) {
             bool notify_upstream = false, notify_timer = false;
+            size_t num_upstream = 0;
             const auto n = kernels.size();
             lock_type lock(this->_mutex);
             for (size_t i=0; i<n; ++i) {
@@ -143,7 +292,8 @@ namespace sbn {
                     const auto num_downstream_threads = this->_downstream_threads.size();
                     const auto size = std::max(num_upstream_threads,num_downstream_threads);
                     const auto n = k->hash() % size;
-                    this->_downstream_kernels[n].emplace_back(std::move(k));
+                    if (merge_downstream(n, k)) { continue; }
+                    enqueue_downstream(n, std::move(k));
                     if (this->_downstream_threads.empty()) {
                         notify_upstream = true;
                     } else {
@@ -160,10 +310,20 @@ namespace sbn {
                     #if defined(SBN_DEBUG)
                     this->log("upstream _", *k);
                     #endif
-                    this->_upstream_kernels.emplace_back(std::move(k)), notify_upstream = true;
+                    if (upstream_full() && !is_pipeline_thread()) {
+                        // let the threads process the kernels that were already queued
+                        this->_upstream_semaphore.notify_all(), num_upstream = 0;
+                        wait_for_free_space(lock);
+                    }
+                    enqueue_upstream(std::move(k)), ++num_upstream;
                 }
             }
-            if (notify_upstream) { this->_upstream_semaphore.notify_all(); }
+            // wake up as many threads as there are new kernels
+            if (notify_upstream || num_upstream >= this->_upstream_threads.size()) {
+                this->_upstream_semaphore.notify_all();
+            } else {
+                for (size_t i=0; i<num_upstream; ++i) { this->_upstream_semaphore.notify_one(); }
+            }
             if (notify_timer) { this->_timer_semaphore.notify_one(); }
         }
 
@@ -173,7 +333,8 @@ namespace sbn {
             this->log("upstream _", *k);
             #endif
             lock_type lock(this->_mutex);
-            this->_upstream_kernels.emplace_back(std::move(k));
+            if (!is_pipeline_thread()) { wait_for_free_space(lock); }
+            enqueue_upstream(std::move(k));
             this->_upstream_semaphore.notify_one();
         }
 
@@ -187,7 +348,8 @@ namespace sbn {
             const auto num_downstream_threads = this->_downstream_threads.size();
             const auto size = std::max(num_upstream_threads,num_downstream_threads);
             const auto i = k->hash() % size;
-            this->_downstream_kernels[i].emplace_back(std::move(k));
+            if (merge_downstream(i, k)) { return; }
+            enqueue_downstream(i, std::move(k));
             if (this->_downstream_threads.empty()) {
                 this->_upstream_semaphore.notify_all();
             } else {
@@ -233,17 +395,140 @@ namespace sbn {
 
         void num_downstream_threads(size_t n);
         void num_upstream_threads(size_t n);
+
+        inline size_t num_downstream_threads() const noexcept {
+            return this->_downstream_threads.size();
+        }
+
+        inline size_t num_upstream_threads() const noexcept {
+            return this->_upstream_threads.size();
+        }
+
+        inline size_t num_merged_kernels() const {
+            lock_type lock(this->_mutex);
+            return this->_num_merged_kernels;
+        }
+
+        /// The number of upstream kernels that started after their deadline.
+        inline size_t num_missed_deadlines() const {
+            lock_type lock(this->_mutex);
+            return this->_num_missed_deadlines;
+        }
+
+        /**
+        \brief Execute upstream kernels in the order of their deadlines.
+        \details Kernels with higher priority are still executed first,
+        kernels of the same priority are executed in the order of their deadlines
+        (see \link kernel_base::deadline\endlink), and kernels without deadline
+        are executed after them in FIFO order. The kernels that are already
+        queued are reordered when the option changes; kernels of the same
+        priority are executed in FIFO order when the option is turned off.
+        */
+        inline void earliest_deadline_first(bool rhs) {
+            lock_type lock(this->_mutex);
+            if (this->_earliest_deadline_first == rhs) { return; }
+            this->_earliest_deadline_first = rhs;
+            this->_upstream_kernels.earliest_deadline_first(rhs);
+        }
+
+        inline bool earliest_deadline_first() const noexcept {
+            return this->_earliest_deadline_first;
+        }
+
+        /**
+        \brief Limit the number of kernels in the upstream queue.
+        \details When the queue is full, \link send\endlink blocks until some
+        of the queued kernels are processed. Pipeline threads never block, instead
+        the kernels that run in these threads should check \link full\endlink
+        and suspend the generation of subordinate kernels.
+        */
+        inline void max_upstream_kernels(size_t rhs) {
+            lock_type lock(this->_mutex);
+            this->_max_upstream_kernels = rhs;
+            this->_producer_semaphore.notify_all();
+        }
+
+        inline size_t max_upstream_kernels() const {
+            lock_type lock(this->_mutex);
+            return this->_max_upstream_kernels;
+        }
+
+        bool full() const override;
+
+        /**
+        \brief Remove the cancelled upstream kernels from the upstream and timer queues.
+        \details The kernels are returned to their parents with
+        \link exit_code::cancelled\endlink exit code: kernels with local parent
+        are sent to this pipeline, kernels with remote parent are sent to the
+        pipeline from which they were received. Running kernels are not
+        interrupted, they should check \link kernel::cancelled\endlink instead.
+        */
+        void cancel() override;
+
         void write(std::ostream& out) const;
 
     private:
-        void upstream_loop(kernel_queue& downstream_queue);
+        void upstream_loop(kernel_queue& downstream_queue, combiner_table& combiners);
         void upstream_start(size_t num_threads);
         void timer_loop();
         void timer_start();
-        void downstream_loop(kernel_queue& queue, semaphore_type& semaphore);
+        void downstream_loop(kernel_queue& queue, combiner_table& combiners,
+                             semaphore_type& semaphore);
         void downstream_start(size_t num_threads);
         void kernel_loop(kernel_ptr kernel);
 
+        inline bool upstream_full() const noexcept {
+            return this->_max_upstream_kernels != 0 &&
+                this->_upstream_kernels.size() >= this->_max_upstream_kernels;
+        }
+
+        inline void enqueue_upstream(kernel_ptr&& k) {
+            this->_upstream_kernels.push(std::move(k));
+        }
+
+        inline void wait_for_free_space(lock_type& lock) {
+            this->_producer_semaphore.wait(lock, [this] () {
+                return !upstream_full() || this->stopping();
+            });
+        }
+
+        /**
+        Merge the returning kernel into the one that waits
+        for the same principal in the downstream queue \p i.
+        \return true if the kernel was merged and deleted
+        */
+        inline bool merge_downstream(size_t i, kernel_ptr& k) {
+            if (!k->isset(kernel_flag::combinable) || !k->principal()) { return false; }
+            auto& combiners = this->_combiners[i];
+            auto result = combiners.find(k->principal());
+            if (result == combiners.end()) { return false; }
+            auto* other = result->second;
+            if (!other->can_merge(*k)) { return false; }
+            other->merge(*k);
+            other->num_merged(other->num_merged() + k->num_merged());
+            k.reset();
+            ++this->_num_merged_kernels;
+            return true;
+        }
+
+        inline void enqueue_downstream(size_t i, kernel_ptr&& k) {
+            // the kernel that can not be merged does not replace the previous one
+            if (k->can_merge(*k)) { this->_combiners[i][k->principal()] = k.get(); }
+            enqueue_by_priority(this->_downstream_kernels[i], std::move(k));
+        }
+
+        static inline kernel_ptr pop_downstream(kernel_queue& queue, combiner_table& combiners) {
+            auto k = std::move(queue.front());
+            queue.pop_front();
+            if (!combiners.empty()) {
+                auto result = combiners.find(k->principal());
+                if (result != combiners.end() && result->second == k.get()) {
+                    combiners.erase(result);
+                }
+            }
+            return k;
+        }
+
         inline void make_thread(kernel_ptr&& k) {
             this->_kernel_threads.emplace_back(
                 [this] (kernel_ptr&& k) {
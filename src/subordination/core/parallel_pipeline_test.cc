@@ -1,4 +1,10 @@
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <valgrind/config.hh>
 
@@ -74,6 +80,208 @@ TEST(parallel_pipeline, _) {
     local.clear(sack);
 }
 
+sbn::parallel_pipeline combining{1};
+std::promise<int> combined_sum;
+
+class Sum_child: public sbn::kernel {
+
+private:
+    int _sum = 0;
+
+public:
+
+    inline explicit Sum_child(int value): _sum(value) {
+        setf(sbn::kernel::flag::combinable);
+    }
+
+    void act() override {
+        return_to_parent(sbn::exit_code::success);
+        combining.send(std::move(this_ptr()));
+    }
+
+    void merge(sbn::kernel& other) override {
+        this->_sum += dynamic_cast<Sum_child&>(other)._sum;
+    }
+
+    inline int sum() const noexcept { return this->_sum; }
+
+};
+
+class Sum_main: public sbn::kernel {
+
+private:
+    int _sum = 0;
+    int _num_children = 0;
+
+public:
+
+    void act() override {
+        sbn::kernel_ptr_array children;
+        for (int i=1; i<=num_kernels; ++i) {
+            auto child = sbn::make_pointer<Sum_child>(i);
+            child->parent(this);
+            children.emplace_back(std::move(child));
+        }
+        combining.send(std::move(children));
+    }
+
+    void react(sbn::kernel_ptr&& child) override {
+        auto k = sbn::pointer_dynamic_cast<Sum_child>(std::move(child));
+        this->_sum += k->sum();
+        this->_num_children += k->num_merged();
+        if (this->_num_children == num_kernels) { combined_sum.set_value(this->_sum); }
+    }
+
+};
+
+TEST(parallel_pipeline, combiner) {
+    combining.name("combining");
+    combining.start();
+    combining.send(sbn::make_pointer<Sum_main>());
+    EXPECT_EQ(num_kernels*(num_kernels+1)/2, combined_sum.get_future().get());
+    combining.stop();
+    combining.wait();
+    sbn::kernel_sack sack;
+    combining.clear(sack);
+}
+
+sbn::parallel_pipeline bounded{1};
+std::atomic<int> num_bounded_kernels{0};
+std::promise<int> all_bounded_kernels;
+
+class Bounded_kernel: public sbn::kernel {
+public:
+    void act() override {
+        sbn::kernel_ptr self(std::move(this_ptr()));
+        if (++num_bounded_kernels == num_kernels) {
+            all_bounded_kernels.set_value(num_bounded_kernels);
+        }
+    }
+};
+
+TEST(parallel_pipeline, bounded) {
+    bounded.name("bounded");
+    bounded.max_upstream_kernels(2);
+    bounded.send(sbn::make_pointer<Bounded_kernel>());
+    EXPECT_FALSE(bounded.full());
+    bounded.send(sbn::make_pointer<Bounded_kernel>());
+    EXPECT_TRUE(bounded.full());
+    // the producer blocks until the pipeline starts processing the queue
+    std::thread starter([] () {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        bounded.start();
+    });
+    for (int i=2; i<num_kernels; ++i) {
+        bounded.send(sbn::make_pointer<Bounded_kernel>());
+    }
+    EXPECT_EQ(num_kernels, all_bounded_kernels.get_future().get());
+    starter.join();
+    bounded.stop();
+    bounded.wait();
+    sbn::kernel_sack sack;
+    bounded.clear(sack);
+}
+
+sbn::parallel_pipeline cancelling{1};
+std::promise<void> unblock_cancelling;
+std::promise<int> num_cancelled_kernels;
+
+class Blocking_kernel: public sbn::kernel {
+public:
+    void act() override {
+        sbn::kernel_ptr self(std::move(this_ptr()));
+        unblock_cancelling.get_future().wait();
+    }
+};
+
+class Cancelled_child: public sbn::kernel {
+public:
+    void act() override {
+        return_to_parent(sbn::exit_code::success);
+        cancelling.send(std::move(this_ptr()));
+    }
+};
+
+class Cancelled_main: public sbn::kernel {
+
+private:
+    int _num_cancelled = 0;
+    int _num_returned = 0;
+
+public:
+
+    void react(sbn::kernel_ptr&& child) override {
+        if (child->return_code() == sbn::exit_code::cancelled) { ++this->_num_cancelled; }
+        if (++this->_num_returned == num_kernels) {
+            num_cancelled_kernels.set_value(this->_num_cancelled);
+        }
+    }
+
+};
+
+TEST(parallel_pipeline, cancel) {
+    cancelling.name("cancelling");
+    cancelling.start();
+    // the only upstream thread waits until the children are cancelled
+    cancelling.send(sbn::make_pointer<Blocking_kernel>());
+    std::unique_ptr<Cancelled_main> parent(new Cancelled_main);
+    for (int i=0; i<num_kernels; ++i) {
+        auto child = sbn::make_pointer<Cancelled_child>();
+        child->parent(parent.get());
+        EXPECT_FALSE(child->cancelled());
+        cancelling.send(std::move(child));
+    }
+    parent->cancel();
+    EXPECT_TRUE(parent->cancelled());
+    cancelling.cancel();
+    unblock_cancelling.set_value();
+    EXPECT_EQ(num_kernels, num_cancelled_kernels.get_future().get());
+    cancelling.stop();
+    cancelling.wait();
+    sbn::kernel_sack sack;
+    cancelling.clear(sack);
+}
+
+sbn::parallel_pipeline deadlines{1};
+std::vector<int> executed_kernels;
+std::promise<void> all_deadline_kernels;
+
+class Deadline_kernel: public sbn::kernel {
+
+private:
+    int _index;
+
+public:
+    explicit Deadline_kernel(int index): _index(index) {}
+
+    void act() override {
+        sbn::kernel_ptr self(std::move(this_ptr()));
+        executed_kernels.emplace_back(this->_index);
+        if (executed_kernels.size() == 3) { all_deadline_kernels.set_value(); }
+    }
+
+};
+
+TEST(parallel_pipeline, earliest_deadline_first) {
+    deadlines.name("deadlines");
+    const auto now = sbn::kernel::clock_type::now();
+    for (int i=0; i<3; ++i) {
+        auto k = sbn::make_pointer<Deadline_kernel>(i);
+        k->deadline(now + std::chrono::seconds(3-i));
+        deadlines.send(std::move(k));
+    }
+    // the kernels that are already queued are reordered
+    deadlines.earliest_deadline_first(true);
+    deadlines.start();
+    all_deadline_kernels.get_future().wait();
+    EXPECT_EQ((std::vector<int>{2, 1, 0}), executed_kernels);
+    EXPECT_EQ(0u, deadlines.num_missed_deadlines());
+    deadlines.stop();
+    deadlines.wait();
+    sbn::kernel_sack sack;
+    deadlines.clear(sack);
+}
+
 int main(int argc, char* argv[]) {
     SBN_SKIP_IF_RUNNING_ON_VALGRIND();
     sbn::install_error_handler();
@@ -8,6 +8,25 @@ void sbn::pipeline::recover(kernel_ptr&& k) {
     this->log("recover is not implemented, deleting _", *k);
 }
 
+bool sbn::pipeline::full() const {
+    return false;
+}
+
+void sbn::pipeline::cancel() {}
+void sbn::pipeline::cancel(const kernel&) {}
+
+namespace {
+    thread_local bool this_thread_is_pipeline_thread = false;
+}
+
+void sbn::is_pipeline_thread(bool rhs) noexcept {
+    this_thread_is_pipeline_thread = rhs;
+}
+
+bool sbn::is_pipeline_thread() noexcept {
+    return this_thread_is_pipeline_thread;
+}
+
 const char* sbn::to_string(pipeline_base::states rhs) {
     using s = pipeline_base::states;
     switch (rhs) {
@@ -57,6 +57,14 @@ namespace sbn {
 
     };
 
+    /**
+    \brief Mark the current thread as the thread that processes the kernels of some pipeline.
+    \details Such threads never wait for the free space in the bounded queues,
+    otherwise the pipelines that send kernels to each other would deadlock.
+    */
+    void is_pipeline_thread(bool rhs) noexcept;
+    bool is_pipeline_thread() noexcept;
+
     const char* to_string(pipeline_base::states rhs);
     std::ostream& operator<<(std::ostream& out, pipeline_base::states rhs);
 
@@ -80,6 +88,25 @@ namespace sbn {
         virtual void forward(kernel_ptr&& k);
         virtual void recover(kernel_ptr&& k);
 
+        /**
+        \return true if the queue of the pipeline reached its maximal size
+        and the producer should suspend generation of new kernels
+        */
+        virtual bool full() const;
+
+        /**
+        Remove the cancelled kernels (see \link kernel::cancelled\endlink)
+        from the queue and return them to their parents with
+        \link exit_code::cancelled\endlink exit code.
+        */
+        virtual void cancel();
+
+        /**
+        Cancel the kernel that was received from another process.
+        The \p notice has the same header and identifiers as the kernel.
+        */
+        virtual void cancel(const kernel& notice);
+
         inline index_type index() const noexcept { return this->_index; }
         inline void index(index_type rhs) noexcept { this->_index = rhs; }
 
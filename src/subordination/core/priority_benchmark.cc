@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <subordination/api.hh>
+#include <subordination/core/error_handler.hh>
+
+/*
+Measures the latency of short "probe" kernels that are sent to the local
+pipeline while the pipeline is saturated with long "background" kernels.
+The latency is the time between sending the probe and the start of its
+execution. The probes have the same priority as the background kernels
+("fifo") or higher priority ("priority"), in the latter case they are
+executed as soon as some upstream thread finishes its current kernel.
+
+Usage: priority-benchmark [fifo|priority] [num-background-kernels] [num-probes]
+*/
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using duration = std::chrono::duration<double,std::micro>;
+
+    enum class methods { fifo, priority };
+
+    methods method = methods::priority;
+    size_t num_background_kernels = 20000;
+    size_t num_probes = 100;
+    /// How long each background kernel runs.
+    auto background_work = std::chrono::microseconds(100);
+    /// The interval between the probes.
+    auto probe_interval = std::chrono::milliseconds(1);
+
+    class Background: public sbn::kernel {
+    public:
+        void act() override {
+            const auto t1 = clock_type::now() + background_work;
+            while (clock_type::now() < t1) {}
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+    };
+
+    class Probe: public sbn::kernel {
+
+    private:
+        clock_type::time_point _sent = clock_type::now();
+        duration _latency{};
+
+    public:
+        void act() override {
+            this->_latency = clock_type::now() - this->_sent;
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        inline duration latency() const noexcept { return this->_latency; }
+
+    };
+
+    class Main: public sbn::kernel {
+
+    private:
+        size_t _num_completed = 0;
+        std::vector<duration> _latencies;
+        std::mutex _mutex;
+        std::condition_variable _semaphore;
+
+    public:
+
+        Main() { setf(sbn::kernel::flag::new_thread); }
+
+        void act() override {
+            for (size_t i=0; i<num_background_kernels; ++i) {
+                sbn::upstream<sbn::Local>(this, sbn::make_pointer<Background>());
+            }
+            for (size_t i=0; i<num_probes; ++i) {
+                auto probe = sbn::make_pointer<Probe>();
+                if (method == methods::priority) { probe->priority(1); }
+                sbn::upstream<sbn::Local>(this, std::move(probe));
+                std::this_thread::sleep_for(probe_interval);
+            }
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_semaphore.wait(lock, [this] () {
+                return this->_num_completed == num_background_kernels+num_probes;
+            });
+            report();
+            lock.unlock();
+            sbn::commit<sbn::Local>(std::move(this_ptr()));
+        }
+
+        void react(sbn::kernel_ptr&& k) override {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            if (auto* probe = dynamic_cast<Probe*>(k.get())) {
+                this->_latencies.emplace_back(probe->latency());
+            }
+            if (++this->_num_completed == num_background_kernels+num_probes) {
+                this->_semaphore.notify_one();
+            }
+        }
+
+    private:
+
+        void report() {
+            auto& l = this->_latencies;
+            std::sort(l.begin(), l.end());
+            duration sum{};
+            for (const auto& x : l) { sum += x; }
+            const auto n = l.size();
+            std::cout << std::setw(20) << std::left << "method"
+                << std::setw(20) << "mean-latency-us"
+                << std::setw(20) << "p99-latency-us" << "max-latency-us\n";
+            std::cout << std::setw(20) << (method == methods::fifo ? "fifo" : "priority")
+                << std::setw(20) << (n == 0 ? 0.0 : sum.count()/n)
+                << std::setw(20) << (n == 0 ? 0.0 : l[std::min(n-1, n*99/100)].count())
+                << (n == 0 ? 0.0 : l.back().count()) << std::endl;
+        }
+
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2) {
+        if (std::strcmp(argv[1], "fifo") == 0) { method = methods::fifo; }
+        else if (std::strcmp(argv[1], "priority") == 0) { method = methods::priority; }
+        else { std::cerr << "bad method: " << argv[1] << std::endl; return 1; }
+    }
+    if (argc >= 3) { num_background_kernels = std::stoul(argv[2]); }
+    if (argc >= 4) { num_probes = std::stoul(argv[3]); }
+    sbn::install_error_handler();
+    sbn::factory_guard g;
+    sbn::send(sbn::make_pointer<Main>());
+    return sbn::wait_and_return();
+}
@@ -37,6 +37,9 @@ sbn::kernel_ptr sbn::process_handler::read_kernel() {
         if (k->is_foreign() && !k->target_application()) {
             k->target_application_id(this->_application.id());
         }
+        if (k->phase() == kernel::phases::downstream) {
+            ++this->_num_completed_kernels;
+        }
     }
     return k;
 }
@@ -48,6 +51,12 @@ void sbn::process_handler::write_kernel(const kernel* k) noexcept {
     }
 }
 
+void sbn::process_handler::write_kernels(const kernel_ptr* kernels, size_t n) noexcept {
+    connection::write_kernels(kernels, n);
+    // only upstream kernels are written in batches
+    this->_num_active_kernels += static_cast<int>(n);
+}
+
 void sbn::process_handler::handle(const sys::epoll_event& event) {
     if (state() == connection::states::starting) {
         state(connection::states::started);
@@ -27,6 +27,7 @@ namespace sbn {
         roles _role;
         int _num_active_kernels = 0;
         int _kernel_count_last = 0;
+        size_t _num_completed_kernels = 0;
         time_point _last{};
         kernel_ptr _main_kernel{};
         pipeline* _unix{};
@@ -78,6 +79,12 @@ namespace sbn {
 
         /// The number of kernels that were sent to the process, but have not returned yet.
         inline int num_active_kernels() const noexcept { return this->_num_active_kernels; }
+
+        /// The number of downstream kernels that were received from the process.
+        inline size_t num_completed_kernels() const noexcept {
+            return this->_num_completed_kernels;
+        }
+
         void write(std::ostream& out) const override;
 
     protected:
@@ -85,6 +92,7 @@ namespace sbn {
         void receive_foreign_kernel(kernel_ptr&& fk) override;
         kernel_ptr read_kernel() override;
         void write_kernel(const kernel* k) noexcept override;
+        void write_kernels(const kernel_ptr* kernels, size_t n) noexcept override;
 
     };
 
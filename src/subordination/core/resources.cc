@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -130,14 +131,11 @@ namespace {
 }
 
 sbn::resources::Any::Any(const char* s, size_t n): _type{Type::String} {
-    using t = std::char_traits<char>;
-    this->_string = new char[n+1];
-    t::copy(this->_string, s, n);
-    this->_string[n] = 0;
+    this->_string = string_table::intern(s, n);
 }
 
 sbn::resources::Any::~Any() noexcept {
-    if (type() == Type::String) { delete[] this->_string; }
+    if (type() == Type::String) { string_table::release(this->_string); }
 }
 
 void sbn::resources::Any::swap(Any& rhs) noexcept {
@@ -152,11 +150,8 @@ sbn::resources::Any::Any(const Any& rhs): _type{rhs._type} {
         case Any::Type::Boolean: this->_b = rhs._b; break;
         case Any::Type::U64: this->_u64 = rhs._u64; break;
         case Any::Type::String: {
-            using t = std::char_traits<char>;
-            auto n = t::length(rhs._string);
-            this->_string = new char[n+1];
-            t::copy(this->_string, rhs._string, n);
-            this->_string[n] = 0;
+            this->_string = rhs._string;
+            string_table::retain(this->_string);
             break;
         }
         default: break;
@@ -168,11 +163,8 @@ bool sbn::resources::Any::operator==(const Any& rhs) const noexcept {
     switch (this->_type) {
         case Any::Type::Boolean: return this->_b == rhs._b;
         case Any::Type::U64: return this->_u64 == rhs._u64;
-        case Any::Type::String: {
-            if (!this->_string && !rhs._string) { return true; }
-            if (!this->_string || !rhs._string) { return false; }
-            return std::strcmp(this->_string, rhs._string) == 0;
-        }
+        // interned strings are equal only if they are the same object
+        case Any::Type::String: return this->_string == rhs._string;
         default: return false;
     }
 }
@@ -233,16 +225,16 @@ auto sbn::resources::Remainder::evaluate(const Bindings& b) const noexcept -> An
 }
 
 void sbn::resources::Any::write(sys::byte_buffer& out) const {
-    using t = std::char_traits<char>;
     out.write(this->_type);
     switch (this->_type) {
         case Any::Type::Boolean: out.write(this->_b); break;
         case Any::Type::U64: out.write(this->_u64); break;
         case Any::Type::String: {
             if (this->_string) {
-                const uint32_t n = t::length(this->_string);
+                const auto& value = this->_string->value();
+                const uint32_t n = value.size();
                 out.write(n);
-                out.write(this->_string, n);
+                out.write(value.data(), n);
             } else {
                 out.write(std::numeric_limits<uint32_t>::max());
             }
@@ -253,20 +245,22 @@ void sbn::resources::Any::write(sys::byte_buffer& out) const {
 }
 
 void sbn::resources::Any::read(sys::byte_buffer& in) {
+    if (this->_type == Type::String) {
+        string_table::release(this->_string);
+        this->_string = nullptr;
+    }
     in.read(this->_type);
     switch (this->_type) {
         case Any::Type::Boolean: in.read(this->_b); break;
         case Any::Type::U64: in.read(this->_u64); break;
         case Any::Type::String: {
+            this->_string = nullptr;
             uint32_t n = 0;
             in.read(n);
             if (n != std::numeric_limits<uint32_t>::max()) {
-                if (this->_string) { delete[] this->_string; this->_string = nullptr; }
-                this->_string = new char[n+1];
-                in.read(this->_string, n);
-                this->_string[n] = 0;
-            } else {
-                this->_string = nullptr;
+                std::string tmp(n, '\0');
+                in.read(&tmp[0], n);
+                this->_string = string_table::intern(tmp.data(), n);
             }
             break;
         }
@@ -285,9 +279,13 @@ void sbn::resources::Constant::write(sys::byte_buffer& out) const {
 }
 void sbn::resources::Name::write(sys::byte_buffer& out) const {
     out.write(Expressions::Name);
-    out.write(this->_name);
+    out.write(this->_name.str());
+}
+void sbn::resources::Name::read(sys::byte_buffer& in) {
+    std::string name;
+    in.read(name);
+    this->_name = interned_string(name);
 }
-void sbn::resources::Name::read(sys::byte_buffer& in) { in.read(this->_name); }
 void sbn::resources::Constant::read(sys::byte_buffer& in) { this->_value.read(in); }
 
 #define SBN_RESOURCES_UNARY_OPERATION_IO(NAME, HUMAN_NAME) \
@@ -368,7 +366,7 @@ void sbn::resources::Any::write(std::ostream& out) const {
     switch (this->_type) {
         case Any::Type::Boolean: out << this->_b; break;
         case Any::Type::U64: out << this->_u64; break;
-        case Any::Type::String: write_string(out, this->_string); break;
+        case Any::Type::String: write_string(out, this->_string ? string() : ""); break;
         default: break;
     }
 }
@@ -396,6 +394,9 @@ const char* sbn::resources::resource_to_string(resources r) noexcept {
         case resources::total_threads: return "total-threads";
         case resources::total_memory: return "total-memory";
         case resources::hostname: return "hostname";
+        case resources::free_memory: return "free-memory";
+        case resources::run_queue_length: return "run-queue-length";
+        case resources::completion_rate: return "completion-rate";
         default: return nullptr;
     }
 }
@@ -405,6 +406,9 @@ auto sbn::resources::string_to_resource(const char* s, size_t n) noexcept -> res
     if (str == "total-threads") { return resources::total_threads; }
     if (str == "total-memory") { return resources::total_memory; }
     if (str == "hostname") { return resources::hostname; }
+    if (str == "free-memory") { return resources::free_memory; }
+    if (str == "run-queue-length") { return resources::run_queue_length; }
+    if (str == "completion-rate") { return resources::completion_rate; }
     return bad_resource;
 }
 
@@ -446,10 +450,59 @@ auto sbn::resources::read(std::istream& in, int max_depth) -> expression_ptr {
     return read(s.data(), s.data()+s.size(), max_depth);
 }
 
+auto sbn::resources::Bindings::find(const interned_string& s) const noexcept
+-> symbol_array::const_iterator {
+    const auto& symbols = *this->_symbols;
+    auto result = std::lower_bound(symbols.begin(), symbols.end(), s,
+        [] (const symbol_type& a, const interned_string& b) { return a.first < b; });
+    if (result != symbols.end() && result->first != s) { return symbols.end(); }
+    return result;
+}
+
+auto sbn::resources::Bindings::operator[](const interned_string& s) const noexcept -> value_type {
+    if (!s || !this->_symbols) { return {}; }
+    auto result = find(s);
+    if (result == this->_symbols->end()) { return {}; }
+    return result->second;
+}
+
+auto sbn::resources::Bindings::operator[](const interned_string& s) -> value_type& {
+    // copy on write
+    if (!this->_symbols) {
+        this->_symbols = std::make_shared<symbol_array>();
+    } else if (this->_symbols.use_count() != 1) {
+        this->_symbols = std::make_shared<symbol_array>(*this->_symbols);
+    }
+    auto& symbols = *this->_symbols;
+    auto result = std::lower_bound(symbols.begin(), symbols.end(), s,
+        [] (const symbol_type& a, const interned_string& b) { return a.first < b; });
+    if (result == symbols.end() || result->first != s) {
+        result = symbols.emplace(result, s, value_type{});
+    }
+    return result->second;
+}
+
+void sbn::resources::Bindings::unset(const std::string& name) {
+    auto s = interned_string::find(name);
+    if (!s || !this->_symbols || find(s) == this->_symbols->end()) { return; }
+    if (this->_symbols.use_count() != 1) {
+        this->_symbols = std::make_shared<symbol_array>(*this->_symbols);
+    }
+    this->_symbols->erase(find(s));
+}
+
+bool sbn::resources::Bindings::equal(const symbol_array* a, const symbol_array* b) noexcept {
+    if (a == b) { return true; }
+    const auto na = a ? a->size() : 0, nb = b ? b->size() : 0;
+    if (na != nb) { return false; }
+    return na == 0 || *a == *b;
+}
+
 void sbn::resources::Bindings::write(sys::byte_buffer& out) const {
     for (const auto& x : this->_data) { x.write(out); }
-    out.write(uint32_t(this->_symbols.size()));
-    for (const auto& x : this->_symbols) { out.write(x.first); x.second.write(out); }
+    if (!this->_symbols) { out.write(uint32_t(0)); return; }
+    out.write(uint32_t(this->_symbols->size()));
+    for (const auto& x : *this->_symbols) { out.write(x.first.str()); x.second.write(out); }
 }
 
 void sbn::resources::Bindings::read(sys::byte_buffer& in) {
@@ -457,19 +510,27 @@ void sbn::resources::Bindings::read(sys::byte_buffer& in) {
     for (auto& x : this->_data) { x.read(in); }
     uint32_t nsymbols = 0;
     in.read(nsymbols);
+    if (nsymbols == 0) { return; }
+    auto symbols = std::make_shared<symbol_array>();
+    symbols->reserve(nsymbols);
     for (uint32_t i=0; i<nsymbols; ++i) {
         std::string key;
         Any value;
         in.read(key);
         value.read(in);
-        this->_symbols.emplace(std::move(key), std::move(value));
+        symbols->emplace_back(interned_string(key), std::move(value));
     }
+    std::sort(symbols->begin(), symbols->end(),
+        [] (const symbol_type& a, const symbol_type& b) { return a.first < b.first; });
+    this->_symbols = std::move(symbols);
 }
 
 void sbn::resources::Bindings::write(std::ostream& out) const {
     out << ";; symbols\n";
-    for (const auto& pair : this->_symbols) {
-        out << "(define " << pair.first << ' ' << pair.second << ")\n";
+    if (this->_symbols) {
+        for (const auto& pair : *this->_symbols) {
+            out << "(define " << pair.first << ' ' << pair.second << ")\n";
+        }
     }
     constexpr const auto n = Bindings::size();
     out << ";; resources\n";
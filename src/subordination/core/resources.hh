@@ -5,10 +5,11 @@
 #include <memory>
 #include <ostream>
 #include <type_traits>
-#include <unordered_map>
+#include <vector>
 
 #include <unistdx/base/byte_buffer>
 
+#include <subordination/core/string_table.hh>
 #include <subordination/core/types.hh>
 
 namespace sbn {
@@ -24,7 +25,8 @@ namespace sbn {
             union {
                 bool _b;
                 uint64_t _u64;
-                char* _string;
+                /// Interned string, copying does not allocate memory.
+                string_table::node* _string;
             };
             Type _type{};
         public:
@@ -57,6 +59,11 @@ namespace sbn {
                 return this->_u64;
             }
 
+            inline const char* string() const noexcept {
+                if (this->_type != Type::String || !this->_string) { return nullptr; }
+                return this->_string->value().data();
+            }
+
             bool operator==(const Any& rhs) const noexcept;
 
             inline bool operator!=(const Any& rhs) const noexcept {
@@ -85,7 +92,13 @@ namespace sbn {
             total_threads=0,
             total_memory=1,
             hostname=2,
-            size=3,
+            /// Available memory in bytes sampled at run time.
+            free_memory=3,
+            /// The no. of runnable threads sampled at run time.
+            run_queue_length=4,
+            /// The no. of kernels completed by the node per minute.
+            completion_rate=5,
+            size=6,
         };
 
         const char* resource_to_string(resources r) noexcept;
@@ -94,10 +107,14 @@ namespace sbn {
         class Bindings {
         public:
             using value_type = Any;
+            using symbol_type = std::pair<interned_string,value_type>;
+            /// Symbols sorted by identifier.
+            using symbol_array = std::vector<symbol_type>;
         private:
             // total-threads should be at least 1
             std::array<value_type,size_t(resources::size)> _data{uint64_t{1}};
-            std::unordered_map<std::string,value_type> _symbols;
+            /// User-defined symbols are shared between copies until one of them is modified.
+            std::shared_ptr<symbol_array> _symbols;
         public:
             inline const value_type& operator[](resources r) const noexcept {
                 return this->_data[static_cast<size_t>(r)];
@@ -105,21 +122,24 @@ namespace sbn {
             inline value_type& operator[](resources r) noexcept {
                 return this->_data[static_cast<size_t>(r)];
             }
-            inline value_type operator[](const std::string& s) const noexcept {
-                auto result = this->_symbols.find(s);
-                if (result == this->_symbols.end()) { return {}; }
-                return result->second;
+            /**
+            Look up the symbol by the identifier of the interned string.
+            There is no overload for plain strings: every such lookup would
+            lock the process-wide string table, hence the names are interned
+            once (e.g. when the expression is compiled).
+            */
+            value_type operator[](const interned_string& s) const noexcept;
+            value_type& operator[](const interned_string& s);
+            inline value_type& operator[](const std::string& s) {
+                return operator[](interned_string(s));
             }
-            inline value_type& operator[](const std::string& s) noexcept {
-                return this->_symbols[s];
-            }
-            inline void unset(const std::string& s) { this->_symbols.erase(s); }
+            void unset(const std::string& s);
             inline value_type operator[](size_t i) const noexcept { return this->_data[i]; }
             inline value_type& operator[](size_t i) noexcept { return this->_data[i]; }
             inline void clear() noexcept {
                 // TODO
                 //this->_data.fill(value_type{});
-                this->_symbols.clear();
+                this->_symbols.reset();
             }
             static constexpr inline size_t size() noexcept { return size_t(resources::size); }
             void write(sys::byte_buffer& out) const;
@@ -133,6 +153,9 @@ namespace sbn {
             Bindings& operator=(Bindings&&) = default;
             friend bool operator==(const Bindings& a, const Bindings& b);
             friend bool operator!=(const Bindings& a, const Bindings& b);
+        private:
+            symbol_array::const_iterator find(const interned_string& s) const noexcept;
+            static bool equal(const symbol_array* a, const symbol_array* b) noexcept;
         };
 
         inline std::ostream& operator<<(std::ostream& out, const Bindings& rhs) {
@@ -144,7 +167,7 @@ namespace sbn {
             for (size_t i=0; i<n; ++i) {
                 if (a[i] != b[i]) { return false; }
             }
-            return a._symbols == b._symbols;
+            return Bindings::equal(a._symbols.get(), b._symbols.get());
         }
 
         inline bool operator!=(const Bindings& a, const Bindings& b) {
@@ -213,11 +236,11 @@ namespace sbn {
             Constant& operator=(Constant&&) = delete;
         };
 
+        /// The name is interned when the expression is created or read.
         class Name: public Expression {
         private:
-            std::string _name{};
+            interned_string _name{};
         public:
-            inline explicit Name(std::string&& name) noexcept: _name(std::move(name)) {}
             inline explicit Name(const std::string& name): _name(name) {}
             inline explicit Name(const char* name): _name(name) {}
             Any evaluate(const Bindings& context) const noexcept override;
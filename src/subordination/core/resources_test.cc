@@ -75,6 +75,8 @@ TEST(resources, name_evaluate) {
     EXPECT_TRUE(expr->evaluate(bindings).boolean()) << "Code:\n" << bindings << *expr;
     bindings["x"] = "helloXXX";
     EXPECT_FALSE(expr->evaluate(bindings).boolean()) << "Code:\n" << bindings << *expr;
+    const auto& const_bindings = bindings;
+    EXPECT_EQ(Any("helloXXX"), const_bindings[interned_string("x")]);
     bindings.unset("x");
     EXPECT_FALSE(expr->evaluate(bindings).boolean()) << "Code:\n" << bindings << *expr;
 }
@@ -155,3 +157,59 @@ TEST(bindings, io_binary_empty_string) {
     actual.read(buf);
     EXPECT_EQ(expected, actual);
 }
+
+TEST(resources, run_time_symbols) {
+    using namespace sbn::resources;
+    using r = resources;
+    auto expected = (r::run_queue_length < expression_ptr(new Symbol(r::total_threads))) &&
+        (r::free_memory > 1024u);
+    std::stringstream tmp;
+    tmp << *expected;
+    auto actual = sbn::resources::read(tmp, 10);
+    std::stringstream tmp2;
+    tmp2 << *actual;
+    EXPECT_EQ(tmp.str(), tmp2.str());
+    Bindings context;
+    context[r::total_threads] = 4u;
+    context[r::run_queue_length] = 1u;
+    context[r::free_memory] = uint64_t{1}<<20;
+    EXPECT_TRUE(actual->evaluate(context).boolean());
+}
+
+TEST(string_table, intern) {
+    using namespace sbn::resources;
+    const auto old_size = string_table::size();
+    {
+        interned_string a("abc"), b(std::string("abc")), c("abcd");
+        EXPECT_EQ(a, b);
+        EXPECT_EQ(a.id(), b.id());
+        EXPECT_NE(a, c);
+        EXPECT_EQ("abc", a.str());
+        EXPECT_EQ(old_size+2, string_table::size());
+        EXPECT_EQ(a, interned_string::find("abc"));
+        EXPECT_FALSE(interned_string::find("abcde"));
+    }
+    EXPECT_EQ(old_size, string_table::size());
+    EXPECT_FALSE(interned_string::find("abc"));
+}
+
+TEST(bindings, copy_on_write) {
+    using namespace sbn::resources;
+    using r = resources;
+    Bindings a;
+    a[r::hostname] = "x";
+    a["b"] = 1u;
+    a["a"] = "y";
+    Bindings b(a);
+    const auto& ca = a;
+    const auto& cb = b;
+    EXPECT_EQ(a, b);
+    b["a"] = 2u;
+    EXPECT_NE(a, b);
+    EXPECT_EQ(Any("y"), ca["a"]);
+    EXPECT_EQ(Any(2u), cb["a"]);
+    b.unset("a");
+    EXPECT_EQ(Any(), cb["a"]);
+    EXPECT_EQ(Any(1u), cb["b"]);
+    EXPECT_EQ(Any(), ca["c"]);
+}
@@ -0,0 +1,530 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <unistdx/base/check>
+#include <unistdx/fs/idirectory>
+#include <unistdx/fs/mkdirs>
+#include <unistdx/io/fildes>
+#include <unistdx/ipc/process>
+#include <unistdx/base/log_message>
+#include <unistdx/system/error>
+
+#include <subordination/core/properties.hh>
+#include <subordination/core/shared_object.hh>
+
+namespace {
+
+    inline void write_fully(sys::fd_type fd, const void* data, size_t n) {
+        const auto* first = static_cast<const char*>(data);
+        while (n != 0) {
+            auto m = ::write(fd, first, n);
+            UNISTDX_CHECK(m);
+            first += m, n -= m;
+        }
+    }
+
+    inline bool file_exists(const char* filename) {
+        struct ::stat st{};
+        return ::stat(filename, &st) == 0;
+    }
+
+    /// Temporary files have the process id after the dot.
+    inline bool is_object_name(const char* name) {
+        if (*name == 0) { return false; }
+        for (; *name; ++name) {
+            if (!std::isxdigit(static_cast<unsigned char>(*name))) { return false; }
+        }
+        return true;
+    }
+
+    void copy_file(const char* src, const char* dst) {
+        using f = sys::open_flag;
+        sys::fildes in(src, f::close_on_exec | f::read_only);
+        sys::fildes out(dst, f::truncate | f::close_on_exec | f::create | f::write_only, 0644);
+        char buffer[4096*16];
+        while (true) {
+            auto n = ::read(in.fd(), buffer, sizeof(buffer));
+            UNISTDX_CHECK(n);
+            if (n == 0) { break; }
+            write_fully(out.fd(), buffer, n);
+        }
+        out.close();
+    }
+
+    uint64_t read_memory_info(const char* key) {
+        std::ifstream in("/proc/meminfo");
+        std::string name, unit;
+        uint64_t value = 0;
+        while (in >> name >> value) {
+            std::getline(in, unit);
+            if (name == key) { return value*1024; }
+        }
+        return 0;
+    }
+
+    /// Memory available for new processes without swapping.
+    inline uint64_t read_free_memory() { return read_memory_info("MemAvailable:"); }
+
+    inline sbn::shared_object_store::time_point to_time_point(const ::timespec& t) {
+        using namespace std::chrono;
+        return sbn::shared_object_store::time_point(
+            duration_cast<sbn::shared_object_store::duration>(
+                seconds(t.tv_sec) + nanoseconds(t.tv_nsec)));
+    }
+
+    /**
+    Call the function with the name of the file in memory, and if it was
+    removed, with the name of the file in the spill directory
+    (the object may be moved by other process at any time).
+    */
+    template <class Function> auto
+    with_object_file(const sys::path& memory, const sys::path& disk, Function func)
+    -> decltype(func(memory.data())) {
+        try {
+            return func(memory.data());
+        } catch (const sys::bad_call& err) {
+            if (err.errc() != std::errc::no_such_file_or_directory) { throw; }
+        }
+        try {
+            return func(disk.data());
+        } catch (const sys::bad_call& err) {
+            if (err.errc() != std::errc::no_such_file_or_directory) { throw; }
+        }
+        throw std::invalid_argument("shared object not found");
+    }
+
+}
+
+constexpr const size_t sbn::shared_object_store::automatic;
+
+sbn::shared_object_id sbn::shared_object_hash(const void* data, size_t size) noexcept {
+    const auto* first = static_cast<const unsigned char*>(data);
+    const auto* last = first + size;
+    uint64_t h = 14695981039346656037ull;
+    while (first != last) { h = (h ^ *first++) * 1099511628211ull; }
+    // objects with the same prefix differ in size
+    for (int i=0; i<8; ++i) { h = (h ^ ((uint64_t(size) >> (i*8)) & 0xff)) * 1099511628211ull; }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+sbn::shared_object::shared_object(shared_object_id id, const char* filename): _id(id) {
+    using f = sys::open_flag;
+    sys::fildes in(filename, f::close_on_exec | f::read_only);
+    struct ::stat st{};
+    UNISTDX_CHECK(::fstat(in.fd(), &st));
+    this->_size = st.st_size;
+    // zero-length mappings are not allowed
+    if (this->_size == 0) { return; }
+    auto* ptr = ::mmap(nullptr, this->_size, PROT_READ, MAP_SHARED, in.fd(), 0);
+    if (ptr == MAP_FAILED) { throw sys::bad_call(); }
+    this->_data = ptr;
+}
+
+sbn::shared_object::~shared_object() noexcept {
+    if (this->_data) { ::munmap(const_cast<void*>(this->_data), this->_size); }
+}
+
+bool sbn::shared_object_store::properties::set(const char* key, const std::string& value) {
+    bool found = true;
+    if (std::strcmp(key, "directory") == 0) {
+        directory = value;
+    } else if (std::strcmp(key, "spill-directory") == 0) {
+        spill_directory = value;
+    } else if (std::strcmp(key, "max-memory-size") == 0) {
+        max_memory_size = value == "auto" ? automatic : std::stoull(value);
+    } else if (std::strcmp(key, "min-free-memory") == 0) {
+        min_free_memory = value == "auto" ? automatic : std::stoull(value);
+    } else if (std::strcmp(key, "scan-interval") == 0) {
+        scan_interval = string_to_duration(value);
+    } else {
+        found = false;
+    }
+    return found;
+}
+
+void sbn::shared_object_store::properties::read_environment() {
+    if (const char* s = std::getenv("SBN_SHARED_OBJECTS_DIRECTORY")) { directory = s; }
+    if (const char* s = std::getenv("SBN_SHARED_OBJECTS_SPILL_DIRECTORY")) { spill_directory = s; }
+}
+
+auto sbn::shared_object_store::publish(const void* data, size_t size) -> shared_object_id {
+    const auto id = shared_object_hash(data, size);
+    lock_type lock(this->_mutex);
+    // the reference is added first, so that the daemon does not remove the object
+    do_reference(id, this_application::id());
+    if (this->_objects.find(id) == this->_objects.end() && find(id).empty()) {
+        write(id, data, size);
+        evict_after_write();
+    } else {
+        check_collision(id, data, size);
+    }
+    return id;
+}
+
+void sbn::shared_object_store::insert(shared_object_id id, const void* data, size_t size) {
+    if (shared_object_hash(data, size) != id) {
+        throw std::invalid_argument("shared object hash mismatch");
+    }
+    lock_type lock(this->_mutex);
+    if (find(id).empty()) {
+        write(id, data, size);
+        evict_after_write();
+    } else {
+        check_collision(id, data, size);
+    }
+}
+
+void sbn::shared_object_store::check_collision(shared_object_id id,
+                                               const void* data, size_t size) const {
+    auto same = [data,size] (const void* other, size_t other_size) {
+        return other_size == size && (size == 0 || std::memcmp(other, data, size) == 0);
+    };
+    bool equal = false;
+    auto result = this->_objects.find(id);
+    if (result != this->_objects.end()) {
+        equal = same(result->second->data(), result->second->size());
+    } else {
+        const auto contents = read(id);
+        equal = same(contents.data(), contents.size());
+    }
+    if (!equal) { throw std::runtime_error("shared object hash collision"); }
+}
+
+auto sbn::shared_object_store::get(shared_object_id id) -> shared_object_ptr {
+    lock_type lock(this->_mutex);
+    // update access time for the eviction
+    const auto filename = path(id);
+    if (::utimensat(AT_FDCWD, filename.data(), nullptr, 0) == 0) {
+        auto entry = this->_index.find(id);
+        if (entry != this->_index.end()) { entry->second.last_access = clock_type::now(); }
+    }
+    auto result = this->_objects.find(id);
+    if (result != this->_objects.end()) { return result->second; }
+    shared_object_ptr ptr = with_object_file(filename, spill_path(id),
+        [id] (const char* name) { return shared_object_ptr(new shared_object(id, name)); });
+    this->_objects.emplace(id, ptr);
+    return ptr;
+}
+
+std::string sbn::shared_object_store::read(shared_object_id id) const {
+    return with_object_file(path(id), spill_path(id), [] (const char* filename) {
+        using f = sys::open_flag;
+        sys::fildes in(filename, f::close_on_exec | f::read_only);
+        struct ::stat st{};
+        UNISTDX_CHECK(::fstat(in.fd(), &st));
+        std::string result(st.st_size, '\0');
+        size_t n = 0;
+        while (n != result.size()) {
+            auto m = ::read(in.fd(), &result[n], result.size()-n);
+            UNISTDX_CHECK(m);
+            if (m == 0) { result.resize(n); break; }
+            n += m;
+        }
+        return result;
+    });
+}
+
+bool sbn::shared_object_store::contains(shared_object_id id) const {
+    {
+        lock_type lock(this->_mutex);
+        if (this->_objects.find(id) != this->_objects.end()) { return true; }
+    }
+    return !find(id).empty();
+}
+
+void sbn::shared_object_store::remove(shared_object_id id) {
+    lock_type lock(this->_mutex);
+    // existing mappings remain valid after the file is removed
+    this->_objects.erase(id);
+    remove_from_index(id);
+    std::remove(path(id).data());
+    std::remove(spill_path(id).data());
+}
+
+void sbn::shared_object_store::reference(shared_object_id id, application::id_type app) {
+    lock_type lock(this->_mutex);
+    do_reference(id, app);
+}
+
+void sbn::shared_object_store::do_reference(shared_object_id id, application::id_type app) {
+    // standalone applications are not tracked by the daemon
+    if (app == 0) { return; }
+    if (!this->_references.emplace(app, id).second) { return; }
+    std::stringstream tmp;
+    tmp << app;
+    const sys::path directory(references_directory(), tmp.str());
+    sys::mkdirs(directory);
+    tmp.str("");
+    tmp << std::hex << id;
+    using f = sys::open_flag;
+    sys::fildes out(sys::path(directory, tmp.str()).data(),
+                    f::close_on_exec | f::create | f::write_only, 0644);
+}
+
+size_t sbn::shared_object_store::release(application::id_type app) {
+    lock_type lock(this->_mutex);
+    for (auto first = this->_references.begin(); first != this->_references.end(); ) {
+        if (first->first == app) { first = this->_references.erase(first); }
+        else { ++first; }
+    }
+    std::stringstream tmp;
+    tmp << app;
+    const auto refs = references_directory();
+    const sys::path directory(refs, tmp.str());
+    std::vector<std::string> names;
+    {
+        sys::idirectory dir;
+        try {
+            dir.open(directory);
+        } catch (const sys::bad_call&) {
+            return 0;
+        }
+        for (const auto& entry : dir) {
+            if (is_object_name(entry.name())) { names.emplace_back(entry.name()); }
+        }
+    }
+    std::vector<std::string> applications;
+    {
+        sys::idirectory dir;
+        dir.open(refs);
+        for (const auto& entry : dir) {
+            if (is_object_name(entry.name()) && tmp.str() != entry.name()) {
+                applications.emplace_back(entry.name());
+            }
+        }
+    }
+    size_t count = 0;
+    for (const auto& name : names) {
+        std::remove(sys::path(directory, name).data());
+        bool referenced = false;
+        for (const auto& other : applications) {
+            if (file_exists(sys::path(sys::path(refs, other), name).data())) {
+                referenced = true;
+                break;
+            }
+        }
+        if (referenced) { continue; }
+        // existing mappings remain valid after the file is removed
+        const auto id = std::stoull(name, nullptr, 16);
+        this->_objects.erase(id);
+        remove_from_index(id);
+        std::remove(path(id).data());
+        std::remove(spill_path(id).data());
+        ++count;
+    }
+    std::remove(directory.data());
+    return count;
+}
+
+auto sbn::shared_object_store::environment() const -> string_array {
+    return {std::string("SBN_SHARED_OBJECTS_DIRECTORY=") + this->_directory.data(),
+            std::string("SBN_SHARED_OBJECTS_SPILL_DIRECTORY=") + this->_spill_directory.data()};
+}
+
+sys::path sbn::shared_object_store::references_directory() const {
+    return sys::path(this->_directory, "refs");
+}
+
+sys::path sbn::shared_object_store::path(shared_object_id id) const {
+    std::stringstream tmp;
+    tmp << std::hex << id;
+    return sys::path(this->_directory, tmp.str());
+}
+
+sys::path sbn::shared_object_store::spill_path(shared_object_id id) const {
+    std::stringstream tmp;
+    tmp << std::hex << id;
+    return sys::path(this->_spill_directory, tmp.str());
+}
+
+bool sbn::shared_object_store::spilled(shared_object_id id) const {
+    return !file_exists(path(id).data()) && file_exists(spill_path(id).data());
+}
+
+std::string sbn::shared_object_store::find(shared_object_id id) const {
+    auto filename = path(id);
+    if (file_exists(filename.data())) { return filename.data(); }
+    filename = spill_path(id);
+    if (file_exists(filename.data())) { return filename.data(); }
+    return std::string();
+}
+
+size_t sbn::shared_object_store::memory_size() {
+    lock_type lock(this->_mutex);
+    scan();
+    return this->_memory_size;
+}
+
+void sbn::shared_object_store::add_to_index(shared_object_id id, size_t size, time_point t) {
+    auto result = this->_index.emplace(id, index_entry{size, t});
+    if (result.second) {
+        this->_memory_size += size;
+    } else {
+        result.first->second.last_access = std::max(result.first->second.last_access, t);
+    }
+}
+
+void sbn::shared_object_store::remove_from_index(shared_object_id id) {
+    auto result = this->_index.find(id);
+    if (result == this->_index.end()) { return; }
+    this->_memory_size -= result->second.size;
+    this->_index.erase(result);
+}
+
+void sbn::shared_object_store::scan() {
+    this->_index.clear();
+    this->_memory_size = 0;
+    this->_last_scan = clock_type::now();
+    if (this->_min_free_memory == automatic) {
+        this->_min_free_memory = read_memory_info("MemTotal:")/20;
+    }
+    if (this->_min_free_memory != 0) { this->_free_memory = read_free_memory(); }
+    this->_scanned_memory_size = 0;
+    sys::idirectory dir;
+    try {
+        dir.open(this->_directory);
+    } catch (const sys::bad_call&) {
+        return;
+    }
+    for (const auto& entry : dir) {
+        if (!is_object_name(entry.name())) { continue; }
+        struct ::stat st{};
+        if (::stat(sys::path(this->_directory, entry.name()).data(), &st) == -1) {
+            continue;
+        }
+        add_to_index(std::stoull(entry.name(), nullptr, 16), st.st_size,
+                     to_time_point(st.st_mtim));
+    }
+    this->_scanned_memory_size = this->_memory_size;
+    if (this->_max_memory_size == automatic) {
+        struct ::statvfs st{};
+        if (::statvfs(this->_directory.data(), &st) == 0) {
+            this->_max_memory_size = st.f_blocks*st.f_frsize/2;
+        }
+    }
+}
+
+size_t sbn::shared_object_store::memory_limit() {
+    // the limits and the available memory are updated by the scan
+    size_t limit = this->_memory_size;
+    if (this->_max_memory_size != 0 && this->_max_memory_size < limit) {
+        limit = this->_max_memory_size;
+    }
+    if (this->_min_free_memory != 0) {
+        // the available memory is sampled by the scan, the objects that
+        // were written after the scan occupy the memory of the file system
+        auto free_memory = this->_free_memory;
+        if (this->_memory_size > this->_scanned_memory_size) {
+            const auto written = this->_memory_size - this->_scanned_memory_size;
+            free_memory = written < free_memory ? free_memory-written : 0;
+        }
+        if (free_memory < this->_min_free_memory) {
+            const auto shortage = this->_min_free_memory - free_memory;
+            limit = shortage < limit ? limit-shortage : 0;
+        }
+    }
+    return limit;
+}
+
+size_t sbn::shared_object_store::evict() {
+    lock_type lock(this->_mutex);
+    return do_evict();
+}
+
+void sbn::shared_object_store::evict_after_write() noexcept {
+    // the object is already written, the eviction is retried after the next write
+    try {
+        do_evict();
+    } catch (const std::exception& err) {
+        sys::log_message("shared-objects", "failed to evict objects: _", err.what());
+    }
+}
+
+size_t sbn::shared_object_store::do_evict() {
+    if (this->_max_memory_size == 0 && this->_min_free_memory == 0) { return 0; }
+    // The objects are written by all application processes on the node,
+    // but the directory is not scanned on every write.
+    if (clock_type::now() - this->_last_scan >= this->_scan_interval) { scan(); }
+    const auto limit = memory_limit();
+    if (this->_memory_size <= limit) { return 0; }
+    using value_type = index_table::value_type;
+    std::vector<const value_type*> objects;
+    objects.reserve(this->_index.size());
+    for (const auto& pair : this->_index) { objects.emplace_back(&pair); }
+    std::sort(objects.begin(), objects.end(),
+              [] (const value_type* a, const value_type* b) {
+                  return a->second.last_access < b->second.last_access;
+              });
+    sys::mkdirs(this->_spill_directory);
+    size_t nbytes = 0;
+    for (const auto* object : objects) {
+        if (this->_memory_size <= limit) { break; }
+        const auto id = object->first;
+        const auto size = object->second.size;
+        const auto src = path(id);
+        const auto dst = spill_path(id);
+        // The object is copied to the temporary file first, so that
+        // other processes never see partially written object.
+        // Existing mappings remain valid after the file is removed.
+        std::stringstream tmp;
+        tmp << dst.data() << '.' << sys::this_process::id();
+        const auto tmp_name = tmp.str();
+        try {
+            copy_file(src.data(), tmp_name.data());
+            UNISTDX_CHECK(std::rename(tmp_name.data(), dst.data()));
+        } catch (const sys::bad_call& err) {
+            std::remove(tmp_name.data());
+            // the object was moved or removed by other process
+            if (err.errc() != std::errc::no_such_file_or_directory) { throw; }
+            remove_from_index(id);
+            continue;
+        } catch (...) {
+            std::remove(tmp_name.data());
+            throw;
+        }
+        std::remove(src.data());
+        remove_from_index(id);
+        nbytes += size;
+    }
+    return nbytes;
+}
+
+void sbn::shared_object_store::write(shared_object_id id, const void* data, size_t size) {
+    using f = sys::open_flag;
+    sys::mkdirs(this->_directory);
+    const auto filename = path(id);
+    // write to the temporary file first, so that other processes
+    // never see partially written object
+    std::stringstream tmp;
+    tmp << filename.data() << '.' << sys::this_process::id();
+    const auto tmp_name = tmp.str();
+    try {
+        sys::fildes out(tmp_name.data(),
+                        f::truncate | f::close_on_exec | f::create | f::write_only, 0644);
+        write_fully(out.fd(), data, size);
+        out.close();
+        UNISTDX_CHECK(std::rename(tmp_name.data(), filename.data()));
+    } catch (...) {
+        std::remove(tmp_name.data());
+        throw;
+    }
+    add_to_index(id, size, clock_type::now());
+}
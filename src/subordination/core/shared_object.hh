@@ -0,0 +1,285 @@
+#ifndef SUBORDINATION_CORE_SHARED_OBJECT_HH
+#define SUBORDINATION_CORE_SHARED_OBJECT_HH
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <valarray>
+#include <vector>
+
+#include <unistdx/fs/path>
+
+#include <subordination/core/application.hh>
+
+namespace sbn {
+
+    /**
+    Content hash of the shared object (64-bit FNV-1a of the contents
+    followed by the size, with the final avalanche step of MurmurHash3).
+    The hash is not collision-resistant: two different objects may have
+    the same hash by accident, and the hash can be forged on purpose.
+    The store compares the contents of the objects with the same hash
+    and refuses to store the second one.
+    */
+    using shared_object_id = uint64_t;
+
+    shared_object_id shared_object_hash(const void* data, size_t size) noexcept;
+
+    /**
+    \brief Read-only memory mapping of the shared object.
+    \details The object is mapped only once per process and is unmapped
+    when the last pointer to it is destroyed.
+    */
+    class shared_object {
+
+    private:
+        const void* _data = nullptr;
+        size_t _size = 0;
+        shared_object_id _id = 0;
+
+    public:
+
+        shared_object(shared_object_id id, const char* filename);
+        ~shared_object() noexcept;
+
+        inline const void* data() const noexcept { return this->_data; }
+        inline size_t size() const noexcept { return this->_size; }
+        inline shared_object_id id() const noexcept { return this->_id; }
+
+        template <class T> inline const T*
+        begin() const noexcept { return static_cast<const T*>(this->_data); }
+
+        template <class T> inline const T*
+        end() const noexcept { return begin<T>() + count<T>(); }
+
+        /// The number of elements of type \c T in the object.
+        template <class T> inline size_t
+        count() const noexcept { return this->_size / sizeof(T); }
+
+        shared_object(const shared_object&) = delete;
+        shared_object& operator=(const shared_object&) = delete;
+        shared_object(shared_object&&) = delete;
+        shared_object& operator=(shared_object&&) = delete;
+
+    };
+
+    using shared_object_ptr = std::shared_ptr<const shared_object>;
+
+    /**
+    \brief Node-local content-addressed store of read-only objects.
+    \details
+    Each object is stored in a separate file in the store directory, the name
+    of the file is the hash of its contents. The principal publishes an object
+    once and puts only its hash into subordinate kernels
+    (\link kernel::shared_objects\endlink). The daemon fetches missing objects
+    from the node that sent the kernel before the kernel is delivered to the
+    application, so that all application processes on the node map the same file.
+    The directory should reside on \c tmpfs to avoid disk input/output.
+
+    The store also holds intermediate results: the subordinate publishes
+    the result and returns only its hash to the principal, the daemons remember
+    the direction from which the hash came and the scheduler prefers
+    the nodes that already hold the objects referenced by the kernel.
+    When the objects occupy more than \link properties::max_memory_size\endlink
+    bytes or the node has less than \link properties::min_free_memory\endlink
+    bytes of available memory, the least recently used objects are moved
+    to the spill directory on the local disk. Spilled objects are still found
+    by \link get\endlink and \link read\endlink. By default the objects
+    occupy at most half of the file system that holds the directory
+    (the size of \c tmpfs is half of the RAM by default) and the node keeps
+    1/20 of its RAM available. The sizes and access times of the objects
+    are kept in memory, the directory is rescanned for the objects
+    written by other processes and the available memory is sampled
+    at most once per \link properties::scan_interval\endlink.
+
+    Each application that publishes the object or receives the kernel
+    that references the object holds the reference to it
+    (an empty file in the \c refs subdirectory named after the application).
+    The daemon \link release\endlink's the references when the application
+    exits and removes the objects that are no longer referenced.
+    */
+    class shared_object_store {
+
+    public:
+        using clock_type = std::chrono::system_clock;
+        using time_point = clock_type::time_point;
+        using duration = clock_type::duration;
+
+        /// The limit is computed from the size of the file system or the RAM.
+        static constexpr const size_t automatic = std::numeric_limits<size_t>::max();
+
+        struct properties {
+            sys::path directory{"/dev/shm/sbn"};
+            sys::path spill_directory{"/var/tmp/sbn"};
+            /// The maximum total size of the objects in memory (zero means no limit).
+            size_t max_memory_size = automatic;
+            /// Spill the objects when the node has less available memory (zero means no limit).
+            size_t min_free_memory = automatic;
+            /// How often the directory is rescanned for the objects of other processes.
+            duration scan_interval = std::chrono::seconds(1);
+            bool set(const char* key, const std::string& value);
+            /// Use the directories that were passed by the daemon.
+            void read_environment();
+        };
+
+        using string_array = application::string_array;
+
+    private:
+        using mutex_type = std::mutex;
+        using lock_type = std::lock_guard<mutex_type>;
+        using object_table = std::unordered_map<shared_object_id,shared_object_ptr>;
+        using reference_set = std::set<std::pair<application::id_type,shared_object_id>>;
+
+        struct index_entry {
+            size_t size = 0;
+            time_point last_access;
+        };
+
+        using index_table = std::unordered_map<shared_object_id,index_entry>;
+
+    private:
+        sys::path _directory{"/dev/shm/sbn"};
+        sys::path _spill_directory{"/var/tmp/sbn"};
+        size_t _max_memory_size = automatic;
+        size_t _min_free_memory = automatic;
+        duration _scan_interval = std::chrono::seconds(1);
+        object_table _objects;
+        /// Objects in the memory directory.
+        index_table _index;
+        /// The total size of the objects in the index.
+        size_t _memory_size = 0;
+        /// Available memory of the node at the time of the last scan.
+        size_t _free_memory = 0;
+        /// The total size of the objects at the time of the last scan.
+        size_t _scanned_memory_size = 0;
+        time_point _last_scan{};
+        /// References that were added by this process.
+        reference_set _references;
+        mutable mutex_type _mutex;
+
+    public:
+
+        shared_object_store() = default;
+
+        inline explicit shared_object_store(const properties& p):
+        _directory(p.directory), _spill_directory(p.spill_directory),
+        _max_memory_size(p.max_memory_size), _min_free_memory(p.min_free_memory),
+        _scan_interval(p.scan_interval) {}
+
+        /**
+        Store the object in the directory if it does not exist
+        and add the reference to it on behalf of the current application.
+        \return the hash of the object contents
+        \throws std::runtime_error if other object with the same hash is stored
+        */
+        shared_object_id publish(const void* data, size_t size);
+
+        template <class T> inline shared_object_id
+        publish(const std::vector<T>& rhs) {
+            static_assert(std::is_trivially_copyable<T>::value, "bad type");
+            return publish(rhs.data(), rhs.size()*sizeof(T));
+        }
+
+        template <class T> inline shared_object_id
+        publish(const std::valarray<T>& rhs) {
+            static_assert(std::is_trivially_copyable<T>::value, "bad type");
+            return publish(rhs.size() == 0 ? nullptr : &rhs[0], rhs.size()*sizeof(T));
+        }
+
+        /**
+        Store the object that was received from other node.
+        \throws std::invalid_argument if the hash does not match the contents
+        \throws std::runtime_error if other object with the same hash is stored
+        */
+        void insert(shared_object_id id, const void* data, size_t size);
+
+        /**
+        Map the object into memory. The object is read from the spill directory
+        if it was moved there by other process.
+        \throws std::invalid_argument if there is no such object on this node
+        */
+        shared_object_ptr get(shared_object_id id);
+
+        /// Read the contents of the object without mapping it.
+        std::string read(shared_object_id id) const;
+
+        bool contains(shared_object_id id) const;
+        void remove(shared_object_id id);
+
+        /// Add the reference to the object on behalf of the application.
+        void reference(shared_object_id id, application::id_type app);
+
+        /**
+        Remove all references of the application and the objects
+        that are not referenced by other applications.
+        \return the number of removed objects
+        */
+        size_t release(application::id_type app);
+
+        /// Environment variables that pass the directories to the application.
+        string_array environment() const;
+
+        sys::path path(shared_object_id id) const;
+        sys::path spill_path(shared_object_id id) const;
+
+        /// Whether the object was moved to the spill directory.
+        bool spilled(shared_object_id id) const;
+
+        /**
+        Move the least recently used objects to the spill directory
+        until the memory limits are satisfied.
+        \return the number of bytes that were moved
+        */
+        size_t evict();
+
+        /// Rescan the directory and return the total size of the objects in memory.
+        size_t memory_size();
+
+        inline const sys::path& directory() const noexcept { return this->_directory; }
+        inline void directory(const sys::path& rhs) { this->_directory = rhs; }
+
+        inline const sys::path& spill_directory() const noexcept {
+            return this->_spill_directory;
+        }
+
+        inline void spill_directory(const sys::path& rhs) { this->_spill_directory = rhs; }
+        inline size_t max_memory_size() const noexcept { return this->_max_memory_size; }
+        inline void max_memory_size(size_t rhs) noexcept { this->_max_memory_size = rhs; }
+        inline size_t min_free_memory() const noexcept { return this->_min_free_memory; }
+        inline void min_free_memory(size_t rhs) noexcept { this->_min_free_memory = rhs; }
+        inline duration scan_interval() const noexcept { return this->_scan_interval; }
+        inline void scan_interval(duration rhs) noexcept { this->_scan_interval = rhs; }
+
+        shared_object_store(const shared_object_store&) = delete;
+        shared_object_store& operator=(const shared_object_store&) = delete;
+        shared_object_store(shared_object_store&&) = delete;
+        shared_object_store& operator=(shared_object_store&&) = delete;
+
+    private:
+        void write(shared_object_id id, const void* data, size_t size);
+        /// \throws std::runtime_error if the stored object has different contents
+        void check_collision(shared_object_id id, const void* data, size_t size) const;
+        void do_reference(shared_object_id id, application::id_type app);
+        sys::path references_directory() const;
+        /// \return the name of the file in memory or on disk, or empty string
+        std::string find(shared_object_id id) const;
+        size_t do_evict();
+        /// Evict the objects after they were written, the errors are only logged.
+        void evict_after_write() noexcept;
+        void scan();
+        void add_to_index(shared_object_id id, size_t size, time_point t);
+        void remove_from_index(shared_object_id id);
+        /// \return the no. of bytes the objects may occupy in memory
+        size_t memory_limit();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
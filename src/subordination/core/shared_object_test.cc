@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <subordination/core/kernel.hh>
+#include <subordination/core/kernel_buffer.hh>
+#include <subordination/core/shared_object.hh>
+
+TEST(shared_object, publish_and_get) {
+    const char* directory = "shared-object-test";
+    std::vector<double> phi{1.0, 0.5, 0.25, 0.125};
+    sbn::shared_object_store store;
+    store.directory(sys::path(directory));
+    const auto id = store.publish(phi);
+    EXPECT_EQ(sbn::shared_object_hash(phi.data(), phi.size()*sizeof(double)), id);
+    // the same contents have the same hash
+    EXPECT_EQ(id, store.publish(phi));
+    EXPECT_TRUE(store.contains(id));
+    auto obj = store.get(id);
+    ASSERT_EQ(phi.size(), obj->count<double>());
+    EXPECT_EQ(phi, std::vector<double>(obj->begin<double>(), obj->end<double>()));
+    // the object is mapped only once
+    EXPECT_EQ(obj, store.get(id));
+    // the object received from other node
+    sbn::shared_object_store other;
+    other.directory(sys::path(directory, "other"));
+    EXPECT_FALSE(other.contains(id));
+    const auto data = store.read(id);
+    EXPECT_THROW(other.insert(id+1, data.data(), data.size()), std::invalid_argument);
+    other.insert(id, data.data(), data.size());
+    EXPECT_TRUE(other.contains(id));
+    EXPECT_EQ(phi.size(), other.get(id)->count<double>());
+    other.remove(id);
+    EXPECT_FALSE(other.contains(id));
+    EXPECT_THROW(other.get(id), std::invalid_argument);
+    store.remove(id);
+    std::remove(sys::path(directory, "other").data());
+    std::remove(directory);
+}
+
+TEST(shared_object, hash_collision) {
+    const char* directory = "shared-object-collision-test";
+    std::vector<double> a{1.0, 2.0}, b{3.0, 4.0};
+    sbn::shared_object_store store;
+    store.directory(sys::path(directory));
+    const auto id = store.publish(a);
+    // other object with the same hash
+    {
+        std::ofstream out(store.path(id).data(), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(b.data()), b.size()*sizeof(double));
+    }
+    EXPECT_THROW(store.publish(a), std::runtime_error);
+    EXPECT_THROW(store.insert(id, a.data(), a.size()*sizeof(double)), std::runtime_error);
+    store.remove(id);
+    std::remove(directory);
+}
+
+TEST(shared_object, spill) {
+    const char* directory = "shared-object-spill-test";
+    const char* spill_directory = "shared-object-spill-test-disk";
+    std::vector<double> a(128, 1.0), b(128, 2.0), c(128, 3.0);
+    sbn::shared_object_store store;
+    store.directory(sys::path(directory));
+    store.spill_directory(sys::path(spill_directory));
+    store.max_memory_size(2*a.size()*sizeof(double));
+    store.min_free_memory(0);
+    // file modification time has coarse granularity
+    const auto tick = std::chrono::milliseconds(20);
+    const auto id_a = store.publish(a);
+    std::this_thread::sleep_for(tick);
+    const auto id_b = store.publish(b);
+    EXPECT_EQ(0u, store.evict());
+    EXPECT_EQ(2*a.size()*sizeof(double), store.memory_size());
+    // make the first object the most recently used one
+    std::this_thread::sleep_for(tick);
+    auto obj_a = store.get(id_a);
+    std::this_thread::sleep_for(tick);
+    const auto id_c = store.publish(c);
+    EXPECT_EQ(2*a.size()*sizeof(double), store.memory_size());
+    EXPECT_FALSE(store.spilled(id_a));
+    EXPECT_TRUE(store.spilled(id_b));
+    EXPECT_FALSE(store.spilled(id_c));
+    // spilled objects are still accessible
+    EXPECT_TRUE(store.contains(id_b));
+    auto obj_b = store.get(id_b);
+    EXPECT_EQ(b, std::vector<double>(obj_b->begin<double>(), obj_b->end<double>()));
+    EXPECT_EQ(b.size()*sizeof(double), store.read(id_b).size());
+    // existing mappings remain valid
+    EXPECT_EQ(a, std::vector<double>(obj_a->begin<double>(), obj_a->end<double>()));
+    for (auto id : {id_a, id_b, id_c}) {
+        store.remove(id);
+        EXPECT_FALSE(store.contains(id));
+    }
+    std::remove(directory);
+    std::remove(spill_directory);
+}
+
+TEST(shared_object, release) {
+    const char* directory = "shared-object-release-test";
+    std::vector<double> a(16, 1.0), b(16, 2.0);
+    sbn::shared_object_store store;
+    store.directory(sys::path(directory));
+    const auto id_a = store.publish(a);
+    const auto id_b = store.publish(b);
+    // the objects with the same prefix have different hashes
+    const auto id_c = store.publish(std::vector<double>(17, 1.0));
+    EXPECT_NE(id_a, id_c);
+    store.remove(id_c);
+    store.reference(id_a, 1);
+    store.reference(id_b, 1);
+    store.reference(id_b, 2);
+    EXPECT_EQ(1u, store.release(1));
+    EXPECT_FALSE(store.contains(id_a));
+    EXPECT_TRUE(store.contains(id_b));
+    EXPECT_EQ(0u, store.release(1));
+    EXPECT_EQ(1u, store.release(2));
+    EXPECT_FALSE(store.contains(id_b));
+    std::remove(sys::path(directory, "refs").data());
+    std::remove(directory);
+    const auto env = store.environment();
+    ASSERT_EQ(2u, env.size());
+    EXPECT_EQ(std::string("SBN_SHARED_OBJECTS_DIRECTORY=") + directory, env.front());
+}
+
+TEST(shared_object, kernel_header) {
+    sbn::kernel_buffer buffer;
+    sbn::kernel k;
+    k.add_shared_object(1);
+    k.add_shared_object(2);
+    k.write_header(buffer);
+    buffer.flip();
+    sbn::kernel k2;
+    k2.read_header(buffer);
+    EXPECT_EQ(k.shared_objects(), k2.shared_objects());
+}
@@ -0,0 +1,85 @@
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+#include <subordination/core/string_table.hh>
+
+namespace {
+
+    using sbn::resources::string_table;
+
+    struct table_type {
+        std::mutex mutex;
+        std::unordered_map<std::string,string_table::node*> strings;
+        string_table::id_type next_id = 1;
+    };
+
+    // The table is never deleted, because strings may be released
+    // by static objects after the table is destroyed.
+    table_type& table() {
+        static table_type* ptr = new table_type;
+        return *ptr;
+    }
+
+    // Increment the counter unless the node is about to be erased.
+    inline bool try_retain(std::atomic<string_table::count_type>& count) noexcept {
+        auto old = count.load(std::memory_order_relaxed);
+        while (old != 0) {
+            if (count.compare_exchange_weak(old, old+1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::string empty_string;
+
+}
+
+auto sbn::resources::string_table::intern(const char* s, size_t n) -> node* {
+    auto& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    std::string key(s, n);
+    auto result = t.strings.find(key);
+    if (result != t.strings.end()) {
+        if (try_retain(result->second->_count)) { return result->second; }
+        // the old node is erased by the thread that released it
+        result->second = new node(t.next_id++, s, n);
+        return result->second;
+    }
+    auto* ptr = new node(t.next_id++, s, n);
+    t.strings.emplace(std::move(key), ptr);
+    return ptr;
+}
+
+auto sbn::resources::string_table::find(const char* s, size_t n) -> node* {
+    auto& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    auto result = t.strings.find(std::string(s, n));
+    if (result == t.strings.end() || !try_retain(result->second->_count)) { return nullptr; }
+    return result->second;
+}
+
+size_t sbn::resources::string_table::size() {
+    auto& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    return t.strings.size();
+}
+
+void sbn::resources::string_table::erase(node* n) noexcept {
+    auto& t = table();
+    {
+        std::lock_guard<std::mutex> lock(t.mutex);
+        auto result = t.strings.find(n->_value);
+        if (result != t.strings.end() && result->second == n) { t.strings.erase(result); }
+    }
+    delete n;
+}
+
+const std::string& sbn::resources::interned_string::str() const noexcept {
+    return this->_node ? this->_node->value() : empty_string;
+}
+
+std::ostream& sbn::resources::operator<<(std::ostream& out, const interned_string& rhs) {
+    return out << rhs.str();
+}
@@ -0,0 +1,144 @@
+#ifndef SUBORDINATION_CORE_STRING_TABLE_HH
+#define SUBORDINATION_CORE_STRING_TABLE_HH
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+
+namespace sbn {
+
+    namespace resources {
+
+        /**
+        \brief Process-wide table of immutable reference-counted strings.
+        \details Each distinct string is stored only once and has unique numeric
+        identifier, so that strings are compared by comparing identifiers
+        and copied by incrementing the reference counter.
+        */
+        class string_table {
+
+        public:
+            using id_type = uint32_t;
+            using count_type = uint32_t;
+
+            class node {
+            private:
+                std::atomic<count_type> _count{1};
+                id_type _id;
+                std::string _value;
+            public:
+                inline explicit node(id_type id, const char* s, size_t n):
+                _id(id), _value(s, n) {}
+                inline id_type id() const noexcept { return this->_id; }
+                inline const std::string& value() const noexcept { return this->_value; }
+                friend class string_table;
+            };
+
+        public:
+            /// \return new reference to the string, the string is added to the table if needed
+            static node* intern(const char* s, size_t n);
+            /// \return new reference to the string or nullptr if it is not in the table
+            static node* find(const char* s, size_t n);
+            /// \return the number of strings in the table
+            static size_t size();
+
+            static inline void retain(node* n) noexcept {
+                if (n) { n->_count.fetch_add(1, std::memory_order_relaxed); }
+            }
+
+            static inline void release(node* n) noexcept {
+                if (n && n->_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    erase(n);
+                }
+            }
+
+        private:
+            static void erase(node* n) noexcept;
+
+        };
+
+        /// \brief A handle to the string in \link string_table\endlink.
+        class interned_string {
+
+        public:
+            using id_type = string_table::id_type;
+            using node = string_table::node;
+
+        private:
+            node* _node{};
+
+        public:
+
+            inline explicit interned_string(const char* s, size_t n):
+            _node(string_table::intern(s, n)) {}
+
+            inline explicit interned_string(const char* s):
+            interned_string(s, std::char_traits<char>::length(s)) {}
+
+            inline explicit interned_string(const std::string& s):
+            interned_string(s.data(), s.size()) {}
+
+            /// Look up the string without adding it to the table.
+            static inline interned_string find(const std::string& s) {
+                return interned_string(string_table::find(s.data(), s.size()));
+            }
+
+            /// Zero identifier denotes null string.
+            inline id_type id() const noexcept { return this->_node ? this->_node->id() : 0; }
+            const std::string& str() const noexcept;
+            inline const char* data() const noexcept { return str().data(); }
+            inline size_t size() const noexcept { return str().size(); }
+
+            inline explicit operator bool() const noexcept { return this->_node != nullptr; }
+            inline bool operator!() const noexcept { return this->_node == nullptr; }
+
+            inline bool operator==(const interned_string& rhs) const noexcept {
+                return this->_node == rhs._node;
+            }
+
+            inline bool operator!=(const interned_string& rhs) const noexcept {
+                return !this->operator==(rhs);
+            }
+
+            inline bool operator<(const interned_string& rhs) const noexcept {
+                return id() < rhs.id();
+            }
+
+            inline void swap(interned_string& rhs) noexcept { std::swap(this->_node, rhs._node); }
+
+            interned_string() = default;
+            inline ~interned_string() noexcept { string_table::release(this->_node); }
+
+            inline interned_string(const interned_string& rhs) noexcept: _node(rhs._node) {
+                string_table::retain(this->_node);
+            }
+
+            inline interned_string& operator=(const interned_string& rhs) noexcept {
+                interned_string tmp(rhs); swap(tmp); return *this;
+            }
+
+            inline interned_string(interned_string&& rhs) noexcept: _node(rhs._node) {
+                rhs._node = nullptr;
+            }
+
+            inline interned_string& operator=(interned_string&& rhs) noexcept {
+                interned_string tmp(std::move(rhs)); swap(tmp); return *this;
+            }
+
+        private:
+            /// Takes ownership of the reference.
+            inline explicit interned_string(node* n) noexcept: _node(n) {}
+
+        };
+
+        inline void swap(interned_string& a, interned_string& b) noexcept { a.swap(b); }
+
+        std::ostream& operator<<(std::ostream& out, const interned_string& rhs);
+
+    }
+
+}
+
+#endif // vim:filetype=cpp
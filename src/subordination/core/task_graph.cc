@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <subordination/core/task_graph.hh>
+
+namespace {
+
+    class compare_priority {
+    private:
+        const sbn::task_graph& _graph;
+    public:
+        inline explicit compare_priority(const sbn::task_graph& g) noexcept: _graph(g) {}
+        // max-heap: longer critical path first, smaller identifier first on ties
+        inline bool operator()(sbn::task_graph::task_id a,
+                               sbn::task_graph::task_id b) const noexcept {
+            const auto pa = this->_graph.priority(a), pb = this->_graph.priority(b);
+            return pa < pb || (pa == pb && a > b);
+        }
+    };
+
+}
+
+void sbn::task_graph::prepare() {
+    const auto n = static_cast<task_id>(size());
+    this->_ready.clear();
+    this->_num_completed = 0;
+    // topological order (Kahn's algorithm)
+    task_id_array order;
+    order.reserve(n);
+    for (task_id i=0; i<n; ++i) {
+        auto& t = this->_tasks[i];
+        t.in_degree = t.num_dependencies;
+        t.completed = false;
+        if (t.in_degree == 0) { order.emplace_back(i); }
+    }
+    for (size_t i=0; i<order.size(); ++i) {
+        for (auto s : this->_tasks[order[i]].successors) {
+            if (--this->_tasks[s].in_degree == 0) { order.emplace_back(s); }
+        }
+    }
+    if (order.size() != n) { throw std::invalid_argument("task graph has cycles"); }
+    // critical path in reverse topological order
+    for (auto first=order.rbegin(), last=order.rend(); first!=last; ++first) {
+        auto& t = this->_tasks[*first];
+        cost_type max_priority = 0;
+        for (auto s : t.successors) {
+            max_priority = std::max(max_priority, this->_tasks[s].priority);
+        }
+        t.priority = t.cost + max_priority;
+    }
+    for (task_id i=0; i<n; ++i) {
+        auto& t = this->_tasks[i];
+        t.in_degree = t.num_dependencies;
+        if (t.in_degree == 0) { push_ready(i); }
+    }
+}
+
+void sbn::task_graph::complete(task_id id) {
+    auto& t = this->_tasks[id];
+    Expects(!t.completed && t.in_degree == 0);
+    t.completed = true;
+    ++this->_num_completed;
+    for (auto s : t.successors) {
+        if (--this->_tasks[s].in_degree == 0) { push_ready(s); }
+    }
+}
+
+auto sbn::task_graph::pop_ready() -> task_id {
+    Expects(has_ready());
+    std::pop_heap(this->_ready.begin(), this->_ready.end(), compare_priority(*this));
+    auto t = this->_ready.back();
+    this->_ready.pop_back();
+    return t;
+}
+
+void sbn::task_graph::push_ready(task_id t) {
+    this->_ready.emplace_back(t);
+    std::push_heap(this->_ready.begin(), this->_ready.end(), compare_priority(*this));
+}
@@ -0,0 +1,102 @@
+#ifndef SUBORDINATION_CORE_TASK_GRAPH_HH
+#define SUBORDINATION_CORE_TASK_GRAPH_HH
+
+#include <cstdint>
+#include <vector>
+
+#include <subordination/bits/contracts.hh>
+
+namespace sbn {
+
+    /**
+    \brief Directed acyclic graph of tasks with explicit dependencies.
+    \details
+    Each task has an in-degree counter that is decremented when one of its
+    dependencies completes, and the task becomes ready when the counter reaches zero,
+    so completion costs O(successors) instead of rescanning the whole graph.
+    Ready tasks are returned in critical-path-first order: the task with the longest
+    path (in terms of task cost) to any of the sinks of the graph goes first.
+    */
+    class task_graph {
+
+    public:
+        using task_id = uint32_t;
+        using cost_type = double;
+        using task_id_array = std::vector<task_id>;
+
+    private:
+        struct task {
+            task_id_array successors;
+            cost_type cost = 1;
+            /// The length of the critical path from this task to any sink.
+            cost_type priority = 0;
+            uint32_t num_dependencies = 0;
+            uint32_t in_degree = 0;
+            bool completed = false;
+            inline explicit task(cost_type c) noexcept: cost(c) {}
+        };
+
+        using task_array = std::vector<task>;
+
+    private:
+        task_array _tasks;
+        /// Binary heap of ready tasks.
+        task_id_array _ready;
+        size_t _num_completed = 0;
+
+    public:
+
+        /// Add task with the specified cost. \return task identifier
+        inline task_id add(cost_type cost=1) {
+            this->_tasks.emplace_back(cost);
+            return static_cast<task_id>(this->_tasks.size()-1);
+        }
+
+        /// Add the dependency: \p t is ready after \p dependency completes.
+        inline void depends(task_id t, task_id dependency) {
+            Expects(t < size() && dependency < size() && t != dependency);
+            this->_tasks[dependency].successors.emplace_back(t);
+            ++this->_tasks[t].num_dependencies;
+        }
+
+        /**
+        Compute critical path for each task, reset in-degree counters and
+        put tasks without dependencies in the ready queue.
+        \throw std::invalid_argument if the graph has cycles
+        */
+        void prepare();
+
+        /// Mark the task as completed and put its successors that became ready in the queue.
+        void complete(task_id t);
+
+        /// \return the ready task with the longest critical path
+        task_id pop_ready();
+
+        inline bool has_ready() const noexcept { return !this->_ready.empty(); }
+        inline size_t num_ready() const noexcept { return this->_ready.size(); }
+        inline size_t size() const noexcept { return this->_tasks.size(); }
+        inline bool empty() const noexcept { return this->_tasks.empty(); }
+        inline size_t num_completed() const noexcept { return this->_num_completed; }
+        inline bool done() const noexcept { return this->_num_completed == size(); }
+        inline bool completed(task_id t) const noexcept { return this->_tasks[t].completed; }
+        inline cost_type cost(task_id t) const noexcept { return this->_tasks[t].cost; }
+        inline cost_type priority(task_id t) const noexcept { return this->_tasks[t].priority; }
+
+        inline const task_id_array& successors(task_id t) const noexcept {
+            return this->_tasks[t].successors;
+        }
+
+        inline void clear() noexcept {
+            this->_tasks.clear();
+            this->_ready.clear();
+            this->_num_completed = 0;
+        }
+
+    private:
+        void push_ready(task_id t);
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
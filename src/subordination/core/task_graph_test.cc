@@ -0,0 +1,76 @@
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <subordination/core/task_graph.hh>
+
+TEST(task_graph, critical_path_first) {
+    // a -> b -> c -> d, e -> d, f (independent)
+    sbn::task_graph g;
+    auto a = g.add(), b = g.add(), c = g.add(), d = g.add(), e = g.add(), f = g.add(10);
+    g.depends(b, a);
+    g.depends(c, b);
+    g.depends(d, c);
+    g.depends(d, e);
+    g.prepare();
+    EXPECT_EQ(4, g.priority(a));
+    EXPECT_EQ(2, g.priority(e));
+    EXPECT_EQ(10, g.priority(f));
+    ASSERT_EQ(3u, g.num_ready());
+    EXPECT_EQ(f, g.pop_ready());
+    EXPECT_EQ(a, g.pop_ready());
+    EXPECT_EQ(e, g.pop_ready());
+    EXPECT_FALSE(g.has_ready());
+    g.complete(e);
+    EXPECT_FALSE(g.has_ready());
+    g.complete(a);
+    ASSERT_TRUE(g.has_ready());
+    EXPECT_EQ(b, g.pop_ready());
+    g.complete(b);
+    EXPECT_EQ(c, g.pop_ready());
+    g.complete(c);
+    EXPECT_EQ(d, g.pop_ready());
+    g.complete(d);
+    g.complete(f);
+    EXPECT_TRUE(g.done());
+    EXPECT_EQ(g.size(), g.num_completed());
+}
+
+TEST(task_graph, grid) {
+    // the same dependencies as in autoreg: each cell depends on its left,
+    // upper and upper-left neighbours
+    constexpr const sbn::task_graph::task_id n = 10;
+    sbn::task_graph g;
+    for (sbn::task_graph::task_id i=0; i<n*n; ++i) { g.add(); }
+    for (sbn::task_graph::task_id i=0; i<n; ++i) {
+        for (sbn::task_graph::task_id j=0; j<n; ++j) {
+            if (i != 0) { g.depends(i*n+j, (i-1)*n+j); }
+            if (j != 0) { g.depends(i*n+j, i*n+j-1); }
+            if (i != 0 && j != 0) { g.depends(i*n+j, (i-1)*n+j-1); }
+        }
+    }
+    g.prepare();
+    EXPECT_EQ(2*n-1, g.priority(0));
+    std::vector<sbn::task_graph::task_id> order;
+    while (!g.done()) {
+        ASSERT_TRUE(g.has_ready());
+        auto t = g.pop_ready();
+        order.emplace_back(t);
+        g.complete(t);
+    }
+    ASSERT_EQ(n*n, order.size());
+    // the tasks are returned in the order of anti-diagonals
+    for (size_t k=1; k<order.size(); ++k) {
+        const auto prev = order[k-1], cur = order[k];
+        EXPECT_LE(prev/n + prev%n, cur/n + cur%n);
+    }
+}
+
+TEST(task_graph, cycle) {
+    sbn::task_graph g;
+    auto a = g.add(), b = g.add();
+    g.depends(a, b);
+    g.depends(b, a);
+    EXPECT_THROW(g.prepare(), std::invalid_argument);
+}
@@ -46,6 +46,8 @@ namespace sbn {
     //using weight_type = sys::u32;
 
     namespace resources {
+        class string_table;
+        class interned_string;
         class Any;
         enum class Type: uint8_t;
         enum class resources: uint32_t;
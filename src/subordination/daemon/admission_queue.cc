@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include <subordination/bits/contracts.hh>
+#include <subordination/core/list.hh>
+#include <subordination/daemon/admission_queue.hh>
+
+void sbnd::admission_queue::push(sbn::kernel_ptr&& k, const sbn::application* app,
+                                 time_point deadline) {
+    const auto id = k->target_application_id();
+    auto result = this->_queues.find(id);
+    if (result == this->_queues.end()) {
+        application_queue q;
+        if (app) {
+            q.priority = app->priority();
+            q.share = std::max(app->share(), share_type(1));
+        }
+        this->_round_robin[q.priority].emplace_back(id);
+        result = this->_queues.emplace(id, std::move(q)).first;
+    }
+    // kernels of the same application are admitted in the order of their priority
+    auto& q = result->second;
+    auto& kernels = q.levels[k->priority()][k->weight()];
+    kernels.emplace_back(queued_kernel{std::move(k), deadline, this->_sequence++});
+    ++q.size;
+    this->_next_deadline = std::min(this->_next_deadline, deadline);
+    ++this->_size;
+}
+
+auto sbnd::admission_queue::head(weight_class_table& classes) -> weight_class_iterator {
+    auto first = classes.begin(), last = classes.end(), result = first;
+    for (; first != last; ++first) {
+        if (first->second.front().sequence < result->second.front().sequence) {
+            result = first;
+        }
+    }
+    return result;
+}
+
+bool sbnd::admission_queue::find_bypassing(application_queue& q, const cost_function& cost,
+                                           const fits_function& fits,
+                                           priority_level_table::iterator& level,
+                                           weight_class_iterator& result) {
+    for (auto first=q.levels.begin(); first != q.levels.end(); ++first) {
+        auto& classes = first->second;
+        auto found = classes.end();
+        for (auto it = classes.begin(); it != classes.end(); ++it) {
+            const auto& x = it->second.front();
+            if (q.deficit < cost(*x.kernel) || !fits(*x.kernel)) { continue; }
+            if (found == classes.end() || x.sequence < found->second.front().sequence) {
+                found = it;
+            }
+        }
+        if (found != classes.end()) {
+            level = first;
+            result = found;
+            return true;
+        }
+    }
+    return false;
+}
+
+sbn::kernel_ptr sbnd::admission_queue::pop(const cost_function& cost, const fits_function& fits) {
+    bool head_blocked = false;
+    for (auto& pair : this->_round_robin) {
+        auto& ring = pair.second;
+        size_t num_blocked = 0;
+        while (num_blocked != ring.size()) {
+            const auto id = ring.front();
+            auto result = this->_queues.find(id);
+            Assert(result != this->_queues.end());
+            auto& q = result->second;
+            auto level = q.levels.begin();
+            auto found = head(level->second);
+            const auto& k = *found->second.front().kernel;
+            if (q.deficit < cost(k)) {
+                // the application has spent its quantum in this round
+                q.deficit += this->_quantum*q.share;
+                ring.pop_front();
+                ring.emplace_back(id);
+                num_blocked = 0;
+                continue;
+            }
+            // find the first kernel that fits into the node within the deficit
+            const bool may_bypass = this->_num_bypassed < this->_max_bypassed;
+            const bool head_fits = fits(k);
+            if (!head_fits && (!may_bypass || !find_bypassing(q, cost, fits, level, found))) {
+                // wait until some kernels finish
+                if (!may_bypass) { return nullptr; }
+                head_blocked = true;
+                ring.pop_front();
+                ring.emplace_back(id);
+                ++num_blocked;
+                continue;
+            }
+            if (!head_fits || head_blocked) { ++this->_num_bypassed; }
+            else { this->_num_bypassed = 0; }
+            auto& kernels = found->second;
+            auto tmp = std::move(kernels.front().kernel);
+            kernels.pop_front();
+            q.deficit -= cost(*tmp);
+            if (kernels.empty()) {
+                level->second.erase(found);
+                if (level->second.empty()) { q.levels.erase(level); }
+            }
+            --q.size;
+            --this->_size;
+            if (q.size == 0) { erase_queue(id); }
+            return tmp;
+        }
+        // all applications with this priority are blocked,
+        // try the applications with lower priority
+    }
+    return nullptr;
+}
+
+template <class Pred> auto
+sbnd::admission_queue::remove(Pred pred) -> kernel_queue {
+    kernel_queue removed;
+    std::vector<application_id_type> empty_queues;
+    this->_next_deadline = time_point::max();
+    for (auto& pair : this->_queues) {
+        auto& q = pair.second;
+        for (auto level = q.levels.begin(); level != q.levels.end(); ) {
+            auto& classes = level->second;
+            for (auto it = classes.begin(); it != classes.end(); ) {
+                std::deque<queued_kernel> kept;
+                for (auto& x : it->second) {
+                    if (pred(*x.kernel, x.deadline)) {
+                        removed.emplace_back(std::move(x.kernel));
+                        --q.size;
+                    } else {
+                        this->_next_deadline = std::min(this->_next_deadline, x.deadline);
+                        kept.emplace_back(std::move(x));
+                    }
+                }
+                if (kept.empty()) { it = classes.erase(it); }
+                else { it->second.swap(kept); ++it; }
+            }
+            if (classes.empty()) { level = q.levels.erase(level); }
+            else { ++level; }
+        }
+        if (q.size == 0) { empty_queues.emplace_back(pair.first); }
+    }
+    for (auto id : empty_queues) { erase_queue(id); }
+    this->_size -= removed.size();
+    return removed;
+}
+
+auto sbnd::admission_queue::expire(time_point now) -> kernel_queue {
+    // the queues are scanned only when the earliest deadline has passed
+    if (now < this->_next_deadline) { return kernel_queue(); }
+    return remove([now] (const sbn::kernel&, time_point deadline) {
+        return deadline <= now;
+    });
+}
+
+auto sbnd::admission_queue::remove_if(const predicate_type& pred) -> kernel_queue {
+    if (empty()) { return kernel_queue(); }
+    return remove([&pred] (const sbn::kernel& k, time_point) { return pred(k); });
+}
+
+void sbnd::admission_queue::erase_queue(application_id_type id) {
+    auto result = this->_queues.find(id);
+    auto& ring = this->_round_robin[result->second.priority];
+    ring.erase(std::find(ring.begin(), ring.end(), id));
+    if (ring.empty()) { this->_round_robin.erase(result->second.priority); }
+    this->_queues.erase(result);
+}
+
+void sbnd::admission_queue::clear(sbn::kernel_sack& sack) {
+    for (auto& pair : this->_queues) {
+        for (auto& level : pair.second.levels) {
+            for (auto& weight_class : level.second) {
+                for (auto& x : weight_class.second) {
+                    x.kernel.release()->mark_as_deleted(sack);
+                }
+            }
+        }
+    }
+    this->_queues.clear();
+    this->_round_robin.clear();
+    this->_size = 0;
+    this->_num_bypassed = 0;
+    this->_next_deadline = time_point::max();
+}
+
+void sbnd::admission_queue::write(std::ostream& out) const {
+    using sbn::list;
+    using sbn::make_list_view;
+    for (const auto& pair : this->_queues) {
+        const auto& q = pair.second;
+        std::vector<std::reference_wrapper<const sbn::kernel>> kernels;
+        kernels.reserve(q.size);
+        for (const auto& level : q.levels) {
+            for (const auto& weight_class : level.second) {
+                for (const auto& x : weight_class.second) { kernels.emplace_back(*x.kernel); }
+            }
+        }
+        out << ' ' << list("application-queue",
+            list("application-id", pair.first),
+            list("priority", unsigned(q.priority)),
+            list("share", q.share),
+            list("deficit", q.deficit),
+            list("outstanding-kernels", make_list_view(kernels)));
+    }
+}
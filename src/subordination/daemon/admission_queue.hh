@@ -0,0 +1,154 @@
+#ifndef SUBORDINATION_DAEMON_ADMISSION_QUEUE_HH
+#define SUBORDINATION_DAEMON_ADMISSION_QUEUE_HH
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <unordered_map>
+
+#include <subordination/core/application.hh>
+#include <subordination/core/kernel.hh>
+#include <subordination/core/types.hh>
+#include <subordination/core/weights.hh>
+
+namespace sbnd {
+
+    /**
+    \brief Outstanding kernels that wait for the threads of the cluster node.
+    \details
+    Deficit round-robin admission. Applications with higher priority are
+    served first; applications with the same priority receive the node's
+    threads in proportion to their shares. Each admitted kernel costs
+    the no. of threads it occupies. The kernels of each application are
+    admitted in the order of their \link sbn::kernel::priority\endlink.
+    The kernels of the same priority and weight share the same cost and
+    either all fit into the node or none of them do, so only the first kernel
+    of each such group is examined, and the admission cost does not depend
+    on the no. of queued kernels.
+
+    When the kernel at the head of the application queue does not fit into
+    the node, the kernels behind it (and the kernels of other applications)
+    that fit within the deficit are admitted instead. Only
+    \link max_bypassed\endlink kernels may bypass the blocked head kernels
+    in a row, after that the admission stops until the head kernel fits,
+    otherwise wide kernels would wait forever behind the stream of narrow ones.
+    */
+    class admission_queue {
+
+    public:
+        using clock_type = std::chrono::system_clock;
+        using time_point = clock_type::time_point;
+        using duration = clock_type::duration;
+        using application_id_type = sbn::application::id_type;
+        using priority_type = sbn::application::priority_type;
+        using share_type = sbn::application::share_type;
+        using kernel_queue = std::deque<sbn::kernel_ptr>;
+        /// \return the no. of threads the kernel occupies
+        using cost_function = std::function<sbn::weight_type(const sbn::kernel&)>;
+        /// \return true if the kernel fits into the node
+        using fits_function = std::function<bool(const sbn::kernel&)>;
+        using predicate_type = std::function<bool(const sbn::kernel&)>;
+
+    private:
+        struct queued_kernel {
+            sbn::kernel_ptr kernel;
+            time_point deadline;
+            /// The no. of the kernel in the order of arrival.
+            size_t sequence;
+        };
+
+        /// Kernels with the same weight have the same cost and fit into the node equally.
+        using weight_class_table = std::map<sbn::kernel::weight_type,std::deque<queued_kernel>>;
+        using kernel_priority_type = sbn::kernel::priority_type;
+        using priority_level_table =
+            std::map<kernel_priority_type,weight_class_table,std::greater<kernel_priority_type>>;
+        using weight_class_iterator = weight_class_table::iterator;
+
+        /**
+        Kernels of one application that wait for the resources.
+        The kernels are grouped by their priority and weight, so that only
+        the first kernel of each group is examined on admission.
+        */
+        struct application_queue {
+            priority_level_table levels;
+            size_t size = 0;
+            /// The no. of threads the application may occupy in the current round.
+            sbn::weight_type deficit = 0;
+            share_type share = 1;
+            priority_type priority = 0;
+        };
+
+        using queue_table = std::unordered_map<application_id_type,application_queue>;
+        using round_robin_queue = std::deque<application_id_type>;
+        using priority_table =
+            std::map<priority_type,round_robin_queue,std::greater<priority_type>>;
+
+    private:
+        /// Outstanding kernels grouped by target application.
+        queue_table _queues;
+        /// Applications with non-empty queues in round-robin order for each priority.
+        priority_table _round_robin;
+        size_t _size = 0;
+        size_t _sequence = 0;
+        sbn::weight_type _quantum = 1;
+        /// The no. of kernels that were admitted in a row while some head kernel did not fit.
+        size_t _num_bypassed = 0;
+        size_t _max_bypassed = 16;
+        /// The earliest deadline of the kernels (may be earlier than the actual one).
+        time_point _next_deadline = time_point::max();
+
+    public:
+
+        /**
+        Add the kernel to the queue of its target application.
+        \param[in] app the target application or nullptr if it is not known
+        \param[in] deadline the time after which the kernel is \link expire\endlink'd
+        */
+        void push(sbn::kernel_ptr&& k, const sbn::application* app,
+                  time_point deadline=time_point::max());
+
+        /// \return the next kernel that fits into the node or nullptr
+        sbn::kernel_ptr pop(const cost_function& cost, const fits_function& fits);
+
+        /// Remove the kernels with the deadline in the past.
+        kernel_queue expire(time_point now);
+
+        /// Remove the kernels that match the predicate.
+        kernel_queue remove_if(const predicate_type& pred);
+
+        void clear(sbn::kernel_sack& sack);
+
+        inline size_t size() const noexcept { return this->_size; }
+        inline bool empty() const noexcept { return this->_size == 0; }
+        inline time_point next_deadline() const noexcept { return this->_next_deadline; }
+        inline sbn::weight_type quantum() const noexcept { return this->_quantum; }
+        inline void quantum(sbn::weight_type rhs) noexcept { this->_quantum = rhs; }
+        inline size_t max_bypassed() const noexcept { return this->_max_bypassed; }
+        inline void max_bypassed(size_t rhs) noexcept { this->_max_bypassed = rhs; }
+
+        void write(std::ostream& out) const;
+
+    private:
+
+        template <class Pred> kernel_queue remove(Pred pred);
+        void erase_queue(application_id_type id);
+
+        /// \return the weight class with the earliest kernel
+        static weight_class_iterator head(weight_class_table& classes);
+
+        /**
+        Find the earliest kernel of the highest priority that fits into the node
+        within the deficit of the application.
+        */
+        static bool find_bypassing(application_queue& q, const cost_function& cost,
+                                   const fits_function& fits,
+                                   priority_level_table::iterator& level,
+                                   weight_class_iterator& result);
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,151 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <subordination/daemon/admission_queue.hh>
+
+namespace {
+
+    inline sbn::kernel_ptr
+    make_kernel(sbn::application::id_type app, sbn::kernel::weight_type weight=1) {
+        sbn::kernel_ptr k(new sbn::kernel);
+        k->target_application_id(app);
+        k->weight(weight);
+        return k;
+    }
+
+    inline sbn::weight_type cost(const sbn::kernel& k) { return k.weight(); }
+    inline bool fits_always(const sbn::kernel&) { return true; }
+
+}
+
+TEST(admission_queue, share) {
+    sbnd::admission_queue queue;
+    sbn::application a, b;
+    a.share(2);
+    b.share(1);
+    for (int i=0; i<30; ++i) {
+        queue.push(make_kernel(1), &a);
+        queue.push(make_kernel(2), &b);
+    }
+    EXPECT_EQ(60u, queue.size());
+    size_t counts[3]{};
+    for (int i=0; i<30; ++i) {
+        auto k = queue.pop(cost, fits_always);
+        ASSERT_TRUE(bool(k));
+        ++counts[k->target_application_id()];
+    }
+    EXPECT_NEAR(20, counts[1], 1);
+    EXPECT_NEAR(10, counts[2], 1);
+    EXPECT_EQ(30u, queue.size());
+}
+
+TEST(admission_queue, priority) {
+    sbnd::admission_queue queue;
+    sbn::application low, high;
+    high.priority(1);
+    for (int i=0; i<5; ++i) {
+        queue.push(make_kernel(1), &low);
+        queue.push(make_kernel(2), &high);
+    }
+    for (int i=0; i<5; ++i) {
+        auto k = queue.pop(cost, fits_always);
+        ASSERT_TRUE(bool(k));
+        EXPECT_EQ(2u, k->target_application_id());
+    }
+    for (int i=0; i<5; ++i) {
+        auto k = queue.pop(cost, fits_always);
+        ASSERT_TRUE(bool(k));
+        EXPECT_EQ(1u, k->target_application_id());
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(bool(queue.pop(cost, fits_always)));
+}
+
+TEST(admission_queue, skip_ahead) {
+    sbnd::admission_queue queue;
+    sbn::application a;
+    // the wide kernel does not fit into the node with two threads
+    queue.push(make_kernel(1, 4), &a);
+    for (int i=0; i<3; ++i) { queue.push(make_kernel(1, 1), &a); }
+    auto fits = [] (const sbn::kernel& k) { return k.weight() <= 2; };
+    for (int i=0; i<3; ++i) {
+        auto k = queue.pop(cost, fits);
+        ASSERT_TRUE(bool(k));
+        EXPECT_EQ(1u, k->weight());
+    }
+    EXPECT_FALSE(bool(queue.pop(cost, fits)));
+    EXPECT_EQ(1u, queue.size());
+    // the wide kernel is admitted when it fits
+    auto k = queue.pop(cost, fits_always);
+    ASSERT_TRUE(bool(k));
+    EXPECT_EQ(4u, k->weight());
+}
+
+TEST(admission_queue, max_bypassed) {
+    sbnd::admission_queue queue;
+    queue.max_bypassed(2);
+    sbn::application a;
+    queue.push(make_kernel(1, 4), &a);
+    for (int i=0; i<5; ++i) { queue.push(make_kernel(1, 1), &a); }
+    auto fits = [] (const sbn::kernel& k) { return k.weight() <= 2; };
+    EXPECT_TRUE(bool(queue.pop(cost, fits)));
+    EXPECT_TRUE(bool(queue.pop(cost, fits)));
+    // the narrow kernels wait until the wide kernel is admitted
+    EXPECT_FALSE(bool(queue.pop(cost, fits)));
+    EXPECT_EQ(4u, queue.size());
+    auto k = queue.pop(cost, fits_always);
+    ASSERT_TRUE(bool(k));
+    EXPECT_EQ(4u, k->weight());
+    EXPECT_TRUE(bool(queue.pop(cost, fits)));
+}
+
+TEST(admission_queue, head_of_line_blocking) {
+    sbnd::admission_queue queue;
+    queue.max_bypassed(0);
+    sbn::application a;
+    queue.push(make_kernel(1, 4), &a);
+    queue.push(make_kernel(1, 1), &a);
+    auto fits = [] (const sbn::kernel& k) { return k.weight() <= 2; };
+    EXPECT_FALSE(bool(queue.pop(cost, fits)));
+    EXPECT_EQ(2u, queue.size());
+}
+
+TEST(admission_queue, expire) {
+    using clock_type = sbnd::admission_queue::clock_type;
+    sbnd::admission_queue queue;
+    sbn::application a;
+    const auto now = clock_type::now();
+    queue.push(make_kernel(1), &a, now - std::chrono::seconds(1));
+    queue.push(make_kernel(1), &a);
+    queue.push(make_kernel(2), &a, now + std::chrono::seconds(1));
+    EXPECT_EQ(now - std::chrono::seconds(1), queue.next_deadline());
+    EXPECT_EQ(1u, queue.expire(now).size());
+    EXPECT_EQ(now + std::chrono::seconds(1), queue.next_deadline());
+    EXPECT_EQ(0u, queue.expire(now).size());
+    EXPECT_EQ(2u, queue.size());
+    auto removed = queue.remove_if([] (const sbn::kernel& k) {
+        return k.target_application_id() == 2;
+    });
+    EXPECT_EQ(1u, removed.size());
+    EXPECT_EQ(clock_type::time_point::max(), queue.next_deadline());
+}
+
+TEST(admission_queue, kernel_order) {
+    sbnd::admission_queue queue;
+    sbn::application a;
+    // kernels of one application are admitted in the order of their priority,
+    // and in FIFO order within the same priority regardless of their weight
+    struct { sys::u8 priority; sbn::kernel::weight_type weight; } params[] =
+        {{0,1}, {0,2}, {1,2}, {0,1}, {1,1}};
+    for (const auto& p : params) {
+        auto k = make_kernel(1, p.weight);
+        k->priority(p.priority);
+        k->id(queue.size()+1);
+        queue.push(std::move(k), &a);
+    }
+    std::vector<sbn::kernel::id_type> ids;
+    while (auto k = queue.pop(cost, fits_always)) { ids.emplace_back(k->id()); }
+    EXPECT_EQ((std::vector<sbn::kernel::id_type>{3, 5, 1, 2, 4}), ids);
+    EXPECT_TRUE(queue.empty());
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <subordination/core/error_handler.hh>
+#include <subordination/daemon/process_pipeline.hh>
+#include <subordination/daemon/socket_pipeline.hh>
+#include <subordination/test/kernel_collector.hh>
+
+namespace {
+
+    const sys::socket_address neighbour(sys::ipv4_socket_address{{10,0,0,1},33333});
+
+    inline void init(sbn::kernel& k, sbn::kernel::id_type id) {
+        k.id(id);
+        k.source(neighbour);
+        k.source_application_id(7);
+        k.target_application_id(7);
+    }
+
+}
+
+/*
+The application on the neighbour cancels the kernel that waits
+in the admission queue of this daemon. The notice comes through
+the socket pipeline and the kernel returns to the neighbour.
+*/
+TEST(socket_pipeline, cancel_queued_kernel) {
+    test::Kernel_collector source;
+    sbnd::process_pipeline proc;
+    proc.name("proc");
+    proc.foreign_pipeline(&source);
+    // no kernel fits into the node
+    proc.max_threads(0);
+    sbnd::socket_pipeline remote;
+    remote.name("remote");
+    remote.foreign_pipeline(&proc);
+    for (sbn::kernel::id_type id : {1, 2}) {
+        sbn::kernel_ptr k(new sbn::kernel);
+        init(*k, id);
+        proc.forward(std::move(k));
+    }
+    {
+        auto g = proc.guard();
+        EXPECT_EQ(2u, proc.num_outstanding_kernels());
+    }
+    sbn::kernel notice;
+    init(notice, 1);
+    {
+        auto g = remote.guard();
+        remote.cancel_received(notice);
+    }
+    auto kernels = source.wait_for(1);
+    ASSERT_EQ(1u, kernels.size());
+    const auto& k = *kernels.front();
+    EXPECT_EQ(1u, k.id());
+    EXPECT_EQ(sbn::exit_code::cancelled, k.return_code());
+    EXPECT_EQ(sbn::kernel::phases::downstream, k.phase());
+    {
+        auto g = proc.guard();
+        EXPECT_EQ(1u, proc.num_outstanding_kernels());
+    }
+    sbn::kernel_sack sack;
+    proc.clear(sack);
+}
+
+int main(int argc, char* argv[]) {
+    sbnd::block_child_signal();
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,42 @@
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <subordination/core/error_handler.hh>
+#include <subordination/daemon/process_pipeline.hh>
+
+TEST(process_pipeline, child_signal_fallback) {
+    using namespace std::chrono;
+    sbnd::process_pipeline::properties p;
+    p.pidfd = false;
+    p.allow_root = true;
+    sbnd::process_pipeline ppl(p);
+    ppl.name("proc");
+    ppl.start();
+    // the signal is delivered to the handler even if this thread is busy
+    std::thread other([] () { std::this_thread::sleep_for(milliseconds(100)); });
+    ppl.add(sbn::application({"/bin/true"}, {}));
+    bool reaped = false;
+    for (int i=0; i<1000 && !reaped; ++i) {
+        {
+            auto g = ppl.guard();
+            reaped = ppl.num_child_processes() == 0;
+        }
+        if (!reaped) { std::this_thread::sleep_for(milliseconds(10)); }
+    }
+    other.join();
+    EXPECT_TRUE(reaped);
+    ppl.stop();
+    ppl.wait();
+    sbn::kernel_sack sack;
+    ppl.clear(sack);
+}
+
+int main(int argc, char* argv[]) {
+    // before any thread is created
+    sbnd::block_child_signal();
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,214 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+
+#include <unistdx/fs/path>
+#include <unistdx/ipc/argstream>
+
+#include <subordination/daemon/discovery_test.hh>
+#include <subordination/daemon/test_application.hh>
+#include <subordination/test/config.hh>
+#include <valgrind/config.hh>
+
+#include <dtest/application.hh>
+
+/*
+Starts many sbnd instances in network namespaces of a single machine,
+optionally with network latency, packet loss and node failures, and
+reports convergence time of node discovery, the no. of discovery messages
+and the throughput of the test application.
+
+Usage: cluster-benchmark [nodes=N] [fanout=N] [probes=N] [probe-timeout=1s]
+                         [latency=10ms] [loss=1%] [failures=N]
+*/
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using time_point = clock_type::time_point;
+
+    struct benchmark_parameters {
+        size_t nodes = 16;
+        size_t fanout = 2;
+        size_t failures = 0;
+        size_t probes = 8;
+        std::string probe_timeout = "5s";
+        std::string latency;
+        std::string loss;
+
+        void set(const std::string& key, const std::string& value) {
+            if (key == "nodes") { nodes = std::stoul(value); }
+            else if (key == "fanout") { fanout = std::stoul(value); }
+            else if (key == "failures") { failures = std::stoul(value); }
+            else if (key == "probes") { probes = std::stoul(value); }
+            else if (key == "probe-timeout") { probe_timeout = value; }
+            else if (key == "latency") { latency = value; }
+            else if (key == "loss") { loss = value; }
+            else { throw std::invalid_argument("unknown parameter: " + key); }
+        }
+    };
+
+    struct benchmark_results {
+        time_point start{};
+        time_point converged{};
+        time_point failed{};
+        time_point reconverged{};
+        time_point submitted{};
+        time_point finished{};
+        size_t num_probes = 0;
+        size_t num_timed_out_probes = 0;
+        size_t num_hierarchy_messages = 0;
+    };
+
+    benchmark_parameters params;
+    benchmark_results results;
+
+    size_t count_events(const dts::string_array& lines, const char* expr) {
+        std::regex re(expr);
+        size_t n = 0;
+        for (const auto& line : lines) {
+            if (std::regex_match(line, re)) { ++n; }
+        }
+        return n;
+    }
+
+    double seconds(time_point a, time_point b) {
+        using namespace std::chrono;
+        return duration_cast<duration<double>>(b-a).count();
+    }
+
+    /// Wrap sbnd command into a shell script that sets up network emulation.
+    sys::argstream sbnd_args(const std::string& transactions_directory) {
+        std::stringstream cmd;
+        if (!params.latency.empty() || !params.loss.empty()) {
+            cmd << "for i in $(ls /sys/class/net); do "
+                "test $i = lo || tc qdisc add dev $i root netem";
+            if (!params.latency.empty()) { cmd << " delay " << params.latency; }
+            if (!params.loss.empty()) { cmd << " loss " << params.loss; }
+            cmd << "; done; ";
+        }
+        cmd << "exec " << SBND_PATH;
+        cmd << " discoverer.fanout=" << params.fanout;
+        cmd << " discoverer.max-probes=" << params.probes;
+        cmd << " discoverer.probe-timeout=" << params.probe_timeout;
+        cmd << " process.allow-root=1";
+        cmd << " remote.connection-timeout=1s";
+        cmd << " remote.max-connection-attempts=10";
+        cmd << " discoverer.scan-interval=5s";
+        cmd << " network.interface-update-interval=1h";
+        cmd << " transactions.directory=" << transactions_directory;
+        sys::argstream args;
+        args.append("/bin/sh");
+        args.append("-c");
+        args.append(cmd.str());
+        return args;
+    }
+
+    void report() {
+        const auto nkernels = SUBORDINATION_TEST_NUM_KERNELS;
+        const auto t = seconds(results.submitted, results.finished);
+        std::cout << std::setw(20) << std::left << "nodes" << params.nodes << '\n'
+            << std::setw(20) << "fanout" << params.fanout << '\n'
+            << std::setw(20) << "probes-in-flight" << params.probes << '\n'
+            << std::setw(20) << "probe-timeout" << params.probe_timeout << '\n'
+            << std::setw(20) << "latency" << params.latency << '\n'
+            << std::setw(20) << "loss" << params.loss << '\n'
+            << std::setw(20) << "failures" << params.failures << '\n'
+            << std::setw(20) << "convergence-time" << seconds(results.start, results.converged) << "s\n";
+        if (params.failures != 0) {
+            std::cout << std::setw(20) << "reconvergence-time"
+                << seconds(results.failed, results.reconverged) << "s\n";
+        }
+        std::cout << std::setw(20) << "probes" << results.num_probes << '\n'
+            << std::setw(20) << "timed-out-probes" << results.num_timed_out_probes << '\n'
+            << std::setw(20) << "hierarchy-messages" << results.num_hierarchy_messages << '\n'
+            << std::setw(20) << "kernels" << nkernels << '\n'
+            << std::setw(20) << "throughput" << (nkernels / t) << " kernels/s\n";
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    SBN_SKIP_IF_RUNNING_ON_VALGRIND();
+    for (int i=1; i<argc; ++i) {
+        std::string arg(argv[i]);
+        auto pos = arg.find('=');
+        if (pos == std::string::npos) { throw std::invalid_argument("bad argument: " + arg); }
+        params.set(arg.substr(0, pos), arg.substr(pos+1));
+    }
+    if (params.failures >= params.nodes) {
+        throw std::invalid_argument("too many failures");
+    }
+    dts::cluster cluster;
+    cluster.name("x");
+    cluster.network({{10,1,0,1},16});
+    cluster.peer_network({{10,0,0,1},16});
+    cluster.generate_nodes(params.nodes);
+    dts::application app;
+    app.exit_code(dts::exit_code::all);
+    app.cluster(std::move(cluster));
+    {
+        const auto num_nodes = app.cluster().size();
+        for (size_t i=0; i<num_nodes; ++i) {
+            std::stringstream tmp;
+            tmp << app.cluster().name() << (i+1);
+            const auto& transactions_directory = tmp.str();
+            std::remove(sys::path(transactions_directory, "transactions").data());
+            app.add_process(i, sbnd_args(transactions_directory));
+        }
+    }
+    results.start = clock_type::now();
+    app.emplace_test(
+        "Wait for all nodes to find their superior nodes.",
+        [] (dts::application& app, const dts::string_array& lines) {
+            dts::expect_event_count(lines, R"(^x.*test.*set principal to.*$)",
+                                    params.nodes-1);
+            results.converged = clock_type::now();
+        });
+    if (params.failures != 0) {
+        app.emplace_test(
+            "Kill nodes.",
+            [] (dts::application& app, const dts::string_array& lines) {
+                for (size_t i=0; i<params.failures; ++i) {
+                    app.kill_process(params.nodes-1-i, sys::signal::kill);
+                }
+                results.failed = clock_type::now();
+            });
+        app.emplace_test(
+            "Wait for superior nodes to remove failed subordinates.",
+            [] (dts::application& app, const dts::string_array& lines) {
+                dts::expect_event_count(lines, R"(^x.*test.*remove subordinate.*$)",
+                                        params.failures);
+                results.reconverged = clock_type::now();
+            });
+    }
+    app.emplace_test(
+        "Run test application.",
+        [] (dts::application& app, const dts::string_array& lines) {
+            sys::argstream args;
+            args.append(SBNC_PATH);
+            args.append("submit");
+            args.append(APP_PATH);
+            args.append("no-failure");
+            results.submitted = clock_type::now();
+            app.run_process(dts::cluster_node_bitmap(app.cluster().size(), {0}),
+                            std::move(args));
+        });
+    app.emplace_test(
+        "Wait for test application to finish.",
+        [] (dts::application& app, const dts::string_array& lines) {
+            dts::expect_event(lines, R"(^x.*test.*job .* terminated with status .*$)");
+            results.finished = clock_type::now();
+            results.num_probes = count_events(lines, R"(^x.*discoverer.*probe .* attempts .*$)");
+            results.num_timed_out_probes =
+                count_events(lines, R"(^x.*discoverer.*probe .* timed out$)");
+            results.num_hierarchy_messages =
+                count_events(lines, R"(^x.*test.*send hierarchy to .*$)");
+            report();
+        });
+    return dts::run(app);
+}
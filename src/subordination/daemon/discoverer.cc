@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <ostream>
@@ -23,6 +24,9 @@ namespace {
     /// to find the best principal node.
     class discovery_timer: public sbn::kernel {};
 
+    /// Timer which is used to cancel the probes that did not return in time.
+    class probe_timer: public sbn::kernel {};
+
 }
 
 std::ostream&
@@ -33,12 +37,16 @@ sbnd::operator<<(std::ostream& out, probe_result rhs) {
 }
 
 void sbnd::discoverer::on_start() {
-    discover();
+    // skip the scan if the superior is known from the cache
+    if (this->_hierarchy.has_superior()) { rejoin(); }
+    else { discover(); }
 }
 
 void sbnd::discoverer::on_kernel(sbn::kernel_ptr&& k) {
     if (typeid(*k) == typeid(discovery_timer)) {
         on_timer();
+    } else if (typeid(*k) == typeid(probe_timer)) {
+        on_probe_timer();
     } else if (typeid(*k) == typeid(probe)) {
         switch (k->phase()) {
             case sbn::kernel::phases::downstream:
@@ -57,33 +65,132 @@ void sbnd::discoverer::on_kernel(sbn::kernel_ptr&& k) {
 }
 
 void sbnd::discoverer::discover() {
-    if (this->_iterator == this->_end) {
+    // keep up to max_probes probes in flight
+    while (this->_probes.size() < max_probes() && this->_iterator != this->_end) {
+        sys::socket_address new_superior(sys::ipv4_socket_address{*this->_iterator, port()});
+        ++this->_iterator;
+        this->_probes.emplace_back(new_superior, this->_hierarchy.superior_socket_address());
+        send_probe(this->_probes.back());
+    }
+    if (this->_probes.empty()) {
         reset_iterator();
         log("_: all addresses have been probed", interface_address());
         discover_later();
     } else {
-        auto addr = *this->_iterator;
-        sys::socket_address new_superior(sys::ipv4_socket_address{addr, port()});
-        const auto& old_superior = this->_hierarchy.superior_socket_address();
-        if (profile()) {
-            profile("`((time . _) (node . \"_\") (probe . \"_\") (attempts . _))",
-                    current_time_in_microseconds(), interface_address(), addr,
-                    this->_attempts);
+        send_probe_timer();
+    }
+}
+
+void sbnd::discoverer::rejoin() {
+    const auto& sup = this->_hierarchy.superior_socket_address();
+    log("_: rejoin _", interface_address(), sup);
+    // the superior has removed the current node when the connection was closed,
+    // so we become its subordinate anew
+    this->_probes.emplace_back(sup, sys::socket_address{});
+    send_probe(this->_probes.back());
+    send_probe_timer();
+}
+
+void sbnd::discoverer::send_probe(probe_state& s) {
+    if (profile()) {
+        profile("`((time . _) (node . \"_\") (probe . \"_\") (attempts . _))",
+                current_time_in_microseconds(), interface_address(), s.address,
+                s.attempts);
+    } else {
+        log("_: probe _ attempts _", interface_address(), s.address, s.attempts);
+    }
+    ++s.attempts;
+    s.deadline = clock_type::now() + this->_probe_timeout;
+    send_probe(s.address, s.old_superior, s.address);
+}
+
+void sbnd::discoverer::send_probe(const sys::socket_address& destination,
+                                  const sys::socket_address& old_superior,
+                                  const sys::socket_address& new_superior) {
+    auto p = sbn::make_pointer<probe>(interface_address(), old_superior, new_superior);
+    p->nodes({this->_hierarchy.this_node()});
+    p->parent(this);
+    p->destination(destination);
+    p->principal_id(1); // TODO
+    p->phase(sbn::kernel::phases::point_to_point);
+    factory.remote().send(std::move(p));
+}
+
+void sbnd::discoverer::send_probe_timer() {
+    if (this->_probe_timer_pending || this->_probe_timeout == duration::zero()) { return; }
+    auto first = time_point::max();
+    for (const auto& s : this->_probes) {
+        if (!s.result) { first = std::min(first, s.deadline); }
+    }
+    for (const auto& pair : this->_cancelled_probes) { first = std::min(first, pair.second); }
+    if (first == time_point::max()) { return; }
+    auto k = sbn::make_pointer<probe_timer>();
+    k->after(std::max(first - clock_type::now(), duration::zero()));
+    k->principal(this);
+    k->phase(phases::point_to_point);
+    factory.local().send(std::move(k));
+    this->_probe_timer_pending = true;
+}
+
+void sbnd::discoverer::on_probe_timer() {
+    this->_probe_timer_pending = false;
+    const auto now = clock_type::now();
+    // the replies to the cancelled probes are not expected any more
+    for (auto first = this->_cancelled_probes.begin();
+         first != this->_cancelled_probes.end(); ) {
+        if (first->second <= now) { first = this->_cancelled_probes.erase(first); }
+        else { ++first; }
+    }
+    auto first = this->_probes.begin(), last = this->_probes.end();
+    auto result = std::remove_if(first, last, [&] (const probe_state& s) {
+        if (s.result || now < s.deadline) { return false; }
+        log("_: probe _ timed out", interface_address(), s.address);
+        cancel_probe(s.address);
+        return true;
+    });
+    if (result != last) {
+        this->_probes.erase(result, last);
+        if (!accept_probe()) { discover(); }
+    }
+    send_probe_timer();
+}
+
+auto sbnd::discoverer::find_probe(const pointer<probe>& p) -> probe_array::iterator {
+    return std::find_if(this->_probes.begin(), this->_probes.end(),
+                        [&p] (const probe_state& s) {
+                            return s.address == p->new_superior() &&
+                                s.old_superior == p->old_superior();
+                        });
+}
+
+bool sbnd::discoverer::accept_probe() {
+    // the first successful probe wins unless the probes with higher priority are in flight
+    if (this->_probes.empty() || !this->_probes.front().result) { return false; }
+    auto p = std::move(this->_probes.front().result);
+    const auto attempts = this->_probes.front().attempts;
+    this->_probes.erase(this->_probes.begin());
+    // the losers are notified about the new superior, hence it is set first
+    probe_succeeded(std::move(p), attempts);
+    cancel_probes();
+    return true;
+}
+
+void sbnd::discoverer::cancel_probes() {
+    for (auto& s : this->_probes) {
+        if (s.result) {
+            // the node has already added the current node as its subordinate
+            send_probe(s.address, s.address, this->_hierarchy.superior_socket_address());
         } else {
-            log("_: probe _ attempts _", interface_address(), addr, this->_attempts);
-        }
-        auto p = sbn::make_pointer<probe>(interface_address(), old_superior, new_superior);
-        p->nodes({this->_hierarchy.this_node()});
-        p->parent(this);
-        p->destination(new_superior);
-        p->principal_id(1); // TODO
-        p->phase(sbn::kernel::phases::point_to_point);
-        factory.remote().send(std::move(p));
-        if (++this->_attempts >= max_attempts()) {
-            this->_attempts = 0;
-            ++this->_iterator;
+            cancel_probe(s.address);
         }
     }
+    this->_probes.clear();
+    send_probe_timer();
+}
+
+void sbnd::discoverer::cancel_probe(const sys::socket_address& address) {
+    // wait for the late reply for one more timeout
+    this->_cancelled_probes[address] = clock_type::now() + this->_probe_timeout;
 }
 
 void sbnd::discoverer::on_timer() {
@@ -160,49 +267,66 @@ sbnd::probe_result sbnd::discoverer::process_probe(pointer<probe>& p) {
 }
 
 void sbnd::discoverer::probe_returned(pointer<probe> p) {
+    auto result = find_probe(p);
+    if (result == this->_probes.end()) {
+        // the probe was cancelled or it is the notification of the old superior
+        const auto& addr = p->new_superior();
+        if (this->_cancelled_probes.erase(addr) != 0 &&
+            p->return_code() == sbn::exit_code::success &&
+            addr != this->_hierarchy.superior_socket_address()) {
+            send_probe(addr, addr, this->_hierarchy.superior_socket_address());
+        }
+        return;
+    }
     if (p->return_code() != sbn::exit_code::success) {
         this->log("_: probe returned from _: _", this->interface_address(),
                   p->new_superior(), p->return_code());
-        discover();
-    } else {
-        const auto& old_superior = p->old_superior(), new_superior = p->new_superior();
-        if (old_superior != new_superior) {
-            if (old_superior) { factory.remote().stop_client(old_superior); }
-            bool changed = false;
-            const auto& nodes = p->nodes();
-            if (!nodes.empty()) {
-                const auto now = hierarchy_node::clock::now();
-                changed |= this->_hierarchy.add_nodes(nodes, now);
-                changed |= this->_hierarchy.add_superior(nodes.front(), now);
-                if (changed) {
-                    update_socket_pipeline_clients();
-                    broadcast_hierarchy(p->nodes().front().socket_address());
-                }
-            }
-            if (profile()) {
-                profile("`((time . _) (node . \"_\") (superior . \"_\") (attempts . _))",
-                        current_time_in_microseconds(), interface_address(),
-                        new_superior, this->_attempts);
-            } else {
-                #if defined(SBN_TEST)
-                sys::log_message("test", "_: set principal to _ attempts _ weight _",
-                                 interface_address(), new_superior, this->_attempts,
-                                 p->nodes().front().total_threads());
-                #endif
+        if (result->attempts < max_attempts()) {
+            send_probe(*result);
+            send_probe_timer();
+            return;
+        }
+        this->_probes.erase(result);
+        if (!accept_probe()) { discover(); }
+        return;
+    }
+    result->result = std::move(p);
+    accept_probe();
+}
+
+void sbnd::discoverer::probe_succeeded(pointer<probe> p, int attempts) {
+    const auto& old_superior = p->old_superior(), new_superior = p->new_superior();
+    if (old_superior != new_superior) {
+        if (old_superior) { factory.remote().stop_client(old_superior); }
+        bool changed = false;
+        const auto& nodes = p->nodes();
+        if (!nodes.empty()) {
+            const auto now = hierarchy_node::clock::now();
+            changed |= this->_hierarchy.add_nodes(nodes, now);
+            changed |= this->_hierarchy.add_superior(nodes.front(), now);
+            if (changed) {
+                update_socket_pipeline_clients();
+                broadcast_hierarchy(p->nodes().front().socket_address());
             }
         }
-        if (p->old_superior() && p->old_superior() != p->new_superior()) {
-            auto new_p = sbn::make_pointer<probe>(p->interface_address(), p->old_superior(),
-                                                  p->new_superior());
-            new_p->parent(this);
-            new_p->destination(p->old_superior());
-            new_p->principal_id(1); // TODO
-            new_p->phase(sbn::kernel::phases::point_to_point);
-            factory.remote().send(std::move(new_p));
+        if (profile()) {
+            profile("`((time . _) (node . \"_\") (superior . \"_\") (attempts . _))",
+                    current_time_in_microseconds(), interface_address(),
+                    new_superior, attempts);
+        } else {
+            #if defined(SBN_TEST)
+            sys::log_message("test", "_: set principal to _ attempts _ weight _",
+                             interface_address(), new_superior, attempts,
+                             p->nodes().front().total_threads());
+            #endif
         }
-        // try to find better superior after a period of time
-        discover_later();
     }
+    if (p->old_superior() && p->old_superior() != p->new_superior()) {
+        // notify the old superior
+        send_probe(p->old_superior(), p->old_superior(), p->new_superior());
+    }
+    // try to find better superior after a period of time
+    discover_later();
 }
 
 void sbnd::discoverer::update_socket_pipeline_clients() {
@@ -227,6 +351,7 @@ sbnd::discoverer::on_client_add(const sys::socket_address& address) {}
 
 void
 sbnd::discoverer::on_client_remove(const sys::socket_address& address) {
+    this->_links.erase(address);
     const auto now = hierarchy_node::clock::now();
     if (this->_hierarchy.remove_node(address, now)) {
         broadcast_hierarchy(address);
@@ -245,8 +370,8 @@ sbnd::discoverer::on_client_remove(const sys::socket_address& address) {
 
 void sbnd::discoverer::broadcast_hierarchy(const sys::socket_address& ignored_endpoint) {
     auto nodes = this->_hierarchy.nodes(this->_max_radius);
-    for (const auto& pair : this->_hierarchy.nodes()) {
-        const auto& sub_socket_address = pair.first;
+    for (const auto& b : this->_hierarchy.neighbours()) {
+        const auto& sub_socket_address = b.socket_address();
         if (sub_socket_address != ignored_endpoint) {
             send_weight(sub_socket_address, nodes);
         }
@@ -264,72 +389,91 @@ std::string sbnd::discoverer::cache_filename() const {
     return tmp.str();
 }
 
-void sbnd::discoverer::write_cache() const {
-    using f = sys::open_flag;
-    sys::fildes out;
+void sbnd::discoverer::write_cache() {
     try {
-        sys::path path(cache_directory(), cache_filename());
-        out.open(path, f::truncate | f::close_on_exec | f::create | f::write_only, 0600);
-        sbn::kernel_buffer buf;
-        buf << this->_hierarchy;
-        buf.flip();
-        buf.flush(out);
-        out.close();
-        log("write hierarchy to _: _", path, this->_hierarchy);
+        const bool in_place = this->_cache.write(this->_hierarchy);
+        log("write hierarchy to _ generation _ in-place _: _", this->_cache.path(),
+            this->_cache.generation(), in_place, this->_hierarchy);
     } catch (const sys::bad_call& err) {
-        log("failed to write cache");
+        log("failed to write cache: _", err.what());
     }
 }
 
 void sbnd::discoverer::read_cache() {
-    using f = sys::open_flag;
-    sys::fildes in;
     try {
-        sys::path path(cache_directory(), cache_filename());
-        in.open(path, f::close_on_exec | f::read_only);
-        sbn::kernel_buffer buf;
-        buf.fill(in);
-        buf.flip();
-        buf >> this->_hierarchy;
-        in.close();
-        log("read hierarchy from _: _", path, this->_hierarchy);
+        hierarchy_node_array nodes;
+        if (!this->_cache.read(this->_hierarchy, nodes)) { return; }
+        if (!this->_hierarchy.restore(nodes, hierarchy_node::clock::now())) { return; }
+        log("read hierarchy from _ generation _: _", this->_cache.path(),
+            this->_cache.generation(), this->_hierarchy);
+        auto g = factory.remote().guard();
         if (auto* sup = this->_hierarchy.superior()) {
-            auto g = factory.remote().guard();
             factory.remote().add_client(sup->socket_address(), this->_hierarchy);
         }
-        //for (const auto& s : this->_hierarchy.subordinates()) {
-        //    auto g = factory.remote().guard();
-        //    factory.remote().add_client(s.socket_address(), s.weight());
-        //}
+        // resume scheduling to the nodes behind the neighbours
+        factory.remote().update_clients(this->_hierarchy);
     } catch (const sys::bad_call& err) {
-        if (err.errc() != std::errc::no_such_file_or_directory) {
-            log("failed to read cache: _", err.what());
-        }
+        log("failed to read cache: _", err.what());
     }
 }
 
 void sbnd::discoverer::send_weight(const sys::socket_address& dest,
                                    const hierarchy_node_array& nodes) {
-    auto h = sbn::make_pointer<Hierarchy_kernel>(interface_address(), nodes);
+    auto h = sbn::make_pointer<Hierarchy_kernel>(interface_address(), hierarchy_node_array{});
+    // send only the nodes that changed since the last message
+    if (!this->_links[dest].diff(this->_journal, nodes, *h)) { return; }
+    forget_removed_nodes();
+    #if defined(SBN_TEST)
+    sys::log_message("test", "_: send hierarchy to _ nodes _ removed _",
+                     interface_address(), dest, h->nodes().size(), h->removed_nodes().size());
+    #endif
     h->point_to_point(1);
     h->parent(this);
     h->destination(dest);
     factory.remote().send(std::move(h));
 }
 
+void sbnd::discoverer::forget_removed_nodes() {
+    auto min_sequence = this->_journal.sequence();
+    for (const auto& pair : this->_links) {
+        const auto s = pair.second.sent_sequence();
+        if (s != 0 && s < min_sequence) { min_sequence = s; }
+    }
+    this->_journal.forget_removed(min_sequence);
+}
+
 void sbnd::discoverer::update_weights(pointer<Hierarchy_kernel> k) {
-    if (k->phase() == kernel::phases::downstream &&
-        k->return_code() != sbn::exit_code::success) {
-        log("_: failed to send hierarchy to _: _", interface_address(), k->source(),
+    const auto& src = k->source();
+    if (k->phase() == kernel::phases::downstream) {
+        if (k->return_code() == sbn::exit_code::success) { return; }
+        log("_: failed to send hierarchy to _: _", interface_address(), src,
             k->return_code());
+        auto result = this->_links.find(src);
+        if (result != this->_links.end()) { result->second.reset_sent(); }
+        // the neighbour has lost the base message, send full snapshot
+        if (k->return_code() == sbn::exit_code::error) {
+            send_weight(src, this->_hierarchy.nodes(this->_max_radius));
+        }
     } else {
+        if (!this->_links[src].accept(*k)) {
+            log("_: hierarchy from _ diverged, request full snapshot",
+                interface_address(), src);
+            k->nodes(hierarchy_node_array{});
+            k->removed_nodes({});
+            k->return_to_parent(sbn::exit_code::error);
+            factory.remote().send(std::move(k));
+            return;
+        }
         const auto now = hierarchy_node::clock::now();
-        if (this->_hierarchy.add_nodes(k->nodes(), now)) {
-            const auto& src = k->source();
+        bool changed = this->_hierarchy.add_nodes(k->nodes(), now);
+        if (k->delta()) { changed |= this->_hierarchy.remove_nodes(k->removed_nodes()); }
+        if (changed) {
             #if defined(SBN_TEST)
-            sys::log_message("test", "_: set _ weight to _",
-                             interface_address(), k->source(),
-                             k->nodes().front().resources()[1]);
+            if (!k->nodes().empty() && k->nodes().front().socket_address() == src) {
+                sys::log_message("test", "_: set _ weight to _",
+                                 interface_address(), src,
+                                 k->nodes().front().resources()[1]);
+            }
             #endif
             update_socket_pipeline_clients();
             broadcast_hierarchy(src);
@@ -344,8 +488,11 @@ _fanout(props.fanout), _hierarchy(interface_address, port) {
     this->_interval = props.scan_interval;
     this->_profile = props.profile;
     this->_max_attempts = props.max_attempts;
+    this->_max_probes = props.max_probes;
+    this->_probe_timeout = props.probe_timeout;
     this->_cache_directory = props.cache_directory;
     this->_max_radius = props.max_radius;
+    this->_cache = hierarchy_cache(sys::path(cache_directory(), cache_filename()));
     reset_iterator();
 }
 
@@ -377,6 +524,14 @@ bool sbnd::discoverer::properties::set(const char* key, const std::string& value
             throw std::out_of_range("out of range");
         }
         max_attempts = static_cast<int>(v);
+    } else if (std::strcmp(key, "max-probes") == 0) {
+        auto v = std::stoul(value);
+        if (v > std::numeric_limits<int>::max() || v == 0) {
+            throw std::out_of_range("out of range");
+        }
+        max_probes = static_cast<int>(v);
+    } else if (std::strcmp(key, "probe-timeout") == 0) {
+        probe_timeout = sbn::string_to_duration(value);
     } else if (std::strcmp(key, "max-radius") == 0) {
         auto v = std::stoul(value);
         if (v > std::numeric_limits<int>::max() || v == 0) {
@@ -3,6 +3,8 @@
 
 #include <chrono>
 #include <iosfwd>
+#include <unordered_map>
+#include <vector>
 
 #include <unistdx/base/log_message>
 #include <unistdx/net/interface_address>
@@ -11,6 +13,7 @@
 #include <subordination/core/properties.hh>
 #include <subordination/daemon/config.hh>
 #include <subordination/daemon/hierarchy.hh>
+#include <subordination/daemon/hierarchy_cache.hh>
 #include <subordination/daemon/hierarchy_kernel.hh>
 #include <subordination/daemon/probe.hh>
 #include <subordination/daemon/resident_kernel.hh>
@@ -36,9 +39,11 @@ namespace sbnd {
     public:
         struct properties {
             sbn::Duration scan_interval = std::chrono::minutes(1);
+            sbn::Duration probe_timeout = std::chrono::seconds(5);
             sys::path cache_directory;
             sys::ipv4_address::rep_type fanout = 64;
             int max_attempts = 1;
+            int max_probes = 8;
             int max_radius = 100;
             bool profile = false;
             bool set(const char* key, const std::string& value);
@@ -54,6 +59,9 @@ namespace sbnd {
         using duration = clock_type::duration;
         using resource_array = sbn::resource_array;
         using hierarchy_node_array = std::vector<hierarchy_node>;
+        using link_table = std::unordered_map<sys::socket_address,hierarchy_link>;
+        using time_point = clock_type::time_point;
+        using cancelled_probe_table = std::unordered_map<sys::socket_address,time_point>;
 
         enum class states {
             initial,
@@ -61,18 +69,45 @@ namespace sbnd {
             probing,
         };
 
+    private:
+        /// The probe that has been sent to potential superior node.
+        struct probe_state {
+            sys::socket_address address;
+            sys::socket_address old_superior;
+            time_point deadline;
+            /// Successful probe that waits for the probes with higher priority.
+            pointer<probe> result;
+            int attempts = 0;
+            inline probe_state(const sys::socket_address& a, const sys::socket_address& b):
+            address(a), old_superior(b) {}
+        };
+        /// In-flight probes ordered by priority.
+        using probe_array = std::vector<probe_state>;
+
     private:
         /// Time period between subsequent network scans.
         duration _interval = std::chrono::minutes(1);
         uint_type _fanout = 10000;
         hierarchy_type _hierarchy;
+        /// The nodes that were sent to the neighbours.
+        hierarchy_journal _journal;
+        /// The state of hierarchy exchange with each neighbour.
+        link_table _links;
         iterator _iterator, _end;
+        probe_array _probes;
+        /// Probes that timed out or lost to another probe and the time when
+        /// they are forgotten.
+        cancelled_probe_table _cancelled_probes;
+        /// Time period after which the probe is cancelled.
+        duration _probe_timeout = std::chrono::seconds(5);
         sys::path _cache_directory{SBND_SHARED_STATE_DIR};
+        hierarchy_cache _cache;
         states _state = states::initial;
-        int _attempts = 0;
         int _max_attempts = 3;
+        int _max_probes = 8;
         int _max_radius = 100;
         bool _profile = false;
+        bool _probe_timer_pending = false;
 
     public:
 
@@ -94,6 +129,7 @@ namespace sbnd {
         inline duration interval() const noexcept { return this->_interval; }
         inline bool profile() const noexcept { return this->_profile; }
         inline int max_attempts() const noexcept { return this->_max_attempts; }
+        inline size_t max_probes() const noexcept { return static_cast<size_t>(this->_max_probes); }
         inline const sys::path& cache_directory() const noexcept { return this->_cache_directory; }
 
         inline ifaddr_type interface_address() const noexcept {
@@ -108,11 +144,22 @@ namespace sbnd {
         void on_timer();
         void discover();
         void discover_later();
+        void rejoin();
+        void send_probe(probe_state& s);
+        void send_probe(const sys::socket_address& destination,
+                        const sys::socket_address& old_superior,
+                        const sys::socket_address& new_superior);
+        void send_probe_timer();
+        void on_probe_timer();
+        bool accept_probe();
+        void cancel_probes();
+        void cancel_probe(const sys::socket_address& address);
+        probe_array::iterator find_probe(const pointer<probe>& p);
         void reset_iterator();
         void probe_received(pointer<probe> p);
         probe_result process_probe(pointer<probe>& p);
         void probe_returned(pointer<probe> p);
-        //void send_probe(const sys::socket_address& dest);
+        void probe_succeeded(pointer<probe> p, int attempts);
 
         inline states state() const noexcept { return this->_state; }
         inline void state(states rhs) noexcept { this->_state = rhs; }
@@ -122,9 +169,11 @@ namespace sbnd {
         void on_client_remove(const sys::socket_address& endp);
         void broadcast_hierarchy(const sys::socket_address& ignored_endpoint);
         std::string cache_filename() const;
-        void write_cache() const;
+        void write_cache();
         void send_weight(const sys::socket_address& dest,
                          const hierarchy_node_array& nodes);
+        /// Forget the removed nodes that every neighbour knows about.
+        void forget_removed_nodes();
         void update_weights(pointer<Hierarchy_kernel> k);
         void update_socket_pipeline_clients();
 
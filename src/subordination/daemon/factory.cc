@@ -30,12 +30,19 @@ void sbnd::Properties::property(const std::string& key, const std::string& value
     } else if (set_if_prefix("unix.", unix, key, value)) {
     } else if (set_if_prefix("discoverer.", discover, key, value)) {
     } else if (set_if_prefix("transactions.", transactions, key, value)) {
+    } else if (set_if_prefix("shared-objects.", shared_objects, key, value)) {
     } else if (key == "factory.flags") {
         factory.flags = string_to_factory_flags(value);
     } else if (key == "network.allowed-interface-addresses") {
         network.allowed_interface_addresses = string_to_interface_address_list(value);
     } else if (key == "network.interface-update-interval") {
         network.interface_update_interval = sbn::string_to_duration(value);
+    } else if (key == "network.resource-update-interval") {
+        network.resource_update_interval = sbn::string_to_duration(value);
+    } else if (key == "network.idle-resource-update-interval") {
+        network.idle_resource_update_interval = sbn::string_to_duration(value);
+    } else if (key == "network.resource-update-threshold") {
+        network.resource_update_threshold = std::stoul(value);
     } else if (key.compare(0, 10, "resources.") == 0) {
         std::string name = key.substr(10);
         if (!sbn::resources::is_valid_name(name.data(), name.data()+name.size())) {
@@ -107,6 +114,14 @@ void sbnd::Factory::clear() {
 void sbnd::Factory::configure(const Properties& props) {
     using f = factory_flags;
     this->_flags = props.factory.flags;
+    {
+        const auto& p = props.shared_objects;
+        this->_shared_objects.directory(p.directory);
+        this->_shared_objects.spill_directory(p.spill_directory);
+        this->_shared_objects.max_memory_size(p.max_memory_size);
+        this->_shared_objects.min_free_memory(p.min_free_memory);
+        this->_shared_objects.scan_interval(p.scan_interval);
+    }
     if (isset(f::local)) {
         this->_local.make(props.local);
         this->_local->name("sbnd local");
@@ -119,6 +134,7 @@ void sbnd::Factory::configure(const Properties& props) {
         this->_remote->remote_pipeline(&this->_remote);
         this->_remote->types(&this->_types);
         this->_remote->instances(&this->_instances);
+        this->_remote->shared_objects(&this->_shared_objects);
     }
     if (isset(f::process)) {
         this->_process.make(props.process);
@@ -129,6 +145,7 @@ void sbnd::Factory::configure(const Properties& props) {
         this->_process->types(&this->_types);
         this->_process->instances(&this->_instances);
         this->_process->unix(&this->_unix);
+        this->_process->shared_objects(&this->_shared_objects);
     }
     if (isset(f::unix)) {
         this->_unix.make(props.unix);
@@ -7,6 +7,7 @@
 #include <subordination/core/kernel_type_registry.hh>
 #include <subordination/core/parallel_pipeline.hh>
 #include <subordination/core/properties.hh>
+#include <subordination/core/shared_object.hh>
 #include <subordination/core/transaction_log.hh>
 #include <subordination/daemon/config.hh>
 #include <subordination/daemon/discoverer.hh>
@@ -47,9 +48,24 @@ namespace sbnd {
         unix_socket_pipeline::properties unix;
         struct { factory_flags flags = factory_flags::all; } factory;
         sbn::transaction_log::properties transactions;
+        sbn::shared_object_store::properties shared_objects;
         struct {
             interface_address_list allowed_interface_addresses;
             sbn::Duration interface_update_interval = std::chrono::minutes(1);
+            /** How often run-time resources are sampled. Zero disables sampling
+            unless \link scheduling_policies::idle\endlink policy is used:
+            the policy compares sampled run-queue lengths, hence
+            \link idle_resource_update_interval\endlink is used instead.
+            Otherwise the sampled resources are used only in resource expressions,
+            and sampling is disabled by default. The interval should be the same
+            on all nodes of the cluster, because the samples of the neighbours
+            are used in scheduling decisions. */
+            sbn::Duration resource_update_interval = sbn::Duration::zero();
+            /// Sampling interval for \link scheduling_policies::idle\endlink policy.
+            sbn::Duration idle_resource_update_interval = std::chrono::seconds(10);
+            /** Sampled resource is sent to other nodes only if it differs from
+            the previous value by more than this no. of per cent. */
+            unsigned resource_update_threshold = 10;
         } network;
         discoverer::properties discover;
         struct Resources {
@@ -135,6 +151,7 @@ namespace sbnd {
         sbn::kernel_type_registry _types;
         sbn::kernel_instance_registry _instances;
         storage<sbn::transaction_log> _transactions;
+        sbn::shared_object_store _shared_objects;
         factory_flags _flags = factory_flags::all;
 
     public:
@@ -149,6 +166,7 @@ namespace sbnd {
         */
         inline sbn::kernel_type_registry& types() noexcept { return this->_types; }
         inline sbn::kernel_instance_registry& instances() noexcept { return this->_instances; }
+        inline sbn::shared_object_store& shared_objects() noexcept { return this->_shared_objects; }
 
         inline sbn::parallel_pipeline& local() noexcept { return *this->_local; }
         inline socket_pipeline& remote() noexcept { return *this->_remote; }
@@ -6,25 +6,27 @@
 #include <subordination/daemon/byte_buffers.hh>
 #include <subordination/daemon/hierarchy.hh>
 
+template <class T> constexpr const typename sbnd::Hierarchy<T>::index_type
+sbnd::Hierarchy<T>::npos;
+
 template <class T> bool
 sbnd::Hierarchy<T>::add_nodes(const hierarchy_node_array& nodes, time_point now) {
     bool updated = false;
-    const auto& n = this->_this_node;
     for (const auto& a : nodes) {
-        if (a.socket_address() == n.socket_address()) { continue; }
-        auto result = this->_nodes.find(a.socket_address());
-        if (result == this->_nodes.end()) {
-            auto r = this->_nodes.emplace(a.socket_address(), a);
-            if (r.second) { r.first->second.last_modified(now); }
+        if (a.socket_address() == socket_address()) { continue; }
+        auto i = find(a.socket_address());
+        if (i == npos) {
+            i = insert(a);
+            this->_nodes[i].last_modified(now);
             updated = true;
         } else {
-            auto& b = result->second;
+            const auto& b = this->_nodes[i];
             if (b.version() < a.version()) {
-                b = a;
+                replace(i, a);
                 updated = true;
             }
             if (b.version() <= a.version()) {
-                b.last_modified(now);
+                this->_nodes[i].last_modified(now);
             }
         }
     }
@@ -34,9 +36,9 @@ sbnd::Hierarchy<T>::add_nodes(const hierarchy_node_array& nodes, time_point now)
 template <class T> bool
 sbnd::Hierarchy<T>::add_superior(const hierarchy_node& node, time_point now) {
     bool updated = false;
-    auto& n = this->_this_node;
-    if (n.superior_socket_address() != node.socket_address()) {
-        n.superior_socket_address(node.socket_address());
+    if (superior_socket_address() != node.socket_address()) {
+        superior(0, node.socket_address());
+        auto& n = this->_nodes.front();
         n.increment_version();
         n.last_modified(now);
         updated = true;
@@ -46,12 +48,15 @@ sbnd::Hierarchy<T>::add_superior(const hierarchy_node& node, time_point now) {
 
 template <class T> bool
 sbnd::Hierarchy<T>::add_subordinate(const hierarchy_node& node, time_point now) {
-    const auto& n = this->_this_node;
-    auto& b = this->_nodes[node.socket_address()];
     bool updated = false;
-    if (b.superior_socket_address() != n.socket_address()) {
-        b.superior_socket_address(n.socket_address());
-        b.last_modified(now);
+    auto i = find(node.socket_address());
+    if (i == npos) {
+        i = insert(node);
+        updated = true;
+    }
+    if (this->_nodes[i].superior_socket_address() != socket_address()) {
+        superior(i, socket_address());
+        this->_nodes[i].last_modified(now);
         updated = true;
     }
     return updated;
@@ -59,33 +64,60 @@ sbnd::Hierarchy<T>::add_subordinate(const hierarchy_node& node, time_point now)
 
 template <class T> bool
 sbnd::Hierarchy<T>::remove_node(const sys::socket_address& sa, time_point now) {
-    auto& n = this->_this_node;
     bool updated = false;
-    if (n.superior_socket_address() == sa) {
-        n.superior_socket_address({});
-        n.last_modified(now);
+    if (superior_socket_address() == sa) {
+        superior(0, {});
+        this->_nodes.front().last_modified(now);
         updated = true;
     }
-    auto result = this->_nodes.find(sa);
-    if (result == this->_nodes.end()) { return false; }
-    auto& b = result->second;
-    if (b.superior_socket_address() == n.socket_address()) {
-        b.superior_socket_address({});
-        b.last_modified(now);
+    const auto i = find(sa);
+    if (i == npos || i == 0) { return false; }
+    auto& b = this->_nodes[i];
+    if (b.superior_socket_address() == socket_address()) {
+        superior(i, {});
+        updated = true;
+    }
+    b.last_modified(now);
+    return updated;
+}
+
+template <class T> bool
+sbnd::Hierarchy<T>::restore(const hierarchy_node_array& nodes, time_point now) {
+    if (nodes.empty() || nodes.front().socket_address() != socket_address()) { return false; }
+    const auto& old = nodes.front();
+    add_nodes(nodes, now);
+    auto& n = this->_nodes.front();
+    if (old.superior_socket_address()) { superior(0, old.superior_socket_address()); }
+    // the neighbours ignore the versions that they have already seen
+    n.version(std::max(n.version(), old.version()));
+    n.increment_version();
+    n.last_modified(now);
+    return true;
+}
+
+template <class T> bool
+sbnd::Hierarchy<T>::remove_nodes(const socket_address_array& nodes) {
+    bool updated = false;
+    for (const auto& sa : nodes) {
+        if (sa == superior_socket_address()) { continue; }
+        const auto i = find(sa);
+        if (i == npos || i == 0) { continue; }
+        if (this->_nodes[i].superior_socket_address() == socket_address()) { continue; }
+        erase(i);
         updated = true;
-    } else {
-        b.last_modified(now);
     }
     return updated;
 }
 
 template <class T> bool
 sbnd::Hierarchy<T>::resources(const resource_array& rhs, time_point now) {
-    auto& n = this->_this_node;
+    auto& n = this->_nodes.front();
     if (n.resources() != rhs) {
+        statistics_type old_value(n);
         n.resources(rhs);
         n.increment_version();
         n.last_modified(now);
+        update_statistics(0, old_value, statistics_type(n));
         return true;
     }
     return false;
@@ -93,20 +125,18 @@ sbnd::Hierarchy<T>::resources(const resource_array& rhs, time_point now) {
 
 template <class T> std::ostream&
 sbnd::operator<<(std::ostream& out, const Hierarchy<T>& rhs) {
-    auto result = rhs._nodes.find(rhs._this_node.superior_socket_address());
+    using index_type = typename Hierarchy<T>::index_type;
     out << "interface-socket-address=" << rhs.interface_socket_address() << ',';
     out << "superior=";
-    if (result != rhs._nodes.end()) { out << result->second; }
+    if (const auto* s = rhs.superior()) { out << *s; }
     out << ',';
     out << "subordinates=";
     bool first = true;
-    for (const auto& pair : rhs._nodes) {
-        if (pair.first == rhs._this_node.superior_socket_address()) { continue; }
-        if (pair.second.superior_socket_address() != rhs._this_node.socket_address()) {
-            continue;
-        }
-        out << pair.first << '*' << pair.second.total_threads();
+    for (index_type i=rhs._links.front().first_child; i != Hierarchy<T>::npos;
+         i=rhs._links[i].next_sibling) {
         if (!first) { out << ','; }
+        const auto& b = rhs._nodes[i];
+        out << b.socket_address() << '*' << b.total_threads();
         first = false;
     }
     return out;
@@ -114,69 +144,262 @@ sbnd::operator<<(std::ostream& out, const Hierarchy<T>& rhs) {
 
 template <class T>
 auto sbnd::Hierarchy<T>::nodes(int radius) const -> hierarchy_node_array {
-    hierarchy_node_array result;
-    result.reserve(this->_nodes.size()+1);
-    result.emplace_back(this->_this_node);
-    // add lower nodes
-    traverse(result, 0, radius, [] (const hierarchy_node& b, const hierarchy_node& a) {
-        return b.superior_socket_address() == a.socket_address();
-    });
-    const int old_size = result.size();
-    result.emplace_back(this->_this_node);
-    // add upper nodes
-    traverse(result, old_size, radius, [&result] (const hierarchy_node& b, const hierarchy_node& a) {
-        return a.superior_socket_address() == b.socket_address() &&
-            std::find_if(result.begin(), result.end(),
-                         [&b] (const hierarchy_node& x) {
-                             return x.socket_address() == b.socket_address();
-                         }) == result.end();
-    });
-    result.erase(result.begin() + old_size);
-    return result;
+    index_array indices;
+    indices.reserve(this->_nodes.size());
+    lower(0, radius, indices);
+    const auto old_size = indices.size();
+    upper(0, radius, indices);
+    // remove the duplicate of the current node
+    indices.erase(indices.begin() + old_size);
+    return to_nodes(indices);
 }
 
 template <class T> auto
 sbnd::Hierarchy<T>::lower_nodes(const hierarchy_node& from, int depth) const
 -> hierarchy_node_array {
-    hierarchy_node_array result;
-    result.reserve(this->_nodes.size()+1);
-    result.emplace_back(from);
-    traverse(result, 0, depth, [] (const hierarchy_node& b, const hierarchy_node& a) {
-        return b.superior_socket_address() == a.socket_address();
-    });
-    result.shrink_to_fit();
-    return result;
+    const auto i = find(from.socket_address());
+    if (i == npos) { return {from}; }
+    index_array indices;
+    lower(i, depth, indices);
+    return to_nodes(indices);
 }
 
 template <class T> auto
 sbnd::Hierarchy<T>::upper_nodes(const hierarchy_node& from, int depth) const
 -> hierarchy_node_array {
-    hierarchy_node_array result;
-    result.reserve(this->_nodes.size()+1);
-    result.emplace_back(from);
-    traverse(result, 0, depth, [&result] (const hierarchy_node& b, const hierarchy_node& a) {
-        return a.superior_socket_address() == b.socket_address() &&
-            std::find_if(result.begin(), result.end(),
-                         [&b] (const hierarchy_node& x) {
-                             return x.socket_address() == b.socket_address();
-                         }) == result.end();
-    });
-    result.shrink_to_fit();
+    const auto i = find(from.socket_address());
+    if (i == npos) { return {from}; }
+    index_array indices;
+    upper(i, depth, indices);
+    return to_nodes(indices);
+}
+
+template <class T> auto
+sbnd::Hierarchy<T>::indices_behind(const sys::socket_address& from) const
+-> index_array {
+    const auto i = find(from);
+    if (i == npos || i == 0) { return {}; }
+    index_array indices;
+    if (from == superior_socket_address()) {
+        upper(i, std::numeric_limits<int>::max(), indices);
+    } else {
+        lower(i, std::numeric_limits<int>::max(), indices);
+    }
+    return indices;
+}
+
+template <class T> auto
+sbnd::Hierarchy<T>::statistics_behind(const sys::socket_address& from) const noexcept
+-> statistics_type {
+    const auto i = find(from);
+    if (i == npos || i == 0) { return {}; }
+    if (from != superior_socket_address()) { return this->_links[i].subtree; }
+    // the superior and its superiors
+    statistics_type result;
+    for (auto j=i; j != npos; j=this->_links[j].parent) {
+        result += statistics_type(this->_nodes[j]);
+    }
     return result;
 }
 
+template <class T> void
+sbnd::Hierarchy<T>::lower(index_type from, int depth, index_array& result) const {
+    size_t j0 = result.size();
+    result.emplace_back(from);
+    for (int d=0; d<depth && j0 != result.size(); ++d) {
+        const auto j1 = result.size();
+        for (auto j=j0; j<j1; ++j) {
+            for (auto i=this->_links[result[j]].first_child; i != npos;
+                 i=this->_links[i].next_sibling) {
+                result.emplace_back(i);
+            }
+        }
+        j0 = j1;
+    }
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::upper(index_type from, int depth, index_array& result) const {
+    result.emplace_back(from);
+    auto i = this->_links[from].parent;
+    for (int d=0; d<depth && i != npos; ++d) {
+        result.emplace_back(i);
+        i = this->_links[i].parent;
+    }
+}
+
+template <class T> auto
+sbnd::Hierarchy<T>::insert(const hierarchy_node& node) -> index_type {
+    const index_type i = this->_nodes.size();
+    this->_nodes.emplace_back(node);
+    this->_links.emplace_back();
+    this->_links[i].subtree = statistics_type(node);
+    this->_indices.emplace(node.socket_address(), i);
+    link(i);
+    adopt_orphans(i);
+    return i;
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::replace(index_type i, const hierarchy_node& node) {
+    auto& b = this->_nodes[i];
+    const bool relink = b.superior_socket_address() != node.superior_socket_address();
+    if (relink) { unlink(i), remove_orphan(i); }
+    update_statistics(i, statistics_type(b), statistics_type(node));
+    b = node;
+    if (relink) { link(i); }
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::erase(index_type i) {
+    unlink(i);
+    remove_orphan(i);
+    auto& links = this->_links;
+    // subordinates of the erased node become orphans
+    for (auto j=links[i].first_child; j != npos; ) {
+        auto& l = links[j];
+        const auto k = j;
+        j = l.next_sibling;
+        l.parent = npos, l.prev_sibling = npos, l.next_sibling = npos;
+        add_orphan(k);
+    }
+    links[i].first_child = npos;
+    this->_indices.erase(this->_nodes[i].socket_address());
+    // move the last node in place of the erased one
+    const index_type last = this->_nodes.size()-1;
+    if (i != last) {
+        this->_nodes[i] = std::move(this->_nodes[last]);
+        links[i] = links[last];
+        this->_indices[this->_nodes[i].socket_address()] = i;
+        const auto& l = links[i];
+        if (l.parent != npos && l.prev_sibling == npos) { links[l.parent].first_child = i; }
+        if (l.prev_sibling != npos) { links[l.prev_sibling].next_sibling = i; }
+        if (l.next_sibling != npos) { links[l.next_sibling].prev_sibling = i; }
+        for (auto j=l.first_child; j != npos; j=links[j].next_sibling) { links[j].parent = i; }
+    }
+    this->_nodes.pop_back();
+    links.pop_back();
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::superior(index_type i, const sys::socket_address& sa) {
+    unlink(i);
+    remove_orphan(i);
+    this->_nodes[i].superior_socket_address(sa);
+    link(i);
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::link(index_type i) {
+    auto& links = this->_links;
+    if (links[i].parent != npos) { return; }
+    const auto p = find(this->_nodes[i].superior_socket_address());
+    if (p == npos) { add_orphan(i); return; }
+    // do not create cycles
+    for (auto j=p; j != npos; j=links[j].parent) {
+        if (j == i) { add_orphan(i); return; }
+    }
+    auto& l = links[i];
+    l.parent = p;
+    l.prev_sibling = npos;
+    l.next_sibling = links[p].first_child;
+    if (l.next_sibling != npos) { links[l.next_sibling].prev_sibling = i; }
+    links[p].first_child = i;
+    for (auto j=p; j != npos; j=links[j].parent) { links[j].subtree += l.subtree; }
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::unlink(index_type i) {
+    auto& links = this->_links;
+    auto& l = links[i];
+    if (l.parent == npos) { return; }
+    for (auto j=l.parent; j != npos; j=links[j].parent) { links[j].subtree -= l.subtree; }
+    if (l.prev_sibling != npos) {
+        links[l.prev_sibling].next_sibling = l.next_sibling;
+    } else {
+        links[l.parent].first_child = l.next_sibling;
+    }
+    if (l.next_sibling != npos) { links[l.next_sibling].prev_sibling = l.prev_sibling; }
+    l.parent = npos, l.prev_sibling = npos, l.next_sibling = npos;
+}
+
+/**
+The orphan table may contain the nodes that were linked or erased
+since they had been added, hence each orphan is checked before linking.
+*/
+template <class T> void
+sbnd::Hierarchy<T>::adopt_orphans(index_type i) {
+    const auto sa = this->_nodes[i].socket_address();
+    auto range = this->_orphans.equal_range(sa);
+    if (range.first == range.second) { return; }
+    index_array orphans;
+    for (auto first=range.first; first != range.second; ++first) {
+        const auto j = find(first->second);
+        if (j != npos && j != i && this->_links[j].parent == npos &&
+            this->_nodes[j].superior_socket_address() == sa) {
+            orphans.emplace_back(j);
+        }
+    }
+    this->_orphans.erase(range.first, range.second);
+    for (auto j : orphans) { link(j); }
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::add_orphan(index_type i) {
+    const auto& n = this->_nodes[i];
+    if (!n.superior_socket_address()) { return; }
+    auto range = this->_orphans.equal_range(n.superior_socket_address());
+    for (auto first=range.first; first != range.second; ++first) {
+        if (first->second == n.socket_address()) { return; }
+    }
+    this->_orphans.emplace(n.superior_socket_address(), n.socket_address());
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::remove_orphan(index_type i) {
+    const auto& n = this->_nodes[i];
+    auto range = this->_orphans.equal_range(n.superior_socket_address());
+    for (auto first=range.first; first != range.second; ++first) {
+        if (first->second == n.socket_address()) { this->_orphans.erase(first); return; }
+    }
+}
+
+template <class T> void
+sbnd::Hierarchy<T>::update_statistics(index_type i, const statistics_type& old_value,
+                                      const statistics_type& new_value) noexcept {
+    for (auto j=i; j != npos; j=this->_links[j].parent) {
+        auto& s = this->_links[j].subtree;
+        s -= old_value;
+        s += new_value;
+    }
+}
+
 template <class T> void
 sbnd::Hierarchy<T>::write(sbn::kernel_buffer& out) const {
     out << this->_netmask;
-    out << this->_this_node;
-    out << this->_nodes;
+    out << this_node();
+    out << uint32_t(num_neighbours());
+    for (const auto& b : neighbours()) { out << b; }
 }
 
 template <class T> void
 sbnd::Hierarchy<T>::read(sbn::kernel_buffer& in) {
+    hierarchy_node n;
     in >> this->_netmask;
-    in >> this->_this_node;
-    in >> this->_nodes;
+    in >> n;
+    this->_nodes.assign(1, n);
+    this->_links.assign(1, link{});
+    this->_links.front().subtree = statistics_type(n);
+    this->_indices.clear();
+    this->_orphans.clear();
+    if (n.socket_address()) { this->_indices.emplace(n.socket_address(), 0); }
+    uint32_t num_neighbours = 0;
+    in >> num_neighbours;
+    for (uint32_t i=0; i<num_neighbours; ++i) {
+        in >> n;
+        if (find(n.socket_address()) == npos) { insert(n); }
+    }
+    link(0);
 }
 
 template class sbnd::Hierarchy<sys::ipv4_address>;
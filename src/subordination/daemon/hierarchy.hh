@@ -2,6 +2,7 @@
 #define SUBORDINATION_DAEMON_HIERARCHY_HH
 
 #include <iosfwd>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 
@@ -14,6 +15,65 @@
 
 namespace sbnd {
 
+    /// \brief The sums of the resources of the nodes in a part of the hierarchy.
+    class hierarchy_statistics {
+
+    public:
+        using counter_type = uint64_t;
+
+    private:
+        counter_type _num_nodes = 0;
+        counter_type _total_threads = 0;
+        counter_type _run_queue_length = 0;
+        counter_type _free_memory = 0;
+
+    public:
+
+        inline explicit hierarchy_statistics(const hierarchy_node& n) noexcept:
+        _num_nodes(1), _total_threads(n.total_threads()) {
+            using r = sbn::resources::resources;
+            const auto& res = n.resources();
+            this->_run_queue_length = res[r::run_queue_length].unsigned_integer();
+            this->_free_memory = res[r::free_memory].unsigned_integer();
+        }
+
+        inline counter_type num_nodes() const noexcept { return this->_num_nodes; }
+        inline counter_type total_threads() const noexcept { return this->_total_threads; }
+        inline counter_type run_queue_length() const noexcept { return this->_run_queue_length; }
+        inline counter_type free_memory() const noexcept { return this->_free_memory; }
+
+        inline hierarchy_statistics& operator+=(const hierarchy_statistics& rhs) noexcept {
+            this->_num_nodes += rhs._num_nodes;
+            this->_total_threads += rhs._total_threads;
+            this->_run_queue_length += rhs._run_queue_length;
+            this->_free_memory += rhs._free_memory;
+            return *this;
+        }
+
+        inline hierarchy_statistics& operator-=(const hierarchy_statistics& rhs) noexcept {
+            this->_num_nodes -= rhs._num_nodes;
+            this->_total_threads -= rhs._total_threads;
+            this->_run_queue_length -= rhs._run_queue_length;
+            this->_free_memory -= rhs._free_memory;
+            return *this;
+        }
+
+        hierarchy_statistics() = default;
+        ~hierarchy_statistics() = default;
+        hierarchy_statistics(const hierarchy_statistics&) = default;
+        hierarchy_statistics& operator=(const hierarchy_statistics&) = default;
+        hierarchy_statistics(hierarchy_statistics&&) = default;
+        hierarchy_statistics& operator=(hierarchy_statistics&&) = default;
+
+    };
+
+    /**
+    \brief Cluster nodes known to the current node.
+    \details The nodes are stored in a flat array, the first element of which is
+    the current node. Each node has the index of its superior, the indices of
+    its subordinates and the precomputed statistics of its subtree.
+    Dangling superior addresses and cycles are not linked.
+    */
     template <class T>
     class Hierarchy {
 
@@ -21,27 +81,68 @@ namespace sbnd {
         using addr_type = T;
         using interface_address_type = sys::interface_address<addr_type>;
         using interface_socket_address_type = sys::interface_socket_address<addr_type>;
-        using container_type = std::unordered_map<sys::socket_address,hierarchy_node>;
+        using container_type = std::vector<hierarchy_node>;
         using const_iterator = typename container_type::const_iterator;
-        using iterator = typename container_type::iterator;
         using size_type = typename container_type::size_type;
+        using index_type = uint32_t;
         using resource_array = sbn::resource_array;
         using hierarchy_node_array = std::vector<hierarchy_node>;
+        using socket_address_array = hierarchy_node::socket_address_array;
         using time_point = hierarchy_node::clock::time_point;
+        using statistics_type = hierarchy_statistics;
+        using index_array = std::vector<index_type>;
+
+        /// Neighbours of the current node.
+        class node_range {
+        private:
+            const_iterator _first, _last;
+        public:
+            inline node_range(const_iterator first, const_iterator last) noexcept:
+            _first(first), _last(last) {}
+            inline const_iterator begin() const noexcept { return this->_first; }
+            inline const_iterator end() const noexcept { return this->_last; }
+            inline size_type size() const noexcept { return this->_last - this->_first; }
+            inline bool empty() const noexcept { return this->_first == this->_last; }
+        };
+
+        static constexpr const index_type npos = std::numeric_limits<index_type>::max();
+
+    private:
+        struct link {
+            index_type parent = npos;
+            index_type first_child = npos;
+            index_type next_sibling = npos;
+            index_type prev_sibling = npos;
+            statistics_type subtree;
+        };
+        using link_array = std::vector<link>;
+        using index_table = std::unordered_map<sys::socket_address,index_type>;
+        using orphan_table = std::unordered_multimap<sys::socket_address,sys::socket_address>;
 
     protected:
         addr_type _netmask;
-        hierarchy_node _this_node;
-        container_type _nodes;
+        /// The current node followed by its neighbours.
+        container_type _nodes = container_type(1);
+        link_array _links = link_array(1);
+        index_table _indices;
+        /// The addresses of unlinked nodes by the address of their superior.
+        orphan_table _orphans;
 
     public:
 
         inline explicit
-        Hierarchy(const interface_address_type& ia, sys::port_type port) noexcept:
+        Hierarchy(const interface_address_type& ia, sys::port_type port):
         _netmask(ia.netmask()) {
-            this->_this_node.socket_address(sys::ipv4_socket_address{ia.address(), port});
+            this->_nodes.front().socket_address(sys::ipv4_socket_address{ia.address(), port});
+            this->_links.front().subtree = statistics_type(this->_nodes.front());
+            this->_indices.emplace(this->_nodes.front().socket_address(), 0);
+        }
+
+        inline node_range neighbours() const noexcept {
+            return node_range(this->_nodes.begin()+1, this->_nodes.end());
         }
 
+        /// The current node followed by its neighbours.
         inline const container_type& nodes() const noexcept { return this->_nodes; }
 
         hierarchy_node_array nodes(int radius) const;
@@ -49,21 +150,31 @@ namespace sbnd {
         hierarchy_node_array upper_nodes(const hierarchy_node& from, int depth) const;
 
         inline hierarchy_node_array lower_nodes(int depth) const {
-            return lower_nodes(this->_this_node, depth);
+            return lower_nodes(this_node(), depth);
         }
 
         inline hierarchy_node_array upper_nodes(int depth) const {
-            return upper_nodes(this->_this_node, depth);
+            return upper_nodes(this_node(), depth);
         }
 
+        /// The nodes that are reachable via the neighbour.
         inline hierarchy_node_array nodes_behind(const sys::socket_address& from) const {
-            auto result = this->_nodes.find(from);
-            if (result == this->_nodes.end()) { return {}; }
-            if (from == superior_socket_address()) {
-                return upper_nodes(result->second, std::numeric_limits<int>::max());
-            } else {
-                return lower_nodes(result->second, std::numeric_limits<int>::max());
-            }
+            return to_nodes(indices_behind(from));
+        }
+
+        /// The indices (in \link nodes\endlink) of the nodes that are reachable via the neighbour.
+        index_array indices_behind(const sys::socket_address& from) const;
+
+        /**
+        The statistics of the nodes that are reachable via the neighbour.
+        This is constant time operation for subordinates and logarithmic
+        time operation for the superior.
+        */
+        statistics_type statistics_behind(const sys::socket_address& from) const noexcept;
+
+        /// The statistics of the subtree of the current node including the node itself.
+        inline const statistics_type& statistics() const noexcept {
+            return this->_links.front().subtree;
         }
 
         inline hierarchy_node_array subordinates() const { return lower_nodes(1); }
@@ -72,21 +183,21 @@ namespace sbnd {
         inline interface_address_type
         interface_address() const noexcept {
             const auto& sa = sys::socket_address_cast<sys::ipv4_socket_address>(
-                this->_this_node.socket_address());
+                this_node().socket_address());
             return interface_address_type{sa.address(), this->_netmask};
         }
 
         /// Socket address of the current node.
         inline const sys::socket_address&
         socket_address() const noexcept {
-            return this->_this_node.socket_address();
+            return this_node().socket_address();
         }
 
         /// Interface address of the current node.
         inline interface_socket_address_type
         interface_socket_address() const noexcept {
             const auto& sa = sys::socket_address_cast<sys::ipv4_socket_address>(
-                this->_this_node.socket_address());
+                this_node().socket_address());
             return interface_socket_address_type{sa.address(), this->_netmask, sa.port()};
         }
 
@@ -94,27 +205,27 @@ namespace sbnd {
 
         inline sys::port_type port() const noexcept {
             const auto& sa = sys::socket_address_cast<sys::ipv4_socket_address>(
-                this->_this_node.socket_address());
+                this_node().socket_address());
             return sa.port();
         }
 
-        inline const hierarchy_node& this_node() const noexcept { return this->_this_node; }
+        inline const hierarchy_node& this_node() const noexcept { return this->_nodes.front(); }
 
         /// Resources of the current node.
         inline const resource_array& resources() const noexcept {
-            return this->_this_node.resources();
+            return this_node().resources();
         }
 
         bool resources(const resource_array& rhs, time_point now);
 
         inline const sys::socket_address& superior_socket_address() const noexcept {
-            return this->_this_node.superior_socket_address();
+            return this_node().superior_socket_address();
         }
 
         inline const hierarchy_node* superior() const noexcept {
-            auto result = this->_nodes.find(this->_this_node.superior_socket_address());
-            if (result == this->_nodes.end()) { return nullptr; }
-            return &result->second;
+            const auto i = this->_links.front().parent;
+            if (i == npos) { return nullptr; }
+            return &this->_nodes[i];
         }
 
         bool add_nodes(const hierarchy_node_array& nodes, time_point now);
@@ -122,12 +233,26 @@ namespace sbnd {
         bool add_subordinate(const hierarchy_node& node, time_point now);
         bool remove_node(const sys::socket_address& sa, time_point now);
 
+        /**
+        Restore the hierarchy from the nodes saved before the restart.
+        The first node is the previous copy of the current node.
+        \return false if the first node has different address
+        */
+        bool restore(const hierarchy_node_array& nodes, time_point now);
+
+        /**
+        Remove the nodes that a neighbour does not see anymore.
+        The superior and the subordinates of the current node are
+        retained, since they are managed by the discoverer directly.
+        */
+        bool remove_nodes(const socket_address_array& nodes);
+
         inline bool
         has_superior() const noexcept {
-            return static_cast<bool>(this->_this_node.superior_socket_address());
+            return static_cast<bool>(this_node().superior_socket_address());
         }
 
-        inline size_type num_neighbours() const noexcept { return this->_nodes.size(); }
+        inline size_type num_neighbours() const noexcept { return this->_nodes.size()-1; }
 
         template <class X>
         friend std::ostream&
@@ -136,7 +261,10 @@ namespace sbnd {
         void write(sbn::kernel_buffer& out) const;
         void read(sbn::kernel_buffer& in);
 
-        Hierarchy() = default;
+        inline Hierarchy() {
+            this->_links.front().subtree = statistics_type(this->_nodes.front());
+        }
+
         ~Hierarchy() = default;
         Hierarchy(const Hierarchy&) = default;
         Hierarchy& operator=(const Hierarchy&) = default;
@@ -145,30 +273,33 @@ namespace sbnd {
 
     private:
 
-        inline bool remove_node(const sys::socket_address& sa) {
-            return this->_nodes.erase(sa) != 0;
-        }
-
-        template <class Predicate>
-        inline void traverse(hierarchy_node_array& result, int j0, int radius,
-                             Predicate pred) const {
-            for (int i=0, j0=0, added=1; i<radius && added; ++i) {
-                added = 0;
-                const int j1 = result.size();
-                for (int j=j0; j<j1; ++j) {
-                    const auto& a = result[j];
-                    for (const auto& pair : this->_nodes) {
-                        const auto& b = pair.second;
-                        if (pred(b, a)) {
-                            result.emplace_back(b);
-                            added = 1;
-                        }
-                    }
-                }
-                j0 = j1;
-            }
+        inline index_type find(const sys::socket_address& sa) const noexcept {
+            auto result = this->_indices.find(sa);
+            if (result == this->_indices.end()) { return npos; }
+            return result->second;
         }
 
+        inline hierarchy_node_array to_nodes(const index_array& indices) const {
+            hierarchy_node_array result;
+            result.reserve(indices.size());
+            for (auto i : indices) { result.emplace_back(this->_nodes[i]); }
+            return result;
+        }
+
+        index_type insert(const hierarchy_node& node);
+        void replace(index_type i, const hierarchy_node& node);
+        void erase(index_type i);
+        void superior(index_type i, const sys::socket_address& sa);
+        void link(index_type i);
+        void unlink(index_type i);
+        void adopt_orphans(index_type i);
+        void add_orphan(index_type i);
+        void remove_orphan(index_type i);
+        void update_statistics(index_type i, const statistics_type& old_value,
+                               const statistics_type& new_value) noexcept;
+        void lower(index_type from, int depth, index_array& result) const;
+        void upper(index_type from, int depth, index_array& result) const;
+
     };
 
     template <class X>
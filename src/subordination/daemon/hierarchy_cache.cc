@@ -0,0 +1,226 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <unistdx/io/fildes>
+#include <unistdx/net/ipv4_socket_address>
+#include <unistdx/system/error>
+
+#include <subordination/daemon/hierarchy_cache.hh>
+
+namespace {
+
+    using header = sbnd::hierarchy_cache::header;
+    using record = sbnd::hierarchy_cache::record;
+
+    constexpr const char magic[4] = {'S','B','N','H'};
+
+    uint32_t checksum(const record& r) noexcept {
+        // FNV-1a over all fields except the checksum
+        record tmp = r;
+        tmp.checksum = 0;
+        const auto* first = reinterpret_cast<const unsigned char*>(&tmp);
+        const auto* last = first + sizeof(record);
+        uint32_t h = 2166136261u;
+        while (first != last) { h = (h ^ *first++) * 16777619u; }
+        return h;
+    }
+
+    bool make_record(const sbnd::hierarchy_node& node, record& r) noexcept {
+        using r_t = sbn::resources::resources;
+        using sys::ipv4_socket_address;
+        const auto& sa = node.socket_address();
+        if (sa.family() != sys::family_type::inet) { return false; }
+        std::memset(&r, 0, sizeof(record));
+        const auto& a = sys::socket_address_cast<ipv4_socket_address>(sa);
+        r.address = a.address().rep();
+        r.port = a.port();
+        const auto& ssa = node.superior_socket_address();
+        if (ssa && ssa.family() == sys::family_type::inet) {
+            const auto& s = sys::socket_address_cast<ipv4_socket_address>(ssa);
+            r.superior_address = s.address().rep();
+            r.superior_port = s.port();
+        }
+        r.version = node.version();
+        const auto& res = node.resources();
+        r.total_threads = res[r_t::total_threads].unsigned_integer();
+        r.total_memory = res[r_t::total_memory].unsigned_integer();
+        r.free_memory = res[r_t::free_memory].unsigned_integer();
+        r.run_queue_length = res[r_t::run_queue_length].unsigned_integer();
+        r.completion_rate = res[r_t::completion_rate].unsigned_integer();
+        r.checksum = checksum(r);
+        return true;
+    }
+
+    sbnd::hierarchy_node make_node(const record& r) {
+        using r_t = sbn::resources::resources;
+        using sys::ipv4_address;
+        using sys::ipv4_socket_address;
+        sbnd::hierarchy_node node;
+        node.socket_address(ipv4_socket_address{ipv4_address{r.address}, r.port});
+        if (r.superior_port != 0) {
+            node.superior_socket_address(
+                ipv4_socket_address{ipv4_address{r.superior_address}, r.superior_port});
+        }
+        node.version(r.version);
+        sbn::resource_array res;
+        res[r_t::total_threads] = r.total_threads;
+        res[r_t::total_memory] = r.total_memory;
+        res[r_t::free_memory] = r.free_memory;
+        res[r_t::run_queue_length] = r.run_queue_length;
+        res[r_t::completion_rate] = r.completion_rate;
+        node.resources(res);
+        return node;
+    }
+
+    inline bool operator==(const record& a, const record& b) noexcept {
+        return std::memcmp(&a, &b, sizeof(record)) == 0;
+    }
+
+    inline void write_fully(sys::fd_type fd, const void* data, size_t n, off_t offset) {
+        const auto* first = static_cast<const char*>(data);
+        while (n != 0) {
+            auto m = ::pwrite(fd, first, n, offset);
+            UNISTDX_CHECK(m);
+            first += m, n -= m, offset += m;
+        }
+    }
+
+    class mapping {
+    private:
+        void* _data = MAP_FAILED;
+        size_t _size = 0;
+    public:
+        inline mapping(sys::fd_type fd, size_t size): _size(size) {
+            this->_data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (this->_data == MAP_FAILED) { throw sys::bad_call(); }
+        }
+        inline ~mapping() noexcept { ::munmap(this->_data, this->_size); }
+        inline const char* data() const noexcept { return static_cast<const char*>(this->_data); }
+        inline size_t size() const noexcept { return this->_size; }
+        mapping(const mapping&) = delete;
+        mapping& operator=(const mapping&) = delete;
+    };
+
+}
+
+constexpr const uint32_t sbnd::hierarchy_cache::format_version;
+
+bool sbnd::hierarchy_cache::write(const hierarchy_type& hierarchy) {
+    record_array records;
+    records.reserve(hierarchy.num_neighbours()+1);
+    record r;
+    if (!make_record(hierarchy.this_node(), r)) { return false; }
+    records.emplace_back(r);
+    for (const auto& node : hierarchy.neighbours()) {
+        if (make_record(node, r)) { records.emplace_back(r); }
+    }
+    ++this->_generation;
+    if (!this->_records.empty() && this->_records.size() == records.size()) {
+        std::vector<uint32_t> changed;
+        const auto n = static_cast<uint32_t>(records.size());
+        for (uint32_t i=0; i<n; ++i) {
+            if (!(records[i] == this->_records[i])) { changed.emplace_back(i); }
+        }
+        if (changed.empty()) { return true; }
+        if (changed.size() <= n*this->_max_in_place_fraction) {
+            try {
+                write_in_place(records, changed);
+                this->_records = std::move(records);
+                return true;
+            } catch (const sys::bad_call& err) {
+                // fall back to rewriting the whole file
+            }
+        }
+    }
+    this->_records = std::move(records);
+    write_all(hierarchy.netmask().rep());
+    return false;
+}
+
+void sbnd::hierarchy_cache::write_all(uint32_t netmask) {
+    using f = sys::open_flag;
+    header h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = format_version;
+    h.record_size = sizeof(record);
+    h.num_records = static_cast<uint32_t>(this->_records.size());
+    h.netmask = netmask;
+    h.generation = this->_generation;
+    std::string tmp_name(this->_path.data());
+    tmp_name += ".new";
+    try {
+        sys::fildes out(tmp_name.data(),
+                        f::truncate | f::close_on_exec | f::create | f::write_only, 0600);
+        write_fully(out.fd(), &h, sizeof(h), 0);
+        write_fully(out.fd(), this->_records.data(), this->_records.size()*sizeof(record),
+                    sizeof(h));
+        // the data must reach the disk before the rename, otherwise
+        // the crash may leave the cache file empty
+        UNISTDX_CHECK(::fsync(out.fd()));
+        out.close();
+        UNISTDX_CHECK(std::rename(tmp_name.data(), this->_path.data()));
+    } catch (...) {
+        // the next write rewrites the whole file
+        this->_records.clear();
+        std::remove(tmp_name.data());
+        throw;
+    }
+}
+
+void sbnd::hierarchy_cache::write_in_place(const record_array& records,
+                                           const std::vector<uint32_t>& changed) {
+    using f = sys::open_flag;
+    sys::fildes out(this->_path.data(), f::close_on_exec | f::write_only);
+    for (auto i : changed) {
+        write_fully(out.fd(), &records[i], sizeof(record), sizeof(header) + i*sizeof(record));
+    }
+    write_fully(out.fd(), &this->_generation, sizeof(generation_type),
+                offsetof(header, generation));
+    out.close();
+}
+
+bool sbnd::hierarchy_cache::read(const hierarchy_type& hierarchy, hierarchy_node_array& nodes) {
+    using f = sys::open_flag;
+    sys::fildes in;
+    try {
+        in.open(this->_path, f::close_on_exec | f::read_only);
+    } catch (const sys::bad_call& err) {
+        if (err.errc() == std::errc::no_such_file_or_directory) { return false; }
+        throw;
+    }
+    struct ::stat st{};
+    UNISTDX_CHECK(::fstat(in.fd(), &st));
+    const size_t size = st.st_size;
+    if (size < sizeof(header)) { return false; }
+    mapping m(in.fd(), size);
+    in.close();
+    header h;
+    std::memcpy(&h, m.data(), sizeof(header));
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 ||
+        h.version != format_version || h.record_size != sizeof(record) ||
+        h.netmask != hierarchy.netmask().rep() ||
+        size < sizeof(header) + size_t(h.num_records)*sizeof(record)) {
+        return false;
+    }
+    record_array records(h.num_records);
+    std::memcpy(records.data(), m.data() + sizeof(header), h.num_records*sizeof(record));
+    if (records.empty() || records.front().checksum != checksum(records.front())) {
+        return false;
+    }
+    nodes.clear();
+    nodes.reserve(records.size());
+    for (const auto& r : records) {
+        if (r.checksum != checksum(r)) { continue; }
+        nodes.emplace_back(make_node(r));
+    }
+    this->_generation = h.generation;
+    // the file and the records diverge when some of them were torn
+    if (nodes.size() == records.size()) { this->_records = std::move(records); }
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef SUBORDINATION_DAEMON_HIERARCHY_CACHE_HH
+#define SUBORDINATION_DAEMON_HIERARCHY_CACHE_HH
+
+#include <cstdint>
+#include <vector>
+
+#include <unistdx/fs/path>
+#include <unistdx/net/ipv4_address>
+
+#include <subordination/daemon/hierarchy.hh>
+#include <subordination/daemon/hierarchy_node.hh>
+
+namespace sbnd {
+
+    /**
+    \brief On-disk copy of the hierarchy that survives daemon restarts.
+    \details The file consists of fixed-size header followed by fixed-size
+    records, one per node, the first record being the current node.
+    Records have the same size, so the file is read via single \c mmap call
+    and small changes are written in place. Large changes are written to
+    a temporary file which is then renamed, so that the readers never
+    see partially written file. Each record has its own checksum,
+    and torn records are skipped.
+    Only IPv4 addresses and numeric resources are stored, the rest
+    is received from the neighbours after the restart.
+    */
+    class hierarchy_cache {
+
+    public:
+        using addr_type = sys::ipv4_address;
+        using hierarchy_type = Hierarchy<addr_type>;
+        using hierarchy_node_array = std::vector<hierarchy_node>;
+        using generation_type = uint64_t;
+
+        /// Increment this number when the layout of the file changes.
+        static constexpr const uint32_t format_version = 1;
+
+        struct header {
+            char magic[4];
+            uint32_t version;
+            uint32_t record_size;
+            uint32_t num_records;
+            uint32_t netmask;
+            uint32_t reserved;
+            generation_type generation;
+        };
+
+        struct record {
+            uint32_t address;
+            uint16_t port;
+            uint16_t superior_port;
+            uint32_t superior_address;
+            uint32_t checksum;
+            uint64_t version;
+            uint64_t total_threads;
+            uint64_t total_memory;
+            uint64_t free_memory;
+            uint64_t run_queue_length;
+            uint64_t completion_rate;
+        };
+
+    private:
+        using record_array = std::vector<record>;
+
+    private:
+        sys::path _path;
+        /// The records that are currently in the file.
+        record_array _records;
+        generation_type _generation = 0;
+        /// The maximum fraction of changed records that are written in place.
+        float _max_in_place_fraction = 0.25f;
+
+    public:
+
+        inline explicit hierarchy_cache(sys::path path): _path(std::move(path)) {}
+
+        /**
+        Write the hierarchy to the file. Writes only changed records
+        if the number of nodes did not change and the number of changed records
+        is small, otherwise rewrites the whole file.
+        \return true if the file was updated in place
+        */
+        bool write(const hierarchy_type& hierarchy);
+
+        /**
+        Read the nodes from the file. The first node is the current node.
+        \return false if the file does not exist, was written by other version
+        of the daemon or for other network
+        */
+        bool read(const hierarchy_type& hierarchy, hierarchy_node_array& nodes);
+
+        inline const sys::path& path() const noexcept { return this->_path; }
+        inline generation_type generation() const noexcept { return this->_generation; }
+
+        inline void max_in_place_fraction(float rhs) noexcept {
+            this->_max_in_place_fraction = rhs;
+        }
+
+        hierarchy_cache() = default;
+        ~hierarchy_cache() = default;
+        hierarchy_cache(const hierarchy_cache&) = delete;
+        hierarchy_cache& operator=(const hierarchy_cache&) = delete;
+        hierarchy_cache(hierarchy_cache&&) = default;
+        hierarchy_cache& operator=(hierarchy_cache&&) = default;
+
+    private:
+        void write_all(uint32_t netmask);
+        void write_in_place(const record_array& records, const std::vector<uint32_t>& changed);
+
+    };
+
+    static_assert(sizeof(hierarchy_cache::header) == 32, "bad header size");
+    static_assert(sizeof(hierarchy_cache::record) == 64, "bad record size");
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,202 @@
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <subordination/core/kernel_buffer.hh>
+#include <subordination/daemon/hierarchy.hh>
+#include <subordination/daemon/hierarchy_kernel.hh>
+
+/*
+Simulates node discovery in a tree-shaped cluster in a single process and
+counts bytes of hierarchy kernels that nodes exchange until the hierarchy
+converges. Full snapshots are compared to delta messages.
+*/
+
+namespace {
+
+    using addr_type = sys::ipv4_address;
+    using hierarchy_type = sbnd::Hierarchy<addr_type>;
+    using hierarchy_node_array = hierarchy_type::hierarchy_node_array;
+    using clock_type = sbnd::hierarchy_node::clock;
+
+    enum class modes { full, delta };
+
+    const char* to_string(modes rhs) noexcept {
+        return rhs == modes::full ? "full" : "delta";
+    }
+
+    struct node {
+        hierarchy_type hierarchy;
+        sbnd::hierarchy_journal journal;
+        std::unordered_map<sys::socket_address,sbnd::hierarchy_link> links;
+        inline explicit node(const sys::interface_address<addr_type>& ia):
+        hierarchy(ia, 33333) {}
+    };
+
+    struct message {
+        size_t source;
+        size_t destination;
+        std::unique_ptr<sbnd::Hierarchy_kernel> kernel;
+        bool snapshot_request;
+    };
+
+    struct statistics {
+        size_t messages = 0;
+        size_t bytes = 0;
+        size_t snapshots = 0;
+    };
+
+    class cluster {
+
+    private:
+        std::vector<node> _nodes;
+        std::unordered_map<sys::socket_address,size_t> _indices;
+        std::deque<message> _messages;
+        statistics _stats;
+        modes _mode;
+        int _max_radius = 100;
+
+    public:
+
+        inline explicit cluster(modes mode): _mode(mode) {}
+
+        void add_node(size_t fanout) {
+            const auto i = this->_nodes.size();
+            const auto n = i + 1;
+            addr_type address{10, 0, sys::u8(n >> 8), sys::u8(n & 0xff)};
+            this->_nodes.emplace_back(sys::interface_address<addr_type>{address, 16});
+            this->_indices.emplace(this->_nodes.back().hierarchy.socket_address(), i);
+            resources(i, 1 + i%8);
+            if (i == 0) { return; }
+            // join the superior in the same way as a probe does
+            const auto j = (i-1) / fanout;
+            auto& sub = this->_nodes[i].hierarchy;
+            auto& sup = this->_nodes[j].hierarchy;
+            const auto now = clock_type::now();
+            sup.add_nodes({sub.this_node()}, now);
+            sup.add_subordinate(sub.this_node(), now);
+            sub.add_nodes(sup.nodes(this->_max_radius), now);
+            sub.add_superior(sup.this_node(), now);
+            broadcast(j, sub.socket_address());
+            broadcast(i, sup.socket_address());
+            run();
+        }
+
+        void resources(size_t i, sys::u64 nthreads) {
+            sbn::resource_array r;
+            r[sbn::resources::resources::total_threads] = nthreads;
+            if (this->_nodes[i].hierarchy.resources(r, clock_type::now())) {
+                broadcast(i, {});
+                run();
+            }
+        }
+
+        inline size_t size() const noexcept { return this->_nodes.size(); }
+        inline const statistics& stats() const noexcept { return this->_stats; }
+
+    private:
+
+        static inline std::unique_ptr<sbnd::Hierarchy_kernel> make_kernel() {
+            return std::unique_ptr<sbnd::Hierarchy_kernel>(new sbnd::Hierarchy_kernel);
+        }
+
+        void broadcast(size_t i, const sys::socket_address& ignored) {
+            auto& n = this->_nodes[i];
+            auto nodes = n.hierarchy.nodes(this->_max_radius);
+            for (const auto& b : n.hierarchy.neighbours()) {
+                if (b.socket_address() == ignored) { continue; }
+                send(i, b.socket_address(), nodes);
+            }
+        }
+
+        void send(size_t i, const sys::socket_address& dest, const hierarchy_node_array& nodes) {
+            auto& n = this->_nodes[i];
+            message m{i, this->_indices[dest], make_kernel(), false};
+            if (this->_mode == modes::full) {
+                m.kernel->nodes(nodes);
+            } else if (!n.links[dest].diff(n.journal, nodes, *m.kernel)) {
+                return;
+            }
+            push(std::move(m));
+        }
+
+        void push(message&& m) {
+            sbn::kernel_buffer buf;
+            m.kernel->write(buf);
+            ++this->_stats.messages;
+            this->_stats.bytes += buf.position();
+            if (!m.kernel->delta() && !m.snapshot_request) { ++this->_stats.snapshots; }
+            this->_messages.emplace_back(std::move(m));
+        }
+
+        void run() {
+            while (!this->_messages.empty()) {
+                auto m = std::move(this->_messages.front());
+                this->_messages.pop_front();
+                receive(m);
+            }
+        }
+
+        void receive(message& m) {
+            auto& n = this->_nodes[m.destination];
+            const auto& src = this->_nodes[m.source].hierarchy.socket_address();
+            if (m.snapshot_request) {
+                n.links[src].reset_sent();
+                send(m.destination, src, n.hierarchy.nodes(this->_max_radius));
+                return;
+            }
+            if (this->_mode == modes::delta && !n.links[src].accept(*m.kernel)) {
+                push(message{m.destination, m.source, make_kernel(), true});
+                return;
+            }
+            const auto now = clock_type::now();
+            bool changed = n.hierarchy.add_nodes(m.kernel->nodes(), now);
+            if (m.kernel->delta()) {
+                changed |= n.hierarchy.remove_nodes(m.kernel->removed_nodes());
+            }
+            if (changed) { broadcast(m.destination, src); }
+        }
+
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t fanout = 4;
+    size_t churn = 4;
+    std::vector<size_t> sizes{16, 64, 256};
+    if (argc >= 2) { fanout = std::stoul(argv[1]); }
+    if (argc >= 3) { churn = std::stoul(argv[2]); }
+    if (argc >= 4) {
+        sizes.clear();
+        for (int i=3; i<argc; ++i) { sizes.emplace_back(std::stoul(argv[i])); }
+    }
+    std::cout << std::setw(10) << "nodes"
+        << std::setw(10) << "mode"
+        << std::setw(12) << "messages"
+        << std::setw(12) << "snapshots"
+        << std::setw(16) << "bytes" << '\n';
+    for (auto size : sizes) {
+        for (auto mode : {modes::full, modes::delta}) {
+            std::mt19937 prng(size);
+            cluster c(mode);
+            for (size_t i=0; i<size; ++i) { c.add_node(fanout); }
+            // change the resources of random nodes
+            std::uniform_int_distribution<size_t> node(0, size-1);
+            std::uniform_int_distribution<sys::u64> nthreads(1, 64);
+            for (size_t i=0; i<churn*size; ++i) { c.resources(node(prng), nthreads(prng)); }
+            const auto& s = c.stats();
+            std::cout << std::setw(10) << c.size()
+                << std::setw(10) << to_string(mode)
+                << std::setw(12) << s.messages
+                << std::setw(12) << s.snapshots
+                << std::setw(16) << s.bytes << '\n';
+        }
+    }
+    return 0;
+}
@@ -1,3 +1,5 @@
+#include <unordered_set>
+
 #include <subordination/core/kernel_buffer.hh>
 #include <subordination/daemon/hierarchy_kernel.hh>
 
@@ -5,10 +7,93 @@ void sbnd::Hierarchy_kernel::write(sbn::kernel_buffer& out) const {
     sbn::kernel::write(out);
     out << this->_interface_address;
     out << this->_nodes;
+    out << this->_removed_nodes;
+    out << this->_sequence << this->_base_sequence;
 }
 
 void sbnd::Hierarchy_kernel::read(sbn::kernel_buffer& in) {
     sbn::kernel::read(in);
     in >> this->_interface_address;
     in >> this->_nodes;
+    in >> this->_removed_nodes;
+    in >> this->_sequence >> this->_base_sequence;
+}
+
+void sbnd::hierarchy_journal::update(const hierarchy_node_array& nodes) {
+    bool changed = false;
+    const auto next = this->_sequence+1;
+    for (const auto& n : nodes) {
+        const auto& a = n.socket_address();
+        auto result = this->_nodes.find(a);
+        if (result == this->_nodes.end()) {
+            this->_nodes.emplace(a, entry{n, next});
+            this->_removed.erase(a);
+            changed = true;
+        } else if (result->second.node != n ||
+                   result->second.node.version() != n.version()) {
+            result->second = entry{n, next};
+            changed = true;
+        }
+    }
+    if (this->_nodes.size() != nodes.size()) {
+        std::unordered_set<sys::socket_address> current;
+        current.reserve(nodes.size());
+        for (const auto& n : nodes) { current.emplace(n.socket_address()); }
+        for (auto first = this->_nodes.begin(); first != this->_nodes.end(); ) {
+            if (current.find(first->first) == current.end()) {
+                this->_removed[first->first] = next;
+                first = this->_nodes.erase(first);
+                changed = true;
+            } else {
+                ++first;
+            }
+        }
+    }
+    if (changed) { this->_sequence = next; }
+}
+
+void sbnd::hierarchy_journal::changes(sequence_type since, hierarchy_node_array& changed,
+                                      socket_address_array& removed) const {
+    for (const auto& pair : this->_nodes) {
+        if (pair.second.sequence > since) { changed.emplace_back(pair.second.node); }
+    }
+    for (const auto& pair : this->_removed) {
+        if (pair.second > since) { removed.emplace_back(pair.first); }
+    }
+}
+
+void sbnd::hierarchy_journal::forget_removed(sequence_type sequence) {
+    if (sequence <= this->_horizon) { return; }
+    for (auto first = this->_removed.begin(); first != this->_removed.end(); ) {
+        if (first->second <= sequence) { first = this->_removed.erase(first); }
+        else { ++first; }
+    }
+    this->_horizon = sequence;
+}
+
+bool sbnd::hierarchy_link::diff(hierarchy_journal& journal, const hierarchy_node_array& nodes,
+                                Hierarchy_kernel& k) {
+    journal.update(nodes);
+    const auto sequence = journal.sequence();
+    if (this->_sent_sequence == 0 || this->_sent_sequence < journal.horizon()) {
+        k.nodes(nodes);
+        k.base_sequence(0);
+    } else {
+        if (this->_sent_sequence == sequence) { return false; }
+        hierarchy_node_array changed;
+        Hierarchy_kernel::socket_address_array removed;
+        journal.changes(this->_sent_sequence, changed, removed);
+        k.nodes(std::move(changed));
+        k.removed_nodes(std::move(removed));
+        k.base_sequence(this->_sent_sequence);
+    }
+    k.sequence(sequence);
+    this->_sent_sequence = sequence;
+    return true;
+}
+
+bool sbnd::hierarchy_link::accept(const Hierarchy_kernel& k) noexcept {
+    if (k.delta() && k.base_sequence() != this->_received_sequence) { return false; }
+    this->_received_sequence = k.sequence();
+    return true;
 }
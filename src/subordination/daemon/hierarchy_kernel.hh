@@ -1,6 +1,8 @@
 #ifndef SUBORDINATION_DAEMON_HIERARCHY_KERNEL_HH
 #define SUBORDINATION_DAEMON_HIERARCHY_KERNEL_HH
 
+#include <unordered_map>
+
 #include <unistdx/net/interface_address>
 #include <unistdx/net/ipv4_address>
 
@@ -9,16 +11,28 @@
 
 namespace sbnd {
 
+    /**
+    \brief Hierarchy nodes that are sent to a neighbour.
+    \details
+    The kernel either carries full snapshot of the nodes (base sequence
+    is zero) or only the nodes that were added or changed since the message
+    with the base sequence number plus the addresses of the removed nodes.
+    */
     class Hierarchy_kernel: public sbn::service_kernel {
 
     public:
         using addr_type = sys::ipv4_address;
         using ifaddr_type = sys::interface_address<addr_type>;
         using hierarchy_node_array = std::vector<hierarchy_node>;
+        using socket_address_array = hierarchy_node::socket_address_array;
+        using sequence_type = uint64_t;
 
     private:
         ifaddr_type _interface_address;
         hierarchy_node_array _nodes;
+        socket_address_array _removed_nodes;
+        sequence_type _sequence = 0;
+        sequence_type _base_sequence = 0;
 
     public:
 
@@ -34,12 +48,130 @@ namespace sbnd {
         inline const ifaddr_type& interface_address() const noexcept { return this->_interface_address; }
         inline const hierarchy_node_array& nodes() const noexcept { return this->_nodes; }
         inline void nodes(const hierarchy_node_array& rhs) { this->_nodes = rhs; }
+        inline void nodes(hierarchy_node_array&& rhs) { this->_nodes = std::move(rhs); }
+
+        /// Addresses of the nodes that were removed since the base message.
+        inline const socket_address_array& removed_nodes() const noexcept {
+            return this->_removed_nodes;
+        }
+
+        inline void removed_nodes(socket_address_array&& rhs) {
+            this->_removed_nodes = std::move(rhs);
+        }
+
+        inline sequence_type sequence() const noexcept { return this->_sequence; }
+        inline void sequence(sequence_type rhs) noexcept { this->_sequence = rhs; }
+        inline sequence_type base_sequence() const noexcept { return this->_base_sequence; }
+        inline void base_sequence(sequence_type rhs) noexcept { this->_base_sequence = rhs; }
+        inline bool delta() const noexcept { return this->_base_sequence != 0; }
 
         void write(sbn::kernel_buffer& out) const override;
         void read(sbn::kernel_buffer& in) override;
 
     };
 
+    /**
+    \brief The nodes that were sent to the neighbours.
+    \details
+    Stores the last sent copy of each node once for all neighbours together
+    with the sequence number of the update in which the node was added or
+    changed, and the sequence numbers of the updates in which the nodes were
+    removed. The difference for a neighbour is computed from the sequence
+    number that was sent to it last time.
+    */
+    class hierarchy_journal {
+
+    public:
+        using sequence_type = Hierarchy_kernel::sequence_type;
+        using hierarchy_node_array = Hierarchy_kernel::hierarchy_node_array;
+        using socket_address_array = Hierarchy_kernel::socket_address_array;
+
+    private:
+        struct entry {
+            hierarchy_node node;
+            sequence_type sequence;
+        };
+
+        using entry_table = std::unordered_map<sys::socket_address,entry>;
+        using sequence_table = std::unordered_map<sys::socket_address,sequence_type>;
+
+    private:
+        entry_table _nodes;
+        /// The sequence numbers of the updates in which the nodes were removed.
+        sequence_table _removed;
+        /// Zero is reserved for the neighbours that did not receive anything.
+        sequence_type _sequence = 1;
+        /// The removed nodes with older sequence numbers are forgotten.
+        sequence_type _horizon = 0;
+
+    public:
+
+        /// Record the nodes that were added, changed or removed since the last update.
+        void update(const hierarchy_node_array& nodes);
+
+        /// Collect the nodes that were added, changed or removed after update \p since.
+        void changes(sequence_type since, hierarchy_node_array& changed,
+                     socket_address_array& removed) const;
+
+        /**
+        Forget the removed nodes that are known to every neighbour that
+        received the update with sequence number \p sequence or newer.
+        */
+        void forget_removed(sequence_type sequence);
+
+        inline sequence_type sequence() const noexcept { return this->_sequence; }
+        inline sequence_type horizon() const noexcept { return this->_horizon; }
+
+    };
+
+    /**
+    \brief The state of hierarchy exchange with one neighbour.
+    \details
+    Stores the sequence number of the last update that was sent to the
+    neighbour to compute the difference from the \link hierarchy_journal\endlink,
+    and the sequence number of the last message received from the neighbour
+    to check that the difference can be applied.
+    */
+    class hierarchy_link {
+
+    public:
+        using sequence_type = Hierarchy_kernel::sequence_type;
+        using hierarchy_node_array = Hierarchy_kernel::hierarchy_node_array;
+
+    private:
+        sequence_type _sent_sequence = 0;
+        sequence_type _received_sequence = 0;
+
+    public:
+
+        /**
+        Update the journal with the current nodes and put the difference
+        between the update that was sent to the neighbour last time and
+        the current one into the kernel. Put full snapshot if nothing was sent.
+        \return false if there are no changes
+        */
+        bool diff(hierarchy_journal& journal, const hierarchy_node_array& nodes,
+                  Hierarchy_kernel& k);
+
+        /**
+        \return false if the kernel is the difference with the message
+        that was not received (the neighbour has to send the full snapshot)
+        */
+        bool accept(const Hierarchy_kernel& k) noexcept;
+
+        /// Send full snapshot next time.
+        inline void reset_sent() noexcept { this->_sent_sequence = 0; }
+
+        inline void reset_received() noexcept { this->_received_sequence = 0; }
+
+        inline sequence_type sent_sequence() const noexcept { return this->_sent_sequence; }
+
+        inline sequence_type received_sequence() const noexcept {
+            return this->_received_sequence;
+        }
+
+    };
+
 }
 
 #endif // vim:filetype=cpp
@@ -1,7 +1,11 @@
+#include <cstdio>
+
 #include <gtest/gtest.h>
 
 #include <subordination/core/kernel_buffer.hh>
 #include <subordination/daemon/hierarchy.hh>
+#include <subordination/daemon/hierarchy_cache.hh>
+#include <subordination/daemon/hierarchy_kernel.hh>
 
 TEST(hierarchy, read_write) {
     sbn::kernel_buffer buf;
@@ -12,3 +16,218 @@ TEST(hierarchy, read_write) {
     buf >> hier2;
     EXPECT_EQ(hier.socket_address(), hier2.socket_address());
 }
+
+TEST(hierarchy, delta) {
+    using addr_type = sys::ipv4_address;
+    using node_array = sbnd::Hierarchy_kernel::hierarchy_node_array;
+    sbnd::Hierarchy<addr_type> a{{{10,0,0,1},16}, 33333};
+    sbnd::Hierarchy<addr_type> b{{{10,0,0,2},16}, 33333};
+    sbnd::Hierarchy<addr_type> c{{{10,0,0,3},16}, 33333};
+    const auto now = sbnd::hierarchy_node::clock::now();
+    sbnd::hierarchy_journal journal;
+    sbnd::hierarchy_link sender, receiver;
+    node_array nodes{a.this_node(), b.this_node()};
+    sbnd::Hierarchy_kernel k1;
+    EXPECT_TRUE(sender.diff(journal, nodes, k1));
+    EXPECT_FALSE(k1.delta());
+    EXPECT_EQ(2u, k1.nodes().size());
+    EXPECT_TRUE(receiver.accept(k1));
+    sbnd::Hierarchy_kernel k2;
+    EXPECT_FALSE(sender.diff(journal, nodes, k2));
+    nodes = {a.this_node(), c.this_node()};
+    EXPECT_TRUE(sender.diff(journal, nodes, k2));
+    EXPECT_TRUE(k2.delta());
+    ASSERT_EQ(1u, k2.nodes().size());
+    EXPECT_EQ(c.socket_address(), k2.nodes().front().socket_address());
+    ASSERT_EQ(1u, k2.removed_nodes().size());
+    EXPECT_EQ(b.socket_address(), k2.removed_nodes().front());
+    EXPECT_TRUE(receiver.accept(k2));
+    sbn::resource_array r;
+    r[sbn::resources::resources::total_threads] = 8;
+    a.resources(r, now);
+    nodes = {a.this_node(), c.this_node()};
+    sbnd::Hierarchy_kernel k3, k4;
+    EXPECT_TRUE(sender.diff(journal, nodes, k3));
+    ASSERT_EQ(1u, k3.nodes().size());
+    EXPECT_EQ(a.socket_address(), k3.nodes().front().socket_address());
+    // the receiver lost k3
+    r[sbn::resources::resources::total_threads] = 16;
+    a.resources(r, now);
+    nodes = {a.this_node(), c.this_node()};
+    EXPECT_TRUE(sender.diff(journal, nodes, k4));
+    EXPECT_FALSE(receiver.accept(k4));
+    sender.reset_sent();
+    sbnd::Hierarchy_kernel k5;
+    EXPECT_TRUE(sender.diff(journal, nodes, k5));
+    EXPECT_FALSE(k5.delta());
+    EXPECT_TRUE(receiver.accept(k5));
+}
+
+TEST(hierarchy, journal) {
+    using addr_type = sys::ipv4_address;
+    using node_array = sbnd::Hierarchy_kernel::hierarchy_node_array;
+    sbnd::Hierarchy<addr_type> a{{{10,0,0,1},16}, 33333};
+    sbnd::Hierarchy<addr_type> b{{{10,0,0,2},16}, 33333};
+    sbnd::Hierarchy<addr_type> c{{{10,0,0,3},16}, 33333};
+    sbnd::Hierarchy<addr_type> d{{{10,0,0,4},16}, 33333};
+    sbnd::hierarchy_journal journal;
+    sbnd::hierarchy_link first, second;
+    node_array nodes{a.this_node(), b.this_node()};
+    sbnd::Hierarchy_kernel k1, k2;
+    EXPECT_TRUE(first.diff(journal, nodes, k1));
+    EXPECT_TRUE(second.diff(journal, nodes, k2));
+    EXPECT_EQ(k1.sequence(), k2.sequence());
+    // the second neighbour misses two updates
+    nodes = {a.this_node(), b.this_node(), c.this_node()};
+    sbnd::Hierarchy_kernel k3;
+    EXPECT_TRUE(first.diff(journal, nodes, k3));
+    ASSERT_EQ(1u, k3.nodes().size());
+    nodes = {a.this_node(), c.this_node(), d.this_node()};
+    sbnd::Hierarchy_kernel k4;
+    EXPECT_TRUE(first.diff(journal, nodes, k4));
+    ASSERT_EQ(1u, k4.nodes().size());
+    EXPECT_EQ(d.socket_address(), k4.nodes().front().socket_address());
+    ASSERT_EQ(1u, k4.removed_nodes().size());
+    // and receives accumulated changes
+    sbnd::Hierarchy_kernel k5;
+    EXPECT_TRUE(second.diff(journal, nodes, k5));
+    EXPECT_EQ(k2.sequence(), k5.base_sequence());
+    EXPECT_EQ(k4.sequence(), k5.sequence());
+    EXPECT_EQ(2u, k5.nodes().size());
+    ASSERT_EQ(1u, k5.removed_nodes().size());
+    EXPECT_EQ(b.socket_address(), k5.removed_nodes().front());
+    // the removed nodes are forgotten when all neighbours know about them
+    journal.forget_removed(k4.sequence());
+    sbnd::hierarchy_link third;
+    sbnd::Hierarchy_kernel k6;
+    EXPECT_TRUE(third.diff(journal, nodes, k6));
+    EXPECT_FALSE(k6.delta());
+    EXPECT_EQ(3u, k6.nodes().size());
+}
+
+TEST(hierarchy, statistics) {
+    using addr_type = sys::ipv4_address;
+    using r = sbn::resources::resources;
+    using node_array = sbnd::Hierarchy<addr_type>::hierarchy_node_array;
+    const auto now = sbnd::hierarchy_node::clock::now();
+    sbnd::Hierarchy<addr_type> a{{{10,0,0,1},16}, 33333};
+    auto make_node = [] (sys::u8 n, sys::u8 superior, sys::u64 nthreads) {
+        sbn::resource_array res;
+        res[r::total_threads] = nthreads;
+        sbnd::hierarchy_node node(sys::ipv4_socket_address{{10,0,0,n},33333}, res);
+        if (superior != 0) {
+            node.superior_socket_address(sys::ipv4_socket_address{{10,0,0,superior},33333});
+        }
+        node.version(1);
+        return node;
+    };
+    auto b = make_node(2, 1, 2), c = make_node(3, 2, 4), d = make_node(4, 1, 8);
+    // the subordinate is added before its superior
+    EXPECT_TRUE(a.add_nodes(node_array{c, d, b}, now));
+    EXPECT_EQ(3u, a.num_neighbours());
+    EXPECT_EQ(2u, a.statistics_behind(b.socket_address()).num_nodes());
+    EXPECT_EQ(6u, a.statistics_behind(b.socket_address()).total_threads());
+    EXPECT_EQ(2u, a.nodes_behind(b.socket_address()).size());
+    EXPECT_EQ(8u, a.statistics_behind(d.socket_address()).total_threads());
+    EXPECT_EQ(4u, a.statistics().num_nodes());
+    EXPECT_EQ(3u, a.subordinates().size());
+    EXPECT_EQ(4u, a.lower_nodes(2).size());
+    // resources of the leaf node change
+    c = make_node(3, 2, 16);
+    c.version(2);
+    EXPECT_TRUE(a.add_nodes(node_array{c}, now));
+    EXPECT_EQ(18u, a.statistics_behind(b.socket_address()).total_threads());
+    EXPECT_EQ(1u+18u+8u, a.statistics().total_threads());
+    // the leaf node moves to another superior
+    c = make_node(3, 4, 16);
+    c.version(3);
+    EXPECT_TRUE(a.add_nodes(node_array{c}, now));
+    EXPECT_EQ(2u, a.statistics_behind(b.socket_address()).total_threads());
+    EXPECT_EQ(24u, a.statistics_behind(d.socket_address()).total_threads());
+    // the leaf node disappears
+    EXPECT_TRUE(a.remove_nodes({c.socket_address()}));
+    EXPECT_EQ(2u, a.num_neighbours());
+    EXPECT_EQ(8u, a.statistics_behind(d.socket_address()).total_threads());
+    EXPECT_EQ(3u, a.statistics().num_nodes());
+    // the superior of the current node is counted upwards
+    auto e = make_node(5, 0, 32);
+    EXPECT_TRUE(a.add_nodes(node_array{e}, now));
+    EXPECT_TRUE(a.add_superior(e, now));
+    ASSERT_NE(nullptr, a.superior());
+    EXPECT_EQ(1u, a.statistics_behind(e.socket_address()).num_nodes());
+    EXPECT_EQ(32u, a.statistics_behind(e.socket_address()).total_threads());
+    EXPECT_EQ(1u, a.nodes_behind(e.socket_address()).size());
+    EXPECT_EQ(4u, a.nodes(10).size());
+}
+
+TEST(hierarchy, orphans) {
+    using addr_type = sys::ipv4_address;
+    using node_array = sbnd::Hierarchy<addr_type>::hierarchy_node_array;
+    const auto now = sbnd::hierarchy_node::clock::now();
+    sbnd::Hierarchy<addr_type> a{{{10,0,0,1},16}, 33333};
+    auto make_node = [] (sys::u8 n, sys::u8 superior) {
+        sbnd::hierarchy_node node(sys::ipv4_socket_address{{10,0,0,n},33333}, sbn::resource_array{});
+        node.superior_socket_address(sys::ipv4_socket_address{{10,0,0,superior},33333});
+        node.version(1);
+        return node;
+    };
+    auto b = make_node(2, 1), e = make_node(5, 2), c = make_node(3, 5), d = make_node(4, 5);
+    EXPECT_TRUE(a.add_nodes(node_array{b, c, d}, now));
+    EXPECT_EQ(2u, a.statistics().num_nodes());
+    EXPECT_TRUE(a.add_nodes(node_array{e}, now));
+    EXPECT_EQ(5u, a.statistics().num_nodes());
+    EXPECT_EQ(4u, a.nodes_behind(b.socket_address()).size());
+    // the subordinates of the removed node are adopted when it comes back
+    EXPECT_TRUE(a.remove_nodes({e.socket_address()}));
+    EXPECT_EQ(2u, a.statistics().num_nodes());
+    EXPECT_TRUE(a.add_nodes(node_array{e}, now));
+    EXPECT_EQ(5u, a.statistics().num_nodes());
+    EXPECT_EQ(4u, a.nodes_behind(b.socket_address()).size());
+}
+
+TEST(hierarchy_cache, restore) {
+    using addr_type = sys::ipv4_address;
+    using r = sbn::resources::resources;
+    using node_array = sbnd::Hierarchy<addr_type>::hierarchy_node_array;
+    const char* filename = "hierarchy-cache-test";
+    const auto now = sbnd::hierarchy_node::clock::now();
+    auto make_node = [] (sys::u8 n, sys::u8 superior, sys::u64 nthreads) {
+        sbn::resource_array res;
+        res[r::total_threads] = nthreads;
+        sbnd::hierarchy_node node(sys::ipv4_socket_address{{10,0,0,n},33333}, res);
+        if (superior != 0) {
+            node.superior_socket_address(sys::ipv4_socket_address{{10,0,0,superior},33333});
+        }
+        node.version(1);
+        return node;
+    };
+    sbnd::Hierarchy<addr_type> a{{{10,0,0,1},16}, 33333};
+    auto b = make_node(2, 0, 2), c = make_node(3, 1, 4), d = make_node(4, 1, 8);
+    EXPECT_TRUE(a.add_nodes(node_array{b, c, d}, now));
+    EXPECT_TRUE(a.add_superior(b, now));
+    {
+        sbnd::hierarchy_cache cache{sys::path(filename)};
+        EXPECT_FALSE(cache.write(a));
+        // one of four records changed
+        d = make_node(4, 1, 16);
+        d.version(2);
+        EXPECT_TRUE(a.add_nodes(node_array{d}, now));
+        EXPECT_TRUE(cache.write(a));
+    }
+    sbnd::Hierarchy<addr_type> a2{{{10,0,0,1},16}, 33333};
+    sbnd::hierarchy_cache cache{sys::path(filename)};
+    node_array nodes;
+    ASSERT_TRUE(cache.read(a2, nodes));
+    EXPECT_EQ(4u, nodes.size());
+    EXPECT_TRUE(a2.restore(nodes, now));
+    EXPECT_EQ(a.superior_socket_address(), a2.superior_socket_address());
+    ASSERT_NE(nullptr, a2.superior());
+    EXPECT_EQ(3u, a2.subordinates().size());
+    EXPECT_EQ(a.statistics().total_threads(), a2.statistics().total_threads());
+    EXPECT_LT(a.this_node().version(), a2.this_node().version());
+    // the cache of other node is ignored
+    sbnd::Hierarchy<addr_type> other{{{10,0,0,5},16}, 33333};
+    ASSERT_TRUE(cache.read(other, nodes));
+    EXPECT_FALSE(other.restore(nodes, now));
+    std::remove(filename);
+}
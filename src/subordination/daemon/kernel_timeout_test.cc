@@ -0,0 +1,55 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <subordination/core/error_handler.hh>
+#include <subordination/daemon/process_pipeline.hh>
+#include <subordination/test/kernel_collector.hh>
+
+namespace {
+
+}
+
+TEST(process_pipeline, kernel_timeout) {
+    using namespace std::chrono;
+    test::Kernel_collector source;
+    sbnd::process_pipeline::properties p;
+    p.kernel_timeout = sbn::Duration(milliseconds(10));
+    sbnd::process_pipeline ppl(p);
+    ppl.name("proc");
+    ppl.foreign_pipeline(&source);
+    // no kernel fits into the node
+    ppl.max_threads(0);
+    ppl.start();
+    {
+        sbn::kernel_ptr remote(new sbn::kernel);
+        remote->id(1);
+        remote->source(sys::socket_address(sys::ipv4_socket_address{{10,0,0,1},33333}));
+        ppl.forward(std::move(remote));
+        sbn::kernel_ptr local(new sbn::kernel);
+        local->id(2);
+        ppl.forward(std::move(local));
+    }
+    // the pipeline wakes up when the kernel expires without any other events
+    auto kernels = source.wait_for(1);
+    ASSERT_EQ(1u, kernels.size());
+    EXPECT_EQ(1u, kernels.front()->id());
+    EXPECT_EQ(sbn::exit_code::no_resources, kernels.front()->return_code());
+    EXPECT_EQ(sbn::kernel::phases::downstream, kernels.front()->phase());
+    {
+        auto g = ppl.guard();
+        EXPECT_EQ(1u, ppl.num_outstanding_kernels());
+        EXPECT_EQ(1u, ppl.num_returned_kernels());
+    }
+    ppl.stop();
+    ppl.wait();
+    sbn::kernel_sack sack;
+    ppl.clear(sack);
+}
+
+int main(int argc, char* argv[]) {
+    sbnd::block_child_signal();
+    sbn::install_error_handler();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <fstream>
 #include <iterator>
 
 #include <unistdx/base/log_message>
@@ -12,6 +13,7 @@
 #include <subordination/daemon/job_status_kernel.hh>
 #include <subordination/daemon/main.hh>
 #include <subordination/daemon/pipeline_status_kernel.hh>
+#include <subordination/daemon/shared_object_kernel.hh>
 #include <subordination/daemon/status_kernel.hh>
 #include <subordination/daemon/terminate_kernel.hh>
 
@@ -49,6 +51,29 @@ namespace {
     }
 
     class network_timer: public sbn::kernel {};
+    class resource_timer: public sbn::kernel {};
+
+    /// The no. of runnable threads excluding the current one.
+    uint64_t read_run_queue_length() {
+        std::ifstream in("/proc/loadavg");
+        double load_average[3]{};
+        uint64_t nrunning = 0;
+        in >> load_average[0] >> load_average[1] >> load_average[2] >> nrunning;
+        if (nrunning != 0) { --nrunning; }
+        return nrunning;
+    }
+
+    /// Memory available for new processes without swapping.
+    uint64_t read_free_memory() {
+        std::ifstream in("/proc/meminfo");
+        std::string name, unit;
+        uint64_t value = 0;
+        while (in >> name >> value) {
+            std::getline(in, unit);
+            if (name == "MemAvailable:") { return value*1024; }
+        }
+        return 0;
+    }
 
 }
 
@@ -67,8 +92,16 @@ void sbnd::Main::send_timer(bool first_time) {
     factory.local().send(std::move(k));
 }
 
+void sbnd::Main::send_resource_timer(bool first_time) {
+    auto k = sbn::make_pointer<resource_timer>();
+    k->after(first_time ? duration::zero() : this->_resource_interval);
+    k->point_to_point(this);
+    factory.local().send(std::move(k));
+}
+
 void sbnd::Main::act() {
     this->send_timer(true);
+    if (this->_resource_interval != duration::zero()) { this->send_resource_timer(true); }
 }
 
 auto
@@ -97,6 +130,41 @@ void sbnd::Main::update_resources() {
     this->_resources[r::hostname] = sys::this_process::hostname();
 }
 
+void sbnd::Main::sample_resources() {
+    using r = sbn::resources::resources;
+    using namespace std::chrono;
+    const auto now = hierarchy_node::clock::now();
+    sample(r::free_memory, read_free_memory());
+    sample(r::run_queue_length, read_run_queue_length());
+    if (factory.isset(factory_flags::process)) {
+        size_t n = 0;
+        { auto g = factory.process().guard(); n = factory.process().num_completed_kernels(); }
+        const auto dt = duration_cast<milliseconds>(now - this->_last_sample).count();
+        if (this->_last_sample != hierarchy_node::time_point{} && dt > 0) {
+            sample(r::completion_rate,
+                   uint64_t((n - this->_num_completed_kernels)*60000UL / dt));
+        }
+        this->_num_completed_kernels = n;
+    }
+    this->_last_sample = now;
+}
+
+/**
+Small fluctuations of the sampled resource are ignored, otherwise
+every sample would increment hierarchy version and every node would
+broadcast its hierarchy and rewrite the cache.
+*/
+void sbnd::Main::sample(sbn::resources::resources r, uint64_t new_value) {
+    using t = sbn::resources::Any::Type;
+    auto& value = this->_resources[r];
+    const auto old_value = value.unsigned_integer();
+    const auto diff = old_value < new_value ? new_value-old_value : old_value-new_value;
+    if (value.type() == t::U64 && diff*100 <= old_value*this->_resource_threshold) {
+        return;
+    }
+    value = new_value;
+}
+
 void sbnd::Main::update_discoverers() {
     interface_address_set new_ifaddrs = this->enumerate_ifaddrs();
     interface_address_set ifaddrs_to_add =
@@ -121,18 +189,25 @@ void sbnd::Main::update_discoverers() {
     for (const ifaddr_type& interface_address : ifaddrs_to_add) {
         this->add_discoverer(interface_address);
     }
-    // update resources
+    propagate_resources();
+    this->send_timer();
+}
+
+void sbnd::Main::propagate_resources() {
     const auto now = hierarchy_node::clock::now();
     for (auto& pair : this->_discoverers) {
         pair.second->resources(this->_resources, now);
     }
-    this->send_timer();
 }
 
 void sbnd::Main::react(sbn::kernel_ptr&& child) {
     if (typeid(*child) == typeid(network_timer)) {
         update_resources();
         update_discoverers();
+    } else if (typeid(*child) == typeid(resource_timer)) {
+        sample_resources();
+        propagate_resources();
+        send_resource_timer();
     } else if (typeid(*child) == typeid(probe)) {
         forward_probe(sbn::pointer_dynamic_cast<probe>(std::move(child)));
     } else if (typeid(*child) == typeid(Hierarchy_kernel)) {
@@ -147,6 +222,42 @@ void sbnd::Main::react(sbn::kernel_ptr&& child) {
         report_pipeline_status(sbn::pointer_dynamic_cast<Pipeline_status_kernel>(std::move(child)));
     } else if (typeid(*child) == typeid(process_pipeline_kernel)) {
         on_event(sbn::pointer_dynamic_cast<process_pipeline_kernel>(std::move(child)));
+    } else if (typeid(*child) == typeid(shared_object_kernel)) {
+        on_shared_object(sbn::pointer_dynamic_cast<shared_object_kernel>(std::move(child)));
+    }
+}
+
+void sbnd::Main::on_shared_object(pointer<shared_object_kernel> k) {
+    auto& objects = factory.shared_objects();
+    const auto id = k->object_id();
+    if (k->phase() == sbn::kernel::phases::downstream) {
+        // the neighbour replied
+        if (k->return_code() == sbn::exit_code::success) {
+            try {
+                objects.insert(id, k->data().data(), k->data().size());
+            } catch (const std::exception& err) {
+                log("failed to store shared object _: _", id, err.what());
+            }
+        } else {
+            log("failed to fetch shared object _ from _: _", id, k->source(), k->return_code());
+        }
+        factory.remote().release_shared_object(id);
+    } else if (!k->source()) {
+        // socket pipeline requests the object from the neighbour
+        k->parent(this);
+        k->principal_id(1);
+        factory.remote().send(std::move(k));
+    } else {
+        // the neighbour requests the object from this node
+        auto ret = sbn::exit_code::success;
+        try {
+            k->data(objects.read(id));
+        } catch (const std::exception& err) {
+            log("failed to read shared object _: _", id, err.what());
+            ret = sbn::exit_code::error;
+        }
+        k->return_to_parent(ret);
+        factory.remote().send(std::move(k));
     }
 }
 
@@ -291,6 +402,14 @@ _discoverer_properties(props.discover) {
         if (x) { this->_allowedifaddrs.insert(x); }
     }
     this->_interval = props.network.interface_update_interval;
+    this->_resource_interval = props.network.resource_update_interval;
+    if (this->_resource_interval == duration::zero() &&
+        props.remote.scheduling_policy == scheduling_policies::idle) {
+        // idle nodes can not be found without run-queue lengths
+        this->_resource_interval = props.network.idle_resource_update_interval;
+        sys::log_message("main", "enable resource sampling for idle scheduling policy");
+    }
+    this->_resource_threshold = props.network.resource_update_threshold;
     update_resources();
     for (auto& pair : props.resources.expressions) {
         this->_resources[pair.first] = pair.second->evaluate(this->_resources);
@@ -32,7 +32,14 @@ namespace sbnd {
         interface_address_set _allowedifaddrs;
         /// Interface address list update interval.
         duration _interval = std::chrono::minutes(1);
+        /// Run-time resources sampling interval.
+        duration _resource_interval = duration::zero();
+        /// Minimal relative change (in per cent) of the sampled resource.
+        unsigned _resource_threshold = 10;
         resource_array _resources;
+        /// The no. of completed kernels at the time of the last sample.
+        size_t _num_completed_kernels = 0;
+        hierarchy_node::time_point _last_sample{};
 
     public:
 
@@ -46,10 +53,14 @@ namespace sbnd {
     private:
 
         void send_timer(bool first_time=false);
+        void send_resource_timer(bool first_time=false);
 
         interface_address_set enumerate_ifaddrs();
         void update_resources();
+        void sample_resources();
+        void sample(sbn::resources::resources r, uint64_t new_value);
         void update_discoverers();
+        void propagate_resources();
         void add_discoverer(const ifaddr_type& rhs);
         void remove_discoverer(const ifaddr_type& rhs);
 
@@ -58,6 +69,7 @@ namespace sbnd {
         void forward_hierarchy_kernel(pointer<Hierarchy_kernel> p);
         void on_event(pointer<socket_pipeline_kernel> k);
         void on_event(pointer<process_pipeline_kernel> k);
+        void on_shared_object(pointer<shared_object_kernel> k);
         void report_status(pointer<Status_kernel> k);
         void report_job_status(pointer<Job_status_kernel> k);
         void report_pipeline_status(pointer<Pipeline_status_kernel> k);
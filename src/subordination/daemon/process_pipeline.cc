@@ -1,6 +1,15 @@
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
 #include <sstream>
+#include <vector>
 
-#include <unistdx/base/unlock_guard>
+#include <unistdx/base/check>
 #include <unistdx/io/two_way_pipe>
 
 #include <subordination/bits/contracts.hh>
@@ -17,22 +26,109 @@ namespace {
         if (new_size == std::numeric_limits<size_t>::max()) { return; }
         fd.pipe_buffer_size(new_size);
     }
+
+    inline sys::fd_type open_process_fd(sys::pid_type pid) noexcept {
+        #if defined(SYS_pidfd_open)
+        return ::syscall(SYS_pidfd_open, pid, 0);
+        #else
+        errno = ENOSYS;
+        return -1;
+        #endif
+    }
+
+    inline bool pidfd_supported() noexcept {
+        auto fd = open_process_fd(sys::this_process::id());
+        if (fd == -1) { return false; }
+        ::close(fd);
+        return true;
+    }
+
+    inline void child_signal_mask(::sigset_t& mask) {
+        UNISTDX_CHECK(::sigemptyset(&mask));
+        UNISTDX_CHECK(::sigaddset(&mask, SIGCHLD));
+    }
+
+}
+
+void sbnd::block_child_signal() {
+    ::sigset_t mask;
+    child_signal_mask(mask);
+    UNISTDX_CHECK(::sigprocmask(SIG_BLOCK, &mask, nullptr));
+}
+
+sbnd::child_process_watcher::child_process_watcher(sys::process&& p, bool pidfd):
+_process(std::move(p)) {
+    if (!pidfd) { return; }
+    auto fd = open_process_fd(this->_process.id());
+    if (fd == -1) {
+        // fall back to SIGCHLD handler
+        if (errno != ENOSYS) { throw sys::bad_call(); }
+    } else {
+        this->_fd = sys::fildes(fd);
+    }
+}
+
+void sbnd::child_process_watcher::handle(const sys::epoll_event& event) {
+    if (event.in()) { reap(); }
+}
+
+bool sbnd::child_process_watcher::reap() {
+    if (state() == states::stopped) { return false; }
+    if (!has_fd()) {
+        // check without reaping that the process has terminated
+        ::siginfo_t info{};
+        UNISTDX_CHECK(::waitid(P_PID, id(), &info, WEXITED | WNOHANG | WNOWAIT));
+        if (info.si_pid != id()) { return false; }
+    }
+    const auto pid = id();
+    auto status = this->_process.wait();
+    // the connection is removed from the pipeline on the next flush
+    state(states::stopped);
+    parent()->on_process_exit(pid, status);
+    return true;
+}
+
+void sbnd::child_process_watcher::write(std::ostream& out) const {
+    sbn::connection::write(out);
+    out << ' ' << sbn::list("child-process-id", id());
+}
+
+/**
+Blocks SIGCHLD in the calling thread. The signal has to be blocked in all
+other threads as well (see \link block_child_signal\endlink), otherwise
+it might be delivered to the thread that does not block it.
+*/
+sbnd::child_signal_handler::child_signal_handler() {
+    ::sigset_t mask;
+    child_signal_mask(mask);
+    block_child_signal();
+    auto fd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    UNISTDX_CHECK(fd);
+    this->_fd = sys::fildes(fd);
+}
+
+void sbnd::child_signal_handler::handle(const sys::epoll_event& event) {
+    if (!event.in()) { return; }
+    // multiple signals are merged into one, hence we check all child processes
+    ::signalfd_siginfo info;
+    while (::read(fd(), &info, sizeof(info)) == sizeof(info)) {}
+    parent()->reap_child_processes();
 }
 
 void sbnd::process_pipeline::loop() {
-    this->_waiting_thread = std::thread([this] () noexcept { wait_loop(); });
     basic_socket_pipeline::loop();
     #if defined(SBN_DEBUG)
     log("waiting for all processes to finish: pid=_", sys::this_process::id());
     #endif
-    try {
-        this->_child_processes.terminate();
-    } catch (const sys::bad_call& err) {
-        if (err.errc() != std::errc::no_such_process) { log_error(err); }
-    }
-    if (this->_waiting_thread.joinable()) { this->_waiting_thread.join(); }
     lock_type lock(this->_mutex);
-    wait_for_processes(lock);
+    for (auto& pair : this->_child_processes) {
+        try {
+            pair.second->process().terminate();
+        } catch (const sys::bad_call& err) {
+            if (err.errc() != std::errc::no_such_process) { log_error(err); }
+        }
+    }
+    wait_for_processes();
 }
 
 typename sbnd::process_pipeline::app_iterator
@@ -46,14 +142,21 @@ sbnd::process_pipeline::do_add(const sbn::application& app) {
     sys::two_way_pipe data_pipe;
     update_buffer_size(data_pipe.in(), this->_pipe_buffer_size);
     update_buffer_size(data_pipe.out(), this->_pipe_buffer_size);
-    const auto& p = _child_processes.emplace(
-        [&app,this,&data_pipe] () {
+    // the application uses the same object store as the daemon
+    sbn::application::string_array env;
+    if (this->_shared_objects) { env = this->_shared_objects->environment(); }
+    sys::process p{
+        [&app,this,&data_pipe,&env] () {
             try {
+                // the signal is blocked in the daemon (see block_child_signal)
+                ::sigset_t mask;
+                child_signal_mask(mask);
+                UNISTDX_CHECK(::sigprocmask(SIG_UNBLOCK, &mask, nullptr));
                 data_pipe.close_in_child();
                 data_pipe.validate();
                 data_pipe.child_in().unsetf(sys::fd_flag::fd_close_on_exec);
                 data_pipe.child_out().unsetf(sys::fd_flag::fd_close_on_exec);
-                return app.execute(data_pipe);
+                return app.execute(data_pipe, env);
             } catch (const std::exception& err) {
                 this->log("failed to execute _: _", app.filename(), err.what());
                 // make address sanitizer happy
@@ -74,10 +177,12 @@ sbnd::process_pipeline::do_add(const sbn::application& app) {
                 #endif
             }
         }
-                            );
+    };
+    const auto pid = p.id();
+    watch(std::move(p));
     data_pipe.close_in_parent();
     data_pipe.validate();
-    auto child = std::make_shared<connection_type>(p.id(), std::move(data_pipe), app);
+    auto child = std::make_shared<connection_type>(pid, std::move(data_pipe), app);
     child->parent(this);
     child->types(types());
     child->name(this->_name);
@@ -85,7 +190,7 @@ sbnd::process_pipeline::do_add(const sbn::application& app) {
     using f = sbn::connection_flags;
     child->setf(f::save_upstream_kernels | f::save_downstream_kernels);
     log("executing app=_,credentials=_:_,pid=_ command _",
-        app.id(), app.user(), app.group(), p.id(), app.arguments().front());
+        app.id(), app.user(), app.group(), pid, app.arguments().front());
     auto result = this->_jobs.emplace(app.id(), child);
     child->add(child);
     return result.first;
@@ -94,22 +199,33 @@ sbnd::process_pipeline::do_add(const sbn::application& app) {
 void sbnd::process_pipeline::remove(application_id_type id) {
     lock_type lock(this->_mutex);
     auto result = this->_jobs.find(id);
-    if (result == this->_jobs.end()) { return; }
-    terminate(result->second->child_process_id());
-    { sbn::kernel_sack sack; result->second->clear(sack); }
-    this->_jobs.erase(result);
+    if (result != this->_jobs.end()) {
+        terminate(result->second->child_process_id());
+        { sbn::kernel_sack sack; result->second->clear(sack); }
+        this->_num_completed_kernels += result->second->num_completed_kernels();
+        this->_jobs.erase(result);
+    }
+    // the objects are fetched even if the application does not run on this node
+    release_shared_objects(id);
 }
 
 void sbnd::process_pipeline::terminate(sys::pid_type id) {
     Expects(id > 0);
-    auto first = this->_child_processes.begin(), last = this->_child_processes.end();
-    while (first != last) {
-        if (first->id() == id) {
-            first->terminate();
-            break;
-        }
-        ++first;
+    auto result = this->_child_processes.find(id);
+    if (result == this->_child_processes.end()) { return; }
+    result->second->process().terminate();
+}
+
+void sbnd::process_pipeline::watch(sys::process&& p) {
+    const auto pid = p.id();
+    auto ptr = std::make_shared<child_process_watcher>(std::move(p), this->_pidfd);
+    ptr->parent(this);
+    ptr->name(this->_name);
+    ptr->state(sbn::connection::states::started);
+    if (ptr->has_fd()) {
+        emplace_handler(sys::epoll_event(ptr->fd(), sys::event::in), ptr);
     }
+    this->_child_processes.emplace(pid, std::move(ptr));
 }
 
 void sbnd::process_pipeline::forward(sbn::kernel_ptr&& fk) {
@@ -121,15 +237,12 @@ void sbnd::process_pipeline::forward(sbn::kernel_ptr&& fk) {
     #endif
     lock_type lock(this->_mutex);
     if (stopping() || stopped()) { return; }
-    auto current_load = total_load();
-    current_load += fk->weights();
-    if ((!this->_interleave && this->_jobs.size() == 1) ||
-        num_threads_used(current_load) < this->_max_threads) {
+    if (this->_outstanding.empty() && fits(total_load() + fk->weights())) {
         do_forward(std::move(fk));
-        poller().notify_one();
     } else {
-        this->_outstanding_kernels.emplace_back(std::move(fk));
+        enqueue(std::move(fk));
     }
+    poller().notify_one();
 }
 
 void sbnd::process_pipeline::do_forward(sbn::kernel_ptr&& fk) {
@@ -152,31 +265,111 @@ void sbnd::process_pipeline::do_forward(sbn::kernel_ptr&& fk) {
     conn->forward(std::move(fk));
 }
 
-void sbnd::process_pipeline::do_process_kernels(kernel_queue& kernels,
-                                                sbn::weight_array& current_load) {
-    const auto nkernels = kernels.size();
-    for (size_t i=0; i<nkernels; ++i) {
-        auto k = std::move(kernels.front());
-        kernels.pop_front();
-        auto new_load = current_load + k->weights();
-        if ((!this->_interleave && this->_jobs.size() == 1) ||
-            num_threads_used(new_load) < this->_max_threads) {
-            if (k->is_native()) {
-                process_kernel(std::move(k));
-            } else {
-                do_forward(std::move(k));
-            }
-            current_load = new_load;
+void sbnd::process_pipeline::process_kernels() {
+    while (!this->_kernels.empty()) {
+        auto k = std::move(this->_kernels.front());
+        this->_kernels.pop_front();
+        if (k->phase() == sbn::kernel::phases::broadcast) {
+            process_kernel(std::move(k));
         } else {
-            kernels.emplace_back(std::move(k));
+            enqueue(std::move(k));
         }
     }
+    return_expired_kernels();
+    admit_kernels();
 }
 
-void sbnd::process_pipeline::process_kernels() {
+const sbn::application*
+sbnd::process_pipeline::find_application(const sbn::kernel& k) const {
+    if (const auto* a = k.target_application()) { return a; }
+    const auto id = k.target_application_id();
+    if (id == k.source_application_id()) {
+        if (const auto* a = k.source_application()) { return a; }
+    }
+    auto result = this->_jobs.find(id);
+    if (result == this->_jobs.end()) { return nullptr; }
+    return &result->second->application();
+}
+
+void sbnd::process_pipeline::enqueue(sbn::kernel_ptr&& k) {
+    // the kernels that can not be returned to the source node never expire
+    auto deadline = time_point::max();
+    if (this->_kernel_timeout != duration::zero() && returnable(*k)) {
+        deadline = clock_type::now() + this->_kernel_timeout;
+    }
+    const auto* a = find_application(*k);
+    this->_outstanding.push(std::move(k), a, deadline);
+}
+
+/**
+Upstream kernels that came from other cluster nodes and waited longer
+than kernel timeout are returned to the source node with
+\link sbn::exit_code::no_resources\endlink exit code, so that the parent
+may send them to another node. Other kernels stay in the queue.
+The kernels are returned after the scan, because the pipeline
+is unlocked when they are forwarded.
+*/
+void sbnd::process_pipeline::return_expired_kernels() {
+    auto expired = this->_outstanding.expire(clock_type::now());
+    for (auto& k : expired) {
+        return_to_source(k, sbn::exit_code::no_resources);
+        ++this->_num_returned_kernels;
+    }
+}
+
+auto sbnd::process_pipeline::next_wakeup_time_point() const noexcept -> time_point {
+    return this->_outstanding.next_deadline();
+}
+
+bool sbnd::process_pipeline::returnable(const sbn::kernel& k) noexcept {
+    if (k.phase() != sbn::kernel::phases::upstream) { return false; }
+    const auto& src = k.source();
+    return src && src.family() != sys::family_type::unix;
+}
+
+bool sbnd::process_pipeline::return_to_source(sbn::kernel_ptr& k, sbn::exit_code ret) {
+    if (!returnable(*k)) { return false; }
+    const auto& src = k->source();
+    log("return _ to _ with _ exit code", *k, src, ret);
+    k->return_to_parent(ret);
+    forward_foreign(std::move(k));
+    return true;
+}
+
+/**
+Only the kernels that came from other cluster nodes are removed from
+the queue, the same as in \link return_expired_kernels\endlink.
+*/
+void sbnd::process_pipeline::cancel(const sbn::kernel& notice) {
+    lock_type lock(this->_mutex);
+    auto cancelled = this->_outstanding.remove_if([&notice] (const sbn::kernel& k) {
+        return returnable(k) && k.same_identity(notice);
+    });
+    for (auto& k : cancelled) { return_to_source(k, sbn::exit_code::cancelled); }
+    sbn::basic_socket_pipeline::cancel(notice);
+}
+
+/**
+The kernels are admitted in the order of \link admission_queue\endlink
+while they fit into the node.
+*/
+void sbnd::process_pipeline::admit_kernels() {
+    if (this->_outstanding.empty()) { return; }
     auto current_load = total_load();
-    do_process_kernels(this->_kernels, current_load);
-    do_process_kernels(this->_outstanding_kernels, current_load);
+    auto cost = [this] (const sbn::kernel& k) {
+        return std::max(num_threads_used(k.weights()), sbn::weight_type(1));
+    };
+    auto fits = [this,&current_load] (const sbn::kernel& k) {
+        return this->fits(current_load + k.weights());
+    };
+    while (auto k = this->_outstanding.pop(cost, fits)) {
+        current_load += k->weights();
+        if (k->is_native()) {
+            process_kernel(std::move(k));
+        } else {
+            do_forward(std::move(k));
+        }
+    }
 }
 
 void sbnd::process_pipeline::process_kernel(sbn::kernel_ptr&& k) {
@@ -213,48 +406,73 @@ void sbnd::process_pipeline::process_connections() {
     */
 }
 
-void sbnd::process_pipeline::wait_loop() {
-    using std::this_thread::sleep_for;
-    using std::chrono::milliseconds;
-    lock_type lock(this->_mutex);
-    while (!stopping()) {
-        if (this->_child_processes.size() == 0) {
-            sys::unlock_guard<lock_type> g(lock);
-            sleep_for(milliseconds(99));
-        } else {
-            wait_for_processes(lock);
+void sbnd::process_pipeline::reap_child_processes() {
+    std::vector<watcher_ptr> watchers;
+    watchers.reserve(this->_child_processes.size());
+    for (const auto& pair : this->_child_processes) { watchers.emplace_back(pair.second); }
+    for (auto& w : watchers) {
+        try {
+            w->reap();
+        } catch (const sys::bad_call& err) {
+            if (err.errc() != std::errc::no_child_process) { log_error(err); }
         }
     }
 }
 
-void sbnd::process_pipeline::wait_for_processes(lock_type& lock) {
+void sbnd::process_pipeline::wait_for_processes() {
+    while (!this->_child_processes.empty()) {
+        auto w = this->_child_processes.begin()->second;
+        const auto pid = w->id();
+        try {
+            sys::process_status status;
+            { auto g = unguard(); status = w->process().wait(); }
+            w->state(sbn::connection::states::stopped);
+            on_process_exit(pid, status);
+        } catch (const sys::bad_call& err) {
+            if (err.errc() != std::errc::no_child_process) { log_error(err); }
+        }
+        this->_child_processes.erase(pid);
+    }
+}
+
+void sbnd::process_pipeline::on_process_exit(sys::pid_type pid, sys::process_status status) {
+    this->_child_processes.erase(pid);
+    auto result = this->find_by_process_id(pid);
+    if (result == this->_jobs.end()) { return; }
+    this->log("app exited: app=_,_", result->first, status);
+    auto application_id = result->first;
+    { sbn::kernel_sack sack; result->second->clear(sack); }
+    this->_num_completed_kernels += result->second->num_completed_kernels();
+    this->_jobs.erase(result);
+    release_shared_objects(application_id);
+    if (!native_pipeline()) { return; }
+    for (auto* target : this->_listeners) {
+        auto k = sbn::make_pointer<process_pipeline_kernel>();
+        k->application_id(application_id);
+        k->event(process_pipeline_event::child_process_terminated);
+        k->status(status);
+        k->principal(target);
+        k->phase(sbn::kernel::phases::point_to_point);
+        send_native(std::move(k));
+    }
+}
+
+void sbnd::process_pipeline::release_shared_objects(application_id_type id) {
+    if (!this->_shared_objects) { return; }
     try {
-        this->_child_processes.wait(lock,
-            [this] (const sys::process& p, sys::process_status status) {
-                auto result = this->find_by_process_id(p.id());
-                if (result == this->_jobs.end()) { return; }
-                this->log("app exited: app=_,_", result->first, status);
-                //result->second->close();
-                auto application_id = result->first;
-                { sbn::kernel_sack sack; result->second->clear(sack); }
-                this->_jobs.erase(result);
-                if (!native_pipeline()) { return; }
-                for (auto* target : this->_listeners) {
-                    auto k = sbn::make_pointer<process_pipeline_kernel>();
-                    k->application_id(application_id);
-                    k->event(process_pipeline_event::child_process_terminated);
-                    k->status(status);
-                    k->principal(target);
-                    k->phase(sbn::kernel::phases::point_to_point);
-                    send_native(std::move(k));
-                }
-            }
-        );
-    } catch (const sys::bad_call& err) {
-        if (err.errc() != std::errc::no_child_process) { log_error(err); }
+        const auto n = this->_shared_objects->release(id);
+        if (n != 0) { log("removed _ shared objects of app _", n, id); }
+    } catch (const std::exception& err) {
+        log("failed to remove shared objects of app _: _", id, err.what());
     }
 }
 
+size_t sbnd::process_pipeline::num_completed_kernels() const noexcept {
+    auto sum = this->_num_completed_kernels;
+    for (const auto& pair : this->_jobs) { sum += pair.second->num_completed_kernels(); }
+    return sum;
+}
+
 typename sbnd::process_pipeline::app_iterator
 sbnd::process_pipeline::find_by_process_id(sys::pid_type pid) {
     Expects(pid > 0);
@@ -270,16 +488,31 @@ sbnd::process_pipeline::find_by_process_id(sys::pid_type pid) {
 
 void sbnd::process_pipeline::clear(sbn::kernel_sack& sack) {
     sbn::basic_socket_pipeline::clear(sack);
-    while (!this->_outstanding_kernels.empty()) {
-        auto* k = this->_outstanding_kernels.front().release();
-        k->mark_as_deleted(sack);
-        this->_outstanding_kernels.pop_front();
-    }
+    this->_outstanding.clear(sack);
 }
 
 sbnd::process_pipeline::process_pipeline(const properties& p):
 sbn::basic_socket_pipeline{p}, _pipe_buffer_size{p.pipe_buffer_size},
-_allowroot{p.allow_root}, _interleave{p.interleave} {}
+_kernel_timeout{std::chrono::duration_cast<duration>(p.kernel_timeout)},
+_allowroot{p.allow_root}, _interleave{p.interleave}, _pidfd{p.pidfd} {
+    this->_outstanding.quantum(p.quantum);
+    this->_outstanding.max_bypassed(p.max_bypassed);
+    init_signal_handler();
+}
+
+sbnd::process_pipeline::process_pipeline() {
+    init_signal_handler();
+}
+
+void sbnd::process_pipeline::init_signal_handler() {
+    if (this->_pidfd && pidfd_supported()) { return; }
+    auto ptr = std::make_shared<child_signal_handler>();
+    ptr->parent(this);
+    ptr->name(this->_name);
+    ptr->state(sbn::connection::states::started);
+    emplace_handler(sys::epoll_event(ptr->fd(), sys::event::in), ptr);
+    this->_signal_handler = std::move(ptr);
+}
 
 bool sbnd::process_pipeline::properties::set(const char* key, const std::string& value) {
     bool found = true;
@@ -290,6 +523,15 @@ bool sbnd::process_pipeline::properties::set(const char* key, const std::string&
         allow_root = sbn::string_to_bool(value);
     } else if (std::strcmp(key, "interleave") == 0) {
         interleave = sbn::string_to_bool(value);
+    } else if (std::strcmp(key, "pidfd") == 0) {
+        pidfd = sbn::string_to_bool(value);
+    } else if (std::strcmp(key, "quantum") == 0) {
+        quantum = std::stoul(value);
+        if (quantum.get() == 0) { throw std::invalid_argument("zero quantum"); }
+    } else if (std::strcmp(key, "max-bypassed") == 0) {
+        max_bypassed = std::stoul(value);
+    } else if (std::strcmp(key, "kernel-timeout") == 0) {
+        kernel_timeout = sbn::string_to_duration(value);
     } else {
         found = false;
     }
@@ -301,12 +543,10 @@ void sbnd::process_pipeline::write(std::ostream& out) const {
     using sbn::list;
     using sbn::make_list_view;
     std::vector<sys::pid_type> pids;
-    {
-        size_t n = this->_child_processes.size();
-        for (size_t i=0; i<n; ++i) {
-            pids.emplace_back(this->_child_processes[i].id());
-        }
-    }
-    out << ' ' << list("outstanding-kernels", make_list_view(this->_outstanding_kernels));
+    pids.reserve(this->_child_processes.size());
+    for (const auto& pair : this->_child_processes) { pids.emplace_back(pair.first); }
+    this->_outstanding.write(out);
     out << ' ' << list("child-processes", make_list_view(pids));
+    out << ' ' << list("returned-kernels", this->_num_returned_kernels);
+    out << ' ' << list("completed-kernels", num_completed_kernels());
 }
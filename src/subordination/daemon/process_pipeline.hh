@@ -1,16 +1,18 @@
 #ifndef SUBORDINATION_DAEMON_PROCESS_PIPELINE_HH
 #define SUBORDINATION_DAEMON_PROCESS_PIPELINE_HH
 
-#include <deque>
 #include <memory>
 #include <unordered_map>
 
+#include <unistdx/io/fildes>
 #include <unistdx/ipc/process>
-#include <unistdx/ipc/process_group>
 
 #include <subordination/core/application.hh>
 #include <subordination/core/basic_socket_pipeline.hh>
 #include <subordination/core/process_handler.hh>
+#include <subordination/core/properties.hh>
+#include <subordination/core/shared_object.hh>
+#include <subordination/daemon/admission_queue.hh>
 
 namespace sbnd {
 
@@ -42,6 +44,72 @@ namespace sbnd {
 
     };
 
+    class process_pipeline;
+
+    /**
+    Block SIGCHLD in the calling thread. Call it in the main thread before
+    any other thread is created: the threads inherit the signal mask, and
+    the signal is delivered only through \link child_signal_handler\endlink.
+    */
+    void block_child_signal();
+
+    /**
+    \brief Event handler that is notified when the child process terminates.
+    \details
+    The handler listens on process file descriptor (pidfd) if the kernel supports it,
+    otherwise the pipeline falls back to the single \link child_signal_handler\endlink.
+    */
+    class child_process_watcher: public sbn::connection {
+
+    private:
+        sys::process _process;
+        sys::fildes _fd;
+
+    public:
+        /// \param pidfd listen on process file descriptor if the kernel supports it
+        child_process_watcher(sys::process&& p, bool pidfd);
+
+        void handle(const sys::epoll_event& event) override;
+        void stop() override {}
+        void write(std::ostream& out) const override;
+
+        /// Reap the child process if it has terminated.
+        bool reap();
+
+        inline const sys::process& process() const noexcept { return this->_process; }
+        inline sys::process& process() noexcept { return this->_process; }
+        inline sys::pid_type id() const noexcept { return this->_process.id(); }
+        inline sys::fd_type fd() const noexcept { return this->_fd.fd(); }
+        inline bool has_fd() const noexcept { return bool(this->_fd); }
+
+        using connection::parent;
+        inline process_pipeline* parent() const noexcept {
+            return reinterpret_cast<process_pipeline*>(this->connection::parent());
+        }
+
+    };
+
+    /// Reaps child processes on SIGCHLD when pidfd is not supported.
+    class child_signal_handler: public sbn::connection {
+
+    private:
+        sys::fildes _fd;
+
+    public:
+        child_signal_handler();
+
+        void handle(const sys::epoll_event& event) override;
+        void stop() override {}
+
+        inline sys::fd_type fd() const noexcept { return this->_fd.fd(); }
+
+        using connection::parent;
+        inline process_pipeline* parent() const noexcept {
+            return reinterpret_cast<process_pipeline*>(this->connection::parent());
+        }
+
+    };
+
     class process_pipeline: public sbn::basic_socket_pipeline {
 
     public:
@@ -49,6 +117,14 @@ namespace sbnd {
             size_t pipe_buffer_size;
             bool allow_root = false;
             bool interleave = false;
+            /// The no. of threads added to application's deficit in each round.
+            sbn::weight_type quantum = 1;
+            /// The no. of kernels that may bypass the kernels that do not fit.
+            size_t max_bypassed = 16;
+            /// How long outstanding kernels wait for the resources.
+            sbn::Duration kernel_timeout = std::chrono::minutes(1);
+            /// Reap child processes via pidfd if the kernel supports it.
+            bool pidfd = true;
 
             inline properties():
             properties{sys::this_process::cpus(), sys::page_size()} {}
@@ -67,31 +143,42 @@ namespace sbnd {
         using application_id_type = sbn::application::id_type;
         using application_table = std::unordered_map<application_id_type,connection_ptr>;
         using app_iterator = typename application_table::iterator;
-        using kernel_queue = std::deque<sbn::kernel_ptr>;
+        using watcher_ptr = std::shared_ptr<child_process_watcher>;
+        using process_table = std::unordered_map<sys::pid_type,watcher_ptr>;
+        using signal_handler_ptr = std::shared_ptr<child_signal_handler>;
 
     private:
-        std::thread _waiting_thread;
         application_table _jobs;
-        sys::process_group _child_processes;
+        process_table _child_processes;
+        signal_handler_ptr _signal_handler;
         pipeline* _unix{};
+        /// The objects of the applications are removed when they exit.
+        sbn::shared_object_store* _shared_objects = nullptr;
         size_t _pipe_buffer_size = 4096UL*16UL;
         /// How long a child process lives without receiving/sending kernels.
         duration _timeout;
-        kernel_queue _outstanding_kernels;
+        /// Kernels that wait for the resources.
+        admission_queue _outstanding;
         /** How long outstanding kernels can wait for the resources. When
         the time runs out, the kernel is sent back to the source cluster
-        node. */
-        duration _kernel_timeout;
+        node. Zero timeout disables the check. */
+        duration _kernel_timeout = std::chrono::minutes(1);
+        /// The no. of kernels returned to the source node after the timeout.
+        size_t _num_returned_kernels = 0;
+        /// The no. of kernels completed by child processes that have exited.
+        size_t _num_completed_kernels = 0;
         unsigned _max_threads = sys::thread_concurrency();
         /// Allow process execution as superuser/supergroup.
         bool _allowroot = true;
         /// Interleave kernels from different applications.
         bool _interleave = false;
+        /// Reap child processes via pidfd if the kernel supports it.
+        bool _pidfd = true;
 
     public:
 
         explicit process_pipeline(const properties& p);
-        process_pipeline() = default;
+        process_pipeline();
         ~process_pipeline() = default;
         process_pipeline(const process_pipeline&) = delete;
         process_pipeline& operator=(const process_pipeline&) = delete;
@@ -109,9 +196,18 @@ namespace sbnd {
         void loop() override;
         void forward(sbn::kernel_ptr&& hdr) override;
 
+        /**
+        Return the outstanding kernel that was cancelled on the source node
+        with \link sbn::exit_code::cancelled\endlink exit code and send the
+        notice to the child processes that execute the kernel.
+        */
+        void cancel(const sbn::kernel& notice) override;
+
         inline void pipe_buffer_size(size_t rhs) noexcept { this->_pipe_buffer_size = rhs; }
         inline void allow_root(bool rhs) noexcept { this->_allowroot = rhs; }
         inline void interleave(bool rhs) noexcept { this->_interleave = rhs; }
+        inline void quantum(sbn::weight_type rhs) noexcept { this->_outstanding.quantum(rhs); }
+        inline void max_bypassed(size_t rhs) noexcept { this->_outstanding.max_bypassed(rhs); }
         inline void timeout(duration rhs) noexcept { this->_timeout = rhs; }
         inline void kernel_timeout(duration rhs) noexcept { this->_kernel_timeout = rhs; }
 
@@ -119,8 +215,30 @@ namespace sbnd {
             return this->_jobs;
         }
 
+        /// The no. of child processes that were not reaped yet.
+        inline size_t num_child_processes() const noexcept {
+            return this->_child_processes.size();
+        }
+
+        inline size_t num_returned_kernels() const noexcept {
+            return this->_num_returned_kernels;
+        }
+
+        /// The no. of kernels that wait for the resources.
+        inline size_t num_outstanding_kernels() const noexcept {
+            return this->_outstanding.size();
+        }
+
+        /// The no. of kernels completed by all child processes since the start.
+        size_t num_completed_kernels() const noexcept;
+
         inline pipeline* unix() const noexcept { return this->_unix; }
         inline void unix(pipeline* rhs) noexcept { this->_unix = rhs; }
+
+        inline void shared_objects(sbn::shared_object_store* rhs) noexcept {
+            this->_shared_objects = rhs;
+        }
+
         inline void max_threads(unsigned rhs) noexcept { this->_max_threads = rhs; }
 
         void clear(sbn::kernel_sack& sack);
@@ -130,19 +248,33 @@ namespace sbnd {
 
         void process_kernels() override;
         void process_connections() override;
+        time_point next_wakeup_time_point() const noexcept override;
 
     private:
 
         app_iterator do_add(const sbn::application& app);
         void do_forward(sbn::kernel_ptr&& k);
         void process_kernel(sbn::kernel_ptr&& k);
-        void wait_loop();
-        void wait_for_processes(lock_type& lock);
+        void enqueue(sbn::kernel_ptr&& k);
+        void admit_kernels();
+        void return_expired_kernels();
+        bool return_to_source(sbn::kernel_ptr& k, sbn::exit_code ret);
+        /// \return true if the kernel came from another cluster node and can be returned there
+        static bool returnable(const sbn::kernel& k) noexcept;
+        const sbn::application* find_application(const sbn::kernel& k) const;
+        void watch(sys::process&& p);
+        void reap_child_processes();
+        void wait_for_processes();
+        void on_process_exit(sys::pid_type pid, sys::process_status status);
+        void init_signal_handler();
         void terminate(sys::pid_type id);
+        void release_shared_objects(application_id_type id);
 
         app_iterator find_by_process_id(sys::pid_type pid);
 
         friend class process_handler;
+        friend class child_process_watcher;
+        friend class child_signal_handler;
 
         inline sbn::weight_array total_load() const noexcept {
             sbn::weight_array sum;
@@ -162,7 +294,10 @@ namespace sbnd {
             return w[0]*this->_max_threads + w[1];
         }
 
-        void do_process_kernels(kernel_queue& kernels, sbn::weight_array& current_load);
+        inline bool fits(const sbn::weight_array& new_load) const noexcept {
+            return (!this->_interleave && this->_jobs.size() == 1) ||
+                num_threads_used(new_load) < this->_max_threads;
+        }
 
     };
 
@@ -117,6 +117,7 @@ void terminate_test(int) { sbn::exit(0); }
 
 #if defined(SUBORDINATION_TEST_DAEMON)
 int main(int argc, char* argv[]) {
+    sbnd::block_child_signal();
     sbn::install_error_handler();
     sys::this_process::bind_signal(sys::signal::user_defined_1, terminate_test);
     sbn::application app({SBN_TEST_APP_EXE_PATH}, {});
@@ -1,5 +1,6 @@
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -233,6 +234,8 @@ public:
 private:
     string_array _arguments;
     resource_expression_ptr _node_filter;
+    sbn::application::priority_type _priority = 0;
+    sbn::application::share_type _share = 1;
     bool _test_recovery = false;
 
 public:
@@ -249,6 +252,23 @@ public:
                     if (i == argc) { throw std::invalid_argument("expected resource expression"); }
                     auto n = t::length(argv[i]);
                     this->_node_filter = sbn::resources::read(argv[i], argv[i]+n, 10);
+                } else if (arg == "-p") {
+                    ++i;
+                    if (i == argc) { throw std::invalid_argument("expected priority"); }
+                    auto p = std::stoul(argv[i]);
+                    if (p > std::numeric_limits<sbn::application::priority_type>::max()) {
+                        throw std::invalid_argument("priority is too large");
+                    }
+                    this->_priority = p;
+                } else if (arg == "-s") {
+                    ++i;
+                    if (i == argc) { throw std::invalid_argument("expected share"); }
+                    auto s = std::stoul(argv[i]);
+                    if (s == 0) { throw std::invalid_argument("zero share"); }
+                    if (s > std::numeric_limits<sbn::application::share_type>::max()) {
+                        throw std::invalid_argument("share is too large");
+                    }
+                    this->_share = s;
                 } else {
                     state = Args;
                 }
@@ -300,6 +320,8 @@ private:
     sbn::kernel_ptr make_application_kernel() {
         auto* app = new sbn::application(std::move(this->_arguments), make_environment());
         app->working_directory(sys::canonical_path("."));
+        app->priority(this->_priority);
+        app->share(this->_share);
         auto k = sbn::make_pointer<sbnd::Foreign_main_kernel>();
         k->target_application(app);
         //k->source_application_id(app->id());
@@ -310,6 +332,8 @@ private:
     sbn::kernel_ptr make_transaction_test_kernel() {
         sbn::application app(std::move(this->_arguments), make_environment());
         app.working_directory(sys::canonical_path("."));
+        app.priority(this->_priority);
+        app.share(this->_share);
         auto k = sbn::make_pointer<sbnd::Transaction_test_kernel>(std::move(app));
         k->target_application(0);
         k->destination(sys::socket_address(SBND_SOCKET));
@@ -490,7 +514,7 @@ public:
 void usage(std::ostream& out, char**) {
     out << "usage: "
         "sbnc [-h] [--help] [--version]\n"
-        "sbnc submit [-T] [-r node-filter] [arguments...]\n"
+        "sbnc submit [-T] [-r node-filter] [-p priority] [-s share] [arguments...]\n"
         "sbnc status [-t entity-type] [-o output-format]\n"
         "sbnc cancel [-t entity-type] [-o output-format] application ids...\n"
         "-t type            entity type (node, job, kernel)\n"
@@ -499,6 +523,8 @@ void usage(std::ostream& out, char**) {
         "-h                 usage\n"
         "-T                 test an ability to recover from power failure\n"
         "-r expression      node selector expression\n"
+        "-p priority        application priority (0-255, higher goes first)\n"
+        "-s share           relative share of node threads among applications\n"
         "arguments...       a command with arguments to run\n";
 }
 
@@ -16,6 +16,7 @@
 #include <subordination/daemon/main.hh>
 #include <subordination/daemon/main_kernel.hh>
 #include <subordination/daemon/pipeline_status_kernel.hh>
+#include <subordination/daemon/shared_object_kernel.hh>
 #include <subordination/daemon/status_kernel.hh>
 #include <subordination/daemon/terminate_kernel.hh>
 #include <subordination/daemon/transaction_test_kernel.hh>
@@ -82,6 +83,7 @@ int real_main(int argc, char* argv[]) {
     factory.types().add<Transaction_gather_subordinate>(7);
     factory.types().add<Job_status_kernel>(8);
     factory.types().add<Pipeline_status_kernel>(9);
+    factory.types().add<shared_object_kernel>(10);
     Properties props;
     props.read(argc, argv);
     if (props.discover.profile) {
@@ -104,6 +106,7 @@ int real_main(int argc, char* argv[]) {
             }
             if (factory.isset(factory_flags::remote)) {
                 factory.remote().add_listener(k.get());
+                factory.remote().shared_object_handler(k.get());
             }
             factory.local().send(std::move(k));
         }
@@ -133,6 +136,8 @@ int real_main(int argc, char* argv[]) {
 }
 
 int main(int argc, char* argv[]) {
+    // before any thread is created
+    sbnd::block_child_signal();
     try {
         return real_main(argc, argv);
     } catch (const std::exception& err) {
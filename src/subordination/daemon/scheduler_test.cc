@@ -0,0 +1,53 @@
+#include <chrono>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <subordination/daemon/socket_pipeline.hh>
+
+namespace {
+
+    using client_ptr = sbnd::socket_pipeline_scheduler::client_ptr;
+
+    inline client_ptr
+    make_client(sys::ipv4_address a, sbnd::socket_pipeline_client::duration interval,
+                sbn::weight_type num_kernels) {
+        client_ptr c(new sbnd::socket_pipeline_client);
+        c->socket_address(sys::ipv4_socket_address{a, 33333});
+        c->state(sbn::connection::states::started);
+        c->completion_interval(interval);
+        c->load() = sbn::weight_array{0u, num_kernels};
+        return c;
+    }
+
+}
+
+TEST(socket_pipeline_scheduler, deadline) {
+    using std::chrono::milliseconds;
+    using std::chrono::seconds;
+    sbnd::socket_pipeline_scheduler scheduler;
+    scheduler.local(false);
+    // the fast neighbour has more kernels in flight
+    auto fast = make_client({10,0,0,2}, milliseconds(1), 4);
+    auto slow = make_client({10,0,0,3}, seconds(10), 0);
+    sbnd::socket_pipeline_scheduler::client_table clients;
+    clients.emplace(fast->socket_address(), fast);
+    clients.emplace(slow->socket_address(), slow);
+    sbnd::socket_pipeline_scheduler::server_array servers;
+    sbn::kernel k;
+    // the less loaded neighbour is chosen for the kernel without deadline
+    auto result = scheduler.schedule(&k, clients, servers);
+    ASSERT_NE(clients.end(), result);
+    EXPECT_EQ(slow->socket_address(), result->first);
+    // the neighbour that is expected to finish the kernel in time is preferred
+    const auto now = sbn::kernel::clock_type::now();
+    k.deadline(now + seconds(1));
+    result = scheduler.schedule(&k, clients, servers);
+    ASSERT_NE(clients.end(), result);
+    EXPECT_EQ(fast->socket_address(), result->first);
+    // the load decides when no neighbour finishes the kernel in time
+    k.deadline(now - seconds(1));
+    result = scheduler.schedule(&k, clients, servers);
+    ASSERT_NE(clients.end(), result);
+    EXPECT_EQ(slow->socket_address(), result->first);
+}
@@ -0,0 +1,17 @@
+#include <subordination/core/kernel_buffer.hh>
+#include <subordination/daemon/shared_object_kernel.hh>
+
+void sbnd::shared_object_kernel::write(sbn::kernel_buffer& out) const {
+    kernel::write(out);
+    const sys::u64 n = this->_data.size();
+    out << this->_object_id << n;
+    out.write(this->_data.data(), n);
+}
+
+void sbnd::shared_object_kernel::read(sbn::kernel_buffer& in) {
+    kernel::read(in);
+    sys::u64 n = 0;
+    in >> this->_object_id >> n;
+    this->_data.resize(n);
+    if (n != 0) { in.read(&this->_data[0], n); }
+}
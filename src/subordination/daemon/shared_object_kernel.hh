@@ -0,0 +1,37 @@
+#ifndef SUBORDINATION_DAEMON_SHARED_OBJECT_KERNEL_HH
+#define SUBORDINATION_DAEMON_SHARED_OBJECT_KERNEL_HH
+
+#include <string>
+
+#include <subordination/core/kernel.hh>
+#include <subordination/core/shared_object.hh>
+
+namespace sbnd {
+
+    /**
+    \brief Request for the shared object that is sent to the neighbour
+    and the reply that carries the contents of the object.
+    */
+    class shared_object_kernel: public sbn::service_kernel {
+
+    private:
+        sbn::shared_object_id _object_id = 0;
+        std::string _data;
+
+    public:
+
+        shared_object_kernel() = default;
+        inline explicit shared_object_kernel(sbn::shared_object_id id): _object_id(id) {}
+
+        inline sbn::shared_object_id object_id() const noexcept { return this->_object_id; }
+        inline const std::string& data() const noexcept { return this->_data; }
+        inline void data(std::string&& rhs) noexcept { this->_data = std::move(rhs); }
+
+        void read(sbn::kernel_buffer& in) override;
+        void write(sbn::kernel_buffer& out) const override;
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -6,8 +6,10 @@
 #include <unistdx/net/socket>
 
 #include <subordination/core/factory.hh>
+#include <subordination/core/foreign_kernel.hh>
 #include <subordination/core/kernel_instance_registry.hh>
 #include <subordination/core/list.hh>
+#include <subordination/daemon/shared_object_kernel.hh>
 #include <subordination/daemon/socket_pipeline.hh>
 
 /*
@@ -58,6 +60,12 @@ void sbnd::socket_pipeline_server::remove(const connection_ptr&) {
     parent()->remove_server(this->_ifaddr);
 }
 
+auto sbnd::string_to_scheduling_policy(const std::string& s) -> scheduling_policies {
+    if (s == "load") { return scheduling_policies::load; }
+    if (s == "idle") { return scheduling_policies::idle; }
+    throw std::invalid_argument("bad scheduling policy");
+}
+
 void sbnd::socket_pipeline_scheduler::rebase_counters(const client_table& clients) {
     // find minimum counter value
     auto min_load = local_load();
@@ -75,6 +83,76 @@ void sbnd::socket_pipeline_scheduler::rebase_counters(const client_table& client
     this->_local_load -= min_load;
 }
 
+void sbnd::socket_pipeline_scheduler::object_location(sbn::shared_object_id id,
+                                                      const sys::socket_address& address) {
+    auto result = this->_object_locations.find(id);
+    if (result != this->_object_locations.end()) {
+        result->second = address;
+        return;
+    }
+    this->_object_locations.emplace(id, address);
+    this->_object_location_order.emplace_back(id);
+    // forget the oldest locations
+    while (this->_object_location_order.size() > this->_max_object_locations) {
+        this->_object_locations.erase(this->_object_location_order.front());
+        this->_object_location_order.pop_front();
+    }
+}
+
+auto sbnd::socket_pipeline_scheduler::object_location(sbn::shared_object_id id) const
+-> sys::socket_address {
+    auto result = this->_object_locations.find(id);
+    if (result == this->_object_locations.end()) { return sys::socket_address(); }
+    return result->second;
+}
+
+auto sbnd::socket_pipeline_scheduler::relative_load(const socket_pipeline_client& c) const noexcept
+-> sbn::modular_weight_array {
+    if (this->_policy == scheduling_policies::idle) { return c.observed_relative_load(); }
+    return c.relative_load();
+}
+
+bool sbnd::socket_pipeline_scheduler::better(const socket_pipeline_client& a,
+                                             const socket_pipeline_client& b,
+                                             const sbn::kernel& k,
+                                             time_point now) const noexcept {
+    if (k.has_deadline()) {
+        // prefer the node that is expected to finish the kernel in time
+        const bool a_in_time = a.expected_completion(now) <= k.deadline();
+        const bool b_in_time = b.expected_completion(now) <= k.deadline();
+        if (a_in_time != b_in_time) { return a_in_time; }
+    }
+    return less_loaded(a, b);
+}
+
+bool sbnd::socket_pipeline_scheduler::less_loaded(const socket_pipeline_client& a,
+                                                  const socket_pipeline_client& b) const noexcept {
+    const auto& load_a = relative_load(a);
+    const auto& load_b = relative_load(b);
+    if (load_a < load_b) { return true; }
+    // prefer the node with more free memory if the loads are equal
+    return this->_policy == scheduling_policies::idle && !(load_b < load_a) &&
+        b.free_memory_behind() < a.free_memory_behind();
+}
+
+auto sbnd::socket_pipeline_scheduler::least_loaded(const sbn::kernel& k,
+                                                   const client_table& clients,
+                                                   const sys::socket_address& except) const
+-> client_iterator {
+    auto last = clients.end(), result = last;
+    const auto* node_filter = k.node_filter();
+    const auto now = sbn::kernel::clock_type::now();
+    for (auto first=clients.begin(); first != last; ++first) {
+        const auto& address = first->first;
+        const auto& client = *first->second;
+        if (client.state() != sbn::connection::states::started) { continue; }
+        if (address == except || address == k.source()) { continue; }
+        if (node_filter && !client.match(*node_filter)) { continue; }
+        if (result == last || better(client, *result->second, k, now)) { result = first; }
+    }
+    return result;
+}
+
 auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
                                                const client_table& clients,
                                                const server_array& servers)
@@ -122,7 +200,19 @@ auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
         }
         if (fs) { fs->locate(path.data(), this->_nodes); }
     }
-    const bool file_is_local = [&] () -> bool {
+    // prefer the nodes that hold the shared objects referenced by the kernel
+    // (the kernel stays on this node only if it does not need to fetch any of them)
+    bool objects_are_local = !k->shared_objects().empty();
+    for (auto id : k->shared_objects()) {
+        if (this->_shared_objects && this->_shared_objects->contains(id)) { continue; }
+        objects_are_local = false;
+        const auto address = object_location(id);
+        if (address && std::find(this->_nodes.begin(), this->_nodes.end(), address) ==
+            this->_nodes.end()) {
+            this->_nodes.emplace_back(address);
+        }
+    }
+    const bool file_is_local = objects_are_local || [&] () -> bool {
         for (const auto& address : this->_nodes) {
             for (const auto& server : servers) {
                 if (server->socket_address() == address) {
@@ -133,6 +223,7 @@ auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
         return false;
     }();
     auto node_filter = k->node_filter();
+    const auto now = sbn::kernel::clock_type::now();
     bool node_filter_local_matches = true;
     if (node_filter && !node_filter->evaluate(this->_local_resources).boolean()) {
         node_filter_local_matches = false;
@@ -159,20 +250,21 @@ auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
         } else {
             if (result == last) {
                 if (!local() || k->carries_parent() ||
-                    client.relative_load() <= local_relative_load() ||
+                    relative_load(client) <= local_relative_load() ||
                     !node_filter_local_matches) {
                     result = first;
                 } else {
                     log("neighbour skip (local is better) _ relative-load _ local-relative-load _ load _",
-                        client.socket_address(), client.relative_load(), local_relative_load(),
+                        client.socket_address(), relative_load(client), local_relative_load(),
                         client.load());
                 }
             } else {
-                if (client.relative_load() < result->second->relative_load()) {
+                if (better(client, *result->second, *k, now)) {
                     result = first;
                 } else {
                     log("neighbour skip (previous is better) _ relative-load _ local-load _",
-                        client.socket_address(), client.relative_load(), result->second->relative_load());
+                        client.socket_address(), relative_load(client),
+                        relative_load(*result->second));
                 }
             }
         }
@@ -187,7 +279,7 @@ auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
             if (result_with_nodes == last) {
                 result_with_nodes = first;
             } else {
-                if (client.relative_load() < result_with_nodes->second->relative_load()) {
+                if (better(client, *result_with_nodes->second, *k, now)) {
                     result_with_nodes = first;
                 }
             }
@@ -196,7 +288,7 @@ auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
     // prefer nodes where associated file is located
     if (result_with_nodes != last) {
         auto& client = *result_with_nodes->second;
-        if (file_is_local && local_relative_load() < client.relative_load()) {
+        if (file_is_local && local_relative_load() < relative_load(client)) {
             result = last;
         } else {
             result = result_with_nodes;
@@ -213,7 +305,7 @@ auto sbnd::socket_pipeline_scheduler::schedule(sbn::kernel* k,
         //client->num_kernels_increment(k->weight());
         log("neighbour _ load _ local-load _ relative-load _ local-relative-load _ path _ nodes_",
             client->socket_address(), client->load(), local_load(),
-            client->relative_load(), local_relative_load(), path, tmp.str());
+            relative_load(*client), local_relative_load(), path, tmp.str());
     } else {
         // If the local node does not have the required resources,
         // return the kernel to its parent.
@@ -270,6 +362,7 @@ void sbnd::socket_pipeline::remove_server(server_iterator result) {
     // copy interface_address
     interface_address interface_address = (*result)->interface_address();
     this->_servers.erase(result);
+    this->_tree_neighbours.erase(interface_address);
     fire_event_kernels(socket_pipeline_event::remove_server, interface_address);
 }
 
@@ -292,6 +385,7 @@ void sbnd::socket_pipeline::remove_client(client_iterator result) {
     this->log("remove client _ (_)", socket_address, reason);
     #endif
     result->second->state(sbn::connection::states::stopped);
+    this->_speculation.neighbour_failed(socket_address);
     this->_clients.erase(result);
     fire_event_kernels(socket_pipeline_event::remove_client, socket_address);
 }
@@ -319,24 +413,21 @@ void sbnd::socket_pipeline::forward(sbn::kernel_ptr&& k) {
     log("forward _", *k);
     switch (k->phase()) {
         case sbn::kernel::phases::upstream:
-            {
-                auto client = this->_scheduler.schedule(k.get(), this->_clients, this->_servers);
-                if (client == this->_clients.end()) {
-                    if (k->carries_parent()) {
-                        log("warning, sending a kernel carrying parent to local pipeline _", *k);
-                    }
-                    forward_foreign(std::move(k));
-                } else {
-                    //ensure_identity(k.get(), address);
-                    //#if defined(SBN_DEBUG)
-                    std::stringstream tmp;
-                    for (const auto& pair : this->_clients) { tmp << pair.first << ' '; }
-                    log("fwd _ to _ clients (_)", *k, client->first, tmp.str());
-                    //#endif
-                    client->second->forward(std::move(k));
+            if (bool(k->flags() & sbn::kernel_flag::send_to_subordinate_node)) {
+                // Collective kernels are copied along the edges of the hierarchy:
+                // the copy goes to the neighbour that was chosen by the sender,
+                // the original is executed on this node.
+                if (k->destination()) {
+                    auto ptr = find_or_create_client(k->destination());
+                    ptr->forward(std::move(k));
                     this->_semaphore.notify_one();
+                } else {
+                    k->neighbours(tree_neighbours());
+                    forward_foreign(std::move(k));
                 }
+                break;
             }
+            forward_upstream(std::move(k), true);
             break;
         case sbn::kernel::phases::downstream:
         case sbn::kernel::phases::point_to_point:
@@ -363,6 +454,45 @@ void sbnd::socket_pipeline::forward(sbn::kernel_ptr&& k) {
     }
 }
 
+void sbnd::socket_pipeline::forward_upstream(sbn::kernel_ptr&& k, bool fetch_shared_objects) {
+    const bool speculate = this->_speculation.eligible(*k);
+    if (speculate && this->_speculation.duplicate(*k)) {
+        // the kernel was recovered from the failed neighbour,
+        // but the other copy is still running or has already returned
+        log("drop duplicate _", *k);
+        return;
+    }
+    auto client = this->_scheduler.schedule(k.get(), this->_clients, this->_servers);
+    if (fetch_shared_objects && !k->shared_objects().empty()) {
+        // The objects that are not on this node are fetched before the kernel
+        // is executed, unless the kernel is sent in the direction of the objects.
+        const bool local = client == this->_clients.end();
+        const auto target = local ? hold_targets::local : hold_targets::schedule;
+        const auto except = local ? sys::socket_address() : client->second->socket_address();
+        if (wait_for_shared_objects(k, target, except)) { return; }
+    }
+    if (client == this->_clients.end()) {
+        if (k->carries_parent()) {
+            log("warning, sending a kernel carrying parent to local pipeline _", *k);
+        }
+        forward_foreign(std::move(k));
+    } else {
+        //ensure_identity(k.get(), address);
+        //#if defined(SBN_DEBUG)
+        std::stringstream tmp;
+        for (const auto& pair : this->_clients) { tmp << pair.first << ' '; }
+        log("fwd _ to _ clients (_)", *k, client->first, tmp.str());
+        //#endif
+        // the kernel is saved in the upstream queue of the client
+        auto* ptr = k.get();
+        client->second->forward(std::move(k));
+        if (speculate) {
+            this->_speculation.start(*ptr, client->first, sbnd::speculation::clock_type::now());
+        }
+        this->_semaphore.notify_one();
+    }
+}
+
 auto sbnd::socket_pipeline::find_server(const interface_address& interface_address)
 -> server_iterator {
     typedef typename server_array::value_type value_type;
@@ -494,6 +624,58 @@ void sbnd::socket_pipeline::process_kernel(sbn::kernel_ptr& k) {
     }
 }
 
+void sbnd::socket_pipeline::process_connections() {
+    // the copies are written to the buffers before they are flushed
+    speculate();
+    basic_socket_pipeline::process_connections();
+}
+
+void sbnd::socket_pipeline::speculate() {
+    const auto now = sbnd::speculation::clock_type::now();
+    if (!this->_speculation.enabled() || !this->_speculation.due(now)) { return; }
+    // the upstream queue of each neighbour is scanned only once
+    std::unordered_map<sys::socket_address,sbnd::speculation::key_array> stragglers;
+    for (const auto& key : this->_speculation.stragglers(now)) {
+        stragglers[this->_speculation.neighbour(key)].emplace_back(key);
+    }
+    for (const auto& pair : stragglers) {
+        const auto& original = pair.first;
+        const auto& keys = pair.second;
+        auto result = this->_clients.find(original);
+        if (result == this->_clients.end()) { continue; }
+        auto copies = result->second->copy_upstream(keys);
+        for (size_t i=0; i<keys.size(); ++i) {
+            auto& k = copies[i];
+            if (!k) { this->_speculation.erase(keys[i]); continue; }
+            auto other = this->_scheduler.least_loaded(*k, this->_clients, original);
+            if (other == this->_clients.end()) { continue; }
+            log("speculate _ sent to _ copy to _", *k, original, other->first);
+            other->second->forward(std::move(k));
+            this->_speculation.copy(keys[i], other->first, now);
+        }
+    }
+}
+
+bool sbnd::socket_pipeline::finish_speculation(const sbn::kernel& k) {
+    if (!this->_speculation.enabled()) { return true; }
+    using r = sbnd::speculation::results;
+    sys::socket_address other;
+    switch (this->_speculation.finish(k, sbnd::speculation::clock_type::now(), other)) {
+        case r::deliver:
+            break;
+        case r::deliver_first: {
+            log("speculation deliver _ cancel the copy sent to _", k, other);
+            auto result = this->_clients.find(other);
+            if (result != this->_clients.end()) { result->second->cancel_upstream(k); }
+            break;
+        }
+        case r::discard:
+            log("speculation discard _", k);
+            return false;
+    }
+    return true;
+}
+
 auto
 sbnd::socket_pipeline::find_or_create_client(const sys::socket_address& addr) -> client_ptr {
     Expects(addr);
@@ -577,14 +759,131 @@ void sbnd::socket_pipeline::add_client(const sys::socket_address& addr,
                                        const hierarchy_type& hierarchy) {
     Expects(addr);
     auto ptr = this->do_add_client(addr);
-    ptr->nodes_behind(hierarchy.nodes_behind(addr));
+    ptr->nodes_behind(std::make_shared<const hierarchy_node_array>(hierarchy.nodes()),
+                      hierarchy.indices_behind(addr), hierarchy.statistics_behind(addr));
 }
 
 void
 sbnd::socket_pipeline::update_clients(const hierarchy_type& hierarchy) {
+    // each discoverer updates only the clients from its own network
+    const auto interface_address = hierarchy.interface_address();
+    auto in_network = [&interface_address] (const sys::socket_address& sa) {
+        return sa.family() == sys::family_type::inet &&
+            interface_address.contains(
+                sys::socket_address_cast<sys::ipv4_socket_address>(sa).address());
+    };
+    // the nodes are copied once for all clients
+    auto nodes = std::make_shared<const hierarchy_node_array>(hierarchy.nodes());
     for (auto& pair : this->_clients) {
         auto& client = pair.second;
-        client->nodes_behind(hierarchy.nodes_behind(client->socket_address()));
+        const auto& addr = client->socket_address();
+        if (!in_network(addr)) { continue; }
+        client->nodes_behind(nodes, hierarchy.indices_behind(addr),
+                             hierarchy.statistics_behind(addr));
+    }
+    auto& neighbours = this->_tree_neighbours[interface_address];
+    neighbours.clear();
+    if (const auto& sup = hierarchy.superior_socket_address()) {
+        neighbours.emplace_back(sup);
+    }
+    for (const auto& node : hierarchy.subordinates()) {
+        neighbours.emplace_back(node.socket_address());
+    }
+}
+
+auto sbnd::socket_pipeline::tree_neighbours(const sys::socket_address& except) const
+-> socket_address_array {
+    socket_address_array result;
+    for (const auto& pair : this->_tree_neighbours) {
+        for (const auto& a : pair.second) {
+            if (a != except) { result.emplace_back(a); }
+        }
+    }
+    return result;
+}
+
+bool sbnd::socket_pipeline::wait_for_shared_objects(sbn::kernel_ptr& k, hold_targets target,
+                                                    const sys::socket_address& except) {
+    if (!this->_shared_objects || !this->_shared_object_handler) { return false; }
+    // fetch from the neighbour in the direction of the object
+    // or from the node that sent the kernel
+    auto fetch_from = [&] (sbn::shared_object_id id) -> sys::socket_address {
+        auto address = this->_scheduler.object_location(id);
+        return address ? address : k->source();
+    };
+    shared_object_array missing;
+    for (auto id : k->shared_objects()) {
+        // the object is removed when the application exits
+        try {
+            this->_shared_objects->reference(id, k->target_application_id());
+        } catch (const std::exception& err) {
+            log("failed to reference shared object _: _", id, err.what());
+        }
+        if (this->_shared_objects->contains(id)) { continue; }
+        const auto from = fetch_from(id);
+        if (!from || (except && from == except)) { continue; }
+        missing.emplace_back(id);
+    }
+    if (missing.empty()) { return false; }
+    for (auto id : missing) {
+        // fetch each object only once
+        bool requested = false;
+        for (const auto& h : this->_held_kernels) {
+            const auto& m = h.missing;
+            if (std::find(m.begin(), m.end(), id) != m.end()) { requested = true; break; }
+        }
+        if (!requested) { request_shared_object(id, fetch_from(id)); }
+    }
+    log("hold _ until _ shared objects arrive", *k, missing.size());
+    this->_held_kernels.emplace_back(std::move(k), std::move(missing), target);
+    return true;
+}
+
+void sbnd::socket_pipeline::request_shared_object(sbn::shared_object_id id,
+                                                  const sys::socket_address& from) {
+    if (!native_pipeline()) { return; }
+    // the handler becomes the parent of the request and receives the reply
+    sbn::kernel_ptr k(new shared_object_kernel(id));
+    k->principal(this->_shared_object_handler);
+    k->destination(from);
+    k->phase(sbn::kernel::phases::point_to_point);
+    native_pipeline()->send(std::move(k));
+}
+
+void sbnd::socket_pipeline::release_shared_object(sbn::shared_object_id id) {
+    lock_type lock(this->_mutex);
+    held_kernel_array ready;
+    auto first = this->_held_kernels.begin();
+    while (first != this->_held_kernels.end()) {
+        auto& m = first->missing;
+        m.erase(std::remove(m.begin(), m.end(), id), m.end());
+        if (m.empty()) {
+            ready.emplace_back(std::move(*first));
+            first = this->_held_kernels.erase(first);
+        } else {
+            ++first;
+        }
+    }
+    for (auto& h : ready) {
+        auto& k = h.kernel;
+        switch (h.target) {
+            case hold_targets::client: {
+                auto result = this->_clients.find(k->source());
+                if (result == this->_clients.end()) {
+                    forward_foreign(std::move(k));
+                } else {
+                    result->second->route_foreign_kernel(std::move(k));
+                }
+                break;
+            }
+            case hold_targets::local:
+                forward_foreign(std::move(k));
+                break;
+            case hold_targets::schedule:
+                // do not fetch the objects again if the fetch failed
+                forward_upstream(std::move(k), false);
+                break;
+        }
     }
 }
 
@@ -593,6 +892,12 @@ sbn::basic_socket_pipeline{p} {
     this->_max_connection_attempts = p.max_connection_attempts;
     this->_connection_timeout = p.connection_timeout;
     this->_route = p.route;
+    this->_scheduler.policy(p.scheduling_policy);
+    this->_speculation.props(p.speculation);
+    // look for stragglers even if there are no events
+    if (p.speculation.enabled) {
+        wakeup_interval(std::chrono::duration_cast<duration>(p.speculation.interval));
+    }
 }
 
 bool sbnd::socket_pipeline::properties::set(const char* key, const std::string& value) {
@@ -608,6 +913,9 @@ bool sbnd::socket_pipeline::properties::set(const char* key, const std::string&
         connection_timeout = sbn::string_to_duration(value);
     } else if (std::strcmp(key, "route") == 0) {
         route = sbn::string_to_bool(value);
+    } else if (std::strcmp(key, "scheduling-policy") == 0) {
+        scheduling_policy = string_to_scheduling_policy(value);
+    } else if (speculation.set(key, value)) {
     } else {
         found = false;
     }
@@ -669,11 +977,51 @@ void sbnd::socket_pipeline_client::activate(const connection_ptr& self) {
 
 void sbnd::socket_pipeline_client::receive_foreign_kernel(sbn::kernel_ptr&& k) {
     Expects(k);
+    using p = sbn::kernel::phases;
+    if (k->phase() == p::downstream) {
+        if (!parent()->finish_speculation(*k)) {
+            // the result of the other copy was delivered
+            erase_upstream(*k);
+            return;
+        }
+        // only the delivered copy is accounted
+        const auto now = clock_type::now();
+        kernel_completed(now);
+        if (k->deadline_missed(now)) {
+            log("missed deadline _", *k);
+            ++parent()->_num_missed_deadlines;
+        }
+    }
+    if (!k->shared_objects().empty()) {
+        if (k->phase() == p::upstream &&
+            parent()->wait_for_shared_objects(k, socket_pipeline::hold_targets::client)) {
+            return;
+        }
+        if (k->phase() == p::downstream) {
+            // the result is published on the node behind this neighbour
+            for (auto id : k->shared_objects()) {
+                parent()->scheduler().object_location(id, socket_address());
+            }
+        }
+    }
+    route_foreign_kernel(std::move(k));
+}
+
+void sbnd::socket_pipeline_client::route_foreign_kernel(sbn::kernel_ptr&& k) {
+    Expects(k);
+    using p = sbn::kernel::phases;
+    if (k->phase() == p::upstream &&
+        bool(k->flags() & sbn::kernel_flag::send_to_subordinate_node)) {
+        // The copy of the collective kernel is executed on this node
+        // and is copied further to all neighbours except the sender.
+        k->neighbours(parent()->tree_neighbours(k->source()));
+        connection::receive_foreign_kernel(std::move(k));
+        return;
+    }
     if (!route()) {
         connection::receive_foreign_kernel(std::move(k));
         return;
     }
-    using p = sbn::kernel::phases;
     switch (k->phase()) {
         case p::upstream:
             // Route upstream kernels using routing algorithm, i.e.
@@ -696,11 +1044,72 @@ void sbnd::socket_pipeline_client::receive_foreign_kernel(sbn::kernel_ptr&& k) {
     }
 }
 
+auto sbnd::socket_pipeline_client::copy_upstream(const key_array& keys) const
+-> kernel_array {
+    kernel_array copies(keys.size());
+    std::unordered_map<speculation_key,size_t,speculation_key_hash> indices;
+    for (size_t i=0; i<keys.size(); ++i) { indices.emplace(keys[i], i); }
+    for (const auto& k : this->_upstream) {
+        if (indices.empty()) { break; }
+        auto result = indices.find(speculation_key(*k));
+        if (result == indices.end()) { continue; }
+        if (auto* fk = dynamic_cast<const sbn::foreign_kernel*>(k.get())) {
+            copies[result->second] = fk->copy();
+        }
+        indices.erase(result);
+    }
+    return copies;
+}
+
+void sbnd::socket_pipeline_client::erase_upstream(const sbn::kernel& k) {
+    auto result = find_kernel(&k, this->_upstream);
+    if (result != this->_upstream.end()) { this->_upstream.erase(result); }
+}
+
+void sbnd::socket_pipeline_client::cancel_upstream(const sbn::kernel& k) {
+    auto result = find_kernel(&k, this->_upstream);
+    if (result == this->_upstream.end()) { return; }
+    auto& copy = *result;
+    if (!copy->cancellation_sent()) {
+        write_cancellation(copy.get());
+        copy->cancellation_sent(true);
+    }
+    this->_upstream.erase(result);
+}
+
 void sbnd::socket_pipeline_client::write(std::ostream& out) const {
     sbn::connection::write(out);
     using sbn::list;
     using sbn::make_list_view;
-    out << ' ' << list("sum-thread-concurrency", this->_sum_thread_concurrency);
+    out << ' ' << list("sum-thread-concurrency", num_threads_behind());
+    out << ' ' << list("sum-run-queue-length", run_queue_length_behind());
+    out << ' ' << list("sum-free-memory", free_memory_behind());
+    out << ' ' << list("num-nodes-behind", num_nodes_behind());
     out << ' ' << list("route", this->_route);
-    out << ' ' << list("nodes-behind", make_list_view(this->_nodes_behind));
+    out << ' ' << list("completion-interval-us",
+        std::chrono::duration_cast<std::chrono::microseconds>(this->_completion_interval).count());
+    hierarchy_node_array nodes;
+    nodes.reserve(this->_nodes_behind.size());
+    for (auto i : this->_nodes_behind) { nodes.emplace_back((*this->_nodes)[i]); }
+    out << ' ' << list("nodes-behind", make_list_view(nodes));
+}
+
+void sbnd::socket_pipeline_client::kernel_completed(time_point now) noexcept {
+    // measure the interval only while the neighbour is busy
+    if (this->_last_completion != time_point{}) {
+        const auto sample = now - this->_last_completion;
+        if (this->_completion_interval == duration::zero()) {
+            this->_completion_interval = sample;
+        } else {
+            this->_completion_interval = (this->_completion_interval*7 + sample)/8;
+        }
+    }
+    // the returned kernel is still in the upstream queue
+    this->_last_completion = this->_upstream.size() > 1 ? now : time_point{};
+}
+
+void sbnd::socket_pipeline::write(std::ostream& out) const {
+    sbn::basic_socket_pipeline::write(out);
+    using sbn::list;
+    out << ' ' << list("missed-deadlines", this->_num_missed_deadlines);
 }
@@ -1,7 +1,9 @@
 #ifndef SUBORDINATION_DAEMON_SOCKET_PIPELINE_HH
 #define SUBORDINATION_DAEMON_SOCKET_PIPELINE_HH
 
+#include <deque>
 #include <iosfwd>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -14,12 +16,14 @@
 #include <subordination/core/basic_socket_pipeline.hh>
 #include <subordination/core/kernel_instance_registry.hh>
 #include <subordination/core/properties.hh>
+#include <subordination/core/shared_object.hh>
 #include <subordination/core/types.hh>
 #include <subordination/core/weights.hh>
 #include <subordination/daemon/file_system.hh>
 #include <subordination/daemon/hierarchy.hh>
 #include <subordination/daemon/local_server.hh>
 #include <subordination/daemon/socket_pipeline_event.hh>
+#include <subordination/daemon/speculation.hh>
 #include <subordination/daemon/types.hh>
 
 namespace sbnd {
@@ -88,6 +92,15 @@ namespace sbnd {
 
     };
 
+    enum class scheduling_policies: sys::u8 {
+        /// Compare the number of kernels sent to each neighbour.
+        load=0,
+        /// Also take into account run-queue length and free memory of each node.
+        idle=1,
+    };
+
+    auto string_to_scheduling_policy(const std::string& s) -> scheduling_policies;
+
     class socket_pipeline_scheduler {
 
     public:
@@ -100,22 +113,41 @@ namespace sbnd {
         using counter_array = std::array<counter_type,2>;
         using file_system_ptr = std::shared_ptr<file_system>;
         using resource_array = sbn::resources::Bindings;
+        using object_location_table =
+            std::unordered_map<sbn::shared_object_id,sys::socket_address>;
+        using time_point = sbn::kernel::time_point;
 
     private:
         std::vector<file_system_ptr> _file_systems;
         std::vector<sys::socket_address> _nodes;
+        const sbn::shared_object_store* _shared_objects = nullptr;
+        /// The neighbours in the direction of which the shared objects reside.
+        object_location_table _object_locations;
+        /// The order in which the locations were added (the oldest first).
+        std::deque<sbn::shared_object_id> _object_location_order;
+        size_t _max_object_locations = 4096;
         sbn::weight_array _local_load{};
         resource_array _local_resources;
+        scheduling_policies _policy = scheduling_policies::load;
         bool _local = true;
 
     public:
 
+        /**
+        \return the neighbour to which the kernel is sent
+        or the end of the table if the kernel is executed on this node.
+        The kernels with deadline are sent to the neighbours that are expected
+        to finish them in time when there are such neighbours
+        (see \link socket_pipeline_client::expected_completion\endlink).
+        */
         client_iterator schedule(sbn::kernel* k,
                                  const client_table& clients,
                                  const server_array& servers);
 
         inline void local(bool rhs) noexcept { this->_local = rhs; }
         inline bool local() const noexcept { return this->_local; }
+        inline void policy(scheduling_policies rhs) noexcept { this->_policy = rhs; }
+        inline scheduling_policies policy() const noexcept { return this->_policy; }
 
         inline const resource_array& local_resources() const noexcept {
             return this->_local_resources;
@@ -129,8 +161,30 @@ namespace sbnd {
             this->_file_systems.emplace_back(std::move(ptr));
         }
 
+        inline void shared_objects(const sbn::shared_object_store* rhs) noexcept {
+            this->_shared_objects = rhs;
+        }
+
+        /**
+        Remember the neighbour from which the kernel that references
+        the shared object was received. The object resides on this neighbour
+        or on the nodes behind it.
+        */
+        void object_location(sbn::shared_object_id id, const sys::socket_address& address);
+
+        /// \return the neighbour or empty address if the location is not known
+        sys::socket_address object_location(sbn::shared_object_id id) const;
+
         void rebase_counters(const client_table& clients);
 
+        /**
+        \return the least loaded started neighbour that matches the node filter
+        of the kernel, other than the specified one and the one that sent the kernel,
+        or the end of the table if there are no such neighbours
+        */
+        client_iterator least_loaded(const sbn::kernel& k, const client_table& clients,
+                                     const sys::socket_address& except) const;
+
         template <class ... Args>
         inline void
         log(const Args& ... args) const {
@@ -149,12 +203,26 @@ namespace sbnd {
         }
 
         inline sbn::modular_weight_array local_relative_load() const noexcept {
+            using r = sbn::resources::resources;
             sbn::weight_array tmp{local_load()};
+            if (this->_policy == scheduling_policies::idle) {
+                auto n = counter_type(
+                    this->_local_resources[r::run_queue_length].unsigned_integer());
+                if (tmp[1].get() < n) { tmp[1] = n; }
+            }
             auto nthreads = local_num_threads_behind();
             if (nthreads == 0) { nthreads = 1; }
             return sbn::modular_weight_array{{tmp[0],0},{tmp[1]/nthreads,tmp[1]%nthreads}};
         }
 
+        sbn::modular_weight_array relative_load(const socket_pipeline_client& c) const noexcept;
+        bool less_loaded(const socket_pipeline_client& a,
+                         const socket_pipeline_client& b) const noexcept;
+
+        /// \return true if \p a is better than \p b for the kernel \p k
+        bool better(const socket_pipeline_client& a, const socket_pipeline_client& b,
+                    const sbn::kernel& k, time_point now) const noexcept;
+
     };
 
     class socket_pipeline: public sbn::basic_socket_pipeline {
@@ -163,7 +231,9 @@ namespace sbnd {
         struct properties: public sbn::basic_socket_pipeline::properties {
             sys::u32 max_connection_attempts = 1;
             sbn::Duration connection_timeout{std::chrono::seconds(7)};
+            scheduling_policies scheduling_policy = scheduling_policies::load;
             bool route = false;
+            sbnd::speculation::properties speculation;
 
             inline properties():
             properties{sys::this_process::cpus(), sys::page_size()} {}
@@ -192,13 +262,46 @@ namespace sbnd {
         using resource_array = sbn::resources::Bindings;
         using hierarchy_node_array = std::vector<hierarchy_node>;
         using hierarchy_type = Hierarchy<ip_address>;
+        using socket_address_array = sbn::kernel::socket_address_array;
+        using tree_neighbour_table = std::unordered_map<interface_address,socket_address_array>;
+        using shared_object_array = sbn::kernel::shared_object_array;
+
+        /// Where to send the kernel when all shared objects are fetched.
+        enum class hold_targets {
+            /// The kernel was received from the neighbour.
+            client,
+            /// The kernel was scheduled on this node.
+            local,
+            /// The kernel was scheduled on the neighbour that does not have the objects.
+            schedule,
+        };
+
+        /// The kernel that waits for the shared objects to be fetched.
+        struct held_kernel {
+            sbn::kernel_ptr kernel;
+            shared_object_array missing;
+            hold_targets target;
+            inline held_kernel(sbn::kernel_ptr&& k, shared_object_array&& m, hold_targets t):
+            kernel(std::move(k)), missing(std::move(m)), target(t) {}
+        };
+
+        using held_kernel_array = std::vector<held_kernel>;
 
     private:
         server_array _servers;
         client_table _clients;
+        /// The superior and the subordinates of this node for each network interface.
+        tree_neighbour_table _tree_neighbours;
+        sbn::shared_object_store* _shared_objects = nullptr;
+        /// The kernel that fetches shared objects from the neighbours.
+        sbn::kernel* _shared_object_handler = nullptr;
+        held_kernel_array _held_kernels;
         sys::port_type _port = 33333;
         std::chrono::milliseconds _socket_timeout = std::chrono::seconds(7);
         socket_pipeline_scheduler _scheduler;
+        sbnd::speculation _speculation;
+        /// The number of downstream kernels that returned after their deadline.
+        size_t _num_missed_deadlines = 0;
         bool _route = false;
 
     public:
@@ -231,6 +334,37 @@ namespace sbnd {
         inline bool route() const noexcept { return this->_route; }
         inline void route(bool rhs) noexcept { this->_route = rhs; }
 
+        inline const sbnd::speculation& speculation() const noexcept {
+            return this->_speculation;
+        }
+
+        /// The number of downstream kernels that returned after their deadline.
+        inline size_t num_missed_deadlines() const noexcept {
+            auto g = guard();
+            return this->_num_missed_deadlines;
+        }
+
+        /// \return the tree neighbours from all network interfaces except \p except
+        socket_address_array tree_neighbours(const sys::socket_address& except={}) const;
+
+        inline void shared_objects(sbn::shared_object_store* rhs) noexcept {
+            this->_shared_objects = rhs;
+            this->_scheduler.shared_objects(rhs);
+        }
+
+        inline void shared_object_handler(sbn::kernel* rhs) noexcept {
+            this->_shared_object_handler = rhs;
+        }
+
+        /**
+        Deliver the kernels that were waiting for the shared object.
+        The kernels are delivered even if the object was not fetched:
+        the application reports the error when it tries to map the object.
+        */
+        void release_shared_object(sbn::shared_object_id id);
+
+        void write(std::ostream& out) const override;
+
     private:
 
         void remove_client(const sys::socket_address& vaddr);
@@ -260,6 +394,17 @@ namespace sbnd {
 
         void process_kernels() override;
         void process_kernel(sbn::kernel_ptr& k);
+        void forward_upstream(sbn::kernel_ptr&& k, bool fetch_shared_objects);
+        void process_connections() override;
+
+        /// Send the copies of the straggler kernels to the least loaded neighbours.
+        void speculate();
+
+        /**
+        \return true if the downstream kernel should be delivered
+        or false if the result of the other copy was already delivered
+        */
+        bool finish_speculation(const sbn::kernel& k);
 
         client_ptr
         find_or_create_client(const sys::socket_address& addr);
@@ -270,6 +415,17 @@ namespace sbnd {
         client_ptr
         do_add_client(sys::socket&& sock, sys::socket_address vaddr);
 
+        /**
+        Hold the kernel until all shared objects it uses are fetched from
+        the neighbour in the direction of which the objects reside
+        or from the node that sent the kernel.
+        \param[in] except do not fetch the objects that reside behind this neighbour
+        \return true if the kernel was held
+        */
+        bool wait_for_shared_objects(sbn::kernel_ptr& k, hold_targets target,
+                                     const sys::socket_address& except=sys::socket_address());
+        void request_shared_object(sbn::shared_object_id id, const sys::socket_address& from);
+
         template <class ... Args>
         inline void fire_event_kernels(Args&& ... args) {
             if (!native_pipeline()) { return; }
@@ -295,12 +451,23 @@ namespace sbnd {
         using kernel_queue = std::deque<sbn::kernel_ptr>;
         using resource_array = sbn::resources::Bindings;
         using hierarchy_node_array = std::vector<hierarchy_node>;
+        using node_array_ptr = std::shared_ptr<const hierarchy_node_array>;
+        using index_array = socket_pipeline::hierarchy_type::index_array;
+        using kernel_array = std::vector<sbn::kernel_ptr>;
+        using key_array = sbnd::speculation::key_array;
 
     private:
         sys::socket _socket;
         sys::socket_address _old_bind_address;
-        hierarchy_node_array _nodes_behind;
-        counter_type _sum_thread_concurrency{1};
+        /// The copy of the hierarchy nodes that is shared by all clients.
+        node_array_ptr _nodes;
+        /// The indices of the nodes "behind" this node in \link _nodes\endlink.
+        index_array _nodes_behind;
+        hierarchy_statistics _statistics_behind;
+        /// The time at which the last kernel returned while the others were still running.
+        time_point _last_completion{};
+        /// The smoothed interval between the kernels returned from the busy neighbour.
+        duration _completion_interval{};
         bool _route = false;
 
     public:
@@ -347,27 +514,17 @@ namespace sbnd {
         inline bool route() const noexcept { return this->_route; }
         inline void route(bool rhs) noexcept { this->_route = rhs; }
 
-        inline const hierarchy_node_array& nodes_behind() const noexcept {
-            return this->_nodes_behind;
-        }
-
-        inline void nodes_behind(const hierarchy_node_array& rhs) noexcept {
-            this->_nodes_behind = rhs;
-            update_counters();
+        /// The statistics are precomputed by the hierarchy.
+        inline void nodes_behind(node_array_ptr nodes, index_array&& indices,
+                                 const hierarchy_statistics& statistics) noexcept {
+            this->_nodes = std::move(nodes);
+            this->_nodes_behind = std::move(indices);
+            this->_statistics_behind = statistics;
         }
 
-        inline void update_counters() {
-            using r = sbn::resources::resources;
-            counter_type sum = 0;
-            for (const auto& n : this->_nodes_behind) {
-                sum += n.resources()[r::total_threads].unsigned_integer();
-            }
-            this->_sum_thread_concurrency = sum;
-        }
-
-        inline bool match(sbn::kernel::resource_expression& node_filter) {
-            for (const auto& n : this->_nodes_behind) {
-                if (node_filter.evaluate(n.resources()).boolean()) {
+        inline bool match(const sbn::kernel::resource_expression& node_filter) const {
+            for (auto i : this->_nodes_behind) {
+                if (node_filter.evaluate((*this->_nodes)[i].resources()).boolean()) {
                     return true;
                 }
             }
@@ -382,13 +539,41 @@ namespace sbnd {
 
         void receive_foreign_kernel(sbn::kernel_ptr&& k) override;
 
+        /// Route the kernel that has all the shared objects on this node.
+        void route_foreign_kernel(sbn::kernel_ptr&& k);
+
+        /**
+        \return the copies of the upstream kernels that were sent to the neighbour
+        in the same order as the keys (null pointer if there is no such kernel)
+        */
+        kernel_array copy_upstream(const key_array& keys) const;
+
+        /// Forget the upstream kernel the result of which will be discarded.
+        void erase_upstream(const sbn::kernel& k);
+
+        /**
+        Send the cancellation notice for the upstream kernel the result of which
+        will be discarded and forget the kernel.
+        */
+        void cancel_upstream(const sbn::kernel& k);
+
         /// The number of threads "behind" this node in the hierarchy.
         inline counter_type num_threads_behind() const noexcept {
-            return this->_sum_thread_concurrency;
+            return this->_statistics_behind.total_threads();
         }
 
         inline counter_type num_nodes_behind() const noexcept {
-            return this->_sum_thread_concurrency;
+            return this->_statistics_behind.num_nodes();
+        }
+
+        /// The number of runnable threads on the nodes "behind" this node.
+        inline counter_type run_queue_length_behind() const noexcept {
+            return this->_statistics_behind.run_queue_length();
+        }
+
+        /// The amount of available memory on the nodes "behind" this node.
+        inline uint64_t free_memory_behind() const noexcept {
+            return this->_statistics_behind.free_memory();
         }
 
         /**
@@ -410,10 +595,50 @@ namespace sbnd {
                 {tmp[1]/nthreads,tmp[1]%nthreads}};
         }
 
+        /**
+          Same as \link relative_load\endlink, but the number of kernels sent to the
+          client is replaced with the run-queue length of the nodes "behind" the client
+          when the latter is greater. The run queue includes the kernels sent
+          by this node as well as the kernels from other nodes and other processes.
+        */
+        inline sbn::modular_weight_array observed_relative_load() const noexcept {
+            sbn::weight_array tmp{load()};
+            const auto run_queue_length = run_queue_length_behind();
+            if (tmp[1].get() < run_queue_length) { tmp[1] = run_queue_length; }
+            auto num_nodes = num_nodes_behind();
+            if (num_nodes == 0) { num_nodes = 1; }
+            auto nthreads = num_threads_behind();
+            if (nthreads == 0) { nthreads = 1; }
+            return sbn::modular_weight_array{
+                {tmp[0]/num_nodes,tmp[0]%num_nodes},
+                {tmp[1]/nthreads,tmp[1]%nthreads}};
+        }
+
+        /**
+        \return the time at which the kernel that is sent to the neighbour now
+        is expected to return, estimated from the recent throughput of the neighbour
+        and the number of kernels that have not returned yet
+        */
+        inline time_point expected_completion(time_point now) const noexcept {
+            using rep = duration::rep;
+            return now + this->_completion_interval*rep(this->_upstream.size()+1);
+        }
+
+        inline duration completion_interval() const noexcept {
+            return this->_completion_interval;
+        }
+
+        inline void completion_interval(duration rhs) noexcept {
+            this->_completion_interval = rhs;
+        }
+
         void write(std::ostream& out) const override;
 
     private:
 
+        /// Update the throughput estimate when the kernel returns from the neighbour.
+        void kernel_completed(time_point now) noexcept;
+
         void receive_downstream_foreign_kernel(sbn::kernel_ptr&& a) {
             Expects(a);
             auto result = find_kernel(a.get(), this->_upstream);
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <subordination/core/properties.hh>
+#include <subordination/daemon/speculation.hh>
+
+sbnd::speculation_key::speculation_key(const sbn::kernel& k) noexcept:
+id(k.id()), old_id(k.old_id()),
+// the same application id as in sbn::find_kernel
+application_id(k.phase() == sbn::kernel::phases::downstream
+               ? k.source_application_id() : k.target_application_id()) {}
+
+size_t sbnd::speculation_key_hash::operator()(const speculation_key& k) const noexcept {
+    using id_type = speculation_key::id_type;
+    using application_id_type = speculation_key::application_id_type;
+    size_t h = std::hash<id_type>()(k.id);
+    h = h*31 + std::hash<id_type>()(k.old_id);
+    h = h*31 + std::hash<application_id_type>()(k.application_id);
+    return h;
+}
+
+bool sbnd::speculation::properties::set(const char* key, const std::string& value) {
+    bool found = true;
+    if (std::strcmp(key, "speculation") == 0) {
+        enabled = sbn::string_to_bool(value);
+    } else if (std::strcmp(key, "speculation-percentile") == 0) {
+        percentile = std::stod(value);
+        if (!(percentile > 0 && percentile <= 1)) {
+            throw std::out_of_range("percentile is not in (0,1]");
+        }
+    } else if (std::strcmp(key, "speculation-factor") == 0) {
+        factor = std::stod(value);
+        if (!(factor >= 1)) { throw std::out_of_range("factor is less than one"); }
+    } else if (std::strcmp(key, "speculation-min-samples") == 0) {
+        min_samples = std::stoul(value);
+    } else if (std::strcmp(key, "speculation-max-samples") == 0) {
+        max_samples = std::stoul(value);
+    } else if (std::strcmp(key, "speculation-interval") == 0) {
+        interval = std::chrono::duration_cast<duration>(sbn::string_to_duration(value));
+    } else {
+        found = false;
+    }
+    return found;
+}
+
+bool sbnd::speculation::eligible(const sbn::kernel& k) const noexcept {
+    return enabled() &&
+        k.phase() == sbn::kernel::phases::upstream &&
+        k.isset(sbn::kernel_flag::idempotent) &&
+        !k.carries_parent() &&
+        !k.destination();
+}
+
+void sbnd::speculation::start(const sbn::kernel& k,
+                              const sys::socket_address& neighbour,
+                              time_point now) {
+    speculation_key key(k);
+    if (this->_running.find(key) != this->_running.end()) { return; }
+    running_kernel r;
+    r.type = k.type_id();
+    r.start = now;
+    r.original = neighbour;
+    this->_running.emplace(key, r);
+}
+
+auto sbnd::speculation::finish(const sbn::kernel& k,
+                               time_point now,
+                               sys::socket_address& other) -> results {
+    speculation_key key(k);
+    auto result = this->_running.find(key);
+    if (result == this->_running.end()) {
+        auto result2 = this->_discarded.find(key);
+        if (result2 == this->_discarded.end()) { return results::deliver; }
+        this->_discarded.erase(result2);
+        ++this->_num_discarded;
+        return results::discard;
+    }
+    const auto& r = result->second;
+    // the samples are recorded for the first copy only,
+    // otherwise stragglers would raise the threshold
+    const bool copy_won = r.copy && k.source() == r.copy;
+    auto& samples = this->_samples[r.type];
+    samples.emplace_back(now - (copy_won ? r.copy_start : r.start));
+    while (samples.size() > this->_properties.max_samples) { samples.pop_front(); }
+    this->_thresholds.erase(r.type);
+    if (!r.copy) {
+        this->_running.erase(result);
+        return results::deliver;
+    }
+    other = copy_won ? r.original : r.copy;
+    this->_running.erase(result);
+    discard_later(key);
+    return results::deliver_first;
+}
+
+auto sbnd::speculation::threshold(type_id type) const -> duration {
+    auto cached = this->_thresholds.find(type);
+    if (cached != this->_thresholds.end()) { return cached->second; }
+    auto t = duration::max();
+    auto result = this->_samples.find(type);
+    if (result != this->_samples.end()) {
+        const auto& samples = result->second;
+        const auto n = samples.size();
+        if (n != 0 && n >= this->_properties.min_samples) {
+            std::vector<duration> tmp(samples.begin(), samples.end());
+            const auto i = std::min(
+                static_cast<size_t>(std::floor(this->_properties.percentile*(n-1))), n-1);
+            std::nth_element(tmp.begin(), tmp.begin()+i, tmp.end());
+            using rep = duration::rep;
+            t = duration(static_cast<rep>(tmp[i].count()*this->_properties.factor));
+        }
+    }
+    this->_thresholds.emplace(type, t);
+    return t;
+}
+
+auto sbnd::speculation::stragglers(time_point now) const -> key_array {
+    key_array result;
+    if (!enabled()) { return result; }
+    for (const auto& pair : this->_running) {
+        const auto& r = pair.second;
+        if (r.copy || !r.original) { continue; }
+        const auto t = threshold(r.type);
+        if (t != duration::max() && now - r.start > t) { result.emplace_back(pair.first); }
+    }
+    return result;
+}
+
+bool sbnd::speculation::due(time_point now) {
+    if (now - this->_last_check < this->_properties.interval) { return false; }
+    this->_last_check = now;
+    return true;
+}
+
+auto sbnd::speculation::neighbour(const speculation_key& key) const -> sys::socket_address {
+    auto result = this->_running.find(key);
+    if (result == this->_running.end()) { return sys::socket_address(); }
+    return result->second.original;
+}
+
+void sbnd::speculation::copy(const speculation_key& key, const sys::socket_address& neighbour,
+                             time_point now) {
+    auto result = this->_running.find(key);
+    if (result == this->_running.end()) { return; }
+    result->second.copy = neighbour;
+    result->second.copy_start = now;
+    ++this->_num_copies;
+}
+
+void sbnd::speculation::erase(const speculation_key& key) {
+    this->_running.erase(key);
+}
+
+void sbnd::speculation::neighbour_failed(const sys::socket_address& neighbour) {
+    auto first = this->_running.begin();
+    while (first != this->_running.end()) {
+        auto& r = first->second;
+        if (r.copy == neighbour) {
+            r.copy = sys::socket_address();
+        } else if (r.original == neighbour) {
+            if (!r.copy) {
+                // the recovered kernel is scheduled as usual
+                first = this->_running.erase(first);
+                continue;
+            }
+            // the copy becomes the original
+            r.original = r.copy;
+            r.start = r.copy_start;
+            r.copy = sys::socket_address();
+        }
+        ++first;
+    }
+}
+
+bool sbnd::speculation::duplicate(const sbn::kernel& k) const {
+    speculation_key key(k);
+    return this->_running.find(key) != this->_running.end() ||
+        this->_discarded.find(key) != this->_discarded.end();
+}
+
+void sbnd::speculation::discard_later(const speculation_key& key) {
+    if (!this->_discarded.emplace(key).second) { return; }
+    this->_discarded_order.emplace_back(key);
+    // forget the oldest copies (e.g. the results that were lost with the failed node)
+    while (this->_discarded_order.size() > this->_max_discarded) {
+        this->_discarded.erase(this->_discarded_order.front());
+        this->_discarded_order.pop_front();
+    }
+}
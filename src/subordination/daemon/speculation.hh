@@ -0,0 +1,196 @@
+#ifndef SUBORDINATION_DAEMON_SPECULATION_HH
+#define SUBORDINATION_DAEMON_SPECULATION_HH
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <unistdx/net/socket_address>
+
+#include <subordination/core/kernel.hh>
+
+namespace sbnd {
+
+    /**
+    \brief Identifies the kernel sent to the neighbour and its copies.
+    \details The same key is computed for the upstream kernel and for the
+    downstream kernel that returns from the neighbour
+    (see \link sbn::find_kernel\endlink).
+    */
+    struct speculation_key {
+
+        using id_type = sbn::kernel::id_type;
+        using application_id_type = sbn::application::id_type;
+
+        id_type id = 0;
+        id_type old_id = 0;
+        application_id_type application_id = 0;
+
+        speculation_key() = default;
+        explicit speculation_key(const sbn::kernel& k) noexcept;
+
+        inline bool operator==(const speculation_key& rhs) const noexcept {
+            return this->id == rhs.id && this->old_id == rhs.old_id &&
+                this->application_id == rhs.application_id;
+        }
+
+        inline bool operator!=(const speculation_key& rhs) const noexcept {
+            return !this->operator==(rhs);
+        }
+
+    };
+
+    struct speculation_key_hash {
+        size_t operator()(const speculation_key& k) const noexcept;
+    };
+
+    /**
+    \brief Speculative re-execution of straggler kernels.
+    \details
+    The daemon records the time at which each \link sbn::kernel_flag::idempotent\endlink
+    kernel was sent to the neighbour and the completion time of each returned kernel
+    per kernel type. When the kernel runs longer than the configured percentile
+    of the completion time of its type multiplied by the factor, the daemon
+    sends the copy of the kernel to another neighbour. The first result
+    is delivered to the application, the other copy is cancelled and
+    its result is discarded. The completion time of the delivered copy is
+    measured from the time at which this copy was sent. The stragglers are
+    looked for at most once per \link properties::interval\endlink.
+    */
+    class speculation {
+
+    public:
+        /// The completion times are not affected by the adjustments of the wall clock.
+        using clock_type = std::chrono::steady_clock;
+        using duration = clock_type::duration;
+        using time_point = clock_type::time_point;
+        using type_id = sbn::kernel_type::id_type;
+        using key_array = std::vector<speculation_key>;
+
+        struct properties {
+            /// Launch speculative copies of straggler kernels.
+            bool enabled = false;
+            /// The percentile of the completion time of the kernel type.
+            double percentile = 0.95;
+            /// The kernel is a straggler if it runs longer than the percentile times this factor.
+            double factor = 1.5;
+            /// The minimal number of completed kernels of the same type.
+            size_t min_samples = 16;
+            /// The maximal number of recent completion times per kernel type.
+            size_t max_samples = 256;
+            /// How often the daemon looks for the stragglers.
+            duration interval = std::chrono::seconds(1);
+            bool set(const char* key, const std::string& value);
+        };
+
+        /// What to do with the returned kernel.
+        enum class results {
+            /// The kernel was not copied, deliver as usual.
+            deliver,
+            /// The first of the two copies returned, the result of the other copy will be discarded.
+            deliver_first,
+            /// The result of the other copy was already delivered.
+            discard,
+        };
+
+    private:
+        struct running_kernel {
+            type_id type = 0;
+            time_point start{};
+            time_point copy_start{};
+            sys::socket_address original;
+            sys::socket_address copy;
+        };
+
+        using running_kernel_table =
+            std::unordered_map<speculation_key,running_kernel,speculation_key_hash>;
+        using sample_array = std::deque<duration>;
+        using sample_table = std::unordered_map<type_id,sample_array>;
+        using threshold_table = std::unordered_map<type_id,duration>;
+        using key_set = std::unordered_set<speculation_key,speculation_key_hash>;
+
+    private:
+        running_kernel_table _running;
+        sample_table _samples;
+        /// Thresholds that were computed since the last sample of the type.
+        mutable threshold_table _thresholds;
+        time_point _last_check{};
+        /// The kernels whose other copy is still running.
+        key_set _discarded;
+        std::deque<speculation_key> _discarded_order;
+        size_t _max_discarded = 4096;
+        properties _properties;
+        size_t _num_copies = 0;
+        size_t _num_discarded = 0;
+
+    public:
+
+        speculation() = default;
+        inline explicit speculation(const properties& p): _properties(p) {}
+
+        inline bool enabled() const noexcept { return this->_properties.enabled; }
+        inline const properties& props() const noexcept { return this->_properties; }
+        inline void props(const properties& rhs) { this->_properties = rhs; }
+
+        /// \return true if the copy of the kernel may be executed on another node
+        bool eligible(const sbn::kernel& k) const noexcept;
+
+        /// Record the time at which the kernel was sent to the neighbour.
+        void start(const sbn::kernel& k, const sys::socket_address& neighbour, time_point now);
+
+        /**
+        Record the completion time of the returned kernel.
+        \param[out] other the neighbour that executes the other copy of the kernel
+        */
+        results finish(const sbn::kernel& k, time_point now, sys::socket_address& other);
+
+        /// \return the kernels that run longer than the threshold and were not copied
+        key_array stragglers(time_point now) const;
+
+        /// \return true if the \link properties::interval\endlink has passed since the last call
+        bool due(time_point now);
+
+        /// \return the neighbour to which the kernel was sent
+        sys::socket_address neighbour(const speculation_key& key) const;
+
+        /// Record the neighbour that executes the copy of the kernel and the time the copy was sent.
+        void copy(const speculation_key& key, const sys::socket_address& neighbour,
+                  time_point now);
+
+        /// Forget the kernel.
+        void erase(const speculation_key& key);
+
+        /**
+        Forget the copies that were sent to the failed neighbour.
+        The kernels that are recovered from the neighbour are
+        \link duplicate\endlink if the other copy is still running.
+        */
+        void neighbour_failed(const sys::socket_address& neighbour);
+
+        /**
+        \return true if the other copy of the recovered kernel is still running
+        or its result was already delivered
+        */
+        bool duplicate(const sbn::kernel& k) const;
+
+        /**
+        \return the completion time above which the kernel of the type is a straggler
+        or \c duration::max() if there are too few samples
+        */
+        duration threshold(type_id type) const;
+
+        inline size_t num_copies() const noexcept { return this->_num_copies; }
+        inline size_t num_discarded() const noexcept { return this->_num_discarded; }
+        inline size_t num_running() const noexcept { return this->_running.size(); }
+
+    private:
+        void discard_later(const speculation_key& key);
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <subordination/daemon/speculation.hh>
+
+namespace {
+
+    using clock_type = sbnd::speculation::clock_type;
+    using results = sbnd::speculation::results;
+    using std::chrono::seconds;
+
+    const sys::socket_address a(sys::ipv4_socket_address{{10,0,0,1},33333});
+    const sys::socket_address b(sys::ipv4_socket_address{{10,0,0,2},33333});
+
+    void init(sbn::kernel& k, sbn::kernel::id_type id, sbn::kernel::phases phase,
+              const sys::socket_address& source=sys::socket_address()) {
+        k.id(id);
+        k.type_id(7);
+        k.phase(phase);
+        k.setf(sbn::kernel_flag::idempotent);
+        if (source) { k.source(source); }
+    }
+
+    sbnd::speculation::properties make_properties() {
+        sbnd::speculation::properties p;
+        p.enabled = true;
+        p.percentile = 0.5;
+        p.factor = 1.5;
+        p.min_samples = 4;
+        return p;
+    }
+
+}
+
+TEST(speculation, properties) {
+    sbnd::speculation::properties p;
+    EXPECT_FALSE(p.enabled);
+    EXPECT_TRUE(p.set("speculation", "1"));
+    EXPECT_TRUE(p.set("speculation-percentile", "0.9"));
+    EXPECT_TRUE(p.set("speculation-factor", "2"));
+    EXPECT_TRUE(p.set("speculation-min-samples", "10"));
+    EXPECT_TRUE(p.set("speculation-interval", "5s"));
+    EXPECT_FALSE(p.set("route", "1"));
+    EXPECT_TRUE(p.enabled);
+    EXPECT_DOUBLE_EQ(0.9, p.percentile);
+    EXPECT_DOUBLE_EQ(2.0, p.factor);
+    EXPECT_EQ(10u, p.min_samples);
+    EXPECT_EQ(std::chrono::seconds(5), p.interval);
+    EXPECT_THROW(p.set("speculation-percentile", "2"), std::out_of_range);
+    EXPECT_THROW(p.set("speculation-factor", "0.5"), std::out_of_range);
+}
+
+TEST(speculation, eligible) {
+    sbnd::speculation s(make_properties());
+    sbn::kernel k;
+    init(k, 1, sbn::kernel::phases::upstream);
+    EXPECT_TRUE(s.eligible(k));
+    k.destination(a);
+    EXPECT_FALSE(s.eligible(k));
+    sbn::kernel k2;
+    k2.phase(sbn::kernel::phases::upstream);
+    EXPECT_FALSE(s.eligible(k2));
+    sbnd::speculation disabled;
+    EXPECT_FALSE(disabled.eligible(k2));
+}
+
+TEST(speculation, straggler) {
+    sbnd::speculation s(make_properties());
+    const auto t0 = clock_type::now();
+    // the completion times are 1, 2, 3 and 4 seconds,
+    // the median is 2 seconds, the threshold is 3 seconds
+    for (int i=1; i<=4; ++i) {
+        sbn::kernel up, down;
+        init(up, i, sbn::kernel::phases::upstream);
+        init(down, i, sbn::kernel::phases::downstream, a);
+        s.start(up, a, t0);
+        EXPECT_EQ(0u, s.stragglers(t0 + seconds(100)).size());
+        sys::socket_address other;
+        EXPECT_EQ(results::deliver, s.finish(down, t0 + seconds(i), other));
+        EXPECT_FALSE(other);
+    }
+    EXPECT_EQ(seconds(3), s.threshold(7));
+    EXPECT_EQ(sbnd::speculation::duration::max(), s.threshold(8));
+    sbn::kernel up, down_a, down_b;
+    init(up, 10, sbn::kernel::phases::upstream);
+    init(down_a, 10, sbn::kernel::phases::downstream, a);
+    init(down_b, 10, sbn::kernel::phases::downstream, b);
+    s.start(up, a, t0);
+    EXPECT_EQ(0u, s.stragglers(t0 + seconds(2)).size());
+    auto stragglers = s.stragglers(t0 + seconds(4));
+    ASSERT_EQ(1u, stragglers.size());
+    EXPECT_EQ(sbnd::speculation_key(up), stragglers.front());
+    EXPECT_EQ(a, s.neighbour(stragglers.front()));
+    s.copy(stragglers.front(), b, t0 + seconds(4));
+    EXPECT_EQ(0u, s.stragglers(t0 + seconds(5)).size());
+    EXPECT_EQ(1u, s.num_copies());
+    // the copy returns first
+    sys::socket_address other;
+    EXPECT_EQ(results::deliver_first, s.finish(down_b, t0 + seconds(5), other));
+    EXPECT_EQ(a, other);
+    // the completion time of the copy (1 second) is measured from its own start,
+    // the median of 1, 1, 2, 3, 4 seconds is still 2 seconds
+    EXPECT_EQ(seconds(3), s.threshold(7));
+    EXPECT_TRUE(s.duplicate(up));
+    EXPECT_EQ(results::discard, s.finish(down_a, t0 + seconds(6), other));
+    EXPECT_EQ(1u, s.num_discarded());
+    EXPECT_EQ(0u, s.num_running());
+}
+
+TEST(speculation, neighbour_failed) {
+    sbnd::speculation s(make_properties());
+    const auto t0 = clock_type::now();
+    sbn::kernel k1, k2;
+    init(k1, 1, sbn::kernel::phases::upstream);
+    init(k2, 2, sbn::kernel::phases::upstream);
+    s.start(k1, a, t0);
+    s.start(k2, a, t0);
+    s.copy(sbnd::speculation_key(k1), b, t0);
+    s.neighbour_failed(a);
+    // the copy of the first kernel is still running on the other neighbour
+    EXPECT_TRUE(s.duplicate(k1));
+    EXPECT_EQ(b, s.neighbour(sbnd::speculation_key(k1)));
+    // the second kernel is sent again
+    EXPECT_FALSE(s.duplicate(k2));
+    EXPECT_EQ(1u, s.num_running());
+}
+
+TEST(speculation, due) {
+    auto p = make_properties();
+    p.interval = seconds(1);
+    sbnd::speculation s(p);
+    const auto t0 = clock_type::now();
+    EXPECT_TRUE(s.due(t0));
+    EXPECT_FALSE(s.due(t0 + std::chrono::milliseconds(500)));
+    EXPECT_TRUE(s.due(t0 + seconds(1)));
+    EXPECT_FALSE(s.due(t0 + seconds(1)));
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <subordination/daemon/socket_pipeline.hh>
+#include <subordination/test/kernel_collector.hh>
+
+namespace {
+
+    inline sys::socket_address make_address(sys::ipv4_address a) {
+        return sys::ipv4_socket_address{a, 33333};
+    }
+
+    inline sbnd::hierarchy_node make_node(sys::ipv4_address a) {
+        return sbnd::hierarchy_node(make_address(a), sbn::resource_array{});
+    }
+
+    inline sbn::kernel_ptr make_collective_kernel() {
+        sbn::kernel_ptr k(new sbn::kernel);
+        k->setf(sbn::kernel_flag::send_to_subordinate_node);
+        return k;
+    }
+
+}
+
+TEST(socket_pipeline, tree_neighbours) {
+    using hierarchy_type = sbnd::socket_pipeline::hierarchy_type;
+    const auto now = sbnd::hierarchy_node::clock::now();
+    // the node is connected to two networks
+    hierarchy_type a{{{10,0,0,1},16}, 33333};
+    a.add_superior(make_node({10,0,0,2}), now);
+    a.add_subordinate(make_node({10,0,0,3}), now);
+    hierarchy_type b{{{192,168,0,1},24}, 33333};
+    b.add_subordinate(make_node({192,168,0,2}), now);
+    test::Kernel_collector foreign;
+    sbnd::socket_pipeline ppl;
+    ppl.name("remote");
+    ppl.foreign_pipeline(&foreign);
+    {
+        auto g = ppl.guard();
+        ppl.update_clients(a);
+        ppl.update_clients(b);
+    }
+    // the daemon annotates the kernel that came from the application
+    ppl.forward(make_collective_kernel());
+    auto kernels = foreign.wait_for(1);
+    ASSERT_EQ(1u, kernels.size());
+    EXPECT_EQ(3u, kernels.back()->neighbours().size());
+    EXPECT_EQ(2u, ppl.tree_neighbours(make_address({10,0,0,2})).size());
+    // the update of one network does not remove the neighbours from the other
+    a.remove_node(make_address({10,0,0,3}), now);
+    { auto g = ppl.guard(); ppl.update_clients(a); }
+    ppl.forward(make_collective_kernel());
+    kernels = foreign.wait_for(1);
+    ASSERT_EQ(1u, kernels.size());
+    const auto& neighbours = kernels.back()->neighbours();
+    ASSERT_EQ(2u, neighbours.size());
+    EXPECT_NE(neighbours.end(),
+              std::find(neighbours.begin(), neighbours.end(), make_address({192,168,0,2})));
+}
@@ -18,6 +18,7 @@ namespace sbnd {
     class probe;
     class process_pipeline;
     class process_pipeline_kernel;
+    class shared_object_kernel;
     class socket_pipeline;
     class socket_pipeline_client;
     class socket_pipeline_kernel;
@@ -4,6 +4,7 @@
 #include <sstream>
 
 #include <subordination/api.hh>
+#include <subordination/core/generator_kernel.hh>
 #include <subordination/guile/kernel.hh>
 #include <subordination/guile/macros.hh>
 
@@ -90,7 +91,7 @@ namespace {
     SCM kernel_upstream(SCM self, SCM child, SCM pipeline) {
         using namespace sbn::guile;
         auto& kernel = to_kernel_ptr(child);
-        kernel->parent(to_kernel_weak_ptr(self)->get());
+        sbn::make_subordinate(to_kernel_weak_ptr(self)->get(), *kernel);
         symbol_to_pipeline(pipeline)->send(std::move(kernel));
         return SCM_UNSPECIFIED;
     }
@@ -258,7 +259,7 @@ namespace {
 }
 
 void sbn::guile::Kernel_base::upstream(sbn::kernel_ptr&& child, pipeline* ppl) {
-    child->parent(this);
+    sbn::make_subordinate(this, *child);
     this->_children.emplace_back(std::move(child), ppl);
 }
 
@@ -503,8 +504,35 @@ void sbn::guile::Map_kernel::act() {
     const auto last_block_size = block_size + num_kernels%block_size;
     num_kernels /= block_size;
     this->_num_kernels= num_kernels;
-    for (int i=0; i<num_kernels; ++i) {
-        const auto n = i==num_kernels-1 ? last_block_size : block_size;
+    this->_num_blocks = num_kernels;
+    this->_num_generated = 0;
+    this->_block_size_value = block_size;
+    this->_last_block_size = last_block_size;
+    this->_remaining_lists = static_cast<SCM>(this->_lists);
+    generate();
+}
+
+/*
+Children are created on demand: the generation is suspended while the remote
+pipeline is full or too many children are in flight
+and is resumed when the previous children return.
+*/
+void sbn::guile::Map_kernel::generate() {
+    auto& ppl = sbn::factory.remote();
+    const auto max_in_flight = sbn::default_max_children_in_flight(&ppl);
+    std::vector<sbn::kernel_ptr> children;
+    std::vector<SCM> lists;
+    for (SCM s=this->_remaining_lists; s!=SCM_EOL; s=scm_cdr(s)) {
+        lists.emplace_back(scm_car(s));
+    }
+    while (this->_num_generated != this->_num_blocks) {
+        const auto num_in_flight =
+            this->_num_generated - (this->_num_blocks - this->_num_kernels);
+        if (size_t(num_in_flight) >= max_in_flight || (num_in_flight != 0 && ppl.full())) {
+            break;
+        }
+        const auto i = this->_num_generated;
+        const auto n = i==this->_num_blocks-1 ? this->_last_block_size : this->_block_size_value;
         SCM child_lists = SCM_EOL;
         for (auto& parent_list : lists) {
             SCM lst = SCM_EOL;
@@ -519,10 +547,14 @@ void sbn::guile::Map_kernel::act() {
         #if defined(SBN_DEBUG)
         sys::log_message("scm", "make-map-child-kernel _", object_to_string(child_lists));
         #endif
-        auto child = make_pointer<Map_child_kernel>(this->_proc, child_lists, this->_pipeline);
-        child->parent(this);
-        sbn::factory.remote().send(std::move(child));
-    }
+        children.emplace_back(
+            make_pointer<Map_child_kernel>(this->_proc, child_lists, this->_pipeline));
+        ++this->_num_generated;
+    }
+    SCM remaining = SCM_EOL;
+    for (auto it=lists.rbegin(); it!=lists.rend(); ++it) { remaining = scm_cons(*it, remaining); }
+    this->_remaining_lists = remaining;
+    sbn::send_subordinates(this, std::move(children), ppl);
 }
 
 void sbn::guile::Map_kernel::react(sbn::kernel_ptr&& child) {
@@ -532,7 +564,9 @@ void sbn::guile::Map_kernel::react(sbn::kernel_ptr&& child) {
     auto k = sbn::pointer_dynamic_cast<Kernel_base>(std::move(child));
     result(scm_cons(k->result(), result()));
     --this->_num_kernels;
-    if (this->_num_kernels == 0) {
+    if (this->_num_kernels != 0) {
+        generate();
+    } else {
         //scm_write(result(), scm_current_error_port());
         //scm_flush_all_ports();
         auto* ppl = source_pipeline() ? source_pipeline() : &sbn::factory.local();
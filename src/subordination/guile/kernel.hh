@@ -104,6 +104,12 @@ namespace sbn {
             protected_scm _pipeline = SCM_UNSPECIFIED;
             protected_scm _block_size = SCM_UNDEFINED;
             int _num_kernels = 0;
+            // the parts of the lists that were not sent to the children yet
+            protected_scm _remaining_lists = SCM_UNSPECIFIED;
+            int _num_blocks = 0;
+            int _num_generated = 0;
+            int _block_size_value = 1;
+            int _last_block_size = 1;
 
         public:
             Map_kernel() = default;
@@ -116,6 +122,9 @@ namespace sbn {
             void read(sbn::kernel_buffer& in) override;
             void write(sbn::kernel_buffer& out) const override;
 
+        private:
+            void generate();
+
         };
 
         class Map_child_kernel: public Kernel_base {
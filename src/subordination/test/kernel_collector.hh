@@ -0,0 +1,54 @@
+#ifndef SUBORDINATION_TEST_KERNEL_COLLECTOR_HH
+#define SUBORDINATION_TEST_KERNEL_COLLECTOR_HH
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include <subordination/core/kernel.hh>
+#include <subordination/core/pipeline_base.hh>
+#include <subordination/core/types.hh>
+
+namespace test {
+
+    /**
+    \brief Collects the kernels that are sent to the pipeline
+    (e.g. the kernels that are returned to the source node or
+    delivered to the application).
+    */
+    class Kernel_collector: public sbn::pipeline {
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _semaphore;
+        sbn::kernel_ptr_array _kernels;
+
+    public:
+
+        void send(sbn::kernel_ptr&& k) override { forward(std::move(k)); }
+
+        void forward(sbn::kernel_ptr&& k) override {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_kernels.emplace_back(std::move(k));
+            this->_semaphore.notify_all();
+        }
+
+        /**
+        Wait until at least \p n kernels are collected or the timeout expires.
+        \return the kernels that were collected since the previous call
+        */
+        sbn::kernel_ptr_array wait_for(size_t n,
+                                       std::chrono::seconds timeout=std::chrono::seconds(10)) {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_semaphore.wait_for(lock, timeout,
+                                      [this,n] () { return this->_kernels.size() >= n; });
+            sbn::kernel_ptr_array result;
+            result.swap(this->_kernels);
+            return result;
+        }
+
+    };
+
+}
+
+#endif // vim:filetype=cpp